@@ -19,6 +19,7 @@
 #define _XENOMAI_ALCHEMY_BUFFER_H
 
 #include <stdint.h>
+#include <sys/uio.h>
 #include <alchemy/timer.h>
 
 /**
@@ -129,6 +130,54 @@ ssize_t rt_buffer_read(RT_BUFFER *bf,
 				    alchemy_rel_timeout(timeout, &ts));
 }
 
+ssize_t rt_buffer_writev_timed(RT_BUFFER *bf,
+			       const struct iovec *iov, int iovlen,
+			       const struct timespec *abs_timeout);
+
+static inline
+ssize_t rt_buffer_writev_until(RT_BUFFER *bf,
+			       const struct iovec *iov, int iovlen,
+			       RTIME timeout)
+{
+	struct timespec ts;
+	return rt_buffer_writev_timed(bf, iov, iovlen,
+				      alchemy_abs_timeout(timeout, &ts));
+}
+
+static inline
+ssize_t rt_buffer_writev(RT_BUFFER *bf,
+			 const struct iovec *iov, int iovlen,
+			 RTIME timeout)
+{
+	struct timespec ts;
+	return rt_buffer_writev_timed(bf, iov, iovlen,
+				      alchemy_rel_timeout(timeout, &ts));
+}
+
+ssize_t rt_buffer_readv_timed(RT_BUFFER *bf,
+			      const struct iovec *iov, int iovlen,
+			      const struct timespec *abs_timeout);
+
+static inline
+ssize_t rt_buffer_readv_until(RT_BUFFER *bf,
+			      const struct iovec *iov, int iovlen,
+			      RTIME timeout)
+{
+	struct timespec ts;
+	return rt_buffer_readv_timed(bf, iov, iovlen,
+				     alchemy_abs_timeout(timeout, &ts));
+}
+
+static inline
+ssize_t rt_buffer_readv(RT_BUFFER *bf,
+			const struct iovec *iov, int iovlen,
+			RTIME timeout)
+{
+	struct timespec ts;
+	return rt_buffer_readv_timed(bf, iov, iovlen,
+				     alchemy_rel_timeout(timeout, &ts));
+}
+
 int rt_buffer_clear(RT_BUFFER *bf);
 
 int rt_buffer_inquire(RT_BUFFER *bf,
@@ -19,6 +19,7 @@
 #define _XENOMAI_ALCHEMY_QUEUE_H
 
 #include <stdint.h>
+#include <sys/uio.h>
 #include <alchemy/timer.h>
 
 /**
@@ -29,6 +30,7 @@
 /** Creation flags. */
 #define Q_PRIO  0x1	/* Pend by task priority order. */
 #define Q_FIFO  0x0	/* Pend by FIFO order. */
+#define Q_SPSC  0x2	/* Single producer/consumer ring. */
 
 #define Q_UNLIMITED 0	/* No size limit. */
 
@@ -108,6 +110,9 @@ int rt_queue_send(RT_QUEUE *queue,
 int rt_queue_write(RT_QUEUE *queue,
 		   const void *buf, size_t size, int mode);
 
+int rt_queue_write_multi(RT_QUEUE *queue,
+			 const struct iovec *iov, int iovlen, int mode);
+
 ssize_t rt_queue_receive_timed(RT_QUEUE *queue,
 			       void **bufp,
 			       const struct timespec *abs_timeout);
@@ -152,6 +157,30 @@ ssize_t rt_queue_read(RT_QUEUE *queue,
 				   alchemy_rel_timeout(timeout, &ts));
 }
 
+ssize_t rt_queue_read_multi_timed(RT_QUEUE *queue,
+				  struct iovec *iov, int iovlen,
+				  const struct timespec *abs_timeout);
+
+static inline
+ssize_t rt_queue_read_multi_until(RT_QUEUE *queue,
+				  struct iovec *iov, int iovlen,
+				  RTIME timeout)
+{
+	struct timespec ts;
+	return rt_queue_read_multi_timed(queue, iov, iovlen,
+					 alchemy_abs_timeout(timeout, &ts));
+}
+
+static inline
+ssize_t rt_queue_read_multi(RT_QUEUE *queue,
+			    struct iovec *iov, int iovlen,
+			    RTIME timeout)
+{
+	struct timespec ts;
+	return rt_queue_read_multi_timed(queue, iov, iovlen,
+					 alchemy_rel_timeout(timeout, &ts));
+}
+
 int rt_queue_flush(RT_QUEUE *queue);
 
 int rt_queue_inquire(RT_QUEUE *queue,
@@ -22,7 +22,29 @@
 #include <pthread.h>
 #include <boilerplate/list.h>
 
-#define HASHSLOTS  (1<<8)
+/*
+ * Hash tables grow incrementally by linear hashing: once the average
+ * load exceeds HASH_LOADFACTOR objects per bucket, each insertion
+ * splits a single bucket in two, so that there is never any global
+ * rehash. Buckets live in segments of HASHSLOTS entries, the first
+ * one being part of the table descriptor.
+ */
+#define HASH_SEGSHIFT	8
+#define HASHSLOTS	(1<<HASH_SEGSHIFT)
+#define HASH_MAXSEGS	256
+#define HASH_LOADFACTOR	4
+
+struct hash_geometry {
+	/* Per-table seed for the hash function. */
+	unsigned int seed;
+	/* Index mask for the current splitting round. */
+	unsigned int mask;
+	/* Next bucket to split in this round. */
+	unsigned int split;
+	unsigned int nobjs;
+	/* Update sequence, odd while the table is being changed. */
+	unsigned int seq;
+};
 
 struct hashobj {
 	dref_type(const void *) key;
@@ -30,6 +52,7 @@ struct hashobj {
 	char static_key[16];
 #endif
 	size_t len;
+	unsigned int hash;
 	struct holder link;
 };
 
@@ -39,6 +62,8 @@ struct hash_bucket {
 
 struct hash_table {
 	struct hash_bucket table[HASHSLOTS];
+	dref_type(struct hash_bucket *) segments[HASH_MAXSEGS];
+	struct hash_geometry geo;
 	pthread_mutex_t lock;
 };
 
@@ -64,6 +89,7 @@ typedef int (*hash_walk_op)(struct hash_table *t,
 struct pvhashobj {
 	const void *key;
 	size_t len;
+	unsigned int hash;
 	struct pvholder link;
 };
 
@@ -73,6 +99,8 @@ struct pvhash_bucket {
 
 struct pvhash_table {
 	struct pvhash_bucket table[HASHSLOTS];
+	struct pvhash_bucket *segments[HASH_MAXSEGS];
+	struct hash_geometry geo;
 	pthread_mutex_t lock;
 };
 
@@ -113,7 +141,8 @@ static inline void hash_init(struct hash_table *t)
 	__hash_init(__main_heap, t);
 }
 
-void hash_destroy(struct hash_table *t);
+void hash_destroy(struct hash_table *t,
+		  const struct hash_operations *hops);
 
 static inline int hash_enter(struct hash_table *t,
 			     const void *key, size_t len,
@@ -141,6 +170,11 @@ struct hashobj *hash_search(struct hash_table *t,
 int hash_walk(struct hash_table *t,
 	      hash_walk_op walk, void *arg);
 
+static inline unsigned int hash_count(const struct hash_table *t)
+{
+	return t->geo.nobjs;
+}
+
 #ifdef CONFIG_XENO_PSHARED
 
 int __hash_enter_probe(struct hash_table *t,
@@ -179,6 +213,8 @@ struct hashobj *hash_search_probe(struct hash_table *t,
 
 void pvhash_init(struct pvhash_table *t);
 
+void pvhash_destroy(struct pvhash_table *t);
+
 static inline
 int pvhash_enter(struct pvhash_table *t,
 		 const void *key, size_t len,
@@ -209,6 +245,7 @@ int pvhash_walk(struct pvhash_table *t,
 
 #else /* !CONFIG_XENO_PSHARED */
 #define pvhash_init		hash_init
+#define pvhash_destroy(__t)	hash_destroy(__t, NULL)
 #define pvhash_enter		hash_enter
 #define pvhash_enter_dup	hash_enter_dup
 #define pvhash_remove		hash_remove
@@ -82,6 +82,22 @@ struct heapmem_extent {
 	struct heapmem_pgentry pagemap[0]; /* Start of page entries[] */
 };
 
+/*
+ * Optional per-thread caches of bucketed blocks. Threads are spread
+ * over HEAPMEM_MAG_STRIPES magazine sets, each holding up to
+ * HEAPMEM_MAG_DEPTH blocks per log2 size, refilled from and drained
+ * to the heap by batches of HEAPMEM_MAG_BATCH blocks.
+ */
+#define HEAPMEM_MAG_STRIPES	16 /* Must be a power of 2. */
+#define HEAPMEM_MAG_DEPTH	16
+#define HEAPMEM_MAG_BATCH	(HEAPMEM_MAG_DEPTH / 2)
+
+struct heapmem_magazine {
+	pthread_mutex_t lock;
+	int count[HEAPMEM_MAX];
+	void *blocks[HEAPMEM_MAX][HEAPMEM_MAG_DEPTH];
+};
+
 struct heap_memory {
 	pthread_mutex_t lock;
 	struct pvlistobj extents;
@@ -90,6 +106,7 @@ struct heap_memory {
 	size_t used_size;
 	/* Heads of page lists for log2-sized blocks. */
 	uint32_t buckets[HEAPMEM_MAX];
+	struct heapmem_magazine *magazines;
 };
 
 #define __HEAPMEM_MAP_SIZE(__nrpages)					\
@@ -127,6 +144,10 @@ void *heapmem_alloc(struct heap_memory *heap,
 int heapmem_free(struct heap_memory *heap,
 		 void *block);
 
+int heapmem_enable_magazines(struct heap_memory *heap);
+
+void heapmem_flush_magazines(struct heap_memory *heap);
+
 static inline
 size_t heapmem_arena_size(const struct heap_memory *heap)
 {
@@ -139,6 +160,10 @@ size_t heapmem_usable_size(const struct heap_memory *heap)
 	return heap->usable_size;
 }
 
+/*
+ * NOTE: blocks parked in the magazines are accounted as used until
+ * heapmem_flush_magazines() is called.
+ */
 static inline
 size_t heapmem_used_size(const struct heap_memory *heap)
 {
@@ -0,0 +1,67 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+#ifndef _BOILERPLATE_HISTOGRAM_H
+#define _BOILERPLATE_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Log-linear histogram of signed 64bit samples (HDR-style). Values
+ * below 2^sigbits are counted exactly, larger ones fall into buckets
+ * spanning 2^(sigbits-1) subdivisions of each power of two, which
+ * bounds the relative error to 2^(1-sigbits). Negative values are
+ * mirrored. Histograms sharing the same geometry can be merged.
+ */
+struct histogram {
+	int sigbits;
+	int nbuckets;
+	int64_t limit;
+	uint64_t *counts;
+	uint64_t total;
+	int64_t min;
+	int64_t max;
+	double sum;
+	double sumsq;
+};
+
+#define HISTOGRAM_DEFAULT_SIGBITS  7
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int histogram_init(struct histogram *h,
+		   int64_t limit, int sigbits);
+
+void histogram_destroy(struct histogram *h);
+
+void histogram_reset(struct histogram *h);
+
+void histogram_add_count(struct histogram *h,
+			 int64_t value, uint64_t count);
+
+static inline void histogram_add(struct histogram *h, int64_t value)
+{
+	histogram_add_count(h, value, 1);
+}
+
+int histogram_merge(struct histogram *dst,
+		    const struct histogram *src);
+
+int64_t histogram_percentile(const struct histogram *h,
+			     double percent);
+
+double histogram_mean(const struct histogram *h);
+
+double histogram_stddev(const struct histogram *h);
+
+int histogram_dump_json(const struct histogram *h,
+			FILE *fp, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BOILERPLATE_HISTOGRAM_H */
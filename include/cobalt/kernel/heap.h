@@ -21,6 +21,7 @@
 
 #include <linux/string.h>
 #include <linux/rbtree.h>
+#include <linux/percpu.h>
 #include <cobalt/kernel/lock.h>
 #include <cobalt/kernel/list.h>
 #include <cobalt/uapi/kernel/types.h>
@@ -91,6 +92,27 @@ struct xnheap {
 	struct list_head next;
 };
 
+/* Objects moved between a cache and its heap at once. */
+#define XNHEAP_CACHE_BATCH	16
+
+struct xnheap_cache_cpu {
+	/* Only contended when reclaiming memory for the heap. */
+	DECLARE_XNLOCK(lock);
+	void *freelist;
+	int count;
+	unsigned long hits;
+	unsigned long misses;
+};
+
+struct xnheap_cache {
+	struct xnheap *heap;
+	size_t size;
+	int batch;
+	struct xnheap_cache_cpu __percpu *pcpu;
+	char name[XNOBJECT_NAME_LEN];
+	struct list_head next;
+};
+
 extern struct xnheap cobalt_heap;
 
 #define xnmalloc(size)     xnheap_alloc(&cobalt_heap, size)
@@ -133,6 +155,15 @@ ssize_t xnheap_check_block(struct xnheap *heap, void *block);
 void xnheap_set_name(struct xnheap *heap,
 		     const char *name, ...);
 
+int xnheap_cache_init(struct xnheap_cache *cache, struct xnheap *heap,
+		      size_t size, const char *name);
+
+void xnheap_cache_destroy(struct xnheap_cache *cache);
+
+void *xnheap_cache_alloc(struct xnheap_cache *cache);
+
+void xnheap_cache_free(struct xnheap_cache *cache, void *obj);
+
 void *xnheap_vmalloc(size_t size);
 
 void xnheap_vfree(void *p);
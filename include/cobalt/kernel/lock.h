@@ -28,6 +28,19 @@
 /**
  * @addtogroup cobalt_core_lock
  *
+ * Lock ordering: nklock is the outer lock, serializing the
+ * scheduler state, synchronization objects and timer objects.
+ * Finer-grained locks split off from it are leaf locks: they may be
+ * taken with or without nklock held, but no other xnlock may be
+ * acquired while holding them. Only recursion on the same leaf lock
+ * is allowed, which the irqsave/irqrestore forms support.
+ *
+ * Leaf locks currently defined:
+ *
+ * - the per-CPU timer queue lock (struct xntimerdata), guarding the
+ *   queue of outstanding timers each CPU maintains for a clock.
+ *   Timer handlers are always run with this lock dropped.
+ *
  * @{
  */
 #ifdef CONFIG_XENO_OPT_DEBUG_LOCKING
@@ -85,6 +85,27 @@ struct a4l_buffer {
 	/* Theshold below which the user process should not be
 	   awakened */
 	unsigned long wake_count;
+
+	/* Segment size, if the buffer is driven segment per segment
+	   (0 otherwise) */
+	unsigned long seg_size;
+
+	/* Segments handed over to the driver and not committed yet */
+	unsigned long seg_pending;
+};
+
+/* Segment descriptor, filled by a4l_buf_prepare_seg() */
+struct a4l_segment {
+	/* Offset of the segment within the buffer */
+	unsigned long offset;
+	/* Amount of bytes to transfer (a trailing segment may be
+	   shorter than the configured segment size) */
+	unsigned long size;
+	/* Kernel virtual address of the segment */
+	void *vaddr;
+	/* Physical addresses of the segment pages */
+	unsigned long *pg_list;
+	unsigned int nr_pages;
 };
 
 static inline void __dump_buffer_counters(struct a4l_buffer *buf)
@@ -433,6 +454,11 @@ int a4l_buf_evt(struct a4l_subdevice *subd, unsigned long evts);
 
 unsigned long a4l_buf_count(struct a4l_subdevice *subd);
 
+int a4l_buf_prepare_seg(struct a4l_subdevice *subd,
+			struct a4l_segment *seg);
+
+int a4l_buf_commit_seg(struct a4l_subdevice *subd);
+
 /* --- Current Command management function --- */
 
 static inline struct a4l_cmd_desc *a4l_get_cmd(struct a4l_subdevice *subd)
@@ -452,6 +478,8 @@ int a4l_ioctl_bufcfg2(struct a4l_device_context * cxt, void *arg);
 int a4l_ioctl_bufinfo(struct a4l_device_context * cxt, void *arg);
 int a4l_ioctl_bufinfo2(struct a4l_device_context * cxt, void *arg);
 int a4l_ioctl_poll(struct a4l_device_context * cxt, void *arg);
+int a4l_ioctl_segcfg(struct a4l_device_context * cxt, void *arg);
+int a4l_ioctl_segwait(struct a4l_device_context * cxt, void *arg);
 ssize_t a4l_read_buffer(struct a4l_device_context * cxt, void *bufdata, size_t nbytes);
 ssize_t a4l_write_buffer(struct a4l_device_context * cxt, const void *bufdata, size_t nbytes);
 int a4l_select(struct a4l_device_context *cxt,
@@ -403,6 +403,9 @@ int rtdm_fd_valid_p(int ufd);
 int rtdm_fd_select(int ufd, struct xnselector *selector,
 		   unsigned int type);
 
+int __rtdm_fd_select(int ufd, struct xnselector *selector,
+		     unsigned int type, unsigned int index);
+
 int rtdm_device_new_fd(struct rtdm_fd *fd, int ufd,
 		struct rtdm_device *dev);
 
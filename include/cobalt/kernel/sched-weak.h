@@ -36,7 +36,7 @@
 	(XNSCHED_WEAK_MAX_PRIO - XNSCHED_WEAK_MIN_PRIO + 1)
 
 #if XNSCHED_WEAK_NR_PRIO > XNSCHED_CLASS_WEIGHT_FACTOR ||	\
-	(defined(CONFIG_XENO_OPT_SCALABLE_SCHED) &&		\
+	(defined(CONFIG_XENO_OPT_SCHED_MLQ) &&		\
 	 XNSCHED_WEAK_NR_PRIO > XNSCHED_MLQ_LEVELS)
 #error "WEAK class has too many priority levels"
 #endif
@@ -28,9 +28,11 @@
 
 #define XNSCHED_CLASS_WEIGHT_FACTOR	1024
 
-#ifdef CONFIG_XENO_OPT_SCALABLE_SCHED
+#ifdef CONFIG_XENO_OPT_SCHED_MLQ
 
 #include <linux/bitmap.h>
+#include <linux/bitops.h>
+#include <linux/cache.h>
 
 /*
  * Multi-level priority queue, suitable for handling the runnable
@@ -40,12 +42,32 @@
  */
 #define XNSCHED_MLQ_LEVELS  260	/* i.e. XNSCHED_CORE_NR_PRIO */
 
+#ifdef CONFIG_XENO_OPT_SCHED_BITMAP
+
+/*
+ * Bitmap-indexed variant: bit #n of the summary word is set when
+ * word #n of the priority map is non-zero. The lookup metadata fit
+ * in the leading cache line, the list heads follow.
+ */
+#define XNSCHED_MLQ_WORDS  BITS_TO_LONGS(XNSCHED_MLQ_LEVELS)
+
+struct xnsched_mlq {
+	int elems;
+	unsigned long summary;
+	DECLARE_BITMAP(prio_map, XNSCHED_MLQ_LEVELS);
+	struct list_head heads[XNSCHED_MLQ_LEVELS];
+} ____cacheline_aligned;
+
+#else /* !CONFIG_XENO_OPT_SCHED_BITMAP */
+
 struct xnsched_mlq {
 	int elems;
 	DECLARE_BITMAP(prio_map, XNSCHED_MLQ_LEVELS);
 	struct list_head heads[XNSCHED_MLQ_LEVELS];
 };
 
+#endif /* !CONFIG_XENO_OPT_SCHED_BITMAP */
+
 struct xnthread;
 
 void xnsched_initq(struct xnsched_mlq *q);
@@ -68,12 +90,23 @@ static inline int xnsched_emptyq_p(struct xnsched_mlq *q)
 
 static inline int xnsched_weightq(struct xnsched_mlq *q)
 {
+#ifdef CONFIG_XENO_OPT_SCHED_BITMAP
+	int w;
+
+	if (q->summary == 0)
+		return XNSCHED_MLQ_LEVELS;
+
+	w = __ffs(q->summary);
+
+	return w * BITS_PER_LONG + __ffs(q->prio_map[w]);
+#else
 	return find_first_bit(q->prio_map, XNSCHED_MLQ_LEVELS);
+#endif
 }
 
 typedef struct xnsched_mlq xnsched_queue_t;
 
-#else /* ! CONFIG_XENO_OPT_SCALABLE_SCHED */
+#else /* !CONFIG_XENO_OPT_SCHED_MLQ */
 
 typedef struct list_head xnsched_queue_t;
 
@@ -97,7 +130,7 @@ typedef struct list_head xnsched_queue_t;
 	})
 	
 
-#endif /* !CONFIG_XENO_OPT_SCALABLE_SCHED */
+#endif /* !CONFIG_XENO_OPT_SCHED_MLQ */
 
 struct xnthread *xnsched_findq(xnsched_queue_t *q, int prio);
 
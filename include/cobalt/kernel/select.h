@@ -31,6 +31,25 @@
 #define XNSELECT_WRITE     1
 #define XNSELECT_EXCEPT    2
 #define XNSELECT_MAX_TYPES 3
+/* Pseudo event type reporting a descriptor gone (poller mode only). */
+#define XNSELECT_HUP       XNSELECT_MAX_TYPES
+
+/*
+ * Per-descriptor state of a selector in poller mode. Event types are
+ * tracked as bitmasks of (1 << XNSELECT_*).
+ */
+struct xnselect_item {
+	unsigned int expected;
+	unsigned int pending;
+	unsigned long seq;	  /* last xnselect_poll() pass reporting it. */
+	struct list_head link;	  /* link in selector ready list. */
+	struct list_head bindings; /* bindings on this item. */
+};
+
+struct xnselect_event {
+	unsigned int index;
+	unsigned int events;
+};
 
 struct xnselector {
 	struct xnsynch synchbase;
@@ -40,6 +59,11 @@ struct xnselector {
 	} fds [XNSELECT_MAX_TYPES];
 	struct list_head destroy_link;
 	struct list_head bindings; /* only used by xnselector_destroy */
+	/* Poller mode, see xnselector_init_poller(). */
+	struct xnselect_item *items;
+	unsigned int nr_items;
+	unsigned long seq;
+	struct list_head ready;
 };
 
 #define __NFDBITS__	(8 * sizeof(unsigned long))
@@ -83,6 +107,8 @@ static inline void __FD_ZERO__(__kernel_fd_set *__p)
 
 struct xnselect {
 	struct list_head bindings;
+	/* Optional, tells whether the descriptor is still ready. */
+	unsigned int (*probe)(struct xnselect *select_block);
 };
 
 #define DECLARE_XNSELECT(name) struct xnselect name
@@ -98,6 +124,9 @@ struct xnselect_binding {
 
 void xnselect_init(struct xnselect *select_block);
 
+void xnselect_init_probe(struct xnselect *select_block,
+			 unsigned int (*probe)(struct xnselect *select_block));
+
 int xnselect_bind(struct xnselect *select_block,
 		  struct xnselect_binding *binding,
 		  struct xnselector *selector,
@@ -130,6 +159,16 @@ void xnselect_destroy(struct xnselect *select_block);
 
 int xnselector_init(struct xnselector *selector);
 
+int xnselector_init_poller(struct xnselector *selector,
+			   unsigned int nr_items);
+
+void xnselector_unbind(struct xnselector *selector, unsigned int index);
+
+int xnselect_poll(struct xnselector *selector,
+		  struct xnselect_event *events, int maxevents,
+		  unsigned long *seqp,
+		  xnticks_t timeout, xntmode_t timeout_mode);
+
 int xnselect(struct xnselector *selector,
 	     fd_set *out_fds[XNSELECT_MAX_TYPES],
 	     fd_set *in_fds[XNSELECT_MAX_TYPES],
@@ -189,6 +189,15 @@ struct xnthread {
 		xnstat_counter_t pf;	/* Number of page faults */
 		xnstat_exectime_t account; /* Execution time accounting entity */
 		xnstat_exectime_t lastperiod; /* Interval marker for execution time reports */
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALLS
+		struct {
+			unsigned long gen; /* Reset generation */
+			unsigned long count;
+			xnticks_t total; /* ns */
+			xnticks_t max;	/* ns */
+			int max_nr;	/* Syscall which took max */
+		} sc;		/* Syscall latency accounting */
+#endif
 	} stat;
 
 	struct xnselector *selector;    /* For select. */
@@ -216,6 +216,11 @@ struct xnsched;
 
 struct xntimerdata {
 	xntimerq_t q;
+	/*
+	 * Guards q. This is a leaf lock nested into nklock, see
+	 * lock.h for the ordering rules.
+	 */
+	DECLARE_XNLOCK(lock);
 };
 
 static inline struct xntimerdata *
@@ -302,14 +307,14 @@ static inline struct xnsched *xntimer_sched(struct xntimer *timer)
 #define xntimer_sched(t)	xnsched_current()
 #endif /* !CONFIG_SMP */
 
-#define xntimer_percpu_queue(__timer)					\
+#define xntimer_percpu_data(__timer)					\
 	({								\
-		struct xntimerdata *tmd;				\
 		int cpu = xnsched_cpu((__timer)->sched);		\
-		tmd = xnclock_percpu_timerdata(xntimer_clock(__timer), cpu); \
-		&tmd->q;						\
+		xnclock_percpu_timerdata(xntimer_clock(__timer), cpu);	\
 	})
 
+#define xntimer_percpu_queue(__timer)	(&xntimer_percpu_data(__timer)->q)
+
 static inline unsigned long xntimer_gravity(struct xntimer *timer)
 {
 	struct xnclock *clock = xntimer_clock(timer);
@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _COBALT_KERNEL_TRACERING_H
+#define _COBALT_KERNEL_TRACERING_H
+
+#include <linux/types.h>
+#include <cobalt/uapi/kernel/tracering.h>
+
+struct xnthread;
+struct xntimer;
+struct vm_area_struct;
+
+#ifdef CONFIG_XENO_OPT_TRACE_RING
+
+void xntrace_ring_log(int type, struct xnthread *thread,
+		      __u32 arg0, __u32 arg1);
+
+void xntrace_ring_log_timer(struct xntimer *timer);
+
+int xntrace_ring_mmap(struct vm_area_struct *vma);
+
+size_t xntrace_ring_get_size(void);
+
+int xntrace_ring_init(void);
+
+void xntrace_ring_cleanup(void);
+
+#else /* !CONFIG_XENO_OPT_TRACE_RING */
+
+static inline void xntrace_ring_log(int type, struct xnthread *thread,
+				    __u32 arg0, __u32 arg1)
+{ }
+
+static inline void xntrace_ring_log_timer(struct xntimer *timer) { }
+
+static inline int xntrace_ring_init(void)
+{
+	return 0;
+}
+
+static inline void xntrace_ring_cleanup(void) { }
+
+#endif /* !CONFIG_XENO_OPT_TRACE_RING */
+
+#endif /* !_COBALT_KERNEL_TRACERING_H */
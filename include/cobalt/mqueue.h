@@ -22,6 +22,7 @@
 #define _COBALT_MQUEUE_H
 
 #include <cobalt/wrappers.h>
+#include <cobalt/uapi/mqueue.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -67,6 +68,17 @@ COBALT_DECL(ssize_t, mq_timedreceive(mqd_t q,
 COBALT_DECL(int, mq_notify(mqd_t q,
 			   const struct sigevent *evp));
 
+int mq_slot_alloc_np(mqd_t q, void **bufp,
+		     const struct timespec *abs_timeout);
+
+int mq_slot_send_np(mqd_t q, int slot, size_t len, unsigned prio);
+
+ssize_t mq_slot_receive_np(mqd_t q, int *slotp, void **bufp,
+			   unsigned *prio,
+			   const struct timespec *abs_timeout);
+
+int mq_slot_free_np(mqd_t q, int slot);
+
 #ifdef __cplusplus
 }
 #endif
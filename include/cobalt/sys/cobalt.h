@@ -37,6 +37,7 @@
 #include <cobalt/uapi/thread.h>
 #include <cobalt/uapi/cond.h>
 #include <cobalt/uapi/sem.h>
+#include <cobalt/uapi/poller.h>
 #include <cobalt/ticks.h>
 
 #define cobalt_commit_memory(p) __cobalt_commit_memory(p, sizeof(*p))
@@ -124,6 +125,14 @@ int cobalt_event_inquire(cobalt_event_t *event,
 
 int cobalt_event_destroy(cobalt_event_t *event);
 
+int cobalt_poller_create(int size, int flags);
+
+int cobalt_poller_ctl(int pfd, int op, int fd,
+		      const struct cobalt_poll_event *event);
+
+int cobalt_poller_wait(int pfd, struct cobalt_poll_event *events,
+		       int maxevents, const struct timespec *timeout);
+
 int cobalt_sem_inquire(sem_t *sem, struct cobalt_sem_info *info,
 		       pid_t *waitlist, size_t waitsz);
 
@@ -62,6 +62,12 @@
 #   define _CC_COBALT_NET_CAP		0x00000800
 #   define _CC_COBALT_NET_PROXY		0x00001000
 
+#define _CC_COBALT_SYSSTAT		10
+#   define _CC_COBALT_SYSSTAT_QUERY	0
+#   define _CC_COBALT_SYSSTAT_OFF	1
+#   define _CC_COBALT_SYSSTAT_ON	2
+#   define _CC_COBALT_SYSSTAT_RESET	3
+
 
 enum cobalt_run_states {
 	COBALT_STATE_DISABLED,
@@ -25,6 +25,8 @@ struct cobalt_event_state {
 	__u32 flags;
 #define COBALT_EVENT_PENDED  0x1
 	__u32 nwaiters;
+	/* Union of the bits sleepers wait for. */
+	__u32 waitmask;
 };
 
 struct cobalt_event;
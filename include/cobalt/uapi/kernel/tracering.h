@@ -0,0 +1,65 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _COBALT_UAPI_KERNEL_TRACERING_H
+#define _COBALT_UAPI_KERNEL_TRACERING_H
+
+#include <linux/types.h>
+
+#define COBALT_MEMDEV_TRACE  "memdev-trace"
+
+/*
+ * The trace area starts with a header page, followed by one ring per
+ * CPU, each ring_size bytes long. The CPU owning a ring is its only
+ * writer; readers map the area read-only.
+ */
+#define COBALT_TRACE_MAGIC  0x434f5452	/* "COTR" */
+
+struct cobalt_trace_header {
+	__u32 magic;
+	__u32 nr_cpus;
+	__u32 nr_events;	/* Per ring, power of 2. */
+	__u32 ring_size;
+	__u64 clock_freq;	/* Timestamps are raw clock ticks. */
+};
+
+#define COBALT_TRACE_SWITCH	1 /* pid: next, arg0: prev, arg1: prio */
+#define COBALT_TRACE_WAKEUP	2 /* pid: woken, arg0: mask, arg1: prio */
+#define COBALT_TRACE_RELAX	3 /* pid: thread, arg0: reason */
+#define COBALT_TRACE_HARDEN	4 /* pid: thread */
+#define COBALT_TRACE_TIMER	5 /* arg0: opaque timer id */
+
+struct cobalt_trace_event {
+	/*
+	 * Position of the event in the ring plus one, zero while the
+	 * slot is being written. A reader must find the same value
+	 * before and after copying the slot.
+	 */
+	__u64 seq;
+	__u64 stamp;
+	__u32 type;
+	__s32 pid;
+	__u32 arg0;
+	__u32 arg1;
+};
+
+struct cobalt_trace_ring {
+	__u64 head;		/* Count of events written so far. */
+	__u32 cpu;
+	__u32 __pad[13];
+	struct cobalt_trace_event events[0];
+};
+
+#endif /* !_COBALT_UAPI_KERNEL_TRACERING_H */
@@ -56,6 +56,8 @@ struct xnvdso {
 
 #define XNVDSO_FEAT_HOST_REALTIME	0x0000000000000001ULL
 #define XNVDSO_FEAT_WALLCLOCK_OFFSET	0x0000000000000002ULL
+/* Event trace rings can be mapped from COBALT_MEMDEV_TRACE. */
+#define XNVDSO_FEAT_TRACE_RING		0x0000000000000004ULL
 
 static inline int xnvdso_test_feature(struct xnvdso *vdso,
 				      __u64 feature)
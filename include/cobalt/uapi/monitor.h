@@ -28,6 +28,8 @@ struct cobalt_monitor_state {
 #define COBALT_MONITOR_SIGNALED   0x03 /* i.e. GRANTED or DRAINED */
 #define COBALT_MONITOR_BROADCAST  0x04
 #define COBALT_MONITOR_PENDED     0x08
+#define COBALT_MONITOR_GRANTWAIT  0x10 /* Threads wait for a grant. */
+#define COBALT_MONITOR_DRAINWAIT  0x20 /* Threads wait for a drain. */
 };
 
 struct cobalt_monitor;
@@ -0,0 +1,38 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _COBALT_UAPI_MQUEUE_H
+#define _COBALT_UAPI_MQUEUE_H
+
+#include <cobalt/uapi/kernel/types.h>
+
+/*
+ * Creation flag (mq_attr.mq_flags): the message slots are laid out
+ * in the shared heap, so that messages can be passed by slot.
+ */
+#define COBALT_MQ_ZEROCOPY  0x40000000
+
+struct cobalt_mq_slot {
+	/* In: absolute CLOCK_REALTIME timeout (ns), 0 waits forever. */
+	__u64 timeout;
+	/* Out: slot index and payload offset in the shared heap. */
+	__s32 slot;
+	__u32 offset;
+	/* Out: received message length and priority. */
+	__u32 len;
+	__u32 prio;
+};
+
+#endif /* !_COBALT_UAPI_MQUEUE_H */
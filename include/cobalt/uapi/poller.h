@@ -0,0 +1,42 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _COBALT_UAPI_POLLER_H
+#define _COBALT_UAPI_POLLER_H
+
+#include <linux/types.h>
+
+/* Event bits, matching (1 << XNSELECT_*) in the core. */
+#define COBALT_POLLIN	0x1
+#define COBALT_POLLOUT	0x2
+#define COBALT_POLLPRI	0x4
+/* Descriptor closed while watched, never requested. */
+#define COBALT_POLLHUP	0x8
+
+/* Interest set operations. */
+#define COBALT_POLLER_ADD  1
+#define COBALT_POLLER_DEL  2
+#define COBALT_POLLER_MOD  3
+
+/* Largest interest set. */
+#define COBALT_POLLER_MAX  8192
+
+struct cobalt_poll_event {
+	__u32 events;
+	__u32 __pad;
+	__u64 data;
+};
+
+#endif /* !_COBALT_UAPI_POLLER_H */
@@ -135,6 +135,13 @@
 #define sc_cobalt_monitor_wait64		112
 #define sc_cobalt_event_wait64			113
 #define sc_cobalt_recvmmsg64			114
+#define sc_cobalt_mq_slot_alloc			115
+#define sc_cobalt_mq_slot_send			116
+#define sc_cobalt_mq_slot_receive		117
+#define sc_cobalt_mq_slot_free			118
+#define sc_cobalt_poller_create			119
+#define sc_cobalt_poller_ctl			120
+#define sc_cobalt_poller_wait			121
 
 #define __NR_COBALT_SYSCALLS			128 /* Power of 2 */
 
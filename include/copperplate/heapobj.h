@@ -128,6 +128,11 @@ static inline void pvfree(void *ptr)
 	tlsf_free(ptr);
 }
 
+static inline size_t pvvalidate(void *ptr)
+{
+	return malloc_usable_size_ex(ptr, NULL);
+}
+
 static inline char *pvstrdup(const char *ptr)
 {
 	char *str;
@@ -196,6 +201,12 @@ static inline void pvfree(void *ptr)
 	heapmem_free(&heapmem_main, ptr);
 }
 
+static inline size_t pvvalidate(void *ptr)
+{
+	ssize_t size = heapmem_check(&heapmem_main, ptr);
+	return size < 0 ? 0 : size;
+}
+
 static inline char *pvstrdup(const char *ptr)
 {
 	char *str;
@@ -210,6 +221,7 @@ static inline char *pvstrdup(const char *ptr)
 #else /* !CONFIG_XENO_HEAPMEM, i.e. malloc */
 
 #include <stdlib.h>
+#include <malloc.h>
 
 static inline void *pvmalloc(size_t size)
 {
@@ -227,6 +239,18 @@ static inline void pvfree(void *ptr)
 	__STD(free(ptr));
 }
 
+static inline size_t pvvalidate(void *ptr)
+{
+	/*
+	 * Catch trivially wrong cases only: NULL or unaligned. glibc
+	 * has no way to tell whether a block is busy.
+	 */
+	if (ptr == NULL || ((unsigned long)ptr & (sizeof(unsigned long)-1)))
+		return 0;
+
+	return malloc_usable_size(ptr);
+}
+
 static inline char *pvstrdup(const char *ptr)
 {
 	return strdup(ptr);
@@ -384,6 +408,8 @@ void *xnmalloc(size_t size);
 
 void xnfree(void *ptr);
 
+size_t xnvalidate(void *ptr);
+
 char *xnstrdup(const char *ptr);
 
 #else /* !CONFIG_XENO_PSHARED */
@@ -509,6 +535,11 @@ static inline void xnfree(void *ptr)
 	pvfree(ptr);
 }
 
+static inline size_t xnvalidate(void *ptr)
+{
+	return pvvalidate(ptr);
+}
+
 static inline char *xnstrdup(const char *ptr)
 {
 	return pvstrdup(ptr);
@@ -31,6 +31,7 @@ struct timerobj {
 	pthread_mutex_t lock;
 	int cancel_state;
 	struct pvholder next;
+	int spot;
 };
 
 static inline int timerobj_lock(struct timerobj *tmobj)
@@ -253,6 +253,23 @@ u_long q_vbroadcast(u_long qid,
 		    u_long msglen,
 		    u_long *count_r);
 
+u_long q_vgetbuf(u_long qid,
+		 u_long msglen,
+		 void **bufaddr);
+
+u_long q_vsendbuf(u_long qid,
+		  void *buf,
+		  u_long msglen);
+
+u_long q_vreceivebuf(u_long qid,
+		     u_long flags,
+		     u_long timeout,
+		     void **bufaddr,
+		     u_long *msglen_r);
+
+u_long q_vretbuf(u_long qid,
+		 void *buf);
+
 u_long rn_create(const char *name,
 		 void *saddr,
 		 u_long rnsize,
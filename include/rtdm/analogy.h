@@ -176,6 +176,13 @@ int a4l_poll(a4l_desc_t *dsc,
 int a4l_mmap(a4l_desc_t *dsc,
 	     unsigned int idx_subd, unsigned long size, void **ptr);
 
+int a4l_set_segsize(a4l_desc_t *dsc, unsigned long size);
+
+int a4l_wait_segments(a4l_desc_t *dsc,
+		      unsigned int idx_subd, unsigned long release,
+		      unsigned long ms_timeout,
+		      unsigned long *offset, unsigned long *count);
+
 int a4l_async_read(a4l_desc_t *dsc,
 		   void *buf, size_t nbyte, unsigned long ms_timeout);
 
@@ -126,11 +126,17 @@
  * @n
  * @n
  * @anchor Recv
- * <b>Recv, Recvfrom, Recvmsg</b> @n
+ * <b>Recv, Recvfrom, Recvmsg, Recvmmsg</b> @n
  * These functions receive CAN messages from a socket. Only one
  * message per call can be received, so only one buffer with the correct length
  * must be passed. For @c SOCK_RAW, this is the size of struct can_frame. @n
  * @n
+ * Recvmmsg receives a burst of messages in a single call, each entry of the
+ * message vector being filled like by Recvmsg, including its own timestamp.
+ * Combined with @c MSG_WAITFORONE, the call blocks until the first message
+ * arrives, then returns it along with all messages already queued up to the
+ * vector length. @n
+ * @n
  * Unlike a call to one of the @ref Send functions, a Recv function will not
  * return with an error if an interface is down (due to bus-off or setting
  * of stop mode) or in sleep mode. Moreover, in such a case there may still
@@ -155,6 +161,7 @@
  *                 specified by @ref RTCAN_RTIOC_RCV_TIMEOUT.)
  * - MSG_PEEK     (Receive a message but leave it in the socket buffer. The
  *                 next receive operation will get that message again.)
+ * - MSG_WAITFORONE (Recvmmsg only, see above.)
  * .
  * @n
  * Supported Flags [out]: none @n
@@ -179,11 +186,16 @@
  * @n
  * @n
  * @anchor Send
- * <b>Send, Sendto, Sendmsg</b> @n
+ * <b>Send, Sendto, Sendmsg, Sendmmsg</b> @n
  * These functions send out CAN messages. Only one message per call can
  * be transmitted, so only one buffer with the correct length must be passed.
  * For @c SOCK_RAW, this is the size of struct can_frame. @n
  * @n
+ * Sendmmsg transmits a burst of messages in a single call, each entry of the
+ * message vector being processed like by Sendmsg. It stops at the first
+ * message which cannot be sent, returning the number of messages sent so far
+ * if any, the error otherwise. @n
+ * @n
  * The following only applies to @c SOCK_RAW: If a socket address of
  * struct sockaddr_can is given, only @c can_ifindex is used. It is also
  * possible to omit the socket address. Then the interface the socket is
@@ -75,6 +75,27 @@ struct a4l_buffer_config2 {
 };
 typedef struct a4l_buffer_config2 a4l_bufcfg2_t;
 
+/* SEGCFG ioctl argument structure */
+struct a4l_segment_config {
+	unsigned long seg_size;
+	unsigned long reserved[3];
+};
+typedef struct a4l_segment_config a4l_segcfg_t;
+
+/* SEGWAIT ioctl argument structure */
+struct a4l_segment_wait {
+	unsigned int idx_subd;
+	/* In: segments handed back to the driver */
+	unsigned long release;
+	/* In: timeout in ms, A4L_INFINITE or A4L_NONBLOCK */
+	unsigned long timeout;
+	/* Out: offset of the first ready segment in the mapping */
+	unsigned long offset;
+	/* Out: amount of bytes ready from this offset */
+	unsigned long count;
+};
+typedef struct a4l_segment_wait a4l_segwait_t;
+
 /* POLL ioctl argument structure */
 struct a4l_poll {
 	unsigned int idx_subd;
@@ -123,6 +144,12 @@ typedef struct a4l_dev_info a4l_dvinfo_t;
 #define A4L_BUFCFG2 _IOR(CIO,15,a4l_bufcfg_t)
 #define A4L_BUFINFO2 _IOWR(CIO,16,a4l_bufcfg_t)
 
+/* Segmented ring-buffer: the buffer is split into equally sized
+   segments which the driver fills in place and the application
+   consumes in place through the A4L_MMAP mapping */
+#define A4L_SEGCFG _IOR(CIO,17,a4l_segcfg_t)
+#define A4L_SEGWAIT _IOWR(CIO,18,a4l_segwait_t)
+
 /*!
  * @addtogroup analogy_lib_async1
  * @{
@@ -765,6 +765,84 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define IDDP_POOLSZ		2
+/**
+ * IDDP message slab configuration
+ *
+ * When set, the local pool configured with @ref IDDP_POOLSZ is
+ * carved into fixed-size message slots at binding time, instead of
+ * being managed by a general purpose allocator. Picking and
+ * releasing a slot is then a constant-time list operation. Datagrams
+ * larger than the slot size are rejected with -EMSGSIZE by the
+ * sending side.
+ *
+ * A local pool size must be configured with this option, which must
+ * be large enough to hold at least one slot, otherwise binding fails
+ * with -EINVAL.
+ *
+ * It is not allowed to configure a slot size after the socket was
+ * bound. However, multiple configuration calls are allowed prior to
+ * the binding; the last value set will be used.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_MSGSZ
+ * @param [in] optval Pointer to a variable of type size_t, containing
+ * the largest datagram size the socket should receive
+ * @param [in] optlen sizeof(size_t)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid, or *@a optval is zero or too large)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_MSGSZ		3
+/**
+ * IDDP fan-out destination set
+ *
+ * Once a non-empty set of destination ports is attached to a socket,
+ * datagrams sent without an explicit destination address (e.g. with
+ * write(2)) are delivered to every bound port of the set. The payload
+ * is copied once into a buffer obtained from the Cobalt system heap,
+ * which all receivers share by reference; the buffer is released
+ * when the last receiver has consumed the datagram. All receivers
+ * are woken up in a single rescheduling pass.
+ *
+ * Ports of the set which are not bound at the time of the call are
+ * skipped. Sending fails with -ECONNREFUSED if none of them is
+ * bound. An empty set restores the regular default destination.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_FANOUT
+ * @param [in] optval Pointer to struct iddp_fanout
+ * @param [in] optlen sizeof(struct iddp_fanout)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid, or the set contains invalid ports)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_FANOUT		4
+
+/** Maximum number of ports in an IDDP fan-out set. */
+#define IDDP_FANOUT_MAX		32
+
+/**
+ * IDDP fan-out destination set.
+ */
+struct iddp_fanout {
+	/** Number of valid entries in @a ports. */
+	int nr_ports;
+	/** Destination port numbers. */
+	rtipc_port_t ports[IDDP_FANOUT_MAX];
+};
 /** @} */
 
 #define SOL_BUFP		313
@@ -834,6 +912,141 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define BUFP_BUFSZ		2
+/**
+ * BUFP shared ring mode
+ *
+ * When enabled, the buffer reserved at binding time is laid out as a
+ * ring which the application may map into its address space with
+ * mmap(2), so that a producer and a consumer running in the same
+ * process exchange data without any copy through the kernel. The
+ * mapping starts with a struct bufp_ring header, followed by the
+ * data area at bufp_ring::offset. The kernel only takes part when a
+ * thread has to wait for data or room, via the @ref BUFP_RTIOC_WAIT
+ * and @ref BUFP_RTIOC_WAKE requests (see @ref bufp_mapped_ring
+ * "BUFP shared ring").
+ *
+ * The buffer size set with @ref BUFP_BUFSZ must be a power of two
+ * when this mode is enabled, otherwise binding fails with -EINVAL.
+ * A socket in shared ring mode cannot be read or written with the
+ * regular I/O calls, which return -EOPNOTSUPP, and neither can a
+ * socket send to it.
+ *
+ * It is not allowed to change this setting after the socket was
+ * bound.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_MMAP
+ * @param [in] optval Pointer to a variable of type int, non-zero to
+ * enable the shared ring mode
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_MMAP		3
+/** @} */
+
+/**
+ * @anchor bufp_mapped_ring @name BUFP shared ring
+ * Layout of and requests for BUFP sockets in shared ring mode.
+ *
+ * The ring is a single-producer, single-consumer byte stream. The
+ * producer copies data to the data area at offset (head & (size -
+ * 1)), then publishes it by advancing bufp_ring::head. The consumer
+ * reads from offset (tail & (size - 1)), then releases the space by
+ * advancing bufp_ring::tail. Both indexes are free-running and wrap
+ * naturally at 2^32, so that (head - tail) is always the number of
+ * bytes pending in the ring.
+ *
+ * A thread which finds the ring empty (resp. full) issues @ref
+ * BUFP_RTIOC_WAIT, which sleeps until enough data (resp. room) is
+ * available. The kernel raises bufp_ring::rd_waiting (resp.
+ * bufp_ring::wr_waiting) on behalf of the sleeper. Conversely, once
+ * the opposite side has updated its index, it must issue a full
+ * memory barrier, then check the waiter flag, and issue @ref
+ * BUFP_RTIOC_WAKE if it is set.
+ *
+ * The requests must be issued on the bound socket which owns the
+ * ring.
+ * @{ */
+#define RTIOC_TYPE_IPC		RTDM_CLASS_RTIPC
+
+/** Header of a BUFP shared ring, at the start of the mapping. */
+struct bufp_ring {
+	/** Size of the data area in bytes (power of two). */
+	__u32 size;
+	/** Offset of the data area from the start of the mapping. */
+	__u32 offset;
+	/** Set while the consumer waits for data. */
+	__u32 rd_waiting;
+	/** Set while the producer waits for room. */
+	__u32 wr_waiting;
+	__u32 __pad1[12];
+	/** Producer index, only written by the producer. */
+	__u32 head;
+	__u32 __pad2[15];
+	/** Consumer index, only written by the consumer. */
+	__u32 tail;
+	__u32 __pad3[15];
+};
+
+/** Wait for data to read. */
+#define BUFP_RING_WAIT_READ	0x1
+/** Wait for room to write. */
+#define BUFP_RING_WAIT_WRITE	0x2
+
+/** Argument of @ref BUFP_RTIOC_WAIT. */
+struct bufp_ring_wait {
+	/** Either BUFP_RING_WAIT_READ or BUFP_RING_WAIT_WRITE. */
+	__u32 events;
+	/** Number of bytes (resp. free bytes) to wait for. */
+	__u32 len;
+};
+
+/**
+ * Wait for data or room in a shared ring.
+ *
+ * The caller sleeps until at least bufp_ring_wait::len bytes are
+ * pending in the ring (BUFP_RING_WAIT_READ), or free in the ring
+ * (BUFP_RING_WAIT_WRITE). The timeout is taken from SO_RCVTIMEO,
+ * resp. SO_SNDTIMEO.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL (invalid request, or socket not in shared ring mode)
+ * - -ETIMEDOUT (timeout elapsed)
+ * - -EINTR (sleep interrupted by a signal)
+ * - -EIDRM (socket closed while waiting)
+ * .
+ *
+ * @par Calling context:
+ * RT
+ */
+#define BUFP_RTIOC_WAIT		_IOW(RTIOC_TYPE_IPC, 0x00, struct bufp_ring_wait)
+/**
+ * Wake up the waiters of a shared ring.
+ *
+ * The argument is a mask of BUFP_RING_WAIT_READ and
+ * BUFP_RING_WAIT_WRITE, selecting the sleepers to wake up. The
+ * corresponding waiter flags are cleared.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (socket not in shared ring mode)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_RTIOC_WAKE		_IOW(RTIOC_TYPE_IPC, 0x01, int)
 /** @} */
 
 /**
@@ -81,6 +81,15 @@ struct rttst_swtest_error {
 	unsigned int fp_val;
 };
 
+struct rttst_swtest_bench {
+	/* in */
+	__u32 duration_ms;
+	__u32 __pad;
+	/* out */
+	__u64 switches;
+	__u64 elapsed_ns;
+};
+
 #define RTTST_RTDM_NORMAL_CLOSE		0
 #define RTTST_RTDM_DEFER_CLOSE_CONTEXT	1
 
@@ -118,6 +127,36 @@ struct rttst_heap_stathdr {
 	struct rttst_heap_stats *buf;
 };
 
+#define RTTST_SCHEDBENCH_LINEAR     0
+#define RTTST_SCHEDBENCH_MULTILEVEL 1
+#define RTTST_SCHEDBENCH_BITMAP     2
+
+struct rttst_sched_bench {
+	/* in */
+	__u32 nr_threads;
+	__u32 nr_prios;
+	__u32 loops;
+	/* out */
+	__u32 queue_type;
+	__s64 pick_avg_ns;
+	__s64 pick_max_ns;
+	__s64 requeue_avg_ns;
+	__s64 requeue_max_ns;
+};
+
+struct rttst_route_bench {
+	/* in */
+	__u32 nr_routes;
+	__u32 loops;
+	/* out */
+	__u32 trie_nodes;
+	__u32 trie_leaves;
+	__s64 trie_avg_ns;
+	__s64 trie_max_ns;
+	__s64 linear_avg_ns;
+	__s64 linear_max_ns;
+};
+
 #define RTIOC_TYPE_TESTING		RTDM_CLASS_TESTING
 
 /*!
@@ -133,6 +172,10 @@ struct rttst_heap_stathdr {
 #define RTDM_SUBCLASS_RTDMTEST		3
 /** subclase name: "heapcheck" */
 #define RTDM_SUBCLASS_HEAPCHECK		4
+/** subclass name: "schedbench" */
+#define RTDM_SUBCLASS_SCHEDBENCH	5
+/** subclass name: "routebench" */
+#define RTDM_SUBCLASS_ROUTEBENCH	6
 /** @} */
 
 /*!
@@ -175,6 +218,9 @@ struct rttst_heap_stathdr {
 #define RTTST_RTIOC_SWTEST_SET_PAUSE \
 	_IOW(RTIOC_TYPE_TESTING, 0x38, __u32)
 
+#define RTTST_RTIOC_SWTEST_BENCH \
+	_IOWR(RTIOC_TYPE_TESTING, 0x39, struct rttst_swtest_bench)
+
 #define RTTST_RTIOC_RTDM_DEFER_CLOSE \
 	_IOW(RTIOC_TYPE_TESTING, 0x40, __u32)
 
@@ -193,6 +239,12 @@ struct rttst_heap_stathdr {
 #define RTTST_RTIOC_HEAP_STAT_COLLECT \
 	_IOR(RTIOC_TYPE_TESTING, 0x45, int)
 
+#define RTTST_RTIOC_SCHED_BENCH \
+	_IOWR(RTIOC_TYPE_TESTING, 0x46, struct rttst_sched_bench)
+
+#define RTTST_RTIOC_ROUTE_BENCH \
+	_IOWR(RTIOC_TYPE_TESTING, 0x47, struct rttst_route_bench)
+
 /** @} */
 
 #endif /* !_RTDM_UAPI_TESTING_H */
@@ -61,6 +61,7 @@
 
 #define S_memLib_NOT_ENOUGH_MEMORY	(WIND_MEM_ERR_BASE + 0x0001)
 #define S_memLib_INVALID_NBYTES		(WIND_MEM_ERR_BASE + 0x0002)
+#define S_memLib_BLOCK_ERROR		(WIND_MEM_ERR_BASE + 0x0003)
 
 #ifdef __cplusplus
 extern "C" {
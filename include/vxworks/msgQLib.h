@@ -49,6 +49,17 @@ int msgQReceive(MSG_Q_ID msgQId, char *buf, UINT bytes, int timeout);
 STATUS msgQSend(MSG_Q_ID msgQId, const char *buf, UINT bytes,
 		int timeout, int prio);
 
+/* Xenomai extensions for zero-copy transfers. */
+
+char *msgQAllocBuf(MSG_Q_ID msgQId, UINT bytes);
+
+STATUS msgQSendBuf(MSG_Q_ID msgQId, char *buf, UINT bytes,
+		   int timeout, int prio);
+
+int msgQReceiveBuf(MSG_Q_ID msgQId, char **bufp, int timeout);
+
+STATUS msgQFreeBuf(MSG_Q_ID msgQId, char *buf);
+
 #ifdef __cplusplus
 }
 #endif
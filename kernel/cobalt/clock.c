@@ -23,6 +23,7 @@
 #include <cobalt/kernel/clock.h>
 #include <cobalt/kernel/arith.h>
 #include <cobalt/kernel/vdso.h>
+#include <cobalt/kernel/tracering.h>
 #include <cobalt/uapi/time.h>
 #include <asm/xenomai/calibration.h>
 #include <trace/events/cobalt-core.h>
@@ -107,6 +108,7 @@ void xnclock_core_local_shot(struct xnsched *sched)
 	struct xntimer *timer;
 	xnsticks_t delay;
 	xntimerh_t *h;
+	spl_t s;
 
 	/*
 	 * Do not reprogram locally when inside the tick handler -
@@ -121,10 +123,11 @@ void xnclock_core_local_shot(struct xnsched *sched)
 	 * SMP.
 	 */
 	tmd = xnclock_this_timerdata(&nkclock);
+	xnlock_get_irqsave(&tmd->lock, s);
 	h = xntimerq_head(&tmd->q);
 	if (h == NULL) {
 		sched->lflags |= XNIDLE;
-		return;
+		goto out;
 	}
 
 	/*
@@ -169,6 +172,8 @@ void xnclock_core_local_shot(struct xnsched *sched)
 	xntrace_tick((unsigned)delay);
 
 	pipeline_set_timer_shot(delay);
+out:
+	xnlock_put_irqrestore(&tmd->lock, s);
 }
 
 #ifdef CONFIG_SMP
@@ -229,6 +234,7 @@ enqueue:
 void xnclock_apply_offset(struct xnclock *clock, xnsticks_t delta_ns)
 {
 	struct xntimer *timer, *tmp;
+	struct xntimerdata *tmd;
 	struct list_head adjq;
 	struct xnsched *sched;
 	xnsticks_t delta;
@@ -236,6 +242,7 @@ void xnclock_apply_offset(struct xnclock *clock, xnsticks_t delta_ns)
 	unsigned int cpu;
 	xntimerh_t *h;
 	xntimerq_t *q;
+	spl_t s;
 
 	atomic_only();
 
@@ -251,7 +258,10 @@ void xnclock_apply_offset(struct xnclock *clock, xnsticks_t delta_ns)
 
 	for_each_online_cpu(cpu) {
 		sched = xnsched_struct(cpu);
-		q = &xnclock_percpu_timerdata(clock, cpu)->q;
+		tmd = xnclock_percpu_timerdata(clock, cpu);
+		q = &tmd->q;
+
+		xnlock_get_irqsave(&tmd->lock, s);
 
 		for (h = xntimerq_it_begin(q, &it); h;
 		     h = xntimerq_it_next(q, &it, h)) {
@@ -260,8 +270,10 @@ void xnclock_apply_offset(struct xnclock *clock, xnsticks_t delta_ns)
 				list_add_tail(&timer->adjlink, &adjq);
 		}
 
-		if (list_empty(&adjq))
+		if (list_empty(&adjq)) {
+			xnlock_put_irqrestore(&tmd->lock, s);
 			continue;
+		}
 
 		list_for_each_entry_safe(timer, tmp, &adjq, adjlink) {
 			list_del(&timer->adjlink);
@@ -273,6 +285,8 @@ void xnclock_apply_offset(struct xnclock *clock, xnsticks_t delta_ns)
 			xnclock_remote_shot(clock, sched);
 		else
 			xnclock_program_shot(clock, sched);
+
+		xnlock_put_irqrestore(&tmd->lock, s);
 	}
 }
 EXPORT_SYMBOL_GPL(xnclock_apply_offset);
@@ -620,6 +634,7 @@ int xnclock_register(struct xnclock *clock, const cpumask_t *affinity)
 	for_each_online_cpu(cpu) {
 		tmd = xnclock_percpu_timerdata(clock, cpu);
 		xntimerq_init(&tmd->q);
+		xnlock_init(&tmd->lock);
 	}
 
 #ifdef CONFIG_XENO_OPT_STATS
@@ -683,11 +698,13 @@ EXPORT_SYMBOL_GPL(xnclock_deregister);
 void xnclock_tick(struct xnclock *clock)
 {
 	struct xnsched *sched = xnsched_current();
+	struct xntimerdata *tmd;
 	struct xntimer *timer;
 	xnsticks_t delta;
 	xntimerq_t *tmq;
 	xnticks_t now;
 	xntimerh_t *h;
+	spl_t s;
 
 	atomic_only();
 
@@ -700,10 +717,12 @@ void xnclock_tick(struct xnclock *clock)
 	if (IS_ENABLED(CONFIG_XENO_OPT_EXTCLOCK) &&
 	    clock != &nkclock &&
 	    !cpumask_test_cpu(xnsched_cpu(sched), &clock->affinity))
-		tmq = &xnclock_percpu_timerdata(clock, 0)->q;
+		tmd = xnclock_percpu_timerdata(clock, 0);
 	else
 #endif
-		tmq = &xnclock_this_timerdata(clock)->q;
+		tmd = xnclock_this_timerdata(clock);
+
+	tmq = &tmd->q;
 
 	/*
 	 * Optimisation: any local timer reprogramming triggered by
@@ -712,6 +731,13 @@ void xnclock_tick(struct xnclock *clock)
 	 */
 	sched->status |= XNINTCK;
 
+	/*
+	 * The timer queue lock is dropped across handler calls, so
+	 * that timer services invoked from there never nest it into
+	 * any lock those handlers might grab.
+	 */
+	xnlock_get_irqsave(&tmd->lock, s);
+
 	now = xnclock_read_raw(clock);
 	while ((h = xntimerq_head(tmq)) != NULL) {
 		timer = container_of(h, struct xntimer, aplink);
@@ -720,6 +746,7 @@ void xnclock_tick(struct xnclock *clock)
 			break;
 
 		trace_cobalt_timer_expire(timer);
+		xntrace_ring_log_timer(timer);
 
 		xntimer_dequeue(timer, tmq);
 		xntimer_account_fired(timer);
@@ -738,7 +765,9 @@ void xnclock_tick(struct xnclock *clock)
 			continue;
 		}
 
+		xnlock_put_irqrestore(&tmd->lock, s);
 		timer->handler(timer);
+		xnlock_get_irqsave(&tmd->lock, s);
 		now = xnclock_read_raw(clock);
 		timer->status |= XNTIMER_FIRED;
 		/*
@@ -766,12 +795,79 @@ void xnclock_tick(struct xnclock *clock)
 		xntimer_enqueue(timer, tmq);
 	}
 
+	xnlock_put_irqrestore(&tmd->lock, s);
+
 	sched->status &= ~XNINTCK;
 
 	xnclock_program_shot(clock, sched);
 }
 EXPORT_SYMBOL_GPL(xnclock_tick);
 
+/**
+ * @brief Process a core clock tick without grabbing nklock.
+ *
+ * Most core clock ticks on a CPU running in-band work only relay
+ * the host tick, which involves the per-CPU host timer solely. This
+ * routine handles such tick under the local timer queue lock, so
+ * that it never serializes with real-time activities running on
+ * other CPUs.
+ *
+ * @return Non-zero if the tick was fully processed, zero if some
+ * other timer has elapsed, in which case the caller has to complete
+ * the work by calling xnclock_tick() for the core clock under
+ * nklock.
+ *
+ * @coretags{coreirq-only, atomic-entry}
+ */
+int xnclock_core_fast_tick(void)
+{
+	struct xnsched *sched = xnsched_current();
+	struct xntimerdata *tmd;
+	struct xntimer *timer;
+	int done = 1;
+	xnticks_t now;
+	xntimerh_t *h;
+	spl_t s;
+
+	tmd = xnclock_this_timerdata(&nkclock);
+	xnlock_get_irqsave(&tmd->lock, s);
+
+	now = xnclock_core_read_raw();
+	while ((h = xntimerq_head(&tmd->q)) != NULL) {
+		timer = container_of(h, struct xntimer, aplink);
+		if ((xnsticks_t)(xntimerh_date(&timer->aplink) - now) > 0)
+			break;
+
+		if (timer != &sched->htimer) {
+			done = 0;
+			goto out;
+		}
+
+		trace_cobalt_timer_expire(timer);
+		xntrace_ring_log_timer(timer);
+
+		xntimer_dequeue(timer, &tmd->q);
+		xntimer_account_fired(timer);
+		sched->lflags |= XNHTICK;
+		sched->lflags &= ~XNHDEFER;
+		if ((timer->status & XNTIMER_PERIODIC) == 0)
+			continue;
+
+		do {
+			timer->periodic_ticks++;
+			xntimer_update_date(timer);
+		} while (xntimerh_date(&timer->aplink) < now);
+
+		xntimer_enqueue(timer, &tmd->q);
+	}
+
+	xnclock_core_local_shot(sched);
+out:
+	xnlock_put_irqrestore(&tmd->lock, s);
+
+	return done;
+}
+
 static int set_core_clock_gravity(struct xnclock *clock,
 				  const struct xnclock_gravity *p)
 {
@@ -57,6 +57,7 @@ void pipeline_set_timer_shot(unsigned long delay) /* ns */
 static int proxy_set_next_ktime(ktime_t expires,
 				struct clock_event_device *proxy_dev) /* hard irqs on/off */
 {
+	struct xntimerdata *tmd;
 	struct xnsched *sched;
 	unsigned long flags;
 	ktime_t delta;
@@ -73,10 +74,15 @@ static int proxy_set_next_ktime(ktime_t expires,
 	if (delta < 0)
 		delta = 0;
 
-	xnlock_get_irqsave(&nklock, flags);
+	/*
+	 * The host timer belongs to the current CPU, holding the
+	 * local timer queue lock is enough.
+	 */
+	tmd = xnclock_this_timerdata(&nkclock);
+	xnlock_get_irqsave(&tmd->lock, flags);
 	sched = xnsched_current();
 	ret = xntimer_start(&sched->htimer, delta, XN_INFINITE, XN_RELATIVE);
-	xnlock_put_irqrestore(&nklock, flags);
+	xnlock_put_irqrestore(&tmd->lock, flags);
 
 	return ret ? -ETIME : 0;
 }
@@ -90,6 +96,7 @@ static int proxy_set_oneshot_stopped(struct clock_event_device *proxy_dev)
 {
 	struct clock_event_device *real_dev;
 	struct clock_proxy_device *dev;
+	struct xntimerdata *tmd;
 	struct xnsched *sched;
 	spl_t s;
 
@@ -104,7 +111,8 @@ static int proxy_set_oneshot_stopped(struct clock_event_device *proxy_dev)
 	 * assessing the RQ_IDLE condition, so we need to stop it
 	 * prior to testing the latter.
 	 */
-	xnlock_get_irqsave(&nklock, s);
+	tmd = xnclock_this_timerdata(&nkclock);
+	xnlock_get_irqsave(&tmd->lock, s);
 	sched = xnsched_current();
 	xntimer_stop(&sched->htimer);
 	sched->lflags |= XNTSTOP;
@@ -114,7 +122,7 @@ static int proxy_set_oneshot_stopped(struct clock_event_device *proxy_dev)
 		real_dev->set_state_oneshot_stopped(real_dev);
 	}
 
-	xnlock_put_irqrestore(&nklock, s);
+	xnlock_put_irqrestore(&tmd->lock, s);
 
 	return 0;
 }
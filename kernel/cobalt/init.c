@@ -29,6 +29,7 @@
 #include <cobalt/kernel/pipe.h>
 #include <cobalt/kernel/select.h>
 #include <cobalt/kernel/vdso.h>
+#include <cobalt/kernel/tracering.h>
 #include <rtdm/fd.h>
 #include "rtdm/internal.h"
 #include "posix/internal.h"
@@ -230,10 +231,14 @@ static int __init xenomai_init(void)
 	if (ret)
 		goto cleanup_pipe;
 
-	ret = sys_init();
+	ret = xntrace_ring_init();
 	if (ret)
 		goto cleanup_select;
 
+	ret = sys_init();
+	if (ret)
+		goto cleanup_trace;
+
 	ret = pipeline_late_init();
 	if (ret)
 		goto cleanup_sys;
@@ -261,6 +266,8 @@ cleanup_rtdm:
 	rtdm_cleanup();
 cleanup_sys:
 	sys_shutdown();
+cleanup_trace:
+	xntrace_ring_cleanup();
 cleanup_select:
 	xnselect_umount();
 cleanup_pipe:
@@ -216,9 +216,17 @@ void xnintr_core_clock_handler(void)
 	++sched->inesting;
 	sched->lflags |= XNINIRQ;
 
-	xnlock_get(&nklock);
-	xnclock_tick(&nkclock);
-	xnlock_put(&nklock);
+	/*
+	 * Only grab nklock if some timer other than the host tick
+	 * relay has elapsed, so that CPUs which are merely relaying
+	 * in-band ticks do not contend with real-time work running
+	 * on other CPUs.
+	 */
+	if (!xnclock_core_fast_tick()) {
+		xnlock_get(&nklock);
+		xnclock_tick(&nkclock);
+		xnlock_put(&nklock);
+	}
 
 	trace_cobalt_clock_exit(per_cpu(ipipe_percpu.hrtimer_irq, cpu));
 	switch_from_irqstats(sched, prev);
@@ -35,14 +35,17 @@ extern struct xnintr nktimer;
 static int program_htick_shot(unsigned long delay,
 			      struct clock_event_device *cdev)
 {
+	struct xntimerdata *tmd;
 	struct xnsched *sched;
 	int ret;
 	spl_t s;
 
-	xnlock_get_irqsave(&nklock, s);
+	/* The host timer is CPU-local, see xnclock_core_fast_tick(). */
+	tmd = xnclock_this_timerdata(&nkclock);
+	xnlock_get_irqsave(&tmd->lock, s);
 	sched = xnsched_current();
 	ret = xntimer_start(&sched->htimer, delay, XN_INFINITE, XN_RELATIVE);
-	xnlock_put_irqrestore(&nklock, s);
+	xnlock_put_irqrestore(&tmd->lock, s);
 
 	return ret ? -ETIME : 0;
 }
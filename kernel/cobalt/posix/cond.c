@@ -23,6 +23,19 @@
 #include "clock.h"
 #include <trace/events/cobalt-posix.h>
 
+static struct xnheap_cache cond_cache;
+
+__init int cobalt_cond_cache_init(void)
+{
+	return xnheap_cache_init(&cond_cache, &cobalt_heap,
+				 sizeof(struct cobalt_cond), "cond");
+}
+
+__init void cobalt_cond_cache_cleanup(void)
+{
+	xnheap_cache_destroy(&cond_cache);
+}
+
 static inline int
 pthread_cond_init(struct cobalt_cond_shadow *cnd, const struct cobalt_condattr *attr)
 {
@@ -33,7 +46,7 @@ pthread_cond_init(struct cobalt_cond_shadow *cnd, const struct cobalt_condattr *
 	struct list_head *condq;
 	spl_t s;
 
-	cond = xnmalloc(sizeof(*cond));
+	cond = xnheap_cache_alloc(&cond_cache);
 	if (cond == NULL)
 		return -ENOMEM;
 
@@ -81,7 +94,7 @@ fail_register:
 	xnlock_put_irqrestore(&nklock, s);
 	cobalt_umm_free(&sys_ppd->umm, state);
 fail_umm:
-	xnfree(cond);
+	xnheap_cache_free(&cond_cache, cond);
 
 	return ret;
 }
@@ -420,5 +433,5 @@ void cobalt_cond_reclaim(struct cobalt_resnode *node, spl_t s)
 
 	cobalt_umm_free(&cobalt_ppd_get(cond->attr.pshared)->umm,
 			cond->state);
-	xnfree(cond);
+	xnheap_cache_free(&cond_cache, cond);
 }
@@ -68,4 +68,8 @@ int cobalt_cond_deferred_signals(struct cobalt_cond *cond);
 void cobalt_cond_reclaim(struct cobalt_resnode *node,
 			 spl_t s);
 
+int cobalt_cond_cache_init(void);
+
+void cobalt_cond_cache_cleanup(void);
+
 #endif /* !_COBALT_POSIX_COND_H */
@@ -26,6 +26,7 @@
 #include <pipeline/tick.h>
 #include <asm/xenomai/syscall.h>
 #include "corectl.h"
+#include "sysstat.h"
 
 static BLOCKING_NOTIFIER_HEAD(config_notifier_list);
 
@@ -195,6 +196,9 @@ COBALT_SYSCALL(corectl, probing,
 	case _CC_COBALT_START_CORE:
 		ret = start_services();
 		break;
+	case _CC_COBALT_SYSSTAT:
+		ret = cobalt_sysstat_control(u_buf, u_bufsz);
+		break;
 	default:
 		ret = do_conf_option(request, u_buf, u_bufsz);
 	}
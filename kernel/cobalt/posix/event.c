@@ -47,6 +47,23 @@ struct event_wait_context {
 	int mode;
 };
 
+/* nklock held, irqs off */
+static void update_waitmask(struct cobalt_event *event)
+{
+	struct xnthread_wait_context *wc;
+	struct event_wait_context *ewc;
+	unsigned int waitmask = 0;
+	struct xnthread *p;
+
+	xnsynch_for_each_sleeper(p, &event->synch) {
+		wc = xnthread_get_wait_context(p);
+		ewc = container_of(wc, struct event_wait_context, wc);
+		waitmask |= ewc->value;
+	}
+
+	event->state->waitmask = waitmask;
+}
+
 COBALT_SYSCALL(event_init, current,
 	       (struct cobalt_event_shadow __user *u_event,
 		unsigned int value, int flags))
@@ -87,6 +104,7 @@ COBALT_SYSCALL(event_init, current,
 	state->value = value;
 	state->flags = 0;
 	state->nwaiters = 0;
+	state->waitmask = 0;
 	stateoff = cobalt_umm_offset(umm, state);
 	XENO_BUG_ON(COBALT, stateoff != (__u32)stateoff);
 
@@ -152,7 +170,14 @@ int __cobalt_event_wait(struct cobalt_event_shadow __user *u_event,
 		goto out;
 	}
 
+	/*
+	 * Publish our interest before sampling the value. This pairs
+	 * with the full barrier userland issues when posting bits
+	 * prior to checking whether anybody waits for them.
+	 */
 	state->flags |= COBALT_EVENT_PENDED;
+	state->waitmask |= bits;
+	smp_mb();
 	rbits = state->value & bits;
 	testval = mode & COBALT_EVENT_ANY ? rbits : bits;
 	if (rbits && rbits == testval)
@@ -180,6 +205,7 @@ int __cobalt_event_wait(struct cobalt_event_shadow __user *u_event,
 done:
 	if (!xnsynch_pended_p(&event->synch))
 		state->flags &= ~COBALT_EVENT_PENDED;
+	update_waitmask(event);
 out:
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -279,6 +305,7 @@ COBALT_SYSCALL(event_sync, current,
 		}
 	}
 
+	update_waitmask(event);
 	xnsched_run();
 out:
 	xnlock_put_irqrestore(&nklock, s);
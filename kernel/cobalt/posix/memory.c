@@ -24,12 +24,14 @@
 #include <linux/vmalloc.h>
 #include <rtdm/driver.h>
 #include <cobalt/kernel/vdso.h>
+#include <cobalt/kernel/tracering.h>
 #include "process.h"
 #include "memory.h"
 
 #define UMM_PRIVATE  0	/* Per-process user-mapped memory heap */
 #define UMM_SHARED   1	/* Shared user-mapped memory heap */
 #define SYS_GLOBAL   2	/* System heap (not mmapped) */
+#define SYS_TRACE    3	/* Event trace rings (read-only) */
 
 struct xnvdso *nkvdso;
 EXPORT_SYMBOL_GPL(nkvdso);
@@ -252,9 +254,90 @@ static struct rtdm_device sysmem_device = {
 	.label = COBALT_MEMDEV_SYS,
 };
 
+#ifdef CONFIG_XENO_OPT_TRACE_RING
+
+static int tracemem_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+	return xntrace_ring_mmap(vma);
+}
+
+static int do_tracemem_ioctls(struct rtdm_fd *fd,
+			      unsigned int request, void __user *arg)
+{
+	struct cobalt_memdev_stat stat;
+	int ret;
+
+	switch (request) {
+	case MEMDEV_RTIOC_STAT:
+		stat.size = xntrace_ring_get_size();
+		stat.free = 0;
+		ret = rtdm_safe_copy_to_user(fd, arg, &stat, sizeof(stat));
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static int tracemem_ioctl_rt(struct rtdm_fd *fd,
+			     unsigned int request, void __user *arg)
+{
+	return do_tracemem_ioctls(fd, request, arg);
+}
+
+static int tracemem_ioctl_nrt(struct rtdm_fd *fd,
+			      unsigned int request, void __user *arg)
+{
+	return do_tracemem_ioctls(fd, request, arg);
+}
+
+static struct rtdm_driver tracemem_driver = {
+	.profile_info	=	RTDM_PROFILE_INFO(tracemem,
+						  RTDM_CLASS_MEMORY,
+						  SYS_TRACE,
+						  0),
+	.device_flags	=	RTDM_NAMED_DEVICE,
+	.device_count	=	1,
+	.ops = {
+		.open		=	sysmem_open,
+		.ioctl_rt	=	tracemem_ioctl_rt,
+		.ioctl_nrt	=	tracemem_ioctl_nrt,
+		.mmap		=	tracemem_mmap,
+	},
+};
+
+static struct rtdm_device tracemem_device = {
+	.driver = &tracemem_driver,
+	.label = COBALT_MEMDEV_TRACE,
+};
+
+static inline int register_tracemem(void)
+{
+	return rtdm_dev_register(&tracemem_device);
+}
+
+static inline void unregister_tracemem(void)
+{
+	rtdm_dev_unregister(&tracemem_device);
+}
+
+#else /* !CONFIG_XENO_OPT_TRACE_RING */
+
+static inline int register_tracemem(void)
+{
+	return 0;
+}
+
+static inline void unregister_tracemem(void) { }
+
+#endif /* !CONFIG_XENO_OPT_TRACE_RING */
+
 static inline void init_vdso(void)
 {
 	nkvdso->features = XNVDSO_FEATURES;
+	if (IS_ENABLED(CONFIG_XENO_OPT_TRACE_RING))
+		nkvdso->features |= XNVDSO_FEAT_TRACE_RING;
 	nkvdso->wallclock_offset = nkclock.wallclock_offset;
 }
 
@@ -289,8 +372,14 @@ int cobalt_memdev_init(void)
 	if (ret)
 		goto fail_sysmem;
 
+	ret = register_tracemem();
+	if (ret)
+		goto fail_tracemem;
+
 	return 0;
 
+fail_tracemem:
+	rtdm_dev_unregister(&sysmem_device);
 fail_sysmem:
 	rtdm_dev_unregister(umm_devices + UMM_SHARED);
 fail_shared:
@@ -305,6 +394,7 @@ fail_vdso:
 
 void cobalt_memdev_cleanup(void)
 {
+	unregister_tracemem();
 	rtdm_dev_unregister(&sysmem_device);
 	rtdm_dev_unregister(umm_devices + UMM_SHARED);
 	rtdm_dev_unregister(umm_devices + UMM_PRIVATE);
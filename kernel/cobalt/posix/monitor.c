@@ -143,6 +143,29 @@ COBALT_SYSCALL(monitor_enter, primary,
 	return ret;
 }
 
+/* nklock held, irqs off */
+static void monitor_update_pended(struct cobalt_monitor *mon)
+{
+	struct cobalt_monitor_state *state = mon->state;
+	__u32 waitbits = 0, old, new;
+
+	if (!list_empty(&mon->waiters))
+		waitbits |= COBALT_MONITOR_PENDED|COBALT_MONITOR_GRANTWAIT;
+	if (xnsynch_pended_p(&mon->drain))
+		waitbits |= COBALT_MONITOR_PENDED|COBALT_MONITOR_DRAINWAIT;
+
+	/*
+	 * A timed out waiter gets there without owning the gate, so
+	 * userland may be raising signal bits concurrently.
+	 */
+	do {
+		old = READ_ONCE(state->flags);
+		new = (old & ~(COBALT_MONITOR_PENDED|
+			       COBALT_MONITOR_GRANTWAIT|
+			       COBALT_MONITOR_DRAINWAIT)) | waitbits;
+	} while (cmpxchg(&state->flags, old, new) != old);
+}
+
 /* nklock held, irqs off */
 static void monitor_wakeup(struct cobalt_monitor *mon)
 {
@@ -199,8 +222,7 @@ drain:
 			xnsynch_wakeup_one_sleeper(&mon->drain);
 	}
 
-	if (list_empty(&mon->waiters) && !xnsynch_pended_p(&mon->drain))
-		state->flags &= ~COBALT_MONITOR_PENDED;
+	monitor_update_pended(mon);
 }
 
 int __cobalt_monitor_wait(struct cobalt_monitor_shadow __user *u_mon,
@@ -254,7 +276,9 @@ int __cobalt_monitor_wait(struct cobalt_monitor_shadow __user *u_mon,
 	/*
 	 * Tell userland that somebody is now waiting for a signal, so
 	 * that later exiting the monitor on the producer side will
-	 * trigger a wakeup syscall.
+	 * trigger a wakeup syscall. The GRANTWAIT/DRAINWAIT bits tell
+	 * which kind of signal is awaited, so that sending the other
+	 * kind does not cost a syscall.
 	 *
 	 * CAUTION: we must raise the PENDED flag while holding the
 	 * gate mutex, to prevent a signal from sneaking in from a
@@ -262,6 +286,10 @@ int __cobalt_monitor_wait(struct cobalt_monitor_shadow __user *u_mon,
 	 * wakeup call when dropping the gate lock.
 	 */
 	state->flags |= COBALT_MONITOR_PENDED;
+	if (event & COBALT_MONITOR_WAITDRAIN)
+		state->flags |= COBALT_MONITOR_DRAINWAIT;
+	else
+		state->flags |= COBALT_MONITOR_GRANTWAIT;
 
 	tmode = ts ? mon->tmode : XN_RELATIVE;
 
@@ -274,8 +302,7 @@ int __cobalt_monitor_wait(struct cobalt_monitor_shadow __user *u_mon,
 		    !list_empty(&curr->monitor_link))
 			list_del_init(&curr->monitor_link);
 
-		if (list_empty(&mon->waiters) && !xnsynch_pended_p(&mon->drain))
-			state->flags &= ~COBALT_MONITOR_PENDED;
+		monitor_update_pended(mon);
 
 		if (info & XNBREAK) {
 			opret = -EINTR;
@@ -44,6 +44,8 @@ struct cobalt_mq {
 	struct xnsynch senders;
 	size_t memsize;
 	char *mem;
+	/* Slot descriptors, zero-copy mode only. */
+	struct cobalt_msg *slots;
 	struct list_head queued;
 	struct list_head avail;
 	int nrqueued;
@@ -65,6 +67,8 @@ struct cobalt_mq {
 
 struct cobalt_mqd {
 	struct cobalt_mq *mq;
+	/* Zero-copy slots obtained through this descriptor. */
+	int nrheld;
 	struct rtdm_fd fd;
 };
 
@@ -72,7 +76,9 @@ struct cobalt_msg {
 	struct list_head link;
 	unsigned int prio;
 	size_t len;
-	char data[0];
+	/* Descriptor holding this zero-copy slot, NULL if none. */
+	struct cobalt_mqd *owner;
+	char *data;
 };
 
 struct cobalt_mqwait_context {
@@ -133,10 +139,55 @@ static inline void mq_msg_free(struct cobalt_mq *mq, struct cobalt_msg * msg)
 	list_add(&msg->link, &mq->avail); /* For earliest re-use of the block. */
 }
 
+static int mq_init_slots(struct cobalt_mq *mq, const struct mq_attr *attr)
+{
+	struct cobalt_umm *umm = &cobalt_ppd_get(1)->umm;
+	struct cobalt_msg *slots;
+	unsigned int slotsize;
+	u64 memsize;
+	char *mem;
+	int i;
+
+	/*
+	 * Only the payloads live in the shared heap, so that user
+	 * space cannot corrupt the queue links. Slots are cache
+	 * aligned to prevent false sharing between a sender and a
+	 * receiver working on adjacent messages.
+	 */
+	slotsize = ALIGN(attr->mq_msgsize, L1_CACHE_BYTES);
+	memsize = (u64)slotsize * attr->mq_maxmsg;
+	if (memsize > U32_MAX)
+		return -ENOSPC;
+
+	slots = xnheap_vmalloc(attr->mq_maxmsg * sizeof(*slots));
+	if (slots == NULL)
+		return -ENOSPC;
+
+	mem = cobalt_umm_alloc(umm, (__u32)memsize);
+	if (mem == NULL) {
+		xnheap_vfree(slots);
+		return -ENOSPC;
+	}
+
+	mq->memsize = memsize;
+	mq->mem = mem;
+	mq->slots = slots;
+
+	INIT_LIST_HEAD(&mq->avail);
+	for (i = 0; i < attr->mq_maxmsg; i++) {
+		slots[i].owner = NULL;
+		slots[i].data = mem + i * slotsize;
+		mq_msg_free(mq, &slots[i]);
+	}
+
+	return 0;
+}
+
 static inline int mq_init(struct cobalt_mq *mq, const struct mq_attr *attr)
 {
 	unsigned i, msgsize, memsize;
 	char *mem;
+	int ret;
 
 	if (attr == NULL)
 		attr = &default_attr;
@@ -149,35 +200,45 @@ static inline int mq_init(struct cobalt_mq *mq, const struct mq_attr *attr)
 			return -EINVAL;
 	}
 
-	msgsize = attr->mq_msgsize + sizeof(struct cobalt_msg);
+	if (attr->mq_flags & COBALT_MQ_ZEROCOPY) {
+		ret = mq_init_slots(mq, attr);
+		if (ret)
+			return ret;
+	} else {
+		msgsize = attr->mq_msgsize + sizeof(struct cobalt_msg);
 
-	/* Align msgsize on natural boundary. */
-	if ((msgsize % sizeof(unsigned long)))
-		msgsize +=
-		    sizeof(unsigned long) - (msgsize % sizeof(unsigned long));
+		/* Align msgsize on natural boundary. */
+		if ((msgsize % sizeof(unsigned long)))
+			msgsize +=
+			    sizeof(unsigned long) - (msgsize % sizeof(unsigned long));
 
-	memsize = msgsize * attr->mq_maxmsg;
-	memsize = PAGE_ALIGN(memsize);
-	if (get_order(memsize) > MAX_ORDER)
-		return -ENOSPC;
+		memsize = msgsize * attr->mq_maxmsg;
+		memsize = PAGE_ALIGN(memsize);
+		if (get_order(memsize) > MAX_ORDER)
+			return -ENOSPC;
 
-	mem = xnheap_vmalloc(memsize);
-	if (mem == NULL)
-		return -ENOSPC;
+		mem = xnheap_vmalloc(memsize);
+		if (mem == NULL)
+			return -ENOSPC;
+
+		mq->memsize = memsize;
+		mq->mem = mem;
+		mq->slots = NULL;
+
+		/* Fill the pool. */
+		INIT_LIST_HEAD(&mq->avail);
+		for (i = 0; i < attr->mq_maxmsg; i++) {
+			struct cobalt_msg *msg = (struct cobalt_msg *) (mem + i * msgsize);
+			msg->owner = NULL;
+			msg->data = (char *)(msg + 1);
+			mq_msg_free(mq, msg);
+		}
+	}
 
-	mq->memsize = memsize;
 	INIT_LIST_HEAD(&mq->queued);
 	mq->nrqueued = 0;
 	xnsynch_init(&mq->receivers, XNSYNCH_PRIO, NULL);
 	xnsynch_init(&mq->senders, XNSYNCH_PRIO, NULL);
-	mq->mem = mem;
-
-	/* Fill the pool. */
-	INIT_LIST_HEAD(&mq->avail);
-	for (i = 0; i < attr->mq_maxmsg; i++) {
-		struct cobalt_msg *msg = (struct cobalt_msg *) (mem + i * msgsize);
-		mq_msg_free(mq, msg);
-	}
 
 	mq->attr = *attr;
 	mq->target = NULL;
@@ -203,7 +264,11 @@ static inline void mq_destroy(struct cobalt_mq *mq)
 	xnselect_destroy(&mq->read_select); /* Reschedules. */
 	xnselect_destroy(&mq->write_select); /* Ditto. */
 	xnregistry_remove(mq->handle);
-	xnheap_vfree(mq->mem);
+	if (mq->slots) {
+		cobalt_umm_free(&cobalt_ppd_get(1)->umm, mq->mem);
+		xnheap_vfree(mq->slots);
+	} else
+		xnheap_vfree(mq->mem);
 	kfree(mq);
 }
 
@@ -228,11 +293,42 @@ static int mq_unref(struct cobalt_mq *mq)
 	return mq_unref_inner(mq, s);
 }
 
+static void mq_release_msg(struct cobalt_mq *mq, struct cobalt_msg *msg);
+
+static void mqd_release_slots(struct cobalt_mqd *mqd)
+{
+	struct cobalt_mq *mq = mqd->mq;
+	struct cobalt_msg *msg;
+	spl_t s;
+	int i;
+
+	/*
+	 * Give back the slots the descriptor still holds, which
+	 * would be lost for the queue otherwise. This also covers
+	 * the exit of the owner process, since all its descriptors
+	 * are closed then.
+	 */
+	for (i = 0; i < mq->attr.mq_maxmsg && mqd->nrheld > 0; i++) {
+		msg = mq->slots + i;
+		xnlock_get_irqsave(&nklock, s);
+		if (msg->owner == mqd) {
+			msg->owner = NULL;
+			mqd->nrheld--;
+			mq_release_msg(mq, msg);
+			xnsched_run();
+		}
+		xnlock_put_irqrestore(&nklock, s);
+	}
+}
+
 static void mqd_close(struct rtdm_fd *fd)
 {
 	struct cobalt_mqd *mqd = container_of(fd, struct cobalt_mqd, fd);
 	struct cobalt_mq *mq = mqd->mq;
 
+	if (mq->slots)
+		mqd_release_slots(mqd);
+
 	kfree(mqd);
 	mq_unref(mq);
 }
@@ -310,6 +406,7 @@ static inline int mqd_create(struct cobalt_mq *mq, unsigned long flags, int ufd)
 
 	mqd->fd.oflags = flags;
 	mqd->mq = mq;
+	mqd->nrheld = 0;
 
 	ret = rtdm_fd_enter(&mqd->fd, ufd, COBALT_MQD_MAGIC, &mqd_ops);
 	if (ret < 0)
@@ -1091,3 +1188,228 @@ COBALT_SYSCALL(mq_timedreceive64, primary,
 {
 	return __cobalt_mq_timedreceive64(uqd, u_buf, u_len, u_prio, u_ts);
 }
+
+static inline int mq_fetch_slot_timeout(struct timespec64 *ts,
+					const void __user *u_ts)
+{
+	/* u_ts points at the kernel copy of the timeout date. */
+	*ts = ns_to_timespec64(*(__force const __u64 *)u_ts);
+
+	return 0;
+}
+
+static struct cobalt_msg *mq_slot_get(struct cobalt_mq *mq, int slot)
+{
+	if (mq->slots == NULL)
+		return ERR_PTR(-EOPNOTSUPP);
+
+	if (slot < 0 || slot >= mq->attr.mq_maxmsg)
+		return ERR_PTR(-EINVAL);
+
+	return mq->slots + slot;
+}
+
+static int mq_slot_put_user(struct cobalt_mqd *mqd, struct cobalt_msg *msg,
+			    struct cobalt_mq_slot *zs,
+			    struct cobalt_mq_slot __user *u_slot)
+{
+	struct cobalt_mq *mq = mqd->mq;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	msg->owner = mqd;
+	mqd->nrheld++;
+	xnlock_put_irqrestore(&nklock, s);
+
+	zs->slot = msg - mq->slots;
+	zs->offset = cobalt_umm_offset(&cobalt_ppd_get(1)->umm, msg->data);
+
+	return cobalt_copy_to_user(u_slot, zs, sizeof(*zs));
+}
+
+static void mq_slot_release(struct cobalt_mqd *mqd, struct cobalt_msg *msg)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	/* Another thread may have released it via the same descriptor. */
+	if (msg->owner == mqd) {
+		msg->owner = NULL;
+		mqd->nrheld--;
+		mq_release_msg(mqd->mq, msg);
+		xnsched_run();
+	}
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+COBALT_SYSCALL(mq_slot_alloc, primary,
+	       (mqd_t uqd, struct cobalt_mq_slot __user *u_slot))
+{
+	struct cobalt_mq_slot zs;
+	struct cobalt_msg *msg;
+	struct cobalt_mqd *mqd;
+	struct cobalt_mq *mq;
+	int ret;
+
+	if (cobalt_copy_from_user(&zs, u_slot, sizeof(zs)))
+		return -EFAULT;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	mq = mqd->mq;
+	if (mq->slots == NULL) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	msg = mq_timedsend_inner(mqd, 0,
+				 (__force const void __user *)&zs.timeout,
+				 zs.timeout ? mq_fetch_slot_timeout : NULL);
+	if (IS_ERR(msg)) {
+		ret = PTR_ERR(msg);
+		goto out;
+	}
+
+	zs.len = mq->attr.mq_msgsize;
+	zs.prio = 0;
+	ret = mq_slot_put_user(mqd, msg, &zs, u_slot);
+	if (ret)
+		mq_slot_release(mqd, msg);
+out:
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
+
+COBALT_SYSCALL(mq_slot_send, primary,
+	       (mqd_t uqd, int slot, size_t len, unsigned int prio))
+{
+	struct cobalt_msg *msg;
+	struct cobalt_mqd *mqd;
+	struct cobalt_mq *mq;
+	unsigned int flags;
+	int ret;
+	spl_t s;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	mq = mqd->mq;
+	flags = rtdm_fd_flags(&mqd->fd) & COBALT_PERMS_MASK;
+	if (flags != O_WRONLY && flags != O_RDWR) {
+		ret = -EBADF;
+		goto out;
+	}
+
+	if (prio >= COBALT_MSGPRIOMAX) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (len > mq->attr.mq_msgsize) {
+		ret = -EMSGSIZE;
+		goto out;
+	}
+
+	msg = mq_slot_get(mq, slot);
+	if (IS_ERR(msg)) {
+		ret = PTR_ERR(msg);
+		goto out;
+	}
+
+	/* Only a slot held through this descriptor may be queued. */
+	xnlock_get_irqsave(&nklock, s);
+	if (msg->owner != mqd) {
+		xnlock_put_irqrestore(&nklock, s);
+		ret = -EINVAL;
+		goto out;
+	}
+	msg->owner = NULL;
+	mqd->nrheld--;
+	xnlock_put_irqrestore(&nklock, s);
+
+	trace_cobalt_mq_send(uqd, msg->data, len, prio);
+	msg->len = len;
+	msg->prio = prio;
+	ret = mq_finish_send(mqd, msg);
+out:
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
+
+COBALT_SYSCALL(mq_slot_receive, primary,
+	       (mqd_t uqd, struct cobalt_mq_slot __user *u_slot))
+{
+	struct cobalt_mq_slot zs;
+	struct cobalt_msg *msg;
+	struct cobalt_mqd *mqd;
+	struct cobalt_mq *mq;
+	int ret;
+
+	if (cobalt_copy_from_user(&zs, u_slot, sizeof(zs)))
+		return -EFAULT;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	mq = mqd->mq;
+	if (mq->slots == NULL) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	msg = mq_timedrcv_inner(mqd, mq->attr.mq_msgsize,
+				(__force const void __user *)&zs.timeout,
+				zs.timeout ? mq_fetch_slot_timeout : NULL);
+	if (IS_ERR(msg)) {
+		ret = PTR_ERR(msg);
+		goto out;
+	}
+
+	zs.len = msg->len;
+	zs.prio = msg->prio;
+	ret = mq_slot_put_user(mqd, msg, &zs, u_slot);
+	if (ret)
+		mq_slot_release(mqd, msg);
+out:
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
+
+COBALT_SYSCALL(mq_slot_free, primary, (mqd_t uqd, int slot))
+{
+	struct cobalt_msg *msg;
+	struct cobalt_mqd *mqd;
+	int ret = 0;
+	spl_t s;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	msg = mq_slot_get(mqd->mq, slot);
+	if (IS_ERR(msg)) {
+		ret = PTR_ERR(msg);
+		goto out;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+	if (msg->owner == mqd) {
+		msg->owner = NULL;
+		mqd->nrheld--;
+		mq_release_msg(mqd->mq, msg);
+		xnsched_run();
+	} else
+		ret = -EINVAL;
+	xnlock_put_irqrestore(&nklock, s);
+out:
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
@@ -22,6 +22,7 @@
 #include <linux/types.h>
 #include <linux/fcntl.h>
 #include <xenomai/posix/syscall.h>
+#include <cobalt/uapi/mqueue.h>
 
 struct mq_attr {
 	long mq_flags;
@@ -89,4 +90,15 @@ COBALT_SYSCALL_DECL(mq_timedreceive64,
 COBALT_SYSCALL_DECL(mq_notify,
 		    (mqd_t fd, const struct sigevent *__user evp));
 
+COBALT_SYSCALL_DECL(mq_slot_alloc,
+		    (mqd_t uqd, struct cobalt_mq_slot __user *u_slot));
+
+COBALT_SYSCALL_DECL(mq_slot_send,
+		    (mqd_t uqd, int slot, size_t len, unsigned int prio));
+
+COBALT_SYSCALL_DECL(mq_slot_receive,
+		    (mqd_t uqd, struct cobalt_mq_slot __user *u_slot));
+
+COBALT_SYSCALL_DECL(mq_slot_free, (mqd_t uqd, int slot));
+
 #endif /* !_COBALT_POSIX_MQUEUE_H */
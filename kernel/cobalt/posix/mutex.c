@@ -23,6 +23,19 @@
 #include "clock.h"
 #include <cobalt/kernel/time.h>
 
+static struct xnheap_cache mutex_cache;
+
+__init int cobalt_mutex_cache_init(void)
+{
+	return xnheap_cache_init(&mutex_cache, &cobalt_heap,
+				 sizeof(struct cobalt_mutex), "mutex");
+}
+
+__init void cobalt_mutex_cache_cleanup(void)
+{
+	xnheap_cache_destroy(&mutex_cache);
+}
+
 static int cobalt_mutex_init_inner(struct cobalt_mutex_shadow *shadow,
 				   struct cobalt_mutex *mutex,
 				   struct cobalt_mutex_state *state,
@@ -255,20 +268,20 @@ COBALT_SYSCALL(mutex_init, current,
 	if (cobalt_copy_from_user(&attr, u_attr, sizeof(attr)))
 		return -EFAULT;
 
-	mutex = xnmalloc(sizeof(*mutex));
+	mutex = xnheap_cache_alloc(&mutex_cache);
 	if (mutex == NULL)
 		return -ENOMEM;
 
 	state = cobalt_umm_alloc(&cobalt_ppd_get(attr.pshared)->umm,
 				 sizeof(*state));
 	if (state == NULL) {
-		xnfree(mutex);
+		xnheap_cache_free(&mutex_cache, mutex);
 		return -EAGAIN;
 	}
 
 	ret = cobalt_mutex_init_inner(&mx, mutex, state, &attr);
 	if (ret) {
-		xnfree(mutex);
+		xnheap_cache_free(&mutex_cache, mutex);
 		cobalt_umm_free(&cobalt_ppd_get(attr.pshared)->umm, state);
 		return ret;
 	}
@@ -427,7 +440,7 @@ void cobalt_mutex_reclaim(struct cobalt_resnode *node, spl_t s)
 	xnlock_put_irqrestore(&nklock, s);
 
 	cobalt_umm_free(&cobalt_ppd_get(pshared)->umm, state);
-	xnfree(mutex);
+	xnheap_cache_free(&mutex_cache, mutex);
 }
 
 struct xnsynch *lookup_lazy_pp(xnhandle_t handle)
@@ -80,4 +80,8 @@ int cobalt_mutex_release(struct xnthread *cur,
 void cobalt_mutex_reclaim(struct cobalt_resnode *node,
 			  spl_t s);
 
+int cobalt_mutex_cache_init(void);
+
+void cobalt_mutex_cache_cleanup(void);
+
 #endif /* !_COBALT_POSIX_MUTEX_H */
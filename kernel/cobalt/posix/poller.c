@@ -0,0 +1,392 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#include <linux/err.h>
+#include <cobalt/kernel/select.h>
+#include <cobalt/kernel/tree.h>
+#include <rtdm/driver.h>
+#include <rtdm/fd.h>
+#include "internal.h"
+#include "clock.h"
+#include "poller.h"
+
+/*
+ * A poller is a persistent interest set of RTDM descriptors, backed
+ * by a selector in poller mode: registering a descriptor binds its
+ * select handler once to a selector item, waiting only walks the
+ * items which are ready.
+ */
+
+#define COBALT_POLLER_BATCH  16
+
+struct cobalt_poll_entry {
+	struct xnid id;		/* Keyed by descriptor. */
+	int ufd;		/* -1 if unused. */
+	int next_free;
+	unsigned int events;
+	__u64 data;
+};
+
+struct cobalt_poller {
+	struct rtdm_fd fd;
+	struct xnselector *selector;
+	rtdm_mutex_t lock;	/* Serializes interest set updates. */
+	struct rb_root tree;
+	struct cobalt_poll_entry *entries;
+	int free_head;
+};
+
+static void poller_close(struct rtdm_fd *fd)
+{
+	struct cobalt_poller *poller;
+
+	poller = container_of(fd, struct cobalt_poller, fd);
+	xnselector_destroy(poller->selector); /* Drops all bindings. */
+	rtdm_mutex_destroy(&poller->lock);
+	xnfree(poller->entries);
+	xnfree(poller);
+}
+
+static struct rtdm_fd_ops poller_ops = {
+	.close = poller_close,
+};
+
+COBALT_SYSCALL(poller_create, lostage, (int size, int flags))
+{
+	struct cobalt_poller *poller;
+	struct xnselector *selector;
+	int ret, ufd, i;
+
+	if (size <= 0 || size > COBALT_POLLER_MAX)
+		return -EINVAL;
+
+	if (flags & ~O_CLOEXEC)
+		return -EINVAL;
+
+	poller = xnmalloc(sizeof(*poller));
+	if (poller == NULL)
+		return -ENOMEM;
+
+	poller->entries = xnmalloc(size * sizeof(*poller->entries));
+	if (poller->entries == NULL) {
+		ret = -ENOMEM;
+		goto fail_entries;
+	}
+
+	selector = xnmalloc(sizeof(*selector));
+	if (selector == NULL) {
+		ret = -ENOMEM;
+		goto fail_selector;
+	}
+
+	ret = xnselector_init_poller(selector, size);
+	if (ret) {
+		xnfree(selector);
+		goto fail_selector;
+	}
+
+	for (i = 0; i < size; i++) {
+		poller->entries[i].ufd = -1;
+		poller->entries[i].next_free = i + 1 < size ? i + 1 : -1;
+	}
+
+	poller->free_head = 0;
+	poller->selector = selector;
+	xntree_init(&poller->tree);
+	rtdm_mutex_init(&poller->lock);
+
+	ufd = __rtdm_anon_getfd("[cobalt-poller]", O_RDWR | flags);
+	if (ufd < 0) {
+		ret = ufd;
+		goto fail_getfd;
+	}
+
+	poller->fd.oflags = 0;
+	ret = rtdm_fd_enter(&poller->fd, ufd, COBALT_POLLER_MAGIC, &poller_ops);
+	if (ret < 0)
+		goto fail;
+
+	ret = rtdm_fd_register(&poller->fd, ufd);
+	if (ret < 0)
+		goto fail;
+
+	return ufd;
+fail:
+	__rtdm_anon_putfd(ufd);
+fail_getfd:
+	rtdm_mutex_destroy(&poller->lock);
+	xnselector_destroy(selector);
+fail_selector:
+	xnfree(poller->entries);
+fail_entries:
+	xnfree(poller);
+
+	return ret;
+}
+
+static inline struct cobalt_poller *poller_get(int ufd)
+{
+	struct rtdm_fd *fd;
+
+	fd = rtdm_fd_get(ufd, COBALT_POLLER_MAGIC);
+	if (IS_ERR(fd))
+		return ERR_PTR(PTR_ERR(fd) == -EADV ? -EBADF : PTR_ERR(fd));
+
+	return container_of(fd, struct cobalt_poller, fd);
+}
+
+static inline void poller_put(struct cobalt_poller *poller)
+{
+	rtdm_fd_put(&poller->fd);
+}
+
+static int poller_bind(struct cobalt_poller *poller, int ufd,
+		       unsigned int index, unsigned int events)
+{
+	unsigned int type;
+	int ret;
+
+	for (type = 0; type < XNSELECT_MAX_TYPES; type++) {
+		if ((events & (1U << type)) == 0)
+			continue;
+		ret = __rtdm_fd_select(ufd, poller->selector, type, index);
+		if (ret) {
+			xnselector_unbind(poller->selector, index);
+			/* Not an RTDM descriptor. */
+			return ret == -EADV ? -EPERM : ret;
+		}
+	}
+
+	return 0;
+}
+
+static void poller_set(struct cobalt_poll_entry *e, int ufd,
+		       const struct cobalt_poll_event *ev)
+{
+	spl_t s;
+
+	/* Readers map ready items to entries under nklock. */
+	xnlock_get_irqsave(&nklock, s);
+	e->ufd = ufd;
+	if (ev) {
+		e->events = ev->events;
+		e->data = ev->data;
+	}
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+static int poller_add(struct cobalt_poller *poller, int ufd,
+		      const struct cobalt_poll_event *ev)
+{
+	struct cobalt_poll_entry *e;
+	int index, ret;
+
+	if (xnid_fetch(&poller->tree, ufd))
+		return -EEXIST;
+
+	index = poller->free_head;
+	if (index < 0)
+		return -ENOSPC;
+
+	e = poller->entries + index;
+	poller_set(e, ufd, ev);
+
+	ret = poller_bind(poller, ufd, index, ev->events);
+	if (ret) {
+		poller_set(e, -1, NULL);
+		return ret;
+	}
+
+	poller->free_head = e->next_free;
+	xnid_enter(&poller->tree, &e->id, ufd);
+
+	return 0;
+}
+
+static int poller_mod(struct cobalt_poller *poller, int ufd,
+		      const struct cobalt_poll_event *ev)
+{
+	struct cobalt_poll_event old;
+	struct cobalt_poll_entry *e;
+	struct xnid *id;
+	int index, ret;
+
+	id = xnid_fetch(&poller->tree, ufd);
+	if (id == NULL)
+		return -ENOENT;
+
+	e = container_of(id, struct cobalt_poll_entry, id);
+	index = e - poller->entries;
+	old.events = e->events;
+	old.data = e->data;
+
+	xnselector_unbind(poller->selector, index);
+	poller_set(e, ufd, ev);
+	ret = poller_bind(poller, ufd, index, ev->events);
+	if (ret) {
+		/* Try restoring the previous interest. */
+		poller_set(e, ufd, &old);
+		poller_bind(poller, ufd, index, old.events);
+	}
+
+	return ret;
+}
+
+static int poller_del(struct cobalt_poller *poller, int ufd)
+{
+	struct cobalt_poll_entry *e;
+	struct xnid *id;
+	int index;
+
+	id = xnid_fetch(&poller->tree, ufd);
+	if (id == NULL)
+		return -ENOENT;
+
+	e = container_of(id, struct cobalt_poll_entry, id);
+	index = e - poller->entries;
+
+	xnselector_unbind(poller->selector, index);
+	xnid_remove(&poller->tree, id);
+	poller_set(e, -1, NULL);
+	e->next_free = poller->free_head;
+	poller->free_head = index;
+
+	return 0;
+}
+
+COBALT_SYSCALL(poller_ctl, primary,
+	       (int pfd, int op, int fd,
+		const struct cobalt_poll_event __user *u_ev))
+{
+	struct cobalt_poll_event ev;
+	struct cobalt_poller *poller;
+	int ret;
+
+	if (op != COBALT_POLLER_DEL) {
+		if (cobalt_copy_from_user(&ev, u_ev, sizeof(ev)))
+			return -EFAULT;
+		if (ev.events & ~(COBALT_POLLIN|COBALT_POLLOUT|COBALT_POLLPRI))
+			return -EINVAL;
+	}
+
+	if (fd == pfd)
+		return -EINVAL;
+
+	poller = poller_get(pfd);
+	if (IS_ERR(poller))
+		return PTR_ERR(poller);
+
+	ret = rtdm_mutex_lock(&poller->lock);
+	if (ret)
+		goto out;
+
+	switch (op) {
+	case COBALT_POLLER_ADD:
+		ret = poller_add(poller, fd, &ev);
+		break;
+	case COBALT_POLLER_MOD:
+		ret = poller_mod(poller, fd, &ev);
+		break;
+	case COBALT_POLLER_DEL:
+		ret = poller_del(poller, fd);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	rtdm_mutex_unlock(&poller->lock);
+out:
+	poller_put(poller);
+
+	return ret;
+}
+
+COBALT_SYSCALL(poller_wait, primary,
+	       (int pfd, struct cobalt_poll_event __user *u_events,
+		int maxevents, const __s64 __user *u_timeout))
+{
+	struct cobalt_poll_event out[COBALT_POLLER_BATCH];
+	struct xnselect_event ev[COBALT_POLLER_BATCH];
+	xnticks_t timeout = XN_INFINITE;
+	struct cobalt_poller *poller;
+	xntmode_t mode = XN_RELATIVE;
+	struct cobalt_poll_entry *e;
+	int ret, count = 0, nr, n, i;
+	unsigned long seq = 0;
+	__s64 ns;
+	spl_t s;
+
+	if (maxevents <= 0)
+		return -EINVAL;
+
+	if (!access_wok(u_events, maxevents * sizeof(*u_events)))
+		return -EFAULT;
+
+	if (u_timeout) {
+		if (cobalt_copy_from_user(&ns, u_timeout, sizeof(ns)))
+			return -EFAULT;
+		if (ns < 0)
+			return -EINVAL;
+		if (ns == 0)
+			timeout = XN_NONBLOCK;
+		else {
+			timeout = clock_get_ticks(CLOCK_MONOTONIC) + ns;
+			mode = XN_ABSOLUTE;
+		}
+	}
+
+	poller = poller_get(pfd);
+	if (IS_ERR(poller))
+		return PTR_ERR(poller);
+
+	/*
+	 * Only the first batch may wait. The following ones pick
+	 * ready items left over by the previous batch, if room is
+	 * left in the caller's array.
+	 */
+	do {
+		nr = min_t(int, maxevents - count, COBALT_POLLER_BATCH);
+		ret = xnselect_poll(poller->selector, ev, nr, &seq,
+				    timeout, mode);
+		if (ret <= 0)
+			break;
+
+		xnlock_get_irqsave(&nklock, s);
+		for (i = n = 0; i < ret; i++) {
+			e = poller->entries + ev[i].index;
+			if (e->ufd < 0)
+				continue; /* Removed meanwhile. */
+			out[n].events = ev[i].events;
+			out[n].__pad = 0;
+			out[n].data = e->data;
+			n++;
+		}
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (n > 0 && cobalt_copy_to_user(u_events + count, out,
+						 n * sizeof(out[0]))) {
+			ret = -EFAULT;
+			break;
+		}
+		count += n;
+	} while (ret == nr && count < maxevents);
+
+	poller_put(poller);
+
+	if (ret < 0 && (ret == -EFAULT || count == 0))
+		return ret;
+
+	return count;
+}
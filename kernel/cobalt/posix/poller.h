@@ -0,0 +1,33 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _COBALT_POSIX_POLLER_H
+#define _COBALT_POSIX_POLLER_H
+
+#include <cobalt/uapi/poller.h>
+#include <xenomai/posix/syscall.h>
+
+COBALT_SYSCALL_DECL(poller_create,
+		    (int size, int flags));
+
+COBALT_SYSCALL_DECL(poller_ctl,
+		    (int pfd, int op, int fd,
+		     const struct cobalt_poll_event __user *u_ev));
+
+COBALT_SYSCALL_DECL(poller_wait,
+		    (int pfd, struct cobalt_poll_event __user *u_events,
+		     int maxevents, const __s64 __user *u_timeout));
+
+#endif /* !_COBALT_POSIX_POLLER_H */
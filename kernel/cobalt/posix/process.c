@@ -67,6 +67,7 @@
 #include "event.h"
 #include "timerfd.h"
 #include "io.h"
+#include "sysstat.h"
 
 static int gid_arg = -1;
 module_param_named(allowed_group, gid_arg, int, 0644);
@@ -1179,6 +1180,26 @@ __init int cobalt_init(void)
 	if (ret)
 		goto fail_siginit;
 
+	ret = cobalt_timer_cache_init();
+	if (ret)
+		goto fail_timer;
+
+	ret = cobalt_mutex_cache_init();
+	if (ret)
+		goto fail_mutex;
+
+	ret = cobalt_cond_cache_init();
+	if (ret)
+		goto fail_cond;
+
+	ret = cobalt_timerfd_cache_init();
+	if (ret)
+		goto fail_timerfd;
+
+	ret = cobalt_sysstat_init();
+	if (ret)
+		goto fail_sysstat;
+
 	ret = pipeline_trap_kevents();
 	if (ret)
 		goto fail_kevents;
@@ -1188,6 +1209,16 @@ __init int cobalt_init(void)
 
 	return 0;
 fail_kevents:
+	cobalt_sysstat_cleanup();
+fail_sysstat:
+	cobalt_timerfd_cache_cleanup();
+fail_timerfd:
+	cobalt_cond_cache_cleanup();
+fail_cond:
+	cobalt_mutex_cache_cleanup();
+fail_mutex:
+	cobalt_timer_cache_cleanup();
+fail_timer:
 	cobalt_signal_cleanup();
 fail_siginit:
 	cobalt_unregister_personality(0);
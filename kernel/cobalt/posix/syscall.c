@@ -41,8 +41,10 @@
 #include "clock.h"
 #include "event.h"
 #include "timerfd.h"
+#include "poller.h"
 #include "io.h"
 #include "corectl.h"
+#include "sysstat.h"
 #include "../debug.h"
 #include <trace/events/cobalt-posix.h>
 
@@ -489,6 +491,7 @@ int handle_head_syscall(bool caller_is_relaxed, struct pt_regs *regs)
 	struct task_struct *p;
 	unsigned long args[6];
 	unsigned int nr, code;
+	xnticks_t start;
 	long ret;
 
 	if (!__xn_syscall_p(regs))
@@ -500,6 +503,7 @@ int handle_head_syscall(bool caller_is_relaxed, struct pt_regs *regs)
 		goto bad_syscall;
 
 	nr = code & (__NR_COBALT_SYSCALLS - 1);
+	start = cobalt_sysstat_start();
 
 	trace_cobalt_head_sysentry(code);
 
@@ -637,6 +641,7 @@ ret_handled:
 	if (thread) {
 		xnthread_clear_localinfo(thread, XNDESCENT);
 		xnstat_counter_inc(&thread->stat.xsc);
+		cobalt_sysstat_account(thread, nr, start);
 		xnthread_sync_window(thread);
 	}
 
@@ -686,6 +691,7 @@ int handle_root_syscall(struct pt_regs *regs)
 	struct task_struct *p;
 	unsigned long args[6];
 	unsigned int nr, code;
+	xnticks_t start;
 	long ret;
 
 	/*
@@ -704,6 +710,7 @@ int handle_root_syscall(struct pt_regs *regs)
 	/* code has already been checked in the head domain handler. */
 	code = __xn_syscall(regs);
 	nr = code & (__NR_COBALT_SYSCALLS - 1);
+	start = cobalt_sysstat_start();
 
 	trace_cobalt_root_sysentry(code);
 
@@ -783,6 +790,7 @@ ret_handled:
 	if (thread) {
 		xnthread_clear_localinfo(thread, XNDESCENT|XNHICCUP);
 		xnstat_counter_inc(&thread->stat.xsc);
+		cobalt_sysstat_account(thread, nr, start);
 		xnthread_sync_window(thread);
 	}
 
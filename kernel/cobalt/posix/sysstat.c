@@ -0,0 +1,404 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#include <linux/percpu.h>
+#include <linux/bitops.h>
+#include <linux/math64.h>
+#include <linux/jump_label.h>
+#include <cobalt/kernel/lock.h>
+#include <cobalt/kernel/vfile.h>
+#include <cobalt/kernel/sched.h>
+#include <cobalt/kernel/thread.h>
+#include <cobalt/uapi/corectl.h>
+#include <xenomai/posix/syscall.h>
+#include <asm/xenomai/syscall.h>
+#include "sysstat.h"
+
+/*
+ * Syscall latency accounting. Each CPU keeps a record per syscall
+ * number, with a log2 histogram of the time spent from the syscall
+ * entry to the return to userland, switching costs included. Each
+ * thread also sums up the time it spent in syscalls, and remembers
+ * the slowest call it issued.
+ *
+ * Accounting is off by default, in which case the syscall path only
+ * runs through a couple of patched out branches.
+ */
+
+#define SYSSTAT_BUCKETS  16
+/*
+ * Bucket #0 counts the calls which took less than 2^10 ns, bucket #n
+ * those below 2^(10+n) ns, the last one everything else.
+ */
+#define SYSSTAT_SHIFT    10
+
+struct cobalt_sysstat {
+	unsigned long count;
+	xnticks_t total;	/* ns */
+	xnticks_t max;		/* ns */
+	unsigned int hist[SYSSTAT_BUCKETS];
+};
+
+struct cobalt_sysstat_cpu {
+	DECLARE_XNLOCK(lock);
+	struct cobalt_sysstat calls[__NR_COBALT_SYSCALLS];
+};
+
+DEFINE_STATIC_KEY_FALSE(cobalt_sysstat_key);
+
+static DEFINE_PER_CPU(struct cobalt_sysstat_cpu, sysstat_cpu);
+
+/*
+ * Threads lazily drop their figures when this generation count
+ * moves past the one they recorded.
+ */
+static unsigned long sysstat_gen = 1;
+
+#define __COBALT_CALL_ENTRY(__name)	\
+	[sc_cobalt_ ## __name] = #__name,
+
+#include "syscall_entries.h"
+
+static const char *sysstat_names[__NR_COBALT_SYSCALLS] = {
+	__COBALT_CALL_ENTRIES
+};
+
+void __cobalt_sysstat_account(struct xnthread *thread,
+			      unsigned int nr, xnticks_t start)
+{
+	struct cobalt_sysstat_cpu *sc;
+	struct cobalt_sysstat *st;
+	unsigned long gen;
+	xnticks_t ns;
+	int bucket;
+	spl_t s;
+
+	ns = xnclock_core_ticks_to_ns(xnclock_core_read_raw() - start);
+	bucket = min_t(int, fls64(ns >> SYSSTAT_SHIFT), SYSSTAT_BUCKETS - 1);
+
+	/* We may run over the root stage, pin the CPU first. */
+	splhigh(s);
+	sc = raw_cpu_ptr(&sysstat_cpu);
+	xnlock_get(&sc->lock);
+	st = sc->calls + nr;
+	st->count++;
+	st->total += ns;
+	if (ns > st->max)
+		st->max = ns;
+	st->hist[bucket]++;
+	xnlock_put(&sc->lock);
+	splexit(s);
+
+	/* Only the current thread updates its own figures. */
+	gen = READ_ONCE(sysstat_gen);
+	if (thread->stat.sc.gen != gen) {
+		thread->stat.sc.count = 0;
+		thread->stat.sc.total = 0;
+		thread->stat.sc.max = 0;
+		thread->stat.sc.gen = gen;
+	}
+
+	thread->stat.sc.count++;
+	thread->stat.sc.total += ns;
+	if (ns > thread->stat.sc.max) {
+		thread->stat.sc.max = ns;
+		thread->stat.sc.max_nr = nr;
+	}
+}
+
+static void sysstat_reset(void)
+{
+	struct cobalt_sysstat_cpu *sc;
+	int cpu, nr;
+	spl_t s;
+
+	for_each_possible_cpu(cpu) {
+		sc = &per_cpu(sysstat_cpu, cpu);
+		/* Keep the locked sections short. */
+		for (nr = 0; nr < __NR_COBALT_SYSCALLS; nr++) {
+			xnlock_get_irqsave(&sc->lock, s);
+			memset(sc->calls + nr, 0, sizeof(sc->calls[nr]));
+			xnlock_put_irqrestore(&sc->lock, s);
+		}
+	}
+
+	WRITE_ONCE(sysstat_gen, sysstat_gen + 1);
+}
+
+int cobalt_sysstat_control(void __user *u_buf, size_t u_bufsz)
+{
+	__u32 op;
+
+	if (u_bufsz != sizeof(op))
+		return -EINVAL;
+
+	if (cobalt_copy_from_user(&op, u_buf, sizeof(op)))
+		return -EFAULT;
+
+	switch (op) {
+	case _CC_COBALT_SYSSTAT_QUERY:
+		op = static_key_enabled(&cobalt_sysstat_key) ?
+			_CC_COBALT_SYSSTAT_ON : _CC_COBALT_SYSSTAT_OFF;
+		return cobalt_copy_to_user(u_buf, &op, sizeof(op)) ?
+			-EFAULT : 0;
+	case _CC_COBALT_SYSSTAT_RESET:
+		sysstat_reset();
+		return 0;
+	case _CC_COBALT_SYSSTAT_ON:
+	case _CC_COBALT_SYSSTAT_OFF:
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* Patching the branches may sleep. */
+	if (is_primary_domain())
+		return -ENOSYS;
+
+	if (op == _CC_COBALT_SYSSTAT_ON)
+		static_branch_enable(&cobalt_sysstat_key);
+	else
+		static_branch_disable(&cobalt_sysstat_key);
+
+	return 0;
+}
+
+static struct xnvfile_directory sysstat_vfroot;
+
+struct vfile_sysstat_data {
+	int nr;
+	struct cobalt_sysstat st;
+};
+
+static void *sysstat_vfile_next(struct xnvfile_regular_iterator *it)
+{
+	struct vfile_sysstat_data *p = xnvfile_iterator_priv(it);
+	struct cobalt_sysstat_cpu *sc;
+	struct cobalt_sysstat *st;
+	int cpu, n, nr;
+	spl_t s;
+
+	nr = it->pos - 1;
+	if (nr >= __NR_COBALT_SYSCALLS)
+		return NULL;
+
+	memset(p, 0, sizeof(*p));
+	p->nr = nr;
+
+	for_each_possible_cpu(cpu) {
+		sc = &per_cpu(sysstat_cpu, cpu);
+		xnlock_get_irqsave(&sc->lock, s);
+		st = sc->calls + nr;
+		p->st.count += st->count;
+		p->st.total += st->total;
+		if (st->max > p->st.max)
+			p->st.max = st->max;
+		for (n = 0; n < SYSSTAT_BUCKETS; n++)
+			p->st.hist[n] += st->hist[n];
+		xnlock_put_irqrestore(&sc->lock, s);
+	}
+
+	return p;
+}
+
+static void *sysstat_vfile_begin(struct xnvfile_regular_iterator *it)
+{
+	if (it->pos == 0)
+		return VFILE_SEQ_START;
+
+	return sysstat_vfile_next(it);
+}
+
+static int sysstat_vfile_show(struct xnvfile_regular_iterator *it, void *data)
+{
+	struct vfile_sysstat_data *p = data;
+	int n;
+
+	if (p == NULL) {
+		xnvfile_printf(it, "%-24s %-10s %-14s %-10s %-10s  %s\n",
+			       "NAME", "COUNT", "TOTAL(ns)", "AVG(ns)",
+			       "MAX(ns)", "LOG2 HISTOGRAM (<2^10 .. >=2^24 ns)");
+		return 0;
+	}
+
+	if (p->st.count == 0)
+		return VFILE_SEQ_SKIP;
+
+	xnvfile_printf(it, "%-24s %-10lu %-14Lu %-10Lu %-10Lu ",
+		       sysstat_names[p->nr] ?: "?", p->st.count,
+		       p->st.total, div64_u64(p->st.total, p->st.count),
+		       p->st.max);
+
+	for (n = 0; n < SYSSTAT_BUCKETS; n++)
+		xnvfile_printf(it, " %u", p->st.hist[n]);
+
+	xnvfile_printf(it, "\n");
+
+	return 0;
+}
+
+static ssize_t sysstat_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val != 0)
+		return -EINVAL;
+
+	sysstat_reset();
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops sysstat_vfile_ops = {
+	.begin = sysstat_vfile_begin,
+	.next = sysstat_vfile_next,
+	.show = sysstat_vfile_show,
+	.store = sysstat_vfile_store,
+};
+
+static struct xnvfile_regular sysstat_vfile = {
+	.privsz = sizeof(struct vfile_sysstat_data),
+	.ops = &sysstat_vfile_ops,
+};
+
+struct vfile_systhreads_priv {
+	struct xnthread *curr;
+	unsigned long gen;
+};
+
+struct vfile_systhreads_data {
+	int cpu;
+	pid_t pid;
+	char name[XNOBJECT_NAME_LEN];
+	unsigned long count;
+	xnticks_t total;
+	xnticks_t max;
+	int max_nr;
+};
+
+static struct xnvfile_snapshot_ops vfile_systhreads_ops;
+
+static struct xnvfile_snapshot systhreads_vfile = {
+	.privsz = sizeof(struct vfile_systhreads_priv),
+	.datasz = sizeof(struct vfile_systhreads_data),
+	.tag = &nkthreadlist_tag,
+	.ops = &vfile_systhreads_ops,
+};
+
+static int vfile_systhreads_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_systhreads_priv *priv = xnvfile_iterator_priv(it);
+
+	/* &nkthreadq cannot be empty (root thread(s)). */
+	priv->curr = list_first_entry(&nkthreadq, struct xnthread, glink);
+	priv->gen = READ_ONCE(sysstat_gen);
+
+	return cobalt_nrthreads;
+}
+
+static int vfile_systhreads_next(struct xnvfile_snapshot_iterator *it,
+				 void *data)
+{
+	struct vfile_systhreads_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_systhreads_data *p = data;
+	struct xnthread *thread;
+
+	if (priv->curr == NULL)
+		return 0;	/* All done. */
+
+	thread = priv->curr;
+	if (list_is_last(&thread->glink, &nkthreadq))
+		priv->curr = NULL;
+	else
+		priv->curr = list_next_entry(thread, glink);
+
+	if (thread->stat.sc.gen != priv->gen || thread->stat.sc.count == 0)
+		return VFILE_SEQ_SKIP;
+
+	p->cpu = xnsched_cpu(thread->sched);
+	p->pid = xnthread_host_pid(thread);
+	memcpy(p->name, thread->name, sizeof(p->name));
+	p->count = thread->stat.sc.count;
+	p->total = thread->stat.sc.total;
+	p->max = thread->stat.sc.max;
+	p->max_nr = thread->stat.sc.max_nr;
+
+	return 1;
+}
+
+static int vfile_systhreads_show(struct xnvfile_snapshot_iterator *it,
+				 void *data)
+{
+	struct vfile_systhreads_data *p = data;
+
+	if (p == NULL)
+		xnvfile_printf(it, "%-3s  %-6s %-10s %-14s %-10s %-24s %s\n",
+			       "CPU", "PID", "COUNT", "TOTAL(ns)", "MAX(ns)",
+			       "SLOWEST", "NAME");
+	else
+		xnvfile_printf(it, "%3u  %-6d %-10lu %-14Lu %-10Lu %-24s %s\n",
+			       p->cpu, p->pid, p->count, p->total, p->max,
+			       sysstat_names[p->max_nr] ?: "?", p->name);
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_systhreads_ops = {
+	.rewind = vfile_systhreads_rewind,
+	.next = vfile_systhreads_next,
+	.show = vfile_systhreads_show,
+};
+
+int cobalt_sysstat_init(void)
+{
+	int ret, cpu;
+
+	for_each_possible_cpu(cpu)
+		xnlock_init(&per_cpu(sysstat_cpu, cpu).lock);
+
+	ret = xnvfile_init_dir("syscalls", &sysstat_vfroot, &cobalt_vfroot);
+	if (ret)
+		return ret;
+
+	ret = xnvfile_init_regular("stat", &sysstat_vfile, &sysstat_vfroot);
+	if (ret)
+		goto fail_stat;
+
+	ret = xnvfile_init_snapshot("threads", &systhreads_vfile,
+				    &sysstat_vfroot);
+	if (ret)
+		goto fail_threads;
+
+	return 0;
+fail_threads:
+	xnvfile_destroy_regular(&sysstat_vfile);
+fail_stat:
+	xnvfile_destroy_dir(&sysstat_vfroot);
+
+	return ret;
+}
+
+void cobalt_sysstat_cleanup(void)
+{
+	static_branch_disable(&cobalt_sysstat_key);
+	xnvfile_destroy_snapshot(&systhreads_vfile);
+	xnvfile_destroy_regular(&sysstat_vfile);
+	xnvfile_destroy_dir(&sysstat_vfroot);
+}
@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _COBALT_POSIX_SYSSTAT_H
+#define _COBALT_POSIX_SYSSTAT_H
+
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <cobalt/kernel/clock.h>
+
+struct xnthread;
+
+#ifdef CONFIG_XENO_OPT_STATS_SYSCALLS
+
+#include <linux/jump_label.h>
+
+DECLARE_STATIC_KEY_FALSE(cobalt_sysstat_key);
+
+static inline xnticks_t cobalt_sysstat_start(void)
+{
+	if (static_branch_unlikely(&cobalt_sysstat_key))
+		return xnclock_core_read_raw();
+
+	return 0;
+}
+
+void __cobalt_sysstat_account(struct xnthread *thread,
+			      unsigned int nr, xnticks_t start);
+
+static inline void cobalt_sysstat_account(struct xnthread *thread,
+					  unsigned int nr, xnticks_t start)
+{
+	/* start is zero if accounting was off on entry. */
+	if (static_branch_unlikely(&cobalt_sysstat_key) && start)
+		__cobalt_sysstat_account(thread, nr, start);
+}
+
+int cobalt_sysstat_control(void __user *u_buf, size_t u_bufsz);
+
+int cobalt_sysstat_init(void);
+
+void cobalt_sysstat_cleanup(void);
+
+#else /* !CONFIG_XENO_OPT_STATS_SYSCALLS */
+
+static inline xnticks_t cobalt_sysstat_start(void)
+{
+	return 0;
+}
+
+static inline void cobalt_sysstat_account(struct xnthread *thread,
+					  unsigned int nr, xnticks_t start)
+{ }
+
+static inline int cobalt_sysstat_control(void __user *u_buf, size_t u_bufsz)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline int cobalt_sysstat_init(void)
+{
+	return 0;
+}
+
+static inline void cobalt_sysstat_cleanup(void) { }
+
+#endif /* !CONFIG_XENO_OPT_STATS_SYSCALLS */
+
+#endif /* !_COBALT_POSIX_SYSSTAT_H */
@@ -25,6 +25,19 @@
 #include "clock.h"
 #include "signal.h"
 
+static struct xnheap_cache timer_cache;
+
+__init int cobalt_timer_cache_init(void)
+{
+	return xnheap_cache_init(&timer_cache, &cobalt_heap,
+				 sizeof(struct cobalt_timer), "timer");
+}
+
+__init void cobalt_timer_cache_cleanup(void)
+{
+	xnheap_cache_destroy(&timer_cache);
+}
+
 void cobalt_timer_handler(struct xntimer *xntimer)
 {
 	struct cobalt_timer *timer;
@@ -133,7 +146,7 @@ static inline int timer_create(clockid_t clockid,
 	if (cc == NULL)
 		return -EPERM;
 
-	timer = xnmalloc(sizeof(*timer));
+	timer = xnheap_cache_alloc(&timer_cache);
 	if (timer == NULL)
 		return -ENOMEM;
 
@@ -196,7 +209,7 @@ fail:
 out:
 	xnlock_put_irqrestore(&nklock, s);
 
-	xnfree(timer);
+	xnheap_cache_free(&timer_cache, timer);
 
 	return ret;
 }
@@ -250,7 +263,7 @@ timer_delete(timer_t timerid)
 
 	timer_cleanup(cc, timer);
 	xnlock_put_irqrestore(&nklock, s);
-	xnfree(timer);
+	xnheap_cache_free(&timer_cache, timer);
 
 	return ret;
 
@@ -580,7 +593,7 @@ void cobalt_timer_reclaim(struct cobalt_process *p)
 		cobalt_call_extension(timer_cleanup, &timer->extref, ret);
 		timer_cleanup(p, timer);
 		xnlock_put_irqrestore(&nklock, s);
-		xnfree(timer);
+		xnheap_cache_free(&timer_cache, timer);
 		xnlock_get_irqsave(&nklock, s);
 	}
 out:
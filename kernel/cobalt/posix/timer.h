@@ -83,4 +83,8 @@ COBALT_SYSCALL_DECL(timer_gettime,
 
 COBALT_SYSCALL_DECL(timer_getoverrun, (timer_t tm));
 
+int cobalt_timer_cache_init(void);
+
+void cobalt_timer_cache_cleanup(void);
+
 #endif /* !_COBALT_POSIX_TIMER_H */
@@ -37,6 +37,19 @@ struct cobalt_tfd {
 	struct xnthread *target;
 };
 
+static struct xnheap_cache timerfd_cache;
+
+__init int cobalt_timerfd_cache_init(void)
+{
+	return xnheap_cache_init(&timerfd_cache, &cobalt_heap,
+				 sizeof(struct cobalt_tfd), "timerfd");
+}
+
+__init void cobalt_timerfd_cache_cleanup(void)
+{
+	xnheap_cache_destroy(&timerfd_cache);
+}
+
 #define COBALT_TFD_TICKED	(1 << 2)
 
 #define COBALT_TFD_SETTIME_FLAGS (TFD_TIMER_ABSTIME | TFD_WAKEUP)
@@ -139,7 +152,7 @@ static void timerfd_close(struct rtdm_fd *fd)
 	xnsched_run();
 	xnlock_put_irqrestore(&nklock, s);
 	xnselect_destroy(&tfd->read_select); /* Reschedules. */
-	xnfree(tfd);
+	xnheap_cache_free(&timerfd_cache, tfd);
 }
 
 static struct rtdm_fd_ops timerfd_ops = {
@@ -174,7 +187,7 @@ COBALT_SYSCALL(timerfd_create, lostage, (int clockid, int flags))
 	if (IS_ERR(clock))
 		return PTR_ERR(clock);
 
-	tfd = xnmalloc(sizeof(*tfd));
+	tfd = xnheap_cache_alloc(&timerfd_cache);
 	if (tfd == NULL)
 		return -ENOMEM;
 
@@ -210,7 +223,7 @@ fail:
 	xntimer_destroy(&tfd->timer);
 	__rtdm_anon_putfd(ufd);
 fail_getfd:
-	xnfree(tfd);
+	xnheap_cache_free(&timerfd_cache, tfd);
 
 	return ret;
 }
@@ -39,4 +39,8 @@ COBALT_SYSCALL_DECL(timerfd_settime,
 COBALT_SYSCALL_DECL(timerfd_gettime,
 		    (int fd, struct __user_old_itimerspec __user *curr_value));
 
+int cobalt_timerfd_cache_init(void);
+
+void cobalt_timerfd_cache_cleanup(void);
+
 #endif /* TIMERFD_H */
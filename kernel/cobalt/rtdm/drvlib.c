@@ -109,6 +109,40 @@ nanosecs_abs_t rtdm_clock_read_monotonic(void);
 int rtdm_task_init(rtdm_task_t *task, const char *name,
 		   rtdm_task_proc_t task_proc, void *arg,
 		   int priority, nanosecs_rel_t period)
+{
+	return rtdm_task_init_on(task, name, task_proc, arg,
+				 priority, period, cpu_all_mask);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_task_init);
+
+/**
+ * @brief Initialise and start a real-time task on a set of CPUs
+ *
+ * Same as rtdm_task_init(), except that the task is restricted to
+ * run on the CPUs from @a affinity.
+ *
+ * @param[in,out] task Task handle
+ * @param[in] name Optional task name
+ * @param[in] task_proc Procedure to be executed by the task
+ * @param[in] arg Custom argument passed to @c task_proc() on entry
+ * @param[in] priority Priority of the task, see also
+ * @ref rtdmtaskprio "Task Priority Range"
+ * @param[in] period Period in nanoseconds of a cyclic task, 0 for non-cyclic
+ * mode.
+ * @param[in] affinity CPU affinity of the task. This set is
+ * intersected with the CPUs available to the real-time core.
+ *
+ * @return 0 on success, otherwise negative error code. -EINVAL is
+ * returned if @a affinity contains no CPU available to the real-time
+ * core.
+ *
+ * @coretags{secondary-only, might-switch}
+ */
+int rtdm_task_init_on(rtdm_task_t *task, const char *name,
+		      rtdm_task_proc_t task_proc, void *arg,
+		      int priority, nanosecs_rel_t period,
+		      const cpumask_t *affinity)
 {
 	union xnsched_policy_param param;
 	struct xnthread_start_attr sattr;
@@ -121,7 +155,7 @@ int rtdm_task_init(rtdm_task_t *task, const char *name,
 	iattr.name = name;
 	iattr.flags = 0;
 	iattr.personality = &xenomai_personality;
-	iattr.affinity = CPU_MASK_ALL;
+	cpumask_copy(&iattr.affinity, affinity);
 	param.rt.prio = priority;
 
 	err = xnthread_init(task, &iattr, &xnsched_class_rt, &param);
@@ -155,7 +189,7 @@ int rtdm_task_init(rtdm_task_t *task, const char *name,
 	return err;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_task_init);
+EXPORT_SYMBOL_GPL(rtdm_task_init_on);
 
 #ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
 /**
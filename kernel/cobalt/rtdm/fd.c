@@ -979,6 +979,17 @@ int rtdm_fd_valid_p(int ufd)
  */
 int rtdm_fd_select(int ufd, struct xnselector *selector,
 		   unsigned int type)
+{
+	return __rtdm_fd_select(ufd, selector, type, ufd);
+}
+
+/*
+ * Same as rtdm_fd_select(), binding the event to an arbitrary
+ * selector @a index instead of the descriptor number, as pollers
+ * require.
+ */
+int __rtdm_fd_select(int ufd, struct xnselector *selector,
+		     unsigned int type, unsigned int index)
 {
 	struct rtdm_fd *fd;
 	int ret;
@@ -989,7 +1000,7 @@ int rtdm_fd_select(int ufd, struct xnselector *selector,
 
 	set_compat_bit(fd);
 
-	ret = fd->ops->select(fd, selector, type, ufd);
+	ret = fd->ops->select(fd, selector, type, index);
 
 	if (!XENO_ASSERT(COBALT, !spltest()))
 		splnone();
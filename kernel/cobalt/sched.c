@@ -26,6 +26,7 @@
 #include <cobalt/kernel/intr.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/arith.h>
+#include <cobalt/kernel/tracering.h>
 #include <cobalt/uapi/signal.h>
 #include <pipeline/sched.h>
 #define CREATE_TRACE_POINTS
@@ -622,7 +623,7 @@ void xnsched_migrate_passive(struct xnthread *thread, struct xnsched *sched)
 	}
 }
 
-#ifdef CONFIG_XENO_OPT_SCALABLE_SCHED
+#ifdef CONFIG_XENO_OPT_SCHED_MLQ
 
 void xnsched_initq(struct xnsched_mlq *q)
 {
@@ -630,10 +631,14 @@ void xnsched_initq(struct xnsched_mlq *q)
 
 	q->elems = 0;
 	bitmap_zero(q->prio_map, XNSCHED_MLQ_LEVELS);
+#ifdef CONFIG_XENO_OPT_SCHED_BITMAP
+	q->summary = 0;
+#endif
 
 	for (prio = 0; prio < XNSCHED_MLQ_LEVELS; prio++)
 		INIT_LIST_HEAD(q->heads + prio);
 }
+EXPORT_SYMBOL_GPL(xnsched_initq);
 
 static inline int get_qindex(struct xnsched_mlq *q, int prio)
 {
@@ -649,6 +654,23 @@ static inline int get_qindex(struct xnsched_mlq *q, int prio)
 	return XNSCHED_MLQ_LEVELS - prio - 1;
 }
 
+static inline void set_qbit(struct xnsched_mlq *q, int idx)
+{
+	__set_bit(idx, q->prio_map);
+#ifdef CONFIG_XENO_OPT_SCHED_BITMAP
+	q->summary |= 1UL << BIT_WORD(idx);
+#endif
+}
+
+static inline void clear_qbit(struct xnsched_mlq *q, int idx)
+{
+	__clear_bit(idx, q->prio_map);
+#ifdef CONFIG_XENO_OPT_SCHED_BITMAP
+	if (q->prio_map[BIT_WORD(idx)] == 0)
+		q->summary &= ~(1UL << BIT_WORD(idx));
+#endif
+}
+
 static struct list_head *add_q(struct xnsched_mlq *q, int prio)
 {
 	struct list_head *head;
@@ -660,7 +682,7 @@ static struct list_head *add_q(struct xnsched_mlq *q, int prio)
 
 	/* New item is not linked yet. */
 	if (list_empty(head))
-		__set_bit(idx, q->prio_map);
+		set_qbit(q, idx);
 
 	return head;
 }
@@ -670,12 +692,14 @@ void xnsched_addq(struct xnsched_mlq *q, struct xnthread *thread)
 	struct list_head *head = add_q(q, thread->cprio);
 	list_add(&thread->rlink, head);
 }
+EXPORT_SYMBOL_GPL(xnsched_addq);
 
 void xnsched_addq_tail(struct xnsched_mlq *q, struct xnthread *thread)
 {
 	struct list_head *head = add_q(q, thread->cprio);
 	list_add_tail(&thread->rlink, head);
 }
+EXPORT_SYMBOL_GPL(xnsched_addq_tail);
 
 static void del_q(struct xnsched_mlq *q,
 		  struct list_head *entry, int idx)
@@ -686,13 +710,14 @@ static void del_q(struct xnsched_mlq *q,
 	q->elems--;
 
 	if (list_empty(head))
-		__clear_bit(idx, q->prio_map);
+		clear_qbit(q, idx);
 }
 
 void xnsched_delq(struct xnsched_mlq *q, struct xnthread *thread)
 {
 	del_q(q, &thread->rlink, get_qindex(q, thread->cprio));
 }
+EXPORT_SYMBOL_GPL(xnsched_delq);
 
 struct xnthread *xnsched_getq(struct xnsched_mlq *q)
 {
@@ -711,6 +736,7 @@ struct xnthread *xnsched_getq(struct xnsched_mlq *q)
 
 	return thread;
 }
+EXPORT_SYMBOL_GPL(xnsched_getq);
 
 struct xnthread *xnsched_findq(struct xnsched_mlq *q, int prio)
 {
@@ -724,6 +750,7 @@ struct xnthread *xnsched_findq(struct xnsched_mlq *q, int prio)
 
 	return list_first_entry(head, struct xnthread, rlink);
 }
+EXPORT_SYMBOL_GPL(xnsched_findq);
 
 #ifdef CONFIG_XENO_OPT_SCHED_CLASSES
 
@@ -764,7 +791,7 @@ struct xnthread *xnsched_rt_pick(struct xnsched *sched)
 
 #endif /* CONFIG_XENO_OPT_SCHED_CLASSES */
 
-#else /* !CONFIG_XENO_OPT_SCALABLE_SCHED */
+#else /* !CONFIG_XENO_OPT_SCHED_MLQ */
 
 struct xnthread *xnsched_findq(struct list_head *q, int prio)
 {
@@ -781,6 +808,7 @@ struct xnthread *xnsched_findq(struct list_head *q, int prio)
 
 	return NULL;
 }
+EXPORT_SYMBOL_GPL(xnsched_findq);
 
 #ifdef CONFIG_XENO_OPT_SCHED_CLASSES
 
@@ -803,7 +831,7 @@ struct xnthread *xnsched_rt_pick(struct xnsched *sched)
 
 #endif /* CONFIG_XENO_OPT_SCHED_CLASSES */
 
-#endif /* !CONFIG_XENO_OPT_SCALABLE_SCHED */
+#endif /* !CONFIG_XENO_OPT_SCHED_MLQ */
 
 /**
  * @fn int xnsched_run(void)
@@ -940,6 +968,8 @@ int ___xnsched_run(struct xnsched *sched)
 	prev = curr;
 
 	trace_cobalt_switch_context(prev, next);
+	xntrace_ring_log(COBALT_TRACE_SWITCH, next,
+			 xnthread_host_pid(prev), next->cprio);
 
 	/*
 	 * sched->curr is shared locklessly with xnsched_run() and
@@ -45,6 +45,17 @@
  * - a @a struct @a xnselector structure, the selection structure,  passed by
  * the thread calling the xnselect service, where this service does all its
  * housekeeping.
+ *
+ * A selector may alternatively be set up in poller mode by
+ * xnselector_init_poller(). In this mode, the index passed to
+ * xnselect_bind() designates an item of a fixed-size table instead of
+ * a bit in the fd_set masks, and state changes queue the
+ * corresponding item to a ready list. Waiting with xnselect_poll()
+ * then costs O(number of ready items), regardless of the number of
+ * descriptors being watched, and the interest set persists across
+ * waits until xnselector_unbind() drops an item. The file descriptor
+ * side is not affected: the same @a xnselect blocks and select
+ * handlers serve both modes.
  * @{
  */
 
@@ -64,14 +75,63 @@ static int deletion_virq;
 void xnselect_init(struct xnselect *select_block)
 {
 	INIT_LIST_HEAD(&select_block->bindings);
+	select_block->probe = NULL;
 }
 EXPORT_SYMBOL_GPL(xnselect_init);
 
+/**
+ * Initialize a @a struct @a xnselect structure with a state probe.
+ *
+ * Some descriptors stop being ready without the kernel being told,
+ * e.g. when user space hands shared buffers back by writing to
+ * memory. For those, the selector calls @a probe before reporting
+ * the descriptor as ready, and drops the readiness if @a probe
+ * returns zero. Becoming ready must still be signaled with
+ * xnselect_signal().
+ *
+ * @param select_block pointer to the xnselect structure to be initialized
+ *
+ * @param probe state probe, called with nklock held, irqs off.
+ *
+ * @coretags{task-unrestricted}
+ */
+void xnselect_init_probe(struct xnselect *select_block,
+			 unsigned int (*probe)(struct xnselect *select_block))
+{
+	INIT_LIST_HEAD(&select_block->bindings);
+	select_block->probe = probe;
+}
+EXPORT_SYMBOL_GPL(xnselect_init_probe);
+
 static inline int xnselect_wakeup(struct xnselector *selector)
 {
 	return xnsynch_flush(&selector->synchbase, 0) == XNSYNCH_RESCHED;
 }
 
+/* Must be called with nklock locked irqs off */
+static int xnselect_item_signal(struct xnselector *selector,
+				struct xnselect_item *item,
+				unsigned int type, unsigned int state)
+{
+	unsigned int bit = 1U << type;
+
+	if (state) {
+		if (item->pending & bit)
+			return 0;
+		item->pending |= bit;
+		if (!list_empty(&item->link))
+			return 0;
+		list_add_tail(&item->link, &selector->ready);
+		return xnselect_wakeup(selector);
+	}
+
+	item->pending &= ~bit;
+	if (item->pending == 0)
+		list_del_init(&item->link);
+
+	return 0;
+}
+
 /**
  * Bind a file descriptor (represented by its @a xnselect structure) to a
  * selector block.
@@ -102,6 +162,9 @@ static inline int xnselect_wakeup(struct xnselector *selector)
  * @retval -EINVAL if @a type or @a index is invalid;
  * @retval 0 otherwise.
  *
+ * @note If @a selector is in poller mode, @a index designates an item
+ * of the selector table.
+ *
  * @coretags{task-unrestricted, might-switch, atomic-entry}
  */
 int xnselect_bind(struct xnselect *select_block,
@@ -111,9 +174,17 @@ int xnselect_bind(struct xnselect *select_block,
 		  unsigned index,
 		  unsigned state)
 {
+	struct xnselect_item *item;
+
 	atomic_only();
 
-	if (type >= XNSELECT_MAX_TYPES || index > __FD_SETSIZE)
+	if (type >= XNSELECT_MAX_TYPES)
+		return -EINVAL;
+
+	if (selector->items) {
+		if (index >= selector->nr_items)
+			return -EINVAL;
+	} else if (index > __FD_SETSIZE)
 		return -EINVAL;
 
 	binding->selector = selector;
@@ -121,8 +192,18 @@ int xnselect_bind(struct xnselect *select_block,
 	binding->type = type;
 	binding->bit_index = index;
 
-	list_add_tail(&binding->slink, &selector->bindings);
 	list_add_tail(&binding->link, &select_block->bindings);
+
+	if (selector->items) {
+		item = selector->items + index;
+		list_add_tail(&binding->slink, &item->bindings);
+		item->expected |= 1U << type;
+		if (xnselect_item_signal(selector, item, type, state))
+			xnsched_run();
+		return 0;
+	}
+
+	list_add_tail(&binding->slink, &selector->bindings);
 	__FD_SET__(index, &selector->fds[type].expected);
 	if (state) {
 		__FD_SET__(index, &selector->fds[type].pending);
@@ -144,6 +225,13 @@ int __xnselect_signal(struct xnselect *select_block, unsigned state)
 
 	list_for_each_entry(binding, &select_block->bindings, link) {
 		selector = binding->selector;
+		if (selector->items) {
+			if (xnselect_item_signal(selector,
+					 selector->items + binding->bit_index,
+					 binding->type, state))
+				resched = 1;
+			continue;
+		}
 		if (state) {
 			if (!__FD_ISSET__(binding->bit_index,
 					&selector->fds[binding->type].pending)) {
@@ -173,8 +261,9 @@ EXPORT_SYMBOL_GPL(__xnselect_signal);
  */
 void xnselect_destroy(struct xnselect *select_block)
 {
-	struct xnselect_binding *binding, *tmp;
+	struct xnselect_binding *binding;
 	struct xnselector *selector;
+	struct xnselect_item *item;
 	int resched = 0;
 	spl_t s;
 
@@ -183,17 +272,34 @@ void xnselect_destroy(struct xnselect *select_block)
 	if (list_empty(&select_block->bindings))
 		goto out;
 
-	list_for_each_entry_safe(binding, tmp, &select_block->bindings, link) {
+	/*
+	 * The lock is dropped for releasing each binding, during
+	 * which xnselector_unbind() may remove others: always restart
+	 * from the list head.
+	 */
+	while (!list_empty(&select_block->bindings)) {
+		binding = list_first_entry(&select_block->bindings,
+					   struct xnselect_binding, link);
 		list_del(&binding->link);
 		selector = binding->selector;
-		__FD_CLR__(binding->bit_index,
-			 &selector->fds[binding->type].expected);
-		if (!__FD_ISSET__(binding->bit_index,
-				&selector->fds[binding->type].pending)) {
-			__FD_SET__(binding->bit_index,
-				 &selector->fds[binding->type].pending);
-			if (xnselect_wakeup(selector))
+		if (selector->items) {
+			/* Report the loss once, until unbound. */
+			item = selector->items + binding->bit_index;
+			item->expected &= ~(1U << binding->type);
+			item->pending &= ~(1U << binding->type);
+			if (xnselect_item_signal(selector, item,
+						 XNSELECT_HUP, 1))
 				resched = 1;
+		} else {
+			__FD_CLR__(binding->bit_index,
+				   &selector->fds[binding->type].expected);
+			if (!__FD_ISSET__(binding->bit_index,
+					  &selector->fds[binding->type].pending)) {
+				__FD_SET__(binding->bit_index,
+					   &selector->fds[binding->type].pending);
+				if (xnselect_wakeup(selector))
+					resched = 1;
+			}
 		}
 		list_del(&binding->slink);
 		xnlock_put_irqrestore(&nklock, s);
@@ -256,6 +362,22 @@ static void fd_set_zeropad(fd_set *set, unsigned n)
 		set->fds_bits[i] = 0;
 }
 
+/* Must be called with nklock locked irqs off */
+static void xnselect_probe_all(struct xnselector *selector)
+{
+	struct xnselect_binding *binding;
+	struct fds *fds;
+
+	list_for_each_entry(binding, &selector->bindings, slink) {
+		if (binding->fd->probe == NULL)
+			continue;
+		fds = &selector->fds[binding->type];
+		if (__FD_ISSET__(binding->bit_index, &fds->pending) &&
+		    !binding->fd->probe(binding->fd))
+			__FD_CLR__(binding->bit_index, &fds->pending);
+	}
+}
+
 static unsigned fd_set_popcount(fd_set *set, unsigned n)
 {
 	unsigned count = 0, i;
@@ -289,11 +411,103 @@ int xnselector_init(struct xnselector *selector)
 		__FD_ZERO__(&selector->fds[i].pending);
 	}
 	INIT_LIST_HEAD(&selector->bindings);
+	INIT_LIST_HEAD(&selector->ready);
+	selector->items = NULL;
+	selector->nr_items = 0;
+	selector->seq = 0;
 
 	return 0;
 }
 EXPORT_SYMBOL_GPL(xnselector_init);
 
+/**
+ * Initialize a selector structure in poller mode.
+ *
+ * @param selector The selector structure to be initialized.
+ *
+ * @param nr_items The number of items the selector may watch. Item
+ * indices range from 0 to @a nr_items - 1, and are passed as the @a
+ * index argument of xnselect_bind().
+ *
+ * @retval -EINVAL if @a nr_items is zero;
+ * @retval -ENOMEM if the item table cannot be allocated;
+ * @retval 0 otherwise.
+ *
+ * @coretags{task-unrestricted}
+ */
+int xnselector_init_poller(struct xnselector *selector,
+			   unsigned int nr_items)
+{
+	struct xnselect_item *items;
+	unsigned int i;
+
+	if (nr_items == 0 || nr_items > UINT_MAX / sizeof(*items))
+		return -EINVAL;
+
+	items = xnmalloc(nr_items * sizeof(*items));
+	if (items == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_items; i++) {
+		items[i].expected = 0;
+		items[i].pending = 0;
+		items[i].seq = 0;
+		INIT_LIST_HEAD(&items[i].link);
+		INIT_LIST_HEAD(&items[i].bindings);
+	}
+
+	xnselector_init(selector);
+	selector->items = items;
+	selector->nr_items = nr_items;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnselector_init_poller);
+
+/**
+ * Drop all bindings of a poller item.
+ *
+ * The item stops being watched, and any event it has pending is
+ * discarded.
+ *
+ * @param selector The selector structure, in poller mode.
+ *
+ * @param index The item index.
+ *
+ * @coretags{task-unrestricted}
+ */
+void xnselector_unbind(struct xnselector *selector, unsigned int index)
+{
+	struct xnselect_binding *binding;
+	struct xnselect_item *item;
+	spl_t s;
+
+	if (XENO_WARN_ON(COBALT, selector->items == NULL ||
+			 index >= selector->nr_items))
+		return;
+
+	item = selector->items + index;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	while (!list_empty(&item->bindings)) {
+		binding = list_first_entry(&item->bindings,
+					   struct xnselect_binding, slink);
+		list_del(&binding->slink);
+		list_del(&binding->link);
+		xnlock_put_irqrestore(&nklock, s);
+		xnfree(binding);
+		xnlock_get_irqsave(&nklock, s);
+	}
+
+	item->expected = 0;
+	item->pending = 0;
+	list_del_init(&item->link);
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+EXPORT_SYMBOL_GPL(xnselector_unbind);
+
 /**
  * Check the state of a number of file descriptors, wait for a state change if
  * no descriptor is ready.
@@ -348,6 +562,7 @@ int xnselect(struct xnselector *selector,
 		return -ECHRNG;
 
 	xnlock_get_irqsave(&nklock, s);
+	xnselect_probe_all(selector);
 	for (i = 0; i < XNSELECT_MAX_TYPES; i++)
 		if (out_fds[i]
 		    && fd_set_and(out_fds[i], in_fds[i],
@@ -358,6 +573,7 @@ int xnselect(struct xnselector *selector,
 		info = xnsynch_sleep_on(&selector->synchbase,
 					timeout, timeout_mode);
 
+		xnselect_probe_all(selector);
 		for (i = 0; i < XNSELECT_MAX_TYPES; i++)
 			if (out_fds[i]
 			    && fd_set_and(out_fds[i], in_fds[i],
@@ -384,6 +600,112 @@ int xnselect(struct xnselector *selector,
 }
 EXPORT_SYMBOL_GPL(xnselect);
 
+/* Must be called with nklock locked irqs off */
+static void xnselect_probe_ready(struct xnselector *selector)
+{
+	struct xnselect_binding *binding;
+	struct xnselect_item *item, *tmp;
+	unsigned int bit;
+
+	list_for_each_entry_safe(item, tmp, &selector->ready, link) {
+		list_for_each_entry(binding, &item->bindings, slink) {
+			bit = 1U << binding->type;
+			if (binding->fd->probe && (item->pending & bit) &&
+			    !binding->fd->probe(binding->fd))
+				item->pending &= ~bit;
+		}
+		if (item->pending == 0)
+			list_del_init(&item->link);
+	}
+}
+
+/**
+ * Collect the ready items of a poller, waiting for one if none is.
+ *
+ * @param selector structure to check for pending events, in poller mode;
+ * @param events array receiving the index and pending event mask of up to
+ * @a maxevents ready items;
+ * @param maxevents the size of @a events;
+ * @param seqp pointer to a pass cookie, which must be zero on the first
+ * call. The caller may collect further items by calling again with the
+ * cookie updated by the previous call, which never waits and does not
+ * return items already reported during the same pass;
+ * @param timeout the timeout, whose meaning depends on @a timeout_mode,
+ * XN_NONBLOCK for not waiting at all;
+ * @param timeout_mode the mode of @a timeout.
+ *
+ * Items reported are moved to the tail of the ready list, so that
+ * busy descriptors cannot starve the others when @a maxevents is
+ * smaller than the number of ready items.
+ * Ready items whose descriptor has a state probe (see
+ * xnselect_init_probe()) are checked again first, and dropped if no
+ * longer ready.
+ *
+ * @retval -EINVAL if @a selector is not in poller mode or @a maxevents
+ * is not strictly positive;
+ * @retval -EINTR if @a xnselect_poll was interrupted while waiting;
+ * @retval -EIDRM if @a selector was deleted while waiting;
+ * @retval 0 in case of timeout, or if no item is left to report;
+ * @retval the number of ready items copied to @a events.
+ *
+ * @coretags{primary-only, might-switch}
+ */
+int xnselect_poll(struct xnselector *selector,
+		  struct xnselect_event *events, int maxevents,
+		  unsigned long *seqp,
+		  xnticks_t timeout, xntmode_t timeout_mode)
+{
+	struct xnselect_item *item;
+	int info = 0, n = 0;
+	spl_t s;
+
+	if (selector->items == NULL || maxevents <= 0)
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	xnselect_probe_ready(selector);
+
+	if (*seqp == 0) {
+		if (++selector->seq == 0)
+			selector->seq = 1;
+		*seqp = selector->seq;
+		while (list_empty(&selector->ready) && timeout != XN_NONBLOCK) {
+			info = xnsynch_sleep_on(&selector->synchbase,
+						timeout, timeout_mode);
+			if (info & (XNRMID | XNBREAK | XNTIMEO))
+				break;
+			xnselect_probe_ready(selector);
+		}
+	}
+
+	while (n < maxevents && !list_empty(&selector->ready)) {
+		item = list_first_entry(&selector->ready,
+					struct xnselect_item, link);
+		if (item->seq == *seqp)
+			break;	/* Wrapped around. */
+		item->seq = *seqp;
+		events[n].index = item - selector->items;
+		events[n].events = item->pending;
+		n++;
+		list_move_tail(&item->link, &selector->ready);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (n > 0)
+		return n;
+
+	if (info & XNRMID)
+		return -EIDRM;
+
+	if (info & XNBREAK)
+		return -EINTR;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnselect_poll);
+
 /**
  * Destroy a selector block.
  *
@@ -406,9 +728,10 @@ EXPORT_SYMBOL_GPL(xnselector_destroy);
 
 static irqreturn_t xnselector_destroy_loop(int virq, void *dev_id)
 {
-	struct xnselect_binding *binding, *tmpb;
+	struct xnselect_binding *binding;
 	struct xnselector *selector, *tmps;
 	struct xnselect *fd;
+	unsigned int i;
 	spl_t s;
 
 	xnlock_get_irqsave(&nklock, s);
@@ -418,9 +741,14 @@ static irqreturn_t xnselector_destroy_loop(int virq, void *dev_id)
 
 	list_for_each_entry_safe(selector, tmps, &selector_list, destroy_link) {
 		list_del(&selector->destroy_link);
+		for (i = 0; i < selector->nr_items; i++)
+			list_splice_init(&selector->items[i].bindings,
+					 &selector->bindings);
 		if (list_empty(&selector->bindings))
 			goto release;
-		list_for_each_entry_safe(binding, tmpb, &selector->bindings, slink) {
+		while (!list_empty(&selector->bindings)) {
+			binding = list_first_entry(&selector->bindings,
+						   struct xnselect_binding, slink);
 			list_del(&binding->slink);
 			fd = binding->fd;
 			list_del(&binding->link);
@@ -433,6 +761,8 @@ static irqreturn_t xnselector_destroy_loop(int virq, void *dev_id)
 		xnsched_run();
 		xnlock_put_irqrestore(&nklock, s);
 
+		if (selector->items)
+			xnfree(selector->items);
 		xnfree(selector);
 
 		xnlock_get_irqsave(&nklock, s);
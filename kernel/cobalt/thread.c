@@ -38,6 +38,7 @@
 #include <cobalt/kernel/select.h>
 #include <cobalt/kernel/lock.h>
 #include <cobalt/kernel/thread.h>
+#include <cobalt/kernel/tracering.h>
 #include <pipeline/kevents.h>
 #include <pipeline/inband_work.h>
 #include <pipeline/sched.h>
@@ -1100,6 +1101,7 @@ void xnthread_resume(struct xnthread *thread, int mask)
 	xnlock_get_irqsave(&nklock, s);
 
 	trace_cobalt_thread_resume(thread, mask);
+	xntrace_ring_log(COBALT_TRACE_WAKEUP, thread, mask, thread->cprio);
 
 	xntrace_pid(xnthread_host_pid(thread), xnthread_current_priority(thread));
 
@@ -1948,6 +1950,7 @@ int xnthread_harden(void)
 	xnthread_test_cancel();
 
 	trace_cobalt_shadow_hardened(thread);
+	xntrace_ring_log(COBALT_TRACE_HARDEN, thread, 0, 0);
 
 	/*
 	 * Recheck pending signals once again. As we block task
@@ -2061,6 +2064,7 @@ void xnthread_relax(int notify, int reason)
 	 * to resume using the register state of the shadow thread.
 	 */
 	trace_cobalt_shadow_gorelax(reason);
+	xntrace_ring_log(COBALT_TRACE_RELAX, thread, reason, 0);
 
 	/*
 	 * If you intend to change the following interrupt-free
@@ -43,7 +43,7 @@
  */
 
 int xntimer_heading_p(struct xntimer *timer)
-{
+{				/* timer queue locked */
 	struct xnsched *sched = timer->sched;
 	xntimerq_t *q;
 	xntimerh_t *h;
@@ -63,7 +63,7 @@ int xntimer_heading_p(struct xntimer *timer)
 }
 
 void xntimer_enqueue_and_program(struct xntimer *timer, xntimerq_t *q)
-{
+{				/* timer queue locked */
 	struct xnsched *sched = xntimer_sched(timer);
 
 	xntimer_enqueue(timer, q);
@@ -115,16 +115,20 @@ int xntimer_start(struct xntimer *timer,
 		  xnticks_t value, xnticks_t interval,
 		  xntmode_t mode)
 {
+	struct xntimerdata *tmd = xntimer_percpu_data(timer);
 	struct xnclock *clock = xntimer_clock(timer);
-	xntimerq_t *q = xntimer_percpu_queue(timer);
 	xnticks_t date, now, delay, period;
+	xntimerq_t *q = &tmd->q;
 	unsigned long gravity;
 	int ret = 0;
+	spl_t s;
 
 	atomic_only();
 
 	trace_cobalt_timer_start(timer, value, interval, mode);
 
+	xnlock_get_irqsave(&tmd->lock, s);
+
 	if ((timer->status & XNTIMER_DEQUEUED) == 0)
 		xntimer_dequeue(timer, q);
 
@@ -133,8 +137,10 @@ int xntimer_start(struct xntimer *timer,
 	timer->status &= ~(XNTIMER_REALTIME | XNTIMER_FIRED | XNTIMER_PERIODIC);
 	switch (mode) {
 	case XN_RELATIVE:
-		if ((xnsticks_t)value < 0)
-			return -ETIMEDOUT;
+		if ((xnsticks_t)value < 0) {
+			ret = -ETIMEDOUT;
+			goto out;
+		}
 		date = xnclock_ns_to_ticks(clock, value) + now;
 		break;
 	case XN_REALTIME:
@@ -144,8 +150,10 @@ int xntimer_start(struct xntimer *timer,
 	default: /* XN_ABSOLUTE || XN_REALTIME */
 		date = xnclock_ns_to_ticks(clock, value);
 		if ((xnsticks_t)(date - now) <= 0) {
-			if (interval == XN_INFINITE)
-				return -ETIMEDOUT;
+			if (interval == XN_INFINITE) {
+				ret = -ETIMEDOUT;
+				goto out;
+			}
 			/*
 			 * We are late on arrival for the first
 			 * delivery, wait for the next shot on the
@@ -184,6 +192,8 @@ int xntimer_start(struct xntimer *timer,
 
 	timer->status |= XNTIMER_RUNNING;
 	xntimer_enqueue_and_program(timer, q);
+out:
+	xnlock_put_irqrestore(&tmd->lock, s);
 
 	return ret;
 }
@@ -204,18 +214,21 @@ EXPORT_SYMBOL_GPL(xntimer_start);
  */
 void __xntimer_stop(struct xntimer *timer)
 {
+	struct xntimerdata *tmd = xntimer_percpu_data(timer);
 	struct xnclock *clock = xntimer_clock(timer);
-	xntimerq_t *q = xntimer_percpu_queue(timer);
 	struct xnsched *sched;
 	int heading = 1;
+	spl_t s;
 
 	atomic_only();
 
 	trace_cobalt_timer_stop(timer);
 
+	xnlock_get_irqsave(&tmd->lock, s);
+
 	if ((timer->status & XNTIMER_DEQUEUED) == 0) {
 		heading = xntimer_heading_p(timer);
-		xntimer_dequeue(timer, q);
+		xntimer_dequeue(timer, &tmd->q);
 	}
 	timer->status &= ~(XNTIMER_FIRED|XNTIMER_RUNNING);
 	sched = xntimer_sched(timer);
@@ -226,6 +239,8 @@ void __xntimer_stop(struct xntimer *timer)
 	 */
 	if (heading && sched == xnsched_current())
 		xnclock_program_shot(clock, sched);
+
+	xnlock_put_irqrestore(&tmd->lock, s);
 }
 EXPORT_SYMBOL_GPL(__xntimer_stop);
 
@@ -506,8 +521,9 @@ EXPORT_SYMBOL_GPL(xntimer_destroy);
  */
 void __xntimer_migrate(struct xntimer *timer, struct xnsched *sched)
 {				/* nklocked, IRQs off, sched != timer->sched */
+	struct xntimerdata *tmd;
 	struct xnclock *clock;
-	xntimerq_t *q;
+	spl_t s;
 
 	trace_cobalt_timer_migrate(timer, xnsched_cpu(sched));
 
@@ -526,10 +542,12 @@ void __xntimer_migrate(struct xntimer *timer, struct xnsched *sched)
 		xntimer_stop(timer);
 		timer->sched = sched;
 		clock = xntimer_clock(timer);
-		q = xntimer_percpu_queue(timer);
-		xntimer_enqueue(timer, q);
+		tmd = xntimer_percpu_data(timer);
+		xnlock_get_irqsave(&tmd->lock, s);
+		xntimer_enqueue(timer, &tmd->q);
 		if (xntimer_heading_p(timer))
 			xnclock_remote_shot(clock, sched);
+		xnlock_put_irqrestore(&tmd->lock, s);
 	} else
 		timer->sched = sched;
 }
@@ -615,8 +633,9 @@ unsigned long long xntimer_get_overruns(struct xntimer *timer,
 {
 	xnticks_t period = timer->interval;
 	unsigned long long overruns = 0;
+	struct xntimerdata *tmd;
 	xnsticks_t delta;
-	xntimerq_t *q;
+	spl_t s;
 
 	atomic_only();
 
@@ -630,13 +649,15 @@ unsigned long long xntimer_get_overruns(struct xntimer *timer,
 			XENO_BUG_ON(COBALT, (timer->status &
 				    (XNTIMER_DEQUEUED|XNTIMER_PERIODIC))
 				    != XNTIMER_PERIODIC);
-				q = xntimer_percpu_queue(timer);
-			xntimer_dequeue(timer, q);
+			tmd = xntimer_percpu_data(timer);
+			xnlock_get_irqsave(&tmd->lock, s);
+			xntimer_dequeue(timer, &tmd->q);
 			while (xntimerh_date(&timer->aplink) < now) {
 				timer->periodic_ticks++;
 				xntimer_update_date(timer);
 			}
-			xntimer_enqueue_and_program(timer, q);
+			xntimer_enqueue_and_program(timer, &tmd->q);
+			xnlock_put_irqrestore(&tmd->lock, s);
 		}
 	}
 
@@ -167,7 +167,14 @@
 		__cobalt_symbolic_syscall(sigtimedwait64),		\
 		__cobalt_symbolic_syscall(monitor_wait64),		\
 		__cobalt_symbolic_syscall(event_wait64),		\
-		__cobalt_symbolic_syscall(recvmmsg64))
+		__cobalt_symbolic_syscall(recvmmsg64),			\
+		__cobalt_symbolic_syscall(mq_slot_alloc),		\
+		__cobalt_symbolic_syscall(mq_slot_send),		\
+		__cobalt_symbolic_syscall(mq_slot_receive),		\
+		__cobalt_symbolic_syscall(mq_slot_free),		\
+		__cobalt_symbolic_syscall(poller_create),		\
+		__cobalt_symbolic_syscall(poller_ctl),			\
+		__cobalt_symbolic_syscall(poller_wait))
 
 DECLARE_EVENT_CLASS(cobalt_syscall_entry,
 	TP_PROTO(unsigned int nr),
@@ -0,0 +1,177 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/vmalloc.h>
+#include <linux/random.h>
+#include <linux/siphash.h>
+#include <cobalt/kernel/lock.h>
+#include <cobalt/kernel/clock.h>
+#include <cobalt/kernel/thread.h>
+#include <cobalt/kernel/tracering.h>
+#include <rtdm/driver.h>
+
+/**
+ * @ingroup cobalt_core
+ * @defgroup cobalt_core_tracering Event trace ring
+ *
+ * Always-on binary trace of scheduling events.
+ *
+ * Each CPU logs context switches, wakeups, mode switches and timer
+ * shots into its own ring, overwriting the oldest events. The CPU
+ * is the only writer to its ring, with hard irqs off, so logging
+ * takes no lock. The trace area is mapped read-only by monitoring
+ * processes through the COBALT_MEMDEV_TRACE device, which copy
+ * events out of the rings without issuing any syscall.
+ *
+ * @{
+ */
+
+static void *trace_area;
+
+static size_t trace_area_size;
+
+static unsigned int trace_ring_size;
+
+static unsigned int trace_nr_events;
+
+static siphash_key_t trace_id_key;
+
+static inline struct cobalt_trace_ring *trace_ring(int cpu)
+{
+	return trace_area + PAGE_SIZE + cpu * trace_ring_size;
+}
+
+/**
+ * @fn void xntrace_ring_log(int type, struct xnthread *thread, __u32 arg0, __u32 arg1)
+ * @brief Log an event into the trace ring of the current CPU.
+ *
+ * @param type The event type, i.e. COBALT_TRACE_*.
+ *
+ * @param thread The thread the event refers to, NULL if none.
+ *
+ * @param arg0 First type-specific argument.
+ *
+ * @param arg1 Second type-specific argument.
+ *
+ * @coretags{unrestricted}
+ */
+void xntrace_ring_log(int type, struct xnthread *thread,
+		      __u32 arg0, __u32 arg1)
+{
+	struct cobalt_trace_ring *ring;
+	struct cobalt_trace_event *ev;
+	pid_t pid;
+	__u64 pos;
+	spl_t s;
+
+	if (unlikely(trace_area == NULL))
+		return;
+
+	pid = thread ? xnthread_host_pid(thread) : 0;
+
+	splhigh(s);
+	ring = trace_ring(raw_smp_processor_id());
+	pos = ring->head;
+	ev = ring->events + (pos & (trace_nr_events - 1));
+	/* Invalidate the slot for readers first. */
+	WRITE_ONCE(ev->seq, 0);
+	smp_wmb();
+	ev->stamp = xnclock_core_read_raw();
+	ev->type = type;
+	ev->pid = pid;
+	ev->arg0 = arg0;
+	ev->arg1 = arg1;
+	smp_wmb();
+	WRITE_ONCE(ev->seq, pos + 1);
+	WRITE_ONCE(ring->head, pos + 1);
+	splexit(s);
+}
+
+/**
+ * @fn void xntrace_ring_log_timer(struct xntimer *timer)
+ * @brief Log a timer shot into the trace ring of the current CPU.
+ *
+ * The trace area is readable from userland, so the timer is
+ * identified by a keyed hash of its address, which stays the same
+ * for the lifetime of the timer but does not disclose any kernel
+ * address.
+ *
+ * @param timer The timer which has elapsed.
+ *
+ * @coretags{unrestricted}
+ */
+void xntrace_ring_log_timer(struct xntimer *timer)
+{
+	xntrace_ring_log(COBALT_TRACE_TIMER, NULL,
+			 (__u32)siphash_1u64((u64)(unsigned long)timer,
+					     &trace_id_key), 0);
+}
+
+int xntrace_ring_mmap(struct vm_area_struct *vma)
+{
+	if (trace_area == NULL)
+		return -ENODEV;
+
+	if (vma->vm_end - vma->vm_start != trace_area_size)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	return rtdm_mmap_vmem(vma, trace_area);
+}
+
+size_t xntrace_ring_get_size(void)
+{
+	return trace_area_size;
+}
+
+int xntrace_ring_init(void)
+{
+	struct cobalt_trace_header *hdr;
+	int cpu;
+
+	trace_nr_events = rounddown_pow_of_two(CONFIG_XENO_OPT_TRACE_RING_EVENTS);
+	trace_ring_size = PAGE_ALIGN(sizeof(struct cobalt_trace_ring) +
+		trace_nr_events * sizeof(struct cobalt_trace_event));
+	trace_area_size = PAGE_SIZE + nr_cpu_ids * trace_ring_size;
+	trace_area = vmalloc_kernel(trace_area_size, __GFP_ZERO);
+	if (trace_area == NULL)
+		return -ENOMEM;
+
+	get_random_bytes(&trace_id_key, sizeof(trace_id_key));
+
+	hdr = trace_area;
+	hdr->magic = COBALT_TRACE_MAGIC;
+	hdr->nr_cpus = nr_cpu_ids;
+	hdr->nr_events = trace_nr_events;
+	hdr->ring_size = trace_ring_size;
+	hdr->clock_freq = xnclock_core_ns_to_ticks(1000000000LL);
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++)
+		trace_ring(cpu)->cpu = cpu;
+
+	return 0;
+}
+
+void xntrace_ring_cleanup(void)
+{
+	vfree(trace_area);
+	trace_area = NULL;
+}
+
+/** @} */
@@ -106,6 +106,7 @@ static void a4l_reinit_buffer(struct a4l_buffer *buf_desc)
 	buf_desc->cns_count = 0;
 	buf_desc->tmp_count = 0;
 	buf_desc->mng_count = 0;
+	buf_desc->seg_pending = 0;
 
 	/* Flush pending events */
 	buf_desc->flags = 0;
@@ -424,8 +425,11 @@ int a4l_buf_evt(struct a4l_subdevice *subd, unsigned long evts)
 	if (evts == 0) {
 		count = a4l_subd_is_input(subd) ?
 			__count_to_get(buf) : __count_to_put(buf);
-		wake = __count_to_end(buf) < buf->wake_count ?
-			__count_to_end(buf) : buf->wake_count;
+		/* A segmented buffer is only worth a wake-up once a
+		   whole segment is available */
+		wake = buf->seg_size ? buf->seg_size : buf->wake_count;
+		if (__count_to_end(buf) < wake)
+			wake = __count_to_end(buf);
 	} else {
 		/* Even if it is a little more complex, atomic
 		   operations are used so as to prevent any kind of
@@ -460,6 +464,93 @@ unsigned long a4l_buf_count(struct a4l_subdevice *subd)
 	return ret;
 }
 
+/* --- Segment functions --- */
+
+/* Size of the segment starting at pos; only the trailing segment of
+   a finite acquisition may be shorter than the configured size */
+static inline unsigned long __seg_len(struct a4l_buffer *buf,
+				      unsigned long pos)
+{
+	long left;
+
+	if (buf->end_count == 0)
+		return buf->seg_size;
+
+	left = (long)(buf->end_count - pos);
+	if (left <= 0)
+		return 0;
+
+	return (unsigned long)left < buf->seg_size ? left : buf->seg_size;
+}
+
+int a4l_buf_prepare_seg(struct a4l_subdevice *subd, struct a4l_segment *seg)
+{
+	struct a4l_buffer *buf = subd->buf;
+	unsigned long pos, avail, len;
+
+	if (!buf || !test_bit(A4L_SUBD_BUSY_NR, &subd->status))
+		return -ENOENT;
+
+	if (buf->seg_size == 0)
+		return -EINVAL;
+
+	/* The driver fills (input) or drains (output) the segments
+	   following the ones it already holds */
+	if (a4l_subd_is_input(subd)) {
+		pos = buf->prd_count;
+		avail = __count_to_put(buf);
+	} else {
+		pos = buf->cns_count;
+		avail = __count_to_get(buf);
+	}
+
+	pos += buf->seg_pending * buf->seg_size;
+	if (pos % buf->seg_size != 0)
+		return -EINVAL;
+
+	len = __seg_len(buf, pos);
+	if (len == 0)
+		return -ENOSPC;
+
+	if (avail < buf->seg_pending * buf->seg_size + len)
+		return -EAGAIN;
+
+	seg->offset = pos % buf->size;
+	seg->size = len;
+	seg->vaddr = buf->buf + seg->offset;
+	seg->pg_list = buf->pg_list + (seg->offset >> PAGE_SHIFT);
+	seg->nr_pages = PAGE_ALIGN(len) >> PAGE_SHIFT;
+	buf->seg_pending++;
+
+	return 0;
+}
+
+int a4l_buf_commit_seg(struct a4l_subdevice *subd)
+{
+	struct a4l_buffer *buf = subd->buf;
+	int err;
+
+	if (!buf || !test_bit(A4L_SUBD_BUSY_NR, &subd->status))
+		return -ENOENT;
+
+	if (buf->seg_pending == 0)
+		return -EINVAL;
+
+	if (a4l_subd_is_input(subd))
+		err = __put(buf, __seg_len(buf, buf->prd_count));
+	else
+		err = __get(buf, __seg_len(buf, buf->cns_count));
+
+	buf->seg_pending--;
+	if (err < 0)
+		return err;
+
+	/* One notification per completed segment */
+	a4l_signal_sync(&buf->sync);
+
+	return 0;
+}
+
 /* --- Mmap functions --- */
 
 void a4l_map(struct vm_area_struct *area)
@@ -584,6 +675,7 @@ int a4l_ioctl_bufcfg(struct a4l_device_context * cxt, void *arg)
 	struct a4l_buffer *buf = cxt->buffer;
 	struct a4l_subdevice *subd = buf->subd;
 	a4l_bufcfg_t buf_cfg;
+	int ret;
 
 	/* As Linux API is used to allocate a virtual buffer,
 	   the calling process must not be in primary mode */
@@ -627,7 +719,13 @@ int a4l_ioctl_bufcfg(struct a4l_device_context * cxt, void *arg)
 	a4l_free_buffer(buf);
 
 	/* ...to reallocate it */
-	return a4l_alloc_buffer(buf, buf_cfg.buf_size);
+	ret = a4l_alloc_buffer(buf, buf_cfg.buf_size);
+
+	/* Drop a segment layout which does not fit the new size */
+	if (buf->seg_size != 0 && buf->size % buf->seg_size != 0)
+		buf->seg_size = 0;
+
+	return ret;
 }
 
 /* The ioctl BUFCFG2 allows the user space process to define the
@@ -799,6 +897,218 @@ int a4l_ioctl_bufinfo2(struct a4l_device_context * cxt, void *arg)
 	return 0;
 }
 
+/* The ioctl SEGCFG splits the buffer into equally sized segments,
+   which the driver transfers in place (a4l_buf_prepare_seg /
+   a4l_buf_commit_seg) and which the user process consumes in place
+   through the mmap'ed buffer (SEGWAIT). A null size switches back to
+   the byte-oriented mode. */
+
+int a4l_ioctl_segcfg(struct a4l_device_context * cxt, void *arg)
+{
+	struct rtdm_fd *fd = rtdm_private_to_fd(cxt);
+	struct a4l_device *dev = a4l_get_dev(cxt);
+	struct a4l_buffer *buf = cxt->buffer;
+	struct a4l_subdevice *subd = buf->subd;
+	a4l_segcfg_t seg_cfg;
+
+	/* Basic checking */
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
+		__a4l_err("a4l_ioctl_segcfg: unattached device\n");
+		return -EINVAL;
+	}
+
+	if (rtdm_safe_copy_from_user(fd,
+				     &seg_cfg,
+				     arg, sizeof(a4l_segcfg_t)) != 0)
+		return -EFAULT;
+
+	if (subd && test_bit(A4L_SUBD_BUSY_NR, &subd->status)) {
+		__a4l_err("a4l_ioctl_segcfg: acquisition in progress\n");
+		return -EBUSY;
+	}
+
+	/* Segments are made of whole pages and must tile the buffer,
+	   so that none of them wraps around its end */
+	if (seg_cfg.seg_size != 0 &&
+	    ((seg_cfg.seg_size & ~PAGE_MASK) != 0 ||
+	     seg_cfg.seg_size > buf->size ||
+	     buf->size % seg_cfg.seg_size != 0)) {
+		__a4l_err("a4l_ioctl_segcfg: segment size must be a "
+			  "multiple of the page size dividing the buffer "
+			  "size (%lu)\n", buf->size);
+		return -EINVAL;
+	}
+
+	buf->seg_size = seg_cfg.seg_size;
+
+	return 0;
+}
+
+/* Data count the user process may access in place, starting at the
+   consumption (input) or production (output) counter */
+static unsigned long __seg_count_ready(struct a4l_subdevice *subd,
+				       struct a4l_buffer *buf)
+{
+	unsigned long pos, count;
+	long left;
+
+	if (a4l_subd_is_input(subd)) {
+		pos = buf->cns_count;
+		count = __count_to_get(buf);
+	} else {
+		pos = buf->prd_count;
+		count = __count_to_put(buf);
+		left = (long)(buf->end_count - pos);
+		if (buf->end_count != 0 && left < (long)count)
+			count = left > 0 ? left : 0;
+	}
+
+	/* Only whole segments are reported, except the trailing one
+	   of a finite acquisition */
+	if (buf->end_count == 0 || pos + count != buf->end_count)
+		count -= count % buf->seg_size;
+
+	return count;
+}
+
+/* The ioctl SEGWAIT hands the segments the user process is done with
+   back to the driver, then waits for some segments to be ready. On
+   return, the ready area is contiguous within the mapping. */
+
+int a4l_ioctl_segwait(struct a4l_device_context * cxt, void *arg)
+{
+	struct rtdm_fd *fd = rtdm_private_to_fd(cxt);
+	struct a4l_device *dev = a4l_get_dev(cxt);
+	struct a4l_buffer *buf = cxt->buffer;
+	struct a4l_subdevice *subd = buf->subd;
+	unsigned long tmp_cnt, rel_cnt, pos;
+	a4l_segwait_t wait;
+	int ret;
+
+	if (!rtdm_in_rt_context() && rtdm_rt_capable(fd))
+		return -ENOSYS;
+
+	/* Basic checking */
+
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
+		__a4l_err("a4l_ioctl_segwait: unattached device\n");
+		return -EINVAL;
+	}
+
+	if (!subd || !test_bit(A4L_SUBD_BUSY_NR, &subd->status)) {
+		__a4l_err("a4l_ioctl_segwait: idle subdevice on this context\n");
+		return -ENOENT;
+	}
+
+	if (buf->seg_size == 0) {
+		__a4l_err("a4l_ioctl_segwait: buffer is not segmented\n");
+		return -EINVAL;
+	}
+
+	if (rtdm_safe_copy_from_user(fd,
+				     &wait, arg, sizeof(a4l_segwait_t)) != 0)
+		return -EFAULT;
+
+	/* Hand the released segments back to the driver */
+	if (wait.release != 0) {
+		tmp_cnt = __seg_count_ready(subd, buf);
+		if (wait.release > DIV_ROUND_UP(tmp_cnt, buf->seg_size)) {
+			__a4l_err("a4l_ioctl_segwait: releasing more "
+				  "segments than available\n");
+			return -EINVAL;
+		}
+
+		rel_cnt = wait.release * buf->seg_size;
+		if (rel_cnt > tmp_cnt)
+			rel_cnt = tmp_cnt;
+
+		if (a4l_subd_is_input(subd))
+			buf->cns_count += rel_cnt;
+		else {
+			buf->prd_count += rel_cnt;
+			if (subd->munge != NULL) {
+				__munge(subd, subd->munge, buf, rel_cnt);
+				buf->mng_count += rel_cnt;
+			}
+		}
+	}
+
+	pos = a4l_subd_is_input(subd) ? buf->cns_count : buf->prd_count;
+
+	/* Checks the buffer events */
+	a4l_flush_sync(&buf->sync);
+	ret = __handle_event(buf);
+	tmp_cnt = __seg_count_ready(subd, buf);
+
+	if (a4l_subd_is_input(subd)) {
+
+		/* Check if some error occured */
+		if (ret < 0 && ret != -ENOENT) {
+			a4l_cancel_buffer(cxt);
+			return ret;
+		}
+
+		/* Check whether the acquisition is over */
+		if (ret == -ENOENT && tmp_cnt == 0) {
+			a4l_cancel_buffer(cxt);
+			goto out_segwait;
+		}
+	} else if (ret < 0) {
+		/* If some error was detected, cancel the transfer */
+		a4l_cancel_buffer(cxt);
+		return ret;
+	}
+
+	/* Mixing byte-oriented transfers with segments breaks the
+	   segment alignment */
+	if (tmp_cnt != 0 && pos % buf->seg_size != 0) {
+		__a4l_err("a4l_ioctl_segwait: misaligned segment\n");
+		return -EINVAL;
+	}
+
+	if (wait.timeout == A4L_NONBLOCK || tmp_cnt != 0)
+		goto out_munge;
+
+	if (wait.timeout == A4L_INFINITE)
+		ret = a4l_wait_sync(&(buf->sync), rtdm_in_rt_context());
+	else {
+		unsigned long long ns = ((unsigned long long)wait.timeout) *
+			((unsigned long long)NSEC_PER_MSEC);
+		ret = a4l_timedwait_sync(&(buf->sync), rtdm_in_rt_context(), ns);
+	}
+
+	if (ret < 0)
+		return ret;
+
+	tmp_cnt = __seg_count_ready(subd, buf);
+
+out_munge:
+
+	/* Input data is munged once, before being exposed */
+	if (a4l_subd_is_input(subd) && subd->munge != NULL &&
+	    (long)(pos + tmp_cnt - buf->mng_count) > 0) {
+		rel_cnt = pos + tmp_cnt - buf->mng_count;
+		__munge(subd, subd->munge, buf, rel_cnt);
+		buf->mng_count += rel_cnt;
+	}
+
+	wait.offset = pos % buf->size;
+	wait.count = tmp_cnt;
+	if (wait.count > buf->size - wait.offset)
+		wait.count = buf->size - wait.offset;
+
+	return rtdm_safe_copy_to_user(fd,
+				      arg, &wait, sizeof(a4l_segwait_t));
+
+out_segwait:
+
+	wait.offset = 0;
+	wait.count = 0;
+
+	return rtdm_safe_copy_to_user(fd,
+				      arg, &wait, sizeof(a4l_segwait_t));
+}
+
 /* The function a4l_read_buffer can be considered as the kernel entry
    point of the RTDM syscall read. This syscall is supposed to be used
    only during asynchronous acquisitions */
@@ -500,6 +500,53 @@ EXPORT_SYMBOL_GPL(a4l_buf_evt);
 unsigned long a4l_buf_count(struct a4l_subdevice *subd);
 EXPORT_SYMBOL_GPL(a4l_buf_count);
 
+/**
+ * @brief Hand the next buffer segment over to the device driver
+ *
+ * When the user-space program has split the Analogy buffer into
+ * segments (A4L_SEGCFG ioctl), a driver may transfer whole segments
+ * in place instead of copying data through a4l_buf_put() /
+ * a4l_buf_get(). The segment descriptor gives both the kernel address
+ * of the segment and the physical addresses of its pages, so that a
+ * scatter-gather DMA descriptor can be built for it.
+ *
+ * For an input subdevice, the returned segment is the next free one
+ * the device may fill; for an output subdevice, it is the next one
+ * the user-space program has filled. Several segments may be
+ * prepared in a row (e.g. to queue DMA shots); they must be
+ * committed in the same order with a4l_buf_commit_seg().
+ *
+ * @param[in] subd Subdevice descriptor structure
+ * @param[out] seg Segment descriptor to fill
+ *
+ * @return 0 on success, otherwise negative error code:
+ *
+ * - -EINVAL is returned if the buffer is not segmented
+ * - -EAGAIN is returned if no segment is available yet (the
+ *    user-space program is late)
+ * - -ENOSPC is returned if the acquisition end has been reached
+ *
+ */
+int a4l_buf_prepare_seg(struct a4l_subdevice *subd, struct a4l_segment *seg);
+EXPORT_SYMBOL_GPL(a4l_buf_prepare_seg);
+
+/**
+ * @brief Complete the oldest segment prepared by the device driver
+ *
+ * The function a4l_buf_commit_seg() updates the buffer counters with
+ * the size of the oldest segment obtained through
+ * a4l_buf_prepare_seg(), then notifies the user-space side. There is
+ * one wake-up per completed segment, whatever the wake-up threshold
+ * set by a4l_set_wakesize().
+ *
+ * @param[in] subd Subdevice descriptor structure
+ *
+ * @return 0 on success, otherwise negative error code.
+ *
+ */
+int a4l_buf_commit_seg(struct a4l_subdevice *subd);
+EXPORT_SYMBOL_GPL(a4l_buf_commit_seg);
+
 #ifdef DOXYGEN_CPP		/* Only used for doxygen doc generation */
 
 /**
@@ -47,7 +47,9 @@ int (* const a4l_ioctl_functions[]) (struct a4l_device_context *, void *) = {
 	[_IOC_NR(A4L_NBCHANINFO)] = a4l_ioctl_nbchaninfo,
 	[_IOC_NR(A4L_NBRNGINFO)] = a4l_ioctl_nbrnginfo,
 	[_IOC_NR(A4L_BUFCFG2)] = a4l_ioctl_bufcfg2,
-	[_IOC_NR(A4L_BUFINFO2)] = a4l_ioctl_bufinfo2
+	[_IOC_NR(A4L_BUFINFO2)] = a4l_ioctl_bufinfo2,
+	[_IOC_NR(A4L_SEGCFG)] = a4l_ioctl_segcfg,
+	[_IOC_NR(A4L_SEGWAIT)] = a4l_ioctl_segwait
 };
 
 #ifdef CONFIG_PROC_FS
@@ -38,6 +38,10 @@ struct ai_priv {
 	/* Misc fields */
 	unsigned long amplitude_div;
 	unsigned long quanta_cnt;
+
+	/* Segment being filled in place, if the buffer is segmented */
+	struct a4l_segment seg;
+	unsigned long seg_fill;
 };
 
 struct ao_ai2_priv {
@@ -132,12 +136,34 @@ static inline uint16_t ai_value_output(struct ai_priv *priv)
 	return output_tab[idx] / priv->amplitude_div;
 }
 
+/* Store a sample straight into the current buffer segment, the way a
+   scatter-gather DMA engine would; the segment is committed once
+   full. If the reader is late, samples are dropped. */
+static void ai_seg_put(struct a4l_subdevice *subd, uint16_t value)
+{
+	struct ai_priv *priv = (struct ai_priv *)subd->priv;
+
+	if (priv->seg.vaddr == NULL) {
+		if (a4l_buf_prepare_seg(subd, &priv->seg) < 0)
+			return;
+		priv->seg_fill = 0;
+	}
+
+	*(uint16_t *)(priv->seg.vaddr + priv->seg_fill) = value;
+	priv->seg_fill += sizeof(uint16_t);
+
+	if (priv->seg_fill >= priv->seg.size) {
+		a4l_buf_commit_seg(subd);
+		priv->seg.vaddr = NULL;
+	}
+}
+
 int ai_push_values(struct a4l_subdevice *subd)
 {
 	uint64_t now_ns, elapsed_ns = 0;
 	struct a4l_cmd_desc *cmd;
 	struct ai_priv *priv;
-	int i = 0;
+	int i = 0, segmented;
 
 	if (!subd)
 		return -EINVAL;
@@ -148,6 +174,8 @@ int ai_push_values(struct a4l_subdevice *subd)
 	if (!cmd)
 		return -EPIPE;
 
+	segmented = subd->buf->seg_size != 0;
+
 	now_ns = a4l_get_time();
 	elapsed_ns += now_ns - priv->last_ns + priv->reminder_ns;
 	priv->last_ns = now_ns;
@@ -157,7 +185,10 @@ int ai_push_values(struct a4l_subdevice *subd)
 
 		for(j = 0; j < cmd->nb_chan; j++) {
 			uint16_t value = ai_value_output(priv);
-			a4l_buf_put(subd, &value, sizeof(uint16_t));
+			if (segmented)
+				ai_seg_put(subd, value);
+			else
+				a4l_buf_put(subd, &value, sizeof(uint16_t));
 		}
 
 		elapsed_ns -= priv->scan_period_ns;
@@ -167,7 +198,8 @@ int ai_push_values(struct a4l_subdevice *subd)
 	priv->current_ns += i * priv->scan_period_ns;
 	priv->reminder_ns = elapsed_ns;
 
-	if (i != 0)
+	/* Segment commits already notified the reader */
+	if (i != 0 && !segmented)
 		a4l_buf_evt(subd, 0);
 
 	return 0;
@@ -251,6 +283,7 @@ static int ai_cmd(struct a4l_subdevice *subd, struct a4l_cmd_desc *cmd)
 
 	ai_priv->current_ns = ((unsigned long)ai_priv->last_ns);
 	ai_priv->reminder_ns = 0;
+	ai_priv->seg.vaddr = NULL;
 
 	priv->ai_running = 1;
 
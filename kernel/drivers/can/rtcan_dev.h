@@ -30,6 +30,8 @@
 #ifdef __KERNEL__
 
 #include <asm/atomic.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
 #include <linux/netdevice.h>
 #include <linux/semaphore.h>
 
@@ -43,6 +45,11 @@
  * for reception at the same time using Bind */
 #define RTCAN_MAX_RECEIVERS  CONFIG_XENO_DRIVERS_CAN_MAX_RECEIVERS
 
+/* Number of hash chains of the per-device filter index, more than there
+ * can be filters */
+#define RTCAN_RECV_HASH_BITS (ilog2(RTCAN_MAX_RECEIVERS) + 1)
+#define RTCAN_RECV_HASH_SIZE (1 << RTCAN_RECV_HASH_BITS)
+
 /* Suppress handling of refcount if module support is not enabled
  * or modules cannot be unloaded */
 
@@ -152,6 +159,16 @@ struct rtcan_device {
     /* Indicates the length of the empty list */
     int                             free_entries;
 
+    /* Filter index over the reception list, rebuilt whenever the list
+     * changes. Non-inverted filters are hashed by their masked CAN ID
+     * and mask, and every distinct mask in use is listed once, so that
+     * a frame is looked up once per mask instead of being compared with
+     * every filter. Inverted filters are kept on a list of their own. */
+    struct rtcan_recv               *recv_hash[RTCAN_RECV_HASH_SIZE];
+    can_id_t                        recv_masks[RTCAN_MAX_RECEIVERS];
+    int                             recv_mask_count;
+    struct rtcan_recv               *recv_inv_list;
+
     /* A few statistics counters */
     unsigned int tx_count;
     unsigned int rx_count;
@@ -170,6 +187,11 @@ struct rtcan_device {
 extern struct semaphore rtcan_devices_nrt_lock;
 
 
+static inline unsigned int rtcan_recv_hash(can_id_t can_id, can_id_t mask)
+{
+    return hash_32(can_id ^ mask, RTCAN_RECV_HASH_BITS);
+}
+
 void rtcan_dev_free(struct rtcan_device *dev);
 
 int rtcan_dev_register(struct rtcan_device *dev);
@@ -43,6 +43,8 @@ struct rtcan_recv {
 					     */
     struct rtcan_recv       *next;          /* pointer to next list element
 					     */
+    struct rtcan_recv       *hash_next;     /* pointer to next element in
+					     *   the same filter index chain */
 };
 
 
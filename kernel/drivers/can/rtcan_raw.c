@@ -135,6 +135,46 @@ static void rtcan_rcv_deliver(struct rtcan_recv *recv_listener,
 }
 
 
+/*
+ * Deliver a frame to all listeners whose filter accepts it, looking up the
+ * filter index once per distinct mask. Listeners of the socket skip_sock
+ * are left out.
+ */
+static void rtcan_rcv_filtered(struct rtcan_device *dev, struct rtcan_skb *skb,
+			       struct rtcan_socket *skip_sock)
+{
+    can_id_t can_id = skb->rb_frame.can_id;
+    struct rtcan_recv *recv_listener;
+    can_id_t mask, key;
+    int i;
+
+    for (i = 0; i < dev->recv_mask_count; i++) {
+	mask = dev->recv_masks[i];
+	key = can_id & mask;
+	recv_listener = dev->recv_hash[rtcan_recv_hash(key, mask)];
+	while (recv_listener != NULL) {
+	    if (recv_listener->can_filter.can_id == key &&
+		recv_listener->can_filter.can_mask == mask &&
+		recv_listener->sock != skip_sock) {
+		recv_listener->match_count++;
+		rtcan_rcv_deliver(recv_listener, skb);
+	    }
+	    recv_listener = recv_listener->hash_next;
+	}
+    }
+
+    recv_listener = dev->recv_inv_list;
+    while (recv_listener != NULL) {
+	if (recv_listener->sock != skip_sock &&
+	    rtcan_accept_msg(can_id, &recv_listener->can_filter)) {
+	    recv_listener->match_count++;
+	    rtcan_rcv_deliver(recv_listener, skb);
+	}
+	recv_listener = recv_listener->hash_next;
+    }
+}
+
+
 void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
 {
     nanosecs_abs_t timestamp = rtdm_clock_read();
@@ -157,13 +197,7 @@ void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
 	}
     } else {
 	dev->rx_count++;
-	while (recv_listener != NULL) {
-	    if (rtcan_accept_msg(frame->can_id, &recv_listener->can_filter)) {
-		recv_listener->match_count++;
-		rtcan_rcv_deliver(recv_listener, skb);
-	    }
-	    recv_listener = recv_listener->next;
-	}
+	rtcan_rcv_filtered(dev, skb, NULL);
     }
 }
 
@@ -191,22 +225,12 @@ void rtcan_tx_push(struct rtcan_device *dev, struct rtcan_socket *sock,
 void rtcan_loopback(struct rtcan_device *dev)
 {
     nanosecs_abs_t timestamp = rtdm_clock_read();
-    /* Entry in reception list, begin with head */
-    struct rtcan_recv *recv_listener = dev->recv_list;
-    struct rtcan_rb_frame *frame = &dev->tx_skb.rb_frame;
 
     memcpy((void *)&dev->tx_skb.rb_frame + dev->tx_skb.rb_frame_size,
 	   &timestamp, RTCAN_TIMESTAMP_SIZE);
 
-    while (recv_listener != NULL) {
-	dev->rx_count++;
-	if ((dev->tx_socket != recv_listener->sock) &&
-	    rtcan_accept_msg(frame->can_id, &recv_listener->can_filter)) {
-	    recv_listener->match_count++;
-	    rtcan_rcv_deliver(recv_listener, &dev->tx_skb);
-	}
-	recv_listener = recv_listener->next;
-    }
+    dev->rx_count++;
+    rtcan_rcv_filtered(dev, &dev->tx_skb, dev->tx_socket);
     dev->tx_socket = NULL;
 }
 
@@ -548,8 +572,8 @@ ssize_t rtcan_raw_recvmsg(struct rtdm_fd *fd,
     /* Clear frame memory location */
     memset(&frame, 0, sizeof(can_frame_t));
 
-    /* Check flags */
-    if (flags & ~(MSG_DONTWAIT | MSG_PEEK))
+    /* Check flags, MSG_WAITFORONE is handled by recvmmsg() */
+    if (flags & ~(MSG_DONTWAIT | MSG_PEEK | MSG_WAITFORONE))
 	return -EINVAL;
 
 
@@ -52,6 +52,39 @@ void rtcan_raw_print_filter(struct rtcan_device *dev)
 #endif
 
 
+/* Rebuild the filter index of a device from its reception list */
+static void rtcan_raw_index_filters(struct rtcan_device *dev)
+{
+    struct rtcan_recv *r, **chain;
+    can_id_t mask;
+    int i;
+
+    memset(dev->recv_hash, 0, sizeof(dev->recv_hash));
+    dev->recv_mask_count = 0;
+    dev->recv_inv_list = NULL;
+
+    for (r = dev->recv_list; r != NULL; r = r->next) {
+	mask = r->can_filter.can_mask;
+
+	if (mask & CAN_INV_FILTER) {
+	    r->hash_next = dev->recv_inv_list;
+	    dev->recv_inv_list = r;
+	    continue;
+	}
+
+	for (i = 0; i < dev->recv_mask_count; i++)
+	    if (dev->recv_masks[i] == mask)
+		break;
+	if (i == dev->recv_mask_count)
+	    dev->recv_masks[dev->recv_mask_count++] = mask;
+
+	chain = &dev->recv_hash[rtcan_recv_hash(r->can_filter.can_id, mask)];
+	r->hash_next = *chain;
+	*chain = r;
+    }
+}
+
+
 static inline void rtcan_raw_mount_filter(can_filter_t *recv_filter,
 					  can_filter_t *filter)
 {
@@ -191,6 +224,7 @@ int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex)
 	/* Adjust rececption list pointer */
 	dev->recv_list = first;
 
+	rtcan_raw_index_filters(dev);
 	rtcan_raw_print_filter(dev);
 	rtcan_dev_dereference(dev);
     }
@@ -250,6 +284,7 @@ void rtcan_raw_remove_filter(struct rtcan_socket *sock)
 	/* Increase free entries counter by length of old filter list */
 	dev->free_entries += sock->flistlen;
 
+	rtcan_raw_index_filters(dev);
 	rtcan_raw_print_filter(dev);
 	rtcan_dev_dereference(dev);
     }
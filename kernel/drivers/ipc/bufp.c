@@ -23,6 +23,8 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/time.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/map.h>
 #include <cobalt/kernel/bufd.h>
@@ -38,6 +40,7 @@ struct bufp_socket {
 
 	void *bufmem;
 	size_t bufsz;
+	struct bufp_ring *ring;
 	u_long status;
 	xnhandle_t handle;
 	char label[XNOBJECT_NAME_LEN];
@@ -74,6 +77,21 @@ static struct xnmap *portmap;
 #define _BUFP_BINDING   0
 #define _BUFP_BOUND     1
 #define _BUFP_CONNECTED 2
+#define _BUFP_MAPPED    3
+
+/*
+ * In shared ring mode, the ring header occupies the first page of
+ * the mapping, followed by the data area.
+ */
+static inline size_t __bufp_ring_memsz(size_t bufsz)
+{
+	return PAGE_SIZE + PAGE_ALIGN(bufsz);
+}
+
+static inline u32 __bufp_ring_fill(struct bufp_ring *ring)
+{
+	return READ_ONCE(ring->head) - READ_ONCE(ring->tail);
+}
 
 #ifdef CONFIG_XENO_OPT_VFILE
 
@@ -115,6 +133,7 @@ static int bufp_socket(struct rtdm_fd *fd)
 	sk->peer = nullsa;
 	sk->bufmem = NULL;
 	sk->bufsz = 0;
+	sk->ring = NULL;
 	sk->rdoff = 0;
 	sk->wroff = 0;
 	sk->fillsz = 0;
@@ -134,6 +153,21 @@ static int bufp_socket(struct rtdm_fd *fd)
 	return 0;
 }
 
+static void __bufp_free_buffer(struct bufp_socket *sk)
+{
+	/*
+	 * Pages of a shared ring still mapped into user space hold a
+	 * reference, so they outlive this call.
+	 */
+	if (sk->ring) {
+		vfree(sk->ring);
+		sk->ring = NULL;
+	} else if (sk->bufmem)
+		xnheap_vfree(sk->bufmem);
+
+	sk->bufmem = NULL;
+}
+
 static void bufp_close(struct rtdm_fd *fd)
 {
 	struct rtipc_private *priv = rtdm_fd_to_private(fd);
@@ -153,8 +187,7 @@ static void bufp_close(struct rtdm_fd *fd)
 		if (sk->handle)
 			xnregistry_remove(sk->handle);
 
-		if (sk->bufmem)
-			xnheap_vfree(sk->bufmem);
+		__bufp_free_buffer(sk);
 	}
 
 	kfree(sk);
@@ -305,6 +338,9 @@ static ssize_t __bufp_recvmsg(struct rtdm_fd *fd,
 	if (!test_bit(_BUFP_BOUND, &sk->status))
 		return -EAGAIN;
 
+	if (sk->ring)
+		return -EOPNOTSUPP;
+
 	len = rtdm_get_iov_flatlen(iov, iovlen);
 	if (len == 0)
 		return 0;
@@ -557,6 +593,12 @@ static ssize_t __bufp_sendmsg(struct rtdm_fd *fd,
 		return -ECONNREFUSED;
 	}
 
+	/* A shared ring is only fed from user space. */
+	if (rsk->ring) {
+		ret = -EOPNOTSUPP;
+		goto fail;
+	}
+
 	/*
 	 * We may only send complete messages, so there is no point in
 	 * accepting messages which are larger than what the buffer
@@ -704,10 +746,26 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 	if (sk->bufsz == 0)
 		return -ENOBUFS;
 
-	sk->bufmem = xnheap_vmalloc(sk->bufsz);
-	if (sk->bufmem == NULL) {
-		ret = -ENOMEM;
-		goto fail;
+	if (test_bit(_BUFP_MAPPED, &sk->status)) {
+		/* Ring indexes are free-running 32bit counters. */
+		if (!is_power_of_2(sk->bufsz) || sk->bufsz > (1U << 31)) {
+			ret = -EINVAL;
+			goto fail;
+		}
+		sk->ring = vmalloc_user(__bufp_ring_memsz(sk->bufsz));
+		if (sk->ring == NULL) {
+			ret = -ENOMEM;
+			goto fail;
+		}
+		sk->ring->size = sk->bufsz;
+		sk->ring->offset = PAGE_SIZE;
+		sk->bufmem = (void *)sk->ring + PAGE_SIZE;
+	} else {
+		sk->bufmem = xnheap_vmalloc(sk->bufsz);
+		if (sk->bufmem == NULL) {
+			ret = -ENOMEM;
+			goto fail;
+		}
 	}
 
 	sk->name = *sa;
@@ -719,7 +777,7 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 		ret = xnregistry_enter(sk->label, sk,
 				       &sk->handle, &__bufp_pnode.node);
 		if (ret) {
-			xnheap_vfree(sk->bufmem);
+			__bufp_free_buffer(sk);
 			goto fail;
 		}
 	}
@@ -824,7 +882,7 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 	struct __kernel_old_timeval tv;
 	rtdm_lockctx_t s;
 	size_t len;
-	int ret;
+	int ret, val;
 
 	ret = rtipc_get_sockoptin(fd, &sopt, arg);
 	if (ret)
@@ -878,6 +936,22 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 		cobalt_atomic_leave(s);
 		break;
 
+	case BUFP_MMAP:
+		if (sopt.optlen != sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(fd, &val, sopt.optval, sizeof(val)))
+			return -EFAULT;
+		cobalt_atomic_enter(s);
+		if (test_bit(_BUFP_BOUND, &sk->status) ||
+		    test_bit(_BUFP_BINDING, &sk->status))
+			ret = -EALREADY;
+		else if (val)
+			__set_bit(_BUFP_MAPPED, &sk->status);
+		else
+			__clear_bit(_BUFP_MAPPED, &sk->status);
+		cobalt_atomic_leave(s);
+		break;
+
 	case BUFP_LABEL:
 		if (sopt.optlen < sizeof(plabel))
 			return -EINVAL;
@@ -968,6 +1042,107 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 	return ret;
 }
 
+static int __bufp_ring_wait(struct bufp_socket *sk,
+			    struct rtdm_fd *fd, void *arg)
+{
+	struct bufp_ring *ring = sk->ring;
+	struct bufp_ring_wait rwait;
+	nanosecs_rel_t timeout;
+	rtdm_event_t *event;
+	rtdm_toseq_t toseq;
+	__u32 *waiting;
+	rtdm_lockctx_t s;
+	int ret = 0;
+	u32 avail;
+
+	if (rtipc_get_arg(fd, &rwait, arg, sizeof(rwait)))
+		return -EFAULT;
+
+	/*
+	 * The ring header is writable from user space: only trust
+	 * our own copy of the ring size.
+	 */
+	if (ring == NULL || rwait.len == 0 || rwait.len > sk->bufsz)
+		return -EINVAL;
+
+	switch (rwait.events) {
+	case BUFP_RING_WAIT_READ:
+		waiting = &ring->rd_waiting;
+		event = &sk->i_event;
+		timeout = sk->rx_timeout;
+		break;
+	case BUFP_RING_WAIT_WRITE:
+		waiting = &ring->wr_waiting;
+		event = &sk->o_event;
+		timeout = sk->tx_timeout;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	rtdm_toseq_init(&toseq, timeout);
+
+	cobalt_atomic_enter(s);
+
+	for (;;) {
+		/*
+		 * Raise the waiter flag before sampling the indexes;
+		 * this pairs with the barrier user space must issue
+		 * between updating its index and testing the flag, so
+		 * that either we see the update, or the other side
+		 * sees the flag and wakes us up.
+		 */
+		WRITE_ONCE(*waiting, 1);
+		smp_mb();
+		avail = min_t(u32, __bufp_ring_fill(ring), sk->bufsz);
+		if (rwait.events == BUFP_RING_WAIT_WRITE)
+			avail = sk->bufsz - avail;
+		if (avail >= rwait.len)
+			break;
+		/* Wake-ups happen under nklock, so we can't miss any. */
+		ret = rtdm_event_timedwait(event, timeout, &toseq);
+		if (ret)
+			break;
+	}
+
+	WRITE_ONCE(*waiting, 0);
+
+	cobalt_atomic_leave(s);
+
+	return ret;
+}
+
+static int __bufp_ring_wake(struct bufp_socket *sk,
+			    struct rtdm_fd *fd, void *arg)
+{
+	struct bufp_ring *ring = sk->ring;
+	rtdm_lockctx_t s;
+	int events;
+
+	if (rtipc_get_arg(fd, &events, arg, sizeof(events)))
+		return -EFAULT;
+
+	if (ring == NULL ||
+	    (events & ~(BUFP_RING_WAIT_READ|BUFP_RING_WAIT_WRITE)))
+		return -EINVAL;
+
+	cobalt_atomic_enter(s);
+
+	if (events & BUFP_RING_WAIT_READ) {
+		WRITE_ONCE(ring->rd_waiting, 0);
+		rtdm_event_pulse(&sk->i_event);
+	}
+
+	if (events & BUFP_RING_WAIT_WRITE) {
+		WRITE_ONCE(ring->wr_waiting, 0);
+		rtdm_event_pulse(&sk->o_event);
+	}
+
+	cobalt_atomic_leave(s);
+
+	return 0;
+}
+
 static int __bufp_ioctl(struct rtdm_fd *fd,
 			unsigned int request, void *arg)
 {
@@ -1019,6 +1194,14 @@ static int __bufp_ioctl(struct rtdm_fd *fd,
 		ret = -ENOTCONN;
 		break;
 
+	case BUFP_RTIOC_WAIT:
+		ret = __bufp_ring_wait(sk, fd, arg);
+		break;
+
+	case BUFP_RTIOC_WAKE:
+		ret = __bufp_ring_wake(sk, fd, arg);
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -1029,18 +1212,18 @@ static int __bufp_ioctl(struct rtdm_fd *fd,
 static int bufp_ioctl(struct rtdm_fd *fd,
 		      unsigned int request, void *arg)
 {
-	int ret;
-
 	switch (request) {
 	COMPAT_CASE(_RTIOC_BIND):
 		if (rtdm_in_rt_context())
 			return -ENOSYS;	/* Try downgrading to NRT */
-		fallthrough;
-	default:
-		ret = __bufp_ioctl(fd, request, arg);
+		break;
+	case BUFP_RTIOC_WAIT:
+		if (!rtdm_in_rt_context())
+			return -ENOSYS;	/* Try upgrading to RT */
+		break;
 	}
 
-	return ret;
+	return __bufp_ioctl(fd, request, arg);
 }
 
 static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
@@ -1050,8 +1233,10 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 	unsigned int mask = 0;
 	struct rtdm_fd *rfd;
 
-	if (test_bit(_BUFP_BOUND, &sk->status) && sk->fillsz > 0)
-		mask |= POLLIN;
+	if (test_bit(_BUFP_BOUND, &sk->status)) {
+		if (sk->ring ? __bufp_ring_fill(sk->ring) > 0 : sk->fillsz > 0)
+			mask |= POLLIN;
+	}
 
 	/*
 	 * If the socket is connected, POLLOUT means that the peer
@@ -1063,7 +1248,7 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 		rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
 		if (rfd) {
 			rsk = rtipc_fd_to_state(rfd);
-			if (rsk->fillsz < rsk->bufsz)
+			if (rsk->ring == NULL && rsk->fillsz < rsk->bufsz)
 				mask |= POLLOUT;
 		}
 	} else
@@ -1072,6 +1257,21 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 	return mask;
 }
 
+static int bufp_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+	struct rtipc_private *priv = rtdm_fd_to_private(fd);
+	struct bufp_socket *sk = priv->state;
+
+	if (!test_bit(_BUFP_BOUND, &sk->status) || sk->ring == NULL)
+		return -EINVAL;
+
+	if (vma->vm_pgoff != 0 ||
+	    vma->vm_end - vma->vm_start != __bufp_ring_memsz(sk->bufsz))
+		return -EINVAL;
+
+	return rtdm_mmap_vmem(vma, sk->ring);
+}
+
 static int bufp_init(void)
 {
 	portmap = xnmap_create(CONFIG_XENO_OPT_BUFP_NRPORT, 0, 0);
@@ -1100,5 +1300,6 @@ struct rtipc_protocol bufp_proto_driver = {
 		.write = bufp_write,
 		.ioctl = bufp_ioctl,
 		.pollstate = bufp_pollstate,
+		.mmap = bufp_mmap,
 	}
 };
@@ -23,6 +23,7 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/time.h>
+#include <linux/overflow.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/bufd.h>
 #include <cobalt/kernel/map.h>
@@ -31,12 +32,26 @@
 
 #define IDDP_SOCKET_MAGIC 0xa37a37a8
 
+struct iddp_mcast;
+
 struct iddp_message {
 	struct list_head next;
 	int from;
 	size_t rdoff;
 	size_t len;
-	char data[];
+	struct iddp_mcast *mcast;	/* Shared payload holder, if any. */
+	char *data;
+};
+
+/*
+ * A fan-out datagram is carried by a single block from the system
+ * heap, holding one queue link per destination followed by the
+ * payload all links refer to. The last receiver to consume its link
+ * releases the block.
+ */
+struct iddp_mcast {
+	atomic_t refs;
+	struct iddp_message links[];
 };
 
 struct iddp_socket {
@@ -48,6 +63,11 @@ struct iddp_socket {
 	rtdm_waitqueue_t *poolwaitq;
 	rtdm_waitqueue_t privwaitq;
 	size_t poolsz;
+	size_t msgsz;		/* Slab message size, zero if none. */
+	void *slabmem;
+	struct list_head slab;
+	int nr_fanout;
+	rtipc_port_t fanout[IDDP_FANOUT_MAX];
 	rtdm_sem_t insem;
 	struct list_head inq;
 	u_long status;
@@ -106,22 +126,81 @@ static inline void __iddp_init_mbuf(struct iddp_message *mbuf, size_t len)
 {
 	mbuf->rdoff = 0;
 	mbuf->len = len;
+	mbuf->mcast = NULL;
+	mbuf->data = (char *)(mbuf + 1);
 	INIT_LIST_HEAD(&mbuf->next);
 }
 
+/* Returns zero if msgsz is too large to fit a slot. */
+static inline size_t __iddp_slab_slotsz(size_t msgsz)
+{
+	size_t slotsz;
+
+	if (check_add_overflow(msgsz, sizeof(struct iddp_message) +
+			       L1_CACHE_BYTES - 1, &slotsz))
+		return 0;
+
+	return slotsz & ~((size_t)L1_CACHE_BYTES - 1);
+}
+
+static struct iddp_message *__iddp_get_mbuf(struct iddp_socket *sk,
+					    size_t len)
+{
+	struct iddp_message *mbuf = NULL;
+	rtdm_lockctx_t s;
+
+	if (sk->msgsz == 0)
+		return xnheap_alloc(sk->bufpool, len + sizeof(*mbuf));
+
+	cobalt_atomic_enter(s);
+	if (!list_empty(&sk->slab)) {
+		mbuf = list_first_entry(&sk->slab, struct iddp_message, next);
+		list_del(&mbuf->next);
+	}
+	cobalt_atomic_leave(s);
+
+	return mbuf;
+}
+
+static int __iddp_wait_buffer(rtdm_waitqueue_t *waitq,
+			      unsigned long *stalls,
+			      nanosecs_rel_t timeout,
+			      rtdm_toseq_t *toseq)
+{
+	rtdm_lockctx_t s;
+	int ret;
+
+	/*
+	 * No luck, no buffer free. Wait for a buffer to be released
+	 * and retry. Admittedly, we might create a thundering herd
+	 * effect if many waiters put a lot of memory pressure on the
+	 * pool, but in this case, the pool size should be adjusted.
+	 */
+	rtdm_waitqueue_lock(waitq, s);
+	++*stalls;
+	ret = rtdm_timedwait_locked(waitq, timeout, toseq);
+	rtdm_waitqueue_unlock(waitq, s);
+
+	return unlikely(ret == -EIDRM) ? -ECONNRESET : ret;
+}
+
 static struct iddp_message *
 __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 		  nanosecs_rel_t timeout, int flags, int *pret)
 {
 	struct iddp_message *mbuf = NULL;
 	rtdm_toseq_t timeout_seq;
-	rtdm_lockctx_t s;
 	int ret = 0;
 
+	if (sk->msgsz > 0 && len > sk->msgsz) {
+		*pret = -EMSGSIZE;
+		return NULL;
+	}
+
 	rtdm_toseq_init(&timeout_seq, timeout);
 
 	for (;;) {
-		mbuf = xnheap_alloc(sk->bufpool, len + sizeof(*mbuf));
+		mbuf = __iddp_get_mbuf(sk, len);
 		if (mbuf) {
 			__iddp_init_mbuf(mbuf, len);
 			break;
@@ -130,19 +209,8 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 			ret = -EAGAIN;
 			break;
 		}
-		/*
-		 * No luck, no buffer free. Wait for a buffer to be
-		 * released and retry. Admittedly, we might create a
-		 * thundering herd effect if many waiters put a lot of
-		 * memory pressure on the pool, but in this case, the
-		 * pool size should be adjusted.
-		 */
-		rtdm_waitqueue_lock(sk->poolwaitq, s);
-		++sk->stalls;
-		ret = rtdm_timedwait_locked(sk->poolwaitq, timeout, &timeout_seq);
-		rtdm_waitqueue_unlock(sk->poolwaitq, s);
-		if (unlikely(ret == -EIDRM))
-			ret = -ECONNRESET;
+		ret = __iddp_wait_buffer(sk->poolwaitq, &sk->stalls,
+					 timeout, &timeout_seq);
 		if (ret)
 			break;
 	}
@@ -152,10 +220,61 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 	return mbuf;
 }
 
+static struct iddp_mcast *
+__iddp_alloc_mcast(struct iddp_socket *sk, int nr, size_t len,
+		   nanosecs_rel_t timeout, int flags, int *pret)
+{
+	struct iddp_mcast *mcast = NULL;
+	rtdm_toseq_t timeout_seq;
+	int ret = 0;
+
+	rtdm_toseq_init(&timeout_seq, timeout);
+
+	for (;;) {
+		mcast = xnheap_alloc(&cobalt_heap, sizeof(*mcast) +
+				     nr * sizeof(struct iddp_message) + len);
+		if (mcast)
+			break;
+		if (flags & MSG_DONTWAIT) {
+			ret = -EAGAIN;
+			break;
+		}
+		ret = __iddp_wait_buffer(&poolwaitq, &sk->stalls,
+					 timeout, &timeout_seq);
+		if (ret)
+			break;
+	}
+
+	*pret = ret;
+
+	return mcast;
+}
+
+static void __iddp_put_mcast(struct iddp_mcast *mcast)
+{
+	if (atomic_dec_and_test(&mcast->refs)) {
+		xnheap_free(&cobalt_heap, mcast);
+		rtdm_waitqueue_broadcast(&poolwaitq);
+	}
+}
+
 static void __iddp_free_mbuf(struct iddp_socket *sk,
 			     struct iddp_message *mbuf)
 {
-	xnheap_free(sk->bufpool, mbuf);
+	rtdm_lockctx_t s;
+
+	if (mbuf->mcast) {
+		__iddp_put_mcast(mbuf->mcast);
+		return;
+	}
+
+	if (sk->msgsz > 0) {
+		cobalt_atomic_enter(s);
+		list_add(&mbuf->next, &sk->slab);
+		cobalt_atomic_leave(s);
+	} else
+		xnheap_free(sk->bufpool, mbuf);
+
 	rtdm_waitqueue_broadcast(sk->poolwaitq);
 }
 
@@ -170,6 +289,10 @@ static int iddp_socket(struct rtdm_fd *fd)
 	sk->bufpool = &cobalt_heap;
 	sk->poolwaitq = &poolwaitq;
 	sk->poolsz = 0;
+	sk->msgsz = 0;
+	sk->slabmem = NULL;
+	INIT_LIST_HEAD(&sk->slab);
+	sk->nr_fanout = 0;
 	sk->status = 0;
 	sk->handle = 0;
 	sk->rx_timeout = RTDM_TIMEOUT_INFINITE;
@@ -204,20 +327,29 @@ static void iddp_close(struct rtdm_fd *fd)
 			xnmap_remove(portmap, sk->name.sipc_port);
 			cobalt_atomic_leave(s);
 		}
-		if (sk->bufpool != &cobalt_heap) {
-			poolmem = xnheap_get_membase(&sk->privpool);
-			poolsz = xnheap_get_size(&sk->privpool);
-			xnheap_destroy(&sk->privpool);
-			xnheap_vfree(poolmem);
-			return;
-		}
 	}
 
-	/* Send unread datagrams back to the system heap. */
+	/*
+	 * Drop our references on unread fan-out datagrams, and send
+	 * the others back to the system heap unless they live in
+	 * private memory which goes away with the socket.
+	 */
 	while (!list_empty(&sk->inq)) {
 		mbuf = list_entry(sk->inq.next, struct iddp_message, next);
 		list_del(&mbuf->next);
-		xnheap_free(&cobalt_heap, mbuf);
+		if (mbuf->mcast)
+			__iddp_put_mcast(mbuf->mcast);
+		else if (sk->bufpool == &cobalt_heap && sk->slabmem == NULL)
+			xnheap_free(&cobalt_heap, mbuf);
+	}
+
+	if (sk->slabmem)
+		xnheap_vfree(sk->slabmem);
+	else if (sk->bufpool != &cobalt_heap) {
+		poolmem = xnheap_get_membase(&sk->privpool);
+		poolsz = xnheap_get_size(&sk->privpool);
+		xnheap_destroy(&sk->privpool);
+		xnheap_vfree(poolmem);
 	}
 
 	kfree(sk);
@@ -375,6 +507,56 @@ static ssize_t iddp_read(struct rtdm_fd *fd, void *buf, size_t len)
 	return __iddp_recvmsg(fd, &iov, 1, 0, NULL);
 }
 
+static int __iddp_copy_iov(struct rtdm_fd *fd, char *dst,
+			   struct iovec *iov, int iovlen, ssize_t len)
+{
+	ssize_t rdlen, vlen;
+	struct xnbufd bufd;
+	int nvec, ret = 0;
+
+	/* Move "len" bytes to dst from the vector cells */
+	for (nvec = 0, rdlen = len; nvec < iovlen && rdlen > 0; nvec++) {
+		if (iov[nvec].iov_len == 0)
+			continue;
+		vlen = rdlen >= iov[nvec].iov_len ? iov[nvec].iov_len : rdlen;
+		if (rtdm_fd_is_user(fd)) {
+			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_to_kmem(dst, &bufd, vlen);
+			xnbufd_unmap_uread(&bufd);
+		} else {
+			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_to_kmem(dst, &bufd, vlen);
+			xnbufd_unmap_kread(&bufd);
+		}
+		if (ret < 0)
+			return ret;
+		iov[nvec].iov_base += vlen;
+		iov[nvec].iov_len -= vlen;
+		rdlen -= vlen;
+		dst += vlen;
+	}
+
+	return 0;
+}
+
+static void __iddp_queue_mbuf(struct iddp_socket *rsk,
+			      struct iddp_message *mbuf, int flags)
+{
+	/*
+	 * CAUTION: we must remain atomic from the moment we signal
+	 * POLLIN, until sem_up has happened.
+	 */
+	if (list_empty(&rsk->inq)) /* -> readable */
+		xnselect_signal(&rsk->priv->recv_block, POLLIN);
+
+	if (flags & MSG_OOB)
+		list_add(&mbuf->next, &rsk->inq);
+	else
+		list_add_tail(&mbuf->next, &rsk->inq);
+
+	rtdm_sem_up(&rsk->insem); /* Will resched. */
+}
+
 static ssize_t __iddp_sendmsg(struct rtdm_fd *fd,
 			      struct iovec *iov, int iovlen, int flags,
 			      const struct sockaddr_ipc *daddr)
@@ -382,11 +564,10 @@ static ssize_t __iddp_sendmsg(struct rtdm_fd *fd,
 	struct rtipc_private *priv = rtdm_fd_to_private(fd);
 	struct iddp_socket *sk = priv->state, *rsk;
 	struct iddp_message *mbuf;
-	ssize_t len, rdlen, vlen;
-	int nvec, wroff, ret;
 	struct rtdm_fd *rfd;
-	struct xnbufd bufd;
 	rtdm_lockctx_t s;
+	ssize_t len;
+	int ret;
 
 	len = rtdm_get_iov_flatlen(iov, iovlen);
 	if (len == 0)
@@ -412,57 +593,111 @@ static ssize_t __iddp_sendmsg(struct rtdm_fd *fd,
 		return ret;
 	}
 
-	/* Now, move "len" bytes to mbuf->data from the vector cells */
-	for (nvec = 0, rdlen = len, wroff = 0;
-	     nvec < iovlen && rdlen > 0; nvec++) {
-		if (iov[nvec].iov_len == 0)
+	ret = __iddp_copy_iov(fd, mbuf->data, iov, iovlen, len);
+	if (ret < 0)
+		goto fail;
+
+	cobalt_atomic_enter(s);
+	mbuf->from = sk->name.sipc_port;
+	__iddp_queue_mbuf(rsk, mbuf, flags);
+	cobalt_atomic_leave(s);
+
+	rtdm_fd_unlock(rfd);
+
+	return len;
+
+fail:
+	__iddp_free_mbuf(rsk, mbuf);
+
+	rtdm_fd_unlock(rfd);
+
+	return ret;
+}
+
+static ssize_t __iddp_fanout(struct rtdm_fd *fd,
+			     struct iovec *iov, int iovlen, int flags)
+{
+	struct rtipc_private *priv = rtdm_fd_to_private(fd);
+	struct rtdm_fd *rfds[IDDP_FANOUT_MAX], *rfd;
+	struct iddp_socket *sk = priv->state, *rsk;
+	rtipc_port_t ports[IDDP_FANOUT_MAX];
+	struct iddp_message *mbuf;
+	struct iddp_mcast *mcast;
+	int nr_ports, nr, n, ret;
+	rtdm_lockctx_t s;
+	ssize_t len;
+	char *data;
+
+	len = rtdm_get_iov_flatlen(iov, iovlen);
+	if (len == 0)
+		return 0;
+
+	cobalt_atomic_enter(s);
+	nr_ports = sk->nr_fanout;
+	memcpy(ports, sk->fanout, nr_ports * sizeof(ports[0]));
+	for (n = 0, nr = 0; n < nr_ports; n++) {
+		rfd = xnmap_fetch_nocheck(portmap, ports[n]);
+		if (rfd && rtdm_fd_lock(rfd) == 0)
+			rfds[nr++] = rfd;
+	}
+	cobalt_atomic_leave(s);
+
+	if (nr_ports == 0)
+		return -EDESTADDRREQ;
+
+	/* Skip the destinations which are not bound (yet). */
+	for (n = 0; n < nr; ) {
+		rsk = rtipc_fd_to_state(rfds[n]);
+		if (test_bit(_IDDP_BOUND, &rsk->status)) {
+			n++;
 			continue;
-		vlen = rdlen >= iov[nvec].iov_len ? iov[nvec].iov_len : rdlen;
-		if (rtdm_fd_is_user(fd)) {
-			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
-			xnbufd_unmap_uread(&bufd);
-		} else {
-			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
-			xnbufd_unmap_kread(&bufd);
 		}
-		if (ret < 0)
-			goto fail;
-		iov[nvec].iov_base += vlen;
-		iov[nvec].iov_len -= vlen;
-		rdlen -= vlen;
-		wroff += vlen;
+		rtdm_fd_unlock(rfds[n]);
+		rfds[n] = rfds[--nr];
 	}
 
-	cobalt_atomic_enter(s);
+	if (nr == 0)
+		return -ECONNREFUSED;
 
 	/*
-	 * CAUTION: we must remain atomic from the moment we signal
-	 * POLLIN, until sem_up has happened.
+	 * The payload is copied once to a block shared by all
+	 * receivers, each getting a reference to it.
 	 */
-	if (list_empty(&rsk->inq)) /* -> readable */
-		xnselect_signal(&rsk->priv->recv_block, POLLIN);
+	mcast = __iddp_alloc_mcast(sk, nr, len, sk->tx_timeout, flags, &ret);
+	if (unlikely(ret))
+		goto out;
+
+	data = (char *)&mcast->links[nr];
+	ret = __iddp_copy_iov(fd, data, iov, iovlen, len);
+	if (ret < 0) {
+		xnheap_free(&cobalt_heap, mcast);
+		goto out;
+	}
 
-	mbuf->from = sk->name.sipc_port;
+	atomic_set(&mcast->refs, nr);
 
-	if (flags & MSG_OOB)
-		list_add(&mbuf->next, &rsk->inq);
-	else
-		list_add_tail(&mbuf->next, &rsk->inq);
-
-	rtdm_sem_up(&rsk->insem); /* Will resched. */
+	cobalt_atomic_enter(s);
 
-	cobalt_atomic_leave(s);
+	/* Wake up all receivers, then reschedule once. */
+	xnsched_lock();
 
-	rtdm_fd_unlock(rfd);
+	for (n = 0; n < nr; n++) {
+		mbuf = &mcast->links[n];
+		__iddp_init_mbuf(mbuf, len);
+		mbuf->mcast = mcast;
+		mbuf->data = data;
+		mbuf->from = sk->name.sipc_port;
+		__iddp_queue_mbuf(rtipc_fd_to_state(rfds[n]), mbuf, flags);
+	}
 
-	return len;
+	xnsched_unlock();
 
-fail:
-	__iddp_free_mbuf(rsk, mbuf);
+	cobalt_atomic_leave(s);
 
-	rtdm_fd_unlock(rfd);
+	ret = len;
+out:
+	for (n = 0; n < nr; n++)
+		rtdm_fd_unlock(rfds[n]);
 
 	return ret;
 }
@@ -494,7 +729,7 @@ static ssize_t iddp_sendmsg(struct rtdm_fd *fd,
 		if (msg->msg_namelen != 0)
 			return -EINVAL;
 		daddr = sk->peer;
-		if (daddr.sipc_port < 0)
+		if (daddr.sipc_port < 0 && sk->nr_fanout == 0)
 			return -EDESTADDRREQ;
 	}
 
@@ -506,7 +741,11 @@ static ssize_t iddp_sendmsg(struct rtdm_fd *fd,
 	if (ret)
 		return ret;
 
-	ret = __iddp_sendmsg(fd, iov, msg->msg_iovlen, flags, &daddr);
+	/* The fan-out set overrides the default destination. */
+	if (msg->msg_name == NULL && sk->nr_fanout > 0)
+		ret = __iddp_fanout(fd, iov, msg->msg_iovlen, flags);
+	else
+		ret = __iddp_sendmsg(fd, iov, msg->msg_iovlen, flags, &daddr);
 	if (ret <= 0) {
 		rtdm_drop_iovec(iov, iov_fast);
 		return ret;
@@ -523,6 +762,9 @@ static ssize_t iddp_write(struct rtdm_fd *fd,
 	struct iovec iov = { .iov_base = (void *)buf, .iov_len = len };
 	struct iddp_socket *sk = priv->state;
 
+	if (sk->nr_fanout > 0)
+		return __iddp_fanout(fd, &iov, 1, 0);
+
 	if (sk->peer.sipc_port < 0)
 		return -EDESTADDRREQ;
 
@@ -534,10 +776,11 @@ static int __iddp_bind_socket(struct rtdm_fd *fd,
 {
 	struct rtipc_private *priv = rtdm_fd_to_private(fd);
 	struct iddp_socket *sk = priv->state;
+	size_t poolsz, slotsz, off;
+	struct iddp_message *mbuf;
+	void *poolmem = NULL;
 	int ret = 0, port;
 	rtdm_lockctx_t s;
-	void *poolmem;
-	size_t poolsz;
 
 	if (sa->sipc_family != AF_RTIPC)
 		return -EINVAL;
@@ -569,7 +812,30 @@ static int __iddp_bind_socket(struct rtdm_fd *fd,
 	 * setsockopt() before we got there.
 	 */
 	poolsz = sk->poolsz;
-	if (poolsz > 0) {
+	if (sk->msgsz > 0) {
+		/*
+		 * Carve the pool into fixed-size slots, so that
+		 * buffers are picked from a free list instead of
+		 * going through the heap allocator.
+		 */
+		slotsz = __iddp_slab_slotsz(sk->msgsz);
+		if (slotsz == 0 || poolsz < slotsz) {
+			ret = -EINVAL;
+			goto fail;
+		}
+		poolsz = PAGE_ALIGN(poolsz);
+		poolmem = xnheap_vmalloc(poolsz);
+		if (poolmem == NULL) {
+			ret = -ENOMEM;
+			goto fail;
+		}
+		for (off = 0; off + slotsz <= poolsz; off += slotsz) {
+			mbuf = poolmem + off;
+			list_add_tail(&mbuf->next, &sk->slab);
+		}
+		sk->slabmem = poolmem;
+		sk->poolwaitq = &sk->privwaitq;
+	} else if (poolsz > 0) {
 		poolsz = PAGE_ALIGN(poolsz);
 		poolmem = xnheap_vmalloc(poolsz);
 		if (poolmem == NULL) {
@@ -596,10 +862,15 @@ static int __iddp_bind_socket(struct rtdm_fd *fd,
 		ret = xnregistry_enter(sk->label, sk,
 				       &sk->handle, &__iddp_pnode.node);
 		if (ret) {
-			if (poolsz > 0) {
+			if (sk->slabmem) {
+				INIT_LIST_HEAD(&sk->slab);
+				sk->slabmem = NULL;
+			} else if (poolsz > 0)
 				xnheap_destroy(&sk->privpool);
+			if (poolmem)
 				xnheap_vfree(poolmem);
-			}
+			sk->bufpool = &cobalt_heap;
+			sk->poolwaitq = &poolwaitq;
 			goto fail;
 		}
 	}
@@ -702,9 +973,10 @@ static int __iddp_setsockopt(struct iddp_socket *sk,
 	struct _rtdm_setsockopt_args sopt;
 	struct rtipc_port_label plabel;
 	struct __kernel_old_timeval tv;
+	struct iddp_fanout fanout;
 	rtdm_lockctx_t s;
+	int ret, n;
 	size_t len;
-	int ret;
 
 	ret = rtipc_get_sockoptin(fd, &sopt, arg);
 	if (ret)
@@ -758,6 +1030,40 @@ static int __iddp_setsockopt(struct iddp_socket *sk,
 		cobalt_atomic_leave(s);
 		break;
 
+	case IDDP_MSGSZ:
+		ret = rtipc_get_length(fd, &len, sopt.optval, sopt.optlen);
+		if (ret)
+			return ret;
+		if (len == 0 || __iddp_slab_slotsz(len) == 0)
+			return -EINVAL;
+		cobalt_atomic_enter(s);
+		if (test_bit(_IDDP_BOUND, &sk->status) ||
+		    test_bit(_IDDP_BINDING, &sk->status))
+			ret = -EALREADY;
+		else
+			sk->msgsz = len;
+		cobalt_atomic_leave(s);
+		break;
+
+	case IDDP_FANOUT:
+		if (sopt.optlen != sizeof(fanout))
+			return -EINVAL;
+		if (rtipc_get_arg(fd, &fanout, sopt.optval, sizeof(fanout)))
+			return -EFAULT;
+		if (fanout.nr_ports < 0 || fanout.nr_ports > IDDP_FANOUT_MAX)
+			return -EINVAL;
+		for (n = 0; n < fanout.nr_ports; n++) {
+			if (fanout.ports[n] < 0 ||
+			    fanout.ports[n] >= CONFIG_XENO_OPT_IDDP_NRPORT)
+				return -EINVAL;
+		}
+		cobalt_atomic_enter(s);
+		memcpy(sk->fanout, fanout.ports,
+		       fanout.nr_ports * sizeof(fanout.ports[0]));
+		sk->nr_fanout = fanout.nr_ports;
+		cobalt_atomic_leave(s);
+		break;
+
 	case IDDP_LABEL:
 		if (sopt.optlen < sizeof(plabel))
 			return -EINVAL;
@@ -791,6 +1097,7 @@ static int __iddp_getsockopt(struct iddp_socket *sk,
 	struct _rtdm_getsockopt_args sopt;
 	struct rtipc_port_label plabel;
 	struct __kernel_old_timeval tv;
+	struct iddp_fanout fanout;
 	rtdm_lockctx_t s;
 	socklen_t len;
 	int ret;
@@ -842,6 +1149,19 @@ static int __iddp_getsockopt(struct iddp_socket *sk,
 			return -EFAULT;
 		break;
 
+	case IDDP_FANOUT:
+		if (len < sizeof(fanout))
+			return -EINVAL;
+		memset(&fanout, 0, sizeof(fanout));
+		cobalt_atomic_enter(s);
+		fanout.nr_ports = sk->nr_fanout;
+		memcpy(fanout.ports, sk->fanout,
+		       sk->nr_fanout * sizeof(fanout.ports[0]));
+		cobalt_atomic_leave(s);
+		if (rtipc_put_arg(fd, sopt.optval, &fanout, sizeof(fanout)))
+			return -EFAULT;
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -34,6 +34,12 @@ MODULE_AUTHOR("Maintainer: Jan Kiszka <Jan.Kiszka@web.de>");
 MODULE_DESCRIPTION("RTnet loopback driver");
 MODULE_LICENSE("GPL");
 
+static bool rx_dispatch;
+module_param(rx_dispatch, bool, 0444);
+MODULE_PARM_DESC(rx_dispatch, "Pass looped frames to the RX dispatch "
+			      "queues like a NIC would, instead of "
+			      "delivering them synchronously");
+
 static struct rtnet_device *rt_loopback_dev;
 
 /***
@@ -80,7 +86,16 @@ static int rt_loopback_xmit(struct rtskb *rtskb, struct rtnet_device *rtdev)
 	/* parse the Ethernet header as usual */
 	rtskb->protocol = rt_eth_type_trans(rtskb, rtdev);
 
-	rt_stack_deliver(rtskb);
+	if (rx_dispatch) {
+		rtdm_lockctx_t context;
+
+		/* emulate the receive path of a NIC interrupt handler */
+		rtdm_lock_irqsave(context);
+		rtnetif_rx(rtskb);
+		rt_mark_stack_mgr(rtdev);
+		rtdm_lock_irqrestore(context);
+	} else
+		rt_stack_deliver(rtskb);
 
 	return 0;
 }
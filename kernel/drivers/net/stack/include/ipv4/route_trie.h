@@ -0,0 +1,110 @@
+/***
+ *
+ *  include/ipv4/route_trie.h - longest-prefix match table for
+ *  network routes
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ */
+
+#ifndef __RTNET_ROUTE_TRIE_H_
+#define __RTNET_ROUTE_TRIE_H_
+
+#include <linux/types.h>
+#include <linux/bitops.h>
+#include <asm/byteorder.h>
+
+/*
+ * Network routes are looked up in a multibit trie consuming 4 bits
+ * of the destination address per level, hence at most 8 node visits
+ * per lookup. Nodes are compressed the Poptrie way: a bitmap tells
+ * which of the 16 slots lead to a child node, children and leaves of
+ * a node are stored contiguously, and are indexed by counting the
+ * bits set below the slot. Leaves refer to the route table of the
+ * trie, entry #0 standing for "no route".
+ *
+ * A trie is never modified once built. Updates build a new trie from
+ * scratch, then publish it, so that lookups never wait for writers.
+ */
+
+#define RT_NET_TRIE_STRIDE	4
+#define RT_NET_TRIE_SLOTS	(1 << RT_NET_TRIE_STRIDE)
+
+/* Each route adds at most one node per level below the root. */
+#define RT_NET_TRIE_NODES(__routes)					\
+	(1 + (32 / RT_NET_TRIE_STRIDE - 1) * (__routes))
+#define RT_NET_TRIE_LEAVES(__routes)					\
+	(RT_NET_TRIE_SLOTS * RT_NET_TRIE_NODES(__routes))
+
+struct rt_net_route_entry {
+	u32 dest_net_ip; /* network byte order, as all fields */
+	u32 dest_net_mask;
+	u32 gw_ip;
+};
+
+struct rt_net_trie_node {
+	u16 vector;	/* slots leading to a child node */
+	u16 __pad;
+	u32 child_base;
+	u32 leaf_base;
+};
+
+struct rt_net_trie {
+	struct rt_net_trie_node *nodes;
+	u16 *leaves;
+	/* routes[0] is unused, leaves use 0 for "no route". */
+	struct rt_net_route_entry *routes;
+	unsigned int max_routes;
+	unsigned int nr_routes;
+	unsigned int nr_nodes;
+	unsigned int nr_leaves;
+};
+
+static inline bool rt_net_mask_valid(u32 mask)
+{
+	u32 inv = ~ntohl(mask);
+
+	/* Only contiguous masks can be matched by prefix. */
+	return (inv & (inv + 1)) == 0;
+}
+
+int rt_net_trie_build(struct rt_net_trie *t,
+		      const struct rt_net_route_entry *routes,
+		      unsigned int nr_routes);
+
+/***
+ *  rt_net_trie_lookup - returns the most specific route matching
+ *  @daddr (network byte order), or NULL
+ */
+static inline const struct rt_net_route_entry *
+rt_net_trie_lookup(const struct rt_net_trie *t, u32 daddr)
+{
+	const struct rt_net_trie_node *node = t->nodes;
+	u32 addr = ntohl(daddr);
+	unsigned int shift = 32, leaf;
+	u16 bit, below;
+
+	for (;;) {
+		shift -= RT_NET_TRIE_STRIDE;
+		bit = 1U << ((addr >> shift) & (RT_NET_TRIE_SLOTS - 1));
+		below = bit - 1;
+		if (!(node->vector & bit))
+			break;
+		node = t->nodes + node->child_base +
+		       hweight16(node->vector & below);
+	}
+
+	leaf = t->leaves[node->leaf_base + hweight16(~node->vector & below)];
+
+	return leaf ? t->routes + leaf : NULL;
+}
+
+#endif /* __RTNET_ROUTE_TRIE_H_ */
@@ -35,6 +35,8 @@
 #include <rtdm/driver.h>
 #include <stack_mgr.h>
 
+struct rt_packet_ring;
+
 struct rtsocket {
 	unsigned short protocol;
 
@@ -73,6 +75,8 @@ struct rtsocket {
 		struct {
 			struct rtpacket_type packet_type;
 			int ifindex;
+			struct rt_packet_ring *rx_ring;
+			struct rt_packet_ring *tx_ring;
 		} packet;
 	} prot;
 };
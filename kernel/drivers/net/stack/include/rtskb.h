@@ -84,6 +84,14 @@ commands demand to be executed within a non real-time context.
 Pools are organized as normal rtskb queues (struct rtskb_queue). When a rtskb
 is allocated (alloc_rtskb()), it is actually dequeued from the pool's queue.
 When freeing a rtskb (kfree_rtskb()), the rtskb is enqueued to its owning pool.
+
+Unless disabled (rtskb_cache_batch=0), each pool also keeps a small per-CPU
+cache of free rtskbs in front of its queue, which allocations and releases use
+without taking the pool lock. Caches are refilled from and spilled to the
+queue in batches. A CPU running out of rtskbs while its cache and the queue
+are empty takes over the cache of another CPU, so that a pool still hands out
+all of its rtskbs. Cached rtskbs still belong to their pool.
+
 rtskbs can be exchanged between pools (rtskb_acquire()). In this case, the
 passed rtskb switches over to from its owning pool to a given pool, but only if
 this pool can pass an empty rtskb from its own queue back.
@@ -234,10 +242,18 @@ struct rtskb_pool_lock_ops {
 	void (*unlock)(void *cookie);
 };
 
+/* Free rtskbs of a pool kept on a CPU, linked through rtskb->next. */
+struct rtskb_pool_cache {
+	struct rtskb *head;
+	unsigned int count;
+};
+
 struct rtskb_pool {
 	struct rtskb_queue queue;
 	const struct rtskb_pool_lock_ops *lock_ops;
 	void *lock_cookie;
+	struct rtskb_pool_cache __percpu *cache;
+	unsigned int cache_batch;
 };
 
 #define QUEUE_MAX_PRIO 0
@@ -279,6 +295,9 @@ extern void rtskb_over_panic(struct rtskb *skb, int len, void *here);
 extern void rtskb_under_panic(struct rtskb *skb, int len, void *here);
 #endif
 
+extern void rtskb_cache_read_stats(unsigned long *hits, unsigned long *misses,
+				   unsigned long *steals);
+
 extern struct rtskb *rtskb_pool_dequeue(struct rtskb_pool *pool);
 
 extern void rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb);
@@ -85,9 +85,18 @@ static inline void rtnetif_tx(struct rtnet_device *rtdev)
 {
 }
 
+#if CONFIG_XENO_DRIVERS_NET_RX_QUEUES > 1
+void rt_stack_mark_pending(void);
+#else
+static inline void rt_stack_mark_pending(void)
+{
+}
+#endif
+
 static inline void rt_mark_stack_mgr(struct rtnet_device *rtdev)
 {
 	rtdm_event_signal(rtdev->stack_event);
+	rt_stack_mark_pending();
 }
 
 #endif /* __KERNEL__ */
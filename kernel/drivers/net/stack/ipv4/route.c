@@ -23,6 +23,7 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/sched.h>
 #include <net/ip.h>
 
 #include <rtnet_internal.h>
@@ -30,6 +31,7 @@
 #include <rtnet_chrdev.h>
 #include <ipv4/af_inet.h>
 #include <ipv4/route.h>
+#include <ipv4/route_trie.h>
 
 /* FIXME: should also become some tunable parameter */
 #define ROUTER_FORWARD_PRIO                                                    \
@@ -43,14 +45,6 @@ struct host_route {
 	struct dest_route dest_host;
 };
 
-/* Second-level routing: routes to other networks */
-struct net_route {
-	struct net_route *next;
-	u32 dest_net_ip;
-	u32 dest_net_mask;
-	u32 gw_ip;
-};
-
 #if (CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES &                              \
      (CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES - 1))
 #error CONFIG_XENO_DRIVERS_NET_RTIPV4_HOST_ROUTES must be power of 2
@@ -70,29 +64,29 @@ static struct host_route *host_hash_tbl[HOST_HASH_TBL_SIZE];
 static DEFINE_RTDM_LOCK(host_table_lock);
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
-#if (CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES &                               \
-     (CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES - 1))
-#error CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES must be power of 2
-#endif
-#if CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES < 256
-#define NET_HASH_TBL_SIZE 64
-#else
-#define NET_HASH_TBL_SIZE                                                      \
-	((CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES / 256) * 64)
-#endif
-#define NET_HASH_KEY_MASK (NET_HASH_TBL_SIZE - 1)
-#define NET_HASH_KEY_SHIFT 8
+/*
+ * Second-level routing: routes to other networks
+ *
+ * The reference set of routes is only changed under net_route_mutex.
+ * Each change rebuilds the unused trie from that set, publishes it,
+ * then waits for all lookups which may still be walking the former
+ * trie to complete before it can be recycled. Lookups never block:
+ * they only announce themselves in the reader count of the current
+ * epoch.
+ */
+#define NET_ROUTES CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES
 
-static struct net_route net_routes[CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES];
-static struct net_route *free_net_route;
+static struct rt_net_route_entry net_routes[NET_ROUTES];
 static int allocated_net_routes;
-static struct net_route *net_hash_tbl[NET_HASH_TBL_SIZE + 1];
-static unsigned int net_hash_key_shift = NET_HASH_KEY_SHIFT;
-static DEFINE_RTDM_LOCK(net_table_lock);
-
-module_param(net_hash_key_shift, uint, 0444);
-MODULE_PARM_DESC(net_hash_key_shift, "destination right shift for "
-				     "network hash key (default: 8)");
+static DEFINE_MUTEX(net_route_mutex);
+
+static struct rt_net_trie_node net_trie_nodes[2][RT_NET_TRIE_NODES(NET_ROUTES)];
+static u16 net_trie_leaves[2][RT_NET_TRIE_LEAVES(NET_ROUTES)];
+static struct rt_net_route_entry net_trie_routes[2][NET_ROUTES + 1];
+static struct rt_net_trie net_tries[2];
+static struct rt_net_trie *net_trie;
+static unsigned int net_trie_epoch;
+static atomic_t net_trie_readers[2];
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
 /***
@@ -101,10 +95,6 @@ MODULE_PARM_DESC(net_hash_key_shift, "destination right shift for "
 #ifdef CONFIG_XENO_OPT_VFILE
 static int rtnet_ipv4_route_show(struct xnvfile_regular_iterator *it, void *d)
 {
-#ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
-	u32 mask;
-#endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
-
 	xnvfile_printf(it,
 		       "Host routes allocated/total:\t%d/%d\n"
 		       "Host hash table size:\t\t%d\n",
@@ -113,14 +103,12 @@ static int rtnet_ipv4_route_show(struct xnvfile_regular_iterator *it, void *d)
 		       HOST_HASH_TBL_SIZE);
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
-	mask = NET_HASH_KEY_MASK << net_hash_key_shift;
 	xnvfile_printf(it,
 		       "Network routes allocated/total:\t%d/%d\n"
-		       "Network hash table size:\t%d\n"
-		       "Network hash key shift/mask:\t%d/%08X\n",
-		       allocated_net_routes,
-		       CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES,
-		       NET_HASH_TBL_SIZE, net_hash_key_shift, mask);
+		       "Network trie nodes/leaves:\t%u/%u\n",
+		       allocated_net_routes, NET_ROUTES,
+		       READ_ONCE(net_trie)->nr_nodes,
+		       READ_ONCE(net_trie)->nr_leaves);
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_ROUTER
@@ -303,18 +291,15 @@ static struct xnvfile_snapshot rtnet_ipv4_host_route_vfile = {
 static struct xnvfile_link rtnet_ipv4_arp_vfile;
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
-static rtdm_lockctx_t rtnet_ipv4_net_route_lock_ctx;
-
 static int rtnet_ipv4_net_route_lock(struct xnvfile *vfile)
 {
-	rtdm_lock_get_irqsave(&net_table_lock, rtnet_ipv4_net_route_lock_ctx);
+	mutex_lock(&net_route_mutex);
 	return 0;
 }
 
 static void rtnet_ipv4_net_route_unlock(struct xnvfile *vfile)
 {
-	rtdm_lock_put_irqrestore(&net_table_lock,
-				 rtnet_ipv4_net_route_lock_ctx);
+	mutex_unlock(&net_route_mutex);
 }
 
 static struct xnvfile_lock_ops rtnet_ipv4_net_route_lock_ops = {
@@ -323,12 +308,10 @@ static struct xnvfile_lock_ops rtnet_ipv4_net_route_lock_ops = {
 };
 
 struct rtnet_ipv4_net_route_priv {
-	unsigned key;
-	struct net_route *entry_ptr;
+	int index;
 };
 
 struct rtnet_ipv4_net_route_data {
-	int key;
 	u32 dest_net_ip;
 	u32 dest_net_mask;
 	u32 gw_ip;
@@ -357,8 +340,7 @@ static void *rtnet_ipv4_net_route_begin(struct xnvfile_snapshot_iterator *it)
 		return VFILE_SEQ_EMPTY;
 	}
 
-	priv->key = -1;
-	priv->entry_ptr = NULL;
+	priv->index = 0;
 	return data;
 }
 
@@ -375,21 +357,14 @@ static int rtnet_ipv4_net_route_next(struct xnvfile_snapshot_iterator *it,
 	struct rtnet_ipv4_net_route_priv *priv = xnvfile_iterator_priv(it);
 	struct rtnet_ipv4_net_route_data *p = data;
 
-	if (priv->entry_ptr == NULL) {
-		if (++priv->key >= NET_HASH_TBL_SIZE + 1)
-			return 0;
-
-		priv->entry_ptr = net_hash_tbl[priv->key];
-		if (priv->entry_ptr == NULL)
-			return VFILE_SEQ_SKIP;
-	}
+	if (priv->index >= allocated_net_routes)
+		return 0;
 
-	p->key = priv->key;
-	p->dest_net_ip = priv->entry_ptr->dest_net_ip;
-	p->dest_net_mask = priv->entry_ptr->dest_net_mask;
-	p->gw_ip = priv->entry_ptr->gw_ip;
+	p->dest_net_ip = net_routes[priv->index].dest_net_ip;
+	p->dest_net_mask = net_routes[priv->index].dest_net_mask;
+	p->gw_ip = net_routes[priv->index].gw_ip;
 
-	priv->entry_ptr = priv->entry_ptr->next;
+	priv->index++;
 
 	return 1;
 }
@@ -400,22 +375,14 @@ static int rtnet_ipv4_net_route_show(struct xnvfile_snapshot_iterator *it,
 	struct rtnet_ipv4_net_route_data *p = data;
 
 	if (p == NULL) {
-		xnvfile_printf(it, "Hash\tDestination\tMask\t\t\tGateway\n");
+		xnvfile_printf(it, "Destination\tMask\t\t\tGateway\n");
 		return 0;
 	}
 
-	if (p->key < NET_HASH_TBL_SIZE)
-		xnvfile_printf(it,
-			       "%02X\t%u.%u.%u.%-3u\t%u.%u.%u.%-3u"
-			       "\t\t%u.%u.%u.%-3u\n",
-			       p->key, NIPQUAD(p->dest_net_ip),
-			       NIPQUAD(p->dest_net_mask), NIPQUAD(p->gw_ip));
-	else
-		xnvfile_printf(it,
-			       "*\t%u.%u.%u.%-3u\t%u.%u.%u.%-3u\t\t"
-			       "%u.%u.%u.%-3u\n",
-			       NIPQUAD(p->dest_net_ip),
-			       NIPQUAD(p->dest_net_mask), NIPQUAD(p->gw_ip));
+	xnvfile_printf(it,
+		       "%u.%u.%u.%-3u\t%u.%u.%u.%-3u\t\t%u.%u.%u.%-3u\n",
+		       NIPQUAD(p->dest_net_ip),
+		       NIPQUAD(p->dest_net_mask), NIPQUAD(p->gw_ip));
 
 	return 0;
 }
@@ -717,99 +684,112 @@ int rt_ip_route_get_host(u32 addr, char *if_name, unsigned char *dev_addr,
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
 /***
- *  rt_alloc_net_route - allocates new network route
+ *  rt_net_trie_synchronize - waits for all lookups which may have
+ *  picked the former trie to complete
+ *
+ *  Two epoch flips make sure readers which sampled the epoch before
+ *  the trie got published are drained, whichever counter they use.
  */
-static inline struct net_route *rt_alloc_net_route(void)
+static void rt_net_trie_synchronize(void)
 {
-	rtdm_lockctx_t context;
-	struct net_route *rt;
-
-	rtdm_lock_get_irqsave(&net_table_lock, context);
-
-	if ((rt = free_net_route) != NULL) {
-		free_net_route = rt->next;
-		allocated_net_routes++;
+	unsigned int n, idx;
+
+	for (n = 0; n < 2; n++) {
+		idx = net_trie_epoch & 1;
+		WRITE_ONCE(net_trie_epoch, net_trie_epoch + 1);
+		smp_mb();
+		while (atomic_read(&net_trie_readers[idx]) > 0)
+			schedule_timeout_uninterruptible(1);
 	}
-
-	rtdm_lock_put_irqrestore(&net_table_lock, context);
-
-	return rt;
 }
 
 /***
- *  rt_free_net_route - releases network route
+ *  rt_net_trie_update - rebuilds and publishes the lookup trie
  *
- *  Note: must be called with net_table_lock held
+ *  Note: must be called with net_route_mutex held
  */
-static inline void rt_free_net_route(struct net_route *rt)
+static void rt_net_trie_update(void)
 {
-	rt->next = free_net_route;
-	free_net_route = rt;
-	allocated_host_routes--;
+	struct rt_net_trie *t;
+
+	t = net_trie == &net_tries[0] ? &net_tries[1] : &net_tries[0];
+	/* Cannot fail, tries are sized for the whole route set. */
+	rt_net_trie_build(t, net_routes, allocated_net_routes);
+
+	smp_store_release(&net_trie, t);
+	rt_net_trie_synchronize();
+
+	xnvfile_touch_tag(&net_route_tag);
+}
+
+static int rt_net_route_find(u32 addr, u32 mask)
+{
+	int i;
+
+	for (i = 0; i < allocated_net_routes; i++)
+		if (net_routes[i].dest_net_ip == addr &&
+		    net_routes[i].dest_net_mask == mask)
+			return i;
+
+	return -1;
 }
 
 /***
- *  rt_ip_route_add_net: add or update network route
+ *  rt_ip_route_lookup_net - returns the gateway of the most specific
+ *  network route to @daddr
  */
-int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
+static inline bool rt_ip_route_lookup_net(u32 daddr, u32 *gw_ip)
 {
-	rtdm_lockctx_t context;
-	struct net_route *new_route;
-	struct net_route *rt;
-	struct net_route **last_ptr;
-	unsigned int key;
-	u32 shifted_mask;
+	const struct rt_net_route_entry *rt;
+	unsigned int idx;
 
-	addr &= mask;
+	idx = READ_ONCE(net_trie_epoch) & 1;
+	atomic_inc(&net_trie_readers[idx]);
+	smp_mb__after_atomic();
 
-	if ((new_route = rt_alloc_net_route()) != NULL) {
-		new_route->dest_net_ip = addr;
-		new_route->dest_net_mask = mask;
-		new_route->gw_ip = gw_addr;
-	}
+	rt = rt_net_trie_lookup(smp_load_acquire(&net_trie), daddr);
+	if (rt)
+		*gw_ip = rt->gw_ip;
 
-	shifted_mask = NET_HASH_KEY_MASK << net_hash_key_shift;
-	if ((mask & shifted_mask) == shifted_mask)
-		key = (ntohl(addr) >> net_hash_key_shift) & NET_HASH_KEY_MASK;
-	else
-		key = NET_HASH_TBL_SIZE;
-	last_ptr = &net_hash_tbl[key];
+	smp_mb__before_atomic();
+	atomic_dec(&net_trie_readers[idx]);
 
-	rtdm_lock_get_irqsave(&net_table_lock, context);
+	return rt != NULL;
+}
 
-	xnvfile_touch_tag(&net_route_tag);
+/***
+ *  rt_ip_route_add_net: add or update network route
+ */
+int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
+{
+	int i, ret = 0;
 
-	rt = net_hash_tbl[key];
-	while (rt != NULL) {
-		if ((rt->dest_net_ip == addr) && (rt->dest_net_mask == mask)) {
-			rt->gw_ip = gw_addr;
+	if (!rt_net_mask_valid(mask))
+		return -EINVAL;
 
-			if (new_route)
-				rt_free_net_route(new_route);
+	addr &= mask;
 
-			rtdm_lock_put_irqrestore(&net_table_lock, context);
+	mutex_lock(&net_route_mutex);
 
-			return 0;
+	i = rt_net_route_find(addr, mask);
+	if (i < 0) {
+		if (allocated_net_routes >= NET_ROUTES) {
+			/*ERRMSG*/ rtdm_printk(
+				"RTnet: no more network routes available\n");
+			ret = -ENOBUFS;
+			goto out;
 		}
-
-		last_ptr = &rt->next;
-		rt = rt->next;
+		i = allocated_net_routes++;
+		net_routes[i].dest_net_ip = addr;
+		net_routes[i].dest_net_mask = mask;
 	}
+	net_routes[i].gw_ip = gw_addr;
 
-	if (new_route) {
-		new_route->next = *last_ptr;
-		*last_ptr = new_route;
-
-		rtdm_lock_put_irqrestore(&net_table_lock, context);
-
-		return 0;
-	} else {
-		rtdm_lock_put_irqrestore(&net_table_lock, context);
+	rt_net_trie_update();
+out:
+	mutex_unlock(&net_route_mutex);
 
-		/*ERRMSG*/ rtdm_printk(
-			"RTnet: no more network routes available\n");
-		return -ENOBUFS;
-	}
+	return ret;
 }
 
 /***
@@ -817,44 +797,25 @@ int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
  */
 int rt_ip_route_del_net(u32 addr, u32 mask)
 {
-	rtdm_lockctx_t context;
-	struct net_route *rt;
-	struct net_route **last_ptr;
-	unsigned int key;
-	u32 shifted_mask;
+	int i, ret = 0;
 
 	addr &= mask;
 
-	shifted_mask = NET_HASH_KEY_MASK << net_hash_key_shift;
-	if ((mask & shifted_mask) == shifted_mask)
-		key = (ntohl(addr) >> net_hash_key_shift) & NET_HASH_KEY_MASK;
-	else
-		key = NET_HASH_TBL_SIZE;
-	last_ptr = &net_hash_tbl[key];
-
-	rtdm_lock_get_irqsave(&net_table_lock, context);
-
-	rt = net_hash_tbl[key];
-	while (rt != NULL) {
-		if ((rt->dest_net_ip == addr) && (rt->dest_net_mask == mask)) {
-			*last_ptr = rt->next;
-
-			rt_free_net_route(rt);
-
-			xnvfile_touch_tag(&net_route_tag);
+	mutex_lock(&net_route_mutex);
 
-			rtdm_lock_put_irqrestore(&net_table_lock, context);
-
-			return 0;
-		}
-
-		last_ptr = &rt->next;
-		rt = rt->next;
+	i = rt_net_route_find(addr, mask);
+	if (i < 0) {
+		ret = -ENOENT;
+		goto out;
 	}
 
-	rtdm_lock_put_irqrestore(&net_table_lock, context);
+	net_routes[i] = net_routes[--allocated_net_routes];
 
-	return -ENOENT;
+	rt_net_trie_update();
+out:
+	mutex_unlock(&net_route_mutex);
+
+	return ret;
 }
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
@@ -874,7 +835,6 @@ int rt_ip_route_output(struct dest_route *rt_buf, u32 daddr, u32 saddr)
 #else
 #define DADDR real_daddr
 
-	struct net_route *net_rt;
 	int lookup_gw = 1;
 	u32 real_daddr = daddr;
 
@@ -925,48 +885,9 @@ restart:
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
 	if (lookup_gw) {
 		lookup_gw = 0;
-		key = (ntohl(daddr) >> net_hash_key_shift) & NET_HASH_KEY_MASK;
-
-		rtdm_lock_get_irqsave(&net_table_lock, context);
-
-		net_rt = net_hash_tbl[key];
-		while (net_rt != NULL) {
-			if (net_rt->dest_net_ip ==
-			    (daddr & net_rt->dest_net_mask)) {
-				daddr = net_rt->gw_ip;
-
-				rtdm_lock_put_irqrestore(&net_table_lock,
-							 context);
-
-				/* start over, now using the gateway ip as destination */
-				goto restart;
-			}
-
-			net_rt = net_rt->next;
-		}
-
-		rtdm_lock_put_irqrestore(&net_table_lock, context);
-
-		/* last try: no hash key */
-		rtdm_lock_get_irqsave(&net_table_lock, context);
-
-		net_rt = net_hash_tbl[NET_HASH_TBL_SIZE];
-		while (net_rt != NULL) {
-			if (net_rt->dest_net_ip ==
-			    (daddr & net_rt->dest_net_mask)) {
-				daddr = net_rt->gw_ip;
-
-				rtdm_lock_put_irqrestore(&net_table_lock,
-							 context);
-
-				/* start over, now using the gateway ip as destination */
-				goto restart;
-			}
-
-			net_rt = net_rt->next;
-		}
-
-		rtdm_lock_put_irqrestore(&net_table_lock, context);
+		/* start over, now using the gateway ip as destination */
+		if (rt_ip_route_lookup_net(daddr, &daddr))
+			goto restart;
 	}
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
@@ -1029,9 +950,14 @@ int __init rt_ip_routing_init(void)
 	free_host_route = &host_routes[0];
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
-	for (i = 0; i < CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES - 2; i++)
-		net_routes[i].next = &net_routes[i + 1];
-	free_net_route = &net_routes[0];
+	for (i = 0; i < 2; i++) {
+		net_tries[i].nodes = net_trie_nodes[i];
+		net_tries[i].leaves = net_trie_leaves[i];
+		net_tries[i].routes = net_trie_routes[i];
+		net_tries[i].max_routes = NET_ROUTES;
+	}
+	rt_net_trie_build(&net_tries[0], net_routes, 0);
+	net_trie = &net_tries[0];
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
 #ifdef CONFIG_XENO_OPT_VFILE
@@ -0,0 +1,118 @@
+/***
+ *
+ *  ipv4/route_trie.c - longest-prefix match table for network routes
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/string.h>
+
+#include <ipv4/route_trie.h>
+
+/* Mask of the @bits most significant bits, host byte order. */
+static inline u32 prefix_mask(unsigned int bits)
+{
+	return bits ? ~0U << (32 - bits) : 0;
+}
+
+/***
+ *  build_node - fills node @n, covering addresses starting with the
+ *  @depth * RT_NET_TRIE_STRIDE most significant bits of @prefix. @best
+ *  is the longest route covering the whole node, if any.
+ */
+static void build_node(struct rt_net_trie *t, unsigned int n, u32 prefix,
+		       unsigned int depth, u16 best)
+{
+	u16 leaf[RT_NET_TRIE_SLOTS], vector = 0;
+	unsigned int bits, shift, slot, r, len, nr_children, child;
+	int best_len[RT_NET_TRIE_SLOTS];
+	u32 slot_prefix, slot_mask, dest, mask;
+
+	bits = (depth + 1) * RT_NET_TRIE_STRIDE;
+	shift = 32 - bits;
+	slot_mask = prefix_mask(bits);
+
+	for (slot = 0; slot < RT_NET_TRIE_SLOTS; slot++) {
+		leaf[slot] = best;
+		best_len[slot] = -1;
+	}
+
+	for (r = 1; r <= t->nr_routes; r++) {
+		dest = ntohl(t->routes[r].dest_net_ip);
+		mask = ntohl(t->routes[r].dest_net_mask);
+		len = hweight32(mask);
+		/*
+		 * Shorter routes covering the whole node were folded
+		 * into @best by our parent.
+		 */
+		if (len < bits - RT_NET_TRIE_STRIDE ||
+		    (dest & prefix_mask(bits - RT_NET_TRIE_STRIDE)) != prefix)
+			continue;
+		for (slot = 0; slot < RT_NET_TRIE_SLOTS; slot++) {
+			slot_prefix = prefix | (slot << shift);
+			if (len > bits) {
+				/* Route is more specific than the slot. */
+				if ((dest & slot_mask) == slot_prefix)
+					vector |= 1U << slot;
+			} else if ((slot_prefix & mask) == dest &&
+				   (int)len > best_len[slot]) {
+				leaf[slot] = r;
+				best_len[slot] = len;
+			}
+		}
+	}
+
+	nr_children = hweight16(vector);
+	t->nodes[n].vector = vector;
+	t->nodes[n].child_base = t->nr_nodes;
+	t->nodes[n].leaf_base = t->nr_leaves;
+	t->nr_nodes += nr_children;
+
+	for (slot = 0; slot < RT_NET_TRIE_SLOTS; slot++)
+		if (!(vector & (1U << slot)))
+			t->leaves[t->nr_leaves++] = leaf[slot];
+
+	/* Children are allocated as a block, then filled depth-first. */
+	for (slot = 0, child = t->nodes[n].child_base;
+	     slot < RT_NET_TRIE_SLOTS; slot++)
+		if (vector & (1U << slot))
+			build_node(t, child++, prefix | (slot << shift),
+				   depth + 1, leaf[slot]);
+}
+
+/***
+ *  rt_net_trie_build - (re)builds trie @t from a set of routes
+ *
+ *  The storage of @t must be sized for t->max_routes, see
+ *  RT_NET_TRIE_NODES() and RT_NET_TRIE_LEAVES(). Masks must be
+ *  contiguous, and route destinations must be masked already.
+ */
+int rt_net_trie_build(struct rt_net_trie *t,
+		      const struct rt_net_route_entry *routes,
+		      unsigned int nr_routes)
+{
+	if (nr_routes > t->max_routes)
+		return -ENOSPC;
+
+	memset(&t->routes[0], 0, sizeof(t->routes[0]));
+	memcpy(&t->routes[1], routes, nr_routes * sizeof(*routes));
+	t->nr_routes = nr_routes;
+	t->nr_nodes = 1;
+	t->nr_leaves = 0;
+
+	build_node(t, 0, 0, 0, 0);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rt_net_trie_build);
@@ -25,6 +25,9 @@
 #include <linux/module.h>
 #include <linux/sched.h>
 #include <linux/err.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/if_packet.h>
 
 #include <rtnet_iovec.h>
 #include <rtnet_socket.h>
@@ -32,6 +35,270 @@
 
 MODULE_LICENSE("GPL");
 
+/* Upper bound of the memory a single ring may use. */
+#define RT_PACKET_RING_MAX	(16 << 20)
+
+/* Offsets in a ring frame, TPACKET_V2 layout. */
+#define RT_PACKET_RX_DATA	TPACKET_ALIGN(TPACKET2_HDRLEN)
+#define RT_PACKET_TX_DATA	(TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+
+/*
+ * Frame ring shared with user space (PACKET_RX_RING/PACKET_TX_RING).
+ * Each frame starts with a struct tpacket2_hdr, the tp_status word
+ * telling which side owns the frame. RX frames are filled in by the
+ * stack and given to the user by setting TP_STATUS_USER, the user
+ * gives them back by clearing it. TX frames are filled in by the
+ * user and marked TP_STATUS_SEND_REQUEST, send() with no payload
+ * then transmits all pending frames at once.
+ *
+ * Since RX frames are released without entering the kernel, select()
+ * probes the ring state through select_block before reporting the
+ * ring readable, instead of relying on the wakeup event.
+ */
+struct rt_packet_ring {
+	unsigned char *frames;
+	size_t size;
+	unsigned int block_size;
+	unsigned int frame_size;
+	unsigned int frames_per_block;
+	unsigned int frame_nr;
+	unsigned int head;
+	unsigned int drops;
+	rtdm_lock_t lock;
+	rtdm_event_t event;
+	struct xnselect select_block;
+};
+
+static inline struct tpacket2_hdr *
+rt_packet_ring_frame(struct rt_packet_ring *ring, unsigned int n)
+{
+	return (struct tpacket2_hdr *)(ring->frames +
+		(n / ring->frames_per_block) * ring->block_size +
+		(n % ring->frames_per_block) * ring->frame_size);
+}
+
+static inline unsigned int rt_packet_ring_next(struct rt_packet_ring *ring,
+					       unsigned int n)
+{
+	return n + 1 == ring->frame_nr ? 0 : n + 1;
+}
+
+static void rt_packet_ring_destroy(struct rt_packet_ring *ring)
+{
+	xnselect_destroy(&ring->select_block);
+	rtdm_event_destroy(&ring->event);
+	vfree(ring->frames);
+	kfree(ring);
+}
+
+static unsigned int rt_packet_ring_probe(struct xnselect *select_block);
+
+static int rt_packet_ring_create(struct rtdm_fd *fd, struct rtsocket *sock,
+				 struct rt_packet_ring **slot,
+				 const void __user *optval, socklen_t optlen)
+{
+	struct tpacket_req _req, *req;
+	struct rt_packet_ring *ring;
+	rtdm_lockctx_t context;
+	unsigned int fpb;
+
+	if (rtdm_in_rt_context())
+		return -ENOSYS;
+
+	if (optlen < sizeof(*req))
+		return -EINVAL;
+
+	req = rtnet_get_arg(fd, &_req, optval, sizeof(_req));
+	if (IS_ERR(req))
+		return PTR_ERR(req);
+
+	if (req->tp_block_size == 0 || (req->tp_block_size & ~PAGE_MASK) ||
+	    req->tp_frame_size < RT_PACKET_RX_DATA + ETH_HLEN ||
+	    (req->tp_frame_size & (TPACKET_ALIGNMENT - 1)) ||
+	    req->tp_block_nr == 0 ||
+	    req->tp_block_nr > RT_PACKET_RING_MAX / req->tp_block_size)
+		return -EINVAL;
+
+	fpb = req->tp_block_size / req->tp_frame_size;
+	if (fpb == 0 || req->tp_frame_nr != fpb * req->tp_block_nr)
+		return -EINVAL;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (ring == NULL)
+		return -ENOMEM;
+
+	ring->size = (size_t)req->tp_block_size * req->tp_block_nr;
+	/* Zeroed, i.e. TP_STATUS_KERNEL/TP_STATUS_AVAILABLE. */
+	ring->frames = vmalloc_user(ring->size);
+	if (ring->frames == NULL) {
+		kfree(ring);
+		return -ENOMEM;
+	}
+
+	ring->block_size = req->tp_block_size;
+	ring->frame_size = req->tp_frame_size;
+	ring->frames_per_block = fpb;
+	ring->frame_nr = req->tp_frame_nr;
+	rtdm_lock_init(&ring->lock);
+	rtdm_event_init(&ring->event, 0);
+	xnselect_init_probe(&ring->select_block, rt_packet_ring_probe);
+
+	/* Rings cannot be resized or released before the socket is closed. */
+	rtdm_lock_get_irqsave(&sock->param_lock, context);
+	if (*slot == NULL) {
+		*slot = ring;
+		ring = NULL;
+	}
+	rtdm_lock_put_irqrestore(&sock->param_lock, context);
+
+	if (ring) {
+		rt_packet_ring_destroy(ring);
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+/***
+ *  rt_packet_ring_rcv - stores a received frame into the RX ring
+ *
+ *  The frame is copied once in kernel space, the rtskb can then go back
+ *  to its pool immediately instead of being charged to the socket pool.
+ */
+static int rt_packet_ring_rcv(struct rt_packet_ring *ring, struct rtskb *skb,
+			      int socket_type)
+{
+	unsigned int status = TP_STATUS_USER, snaplen, len, nsec;
+	struct rtnet_device *rtdev = skb->rtdev;
+	struct tpacket2_hdr *hdr;
+	struct sockaddr_ll *sll;
+	rtdm_lockctx_t context;
+	unsigned char *src;
+	spl_t s;
+
+	/*
+	 * Several stack managers may feed the same socket, claim the
+	 * frame under lock, fill it in unlocked.
+	 */
+	rtdm_lock_get_irqsave(&ring->lock, context);
+
+	hdr = rt_packet_ring_frame(ring, ring->head);
+	if (READ_ONCE(hdr->tp_status) != TP_STATUS_KERNEL) {
+		ring->drops++;
+		rtdm_lock_put_irqrestore(&ring->lock, context);
+		return -ENOBUFS;
+	}
+
+	if (ring->drops) {
+		status |= TP_STATUS_LOSING;
+		ring->drops = 0;
+	}
+
+	WRITE_ONCE(ring->head, rt_packet_ring_next(ring, ring->head));
+
+	rtdm_lock_put_irqrestore(&ring->lock, context);
+
+	if (socket_type == SOCK_RAW) {
+		src = skb->mac.raw;
+		len = skb->len + (skb->data - skb->mac.raw);
+		hdr->tp_net = RT_PACKET_RX_DATA + (skb->data - skb->mac.raw);
+	} else {
+		src = skb->data;
+		len = skb->len;
+		hdr->tp_net = RT_PACKET_RX_DATA;
+	}
+
+	snaplen = min_t(unsigned int, len, ring->frame_size - RT_PACKET_RX_DATA);
+	memcpy((unsigned char *)hdr + RT_PACKET_RX_DATA, src, snaplen);
+
+	hdr->tp_len = len;
+	hdr->tp_snaplen = snaplen;
+	hdr->tp_mac = RT_PACKET_RX_DATA;
+	hdr->tp_sec = div_u64_rem(skb->time_stamp, NSEC_PER_SEC, &nsec);
+	hdr->tp_nsec = nsec;
+	hdr->tp_vlan_tci = 0;
+	hdr->tp_vlan_tpid = 0;
+
+	sll = (struct sockaddr_ll *)((unsigned char *)hdr +
+				     TPACKET_ALIGN(sizeof(*hdr)));
+	memset(sll, 0, sizeof(*sll));
+	sll->sll_family = AF_PACKET;
+	sll->sll_hatype = rtdev->type;
+	sll->sll_protocol = skb->protocol;
+	sll->sll_pkttype = skb->pkt_type;
+	sll->sll_ifindex = rtdev->ifindex;
+	/* Ethernet specific, as for recvmsg */
+	memcpy(sll->sll_addr, skb->mac.ethernet->h_source, ETH_ALEN);
+	sll->sll_halen = ETH_ALEN;
+
+	/* Hand the frame over once its contents are visible. */
+	smp_wmb();
+	WRITE_ONCE(hdr->tp_status, status);
+
+	rtdm_event_signal(&ring->event);
+
+	xnlock_get_irqsave(&nklock, s);
+	if (xnselect_signal(&ring->select_block, 1))
+		xnsched_run();
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/*
+ * The user consumes RX frames in order, so some frame is pending
+ * unless the last one filled in has been released already.
+ */
+static bool rt_packet_ring_pending(struct rt_packet_ring *ring)
+{
+	unsigned int last = READ_ONCE(ring->head);
+	struct tpacket2_hdr *hdr;
+
+	last = (last == 0 ? ring->frame_nr : last) - 1;
+	hdr = rt_packet_ring_frame(ring, last);
+
+	return READ_ONCE(hdr->tp_status) & TP_STATUS_USER;
+}
+
+static unsigned int rt_packet_ring_probe(struct xnselect *select_block)
+{
+	struct rt_packet_ring *ring =
+		container_of(select_block, struct rt_packet_ring, select_block);
+
+	return rt_packet_ring_pending(ring);
+}
+
+/***
+ *  rt_packet_ring_wait - waits for the RX ring to hold some frame
+ */
+static int rt_packet_ring_wait(struct rt_packet_ring *ring,
+			       nanosecs_rel_t timeout)
+{
+	rtdm_toseq_t timeout_seq;
+	int ret;
+
+	rtdm_toseq_init(&timeout_seq, timeout);
+
+	for (;;) {
+		/* Drop stale signals, the ring state is authoritative. */
+		rtdm_event_clear(&ring->event);
+		if (rt_packet_ring_pending(ring))
+			return 0;
+
+		ret = rtdm_event_timedwait(&ring->event, timeout, &timeout_seq);
+		switch (ret) {
+		case 0:
+			break;
+		case -EWOULDBLOCK:
+		case -ETIMEDOUT:
+		case -EINTR:
+			return ret;
+		default:
+			return -EBADF; /* socket has been closed */
+		}
+	}
+}
+
 /***
  *  rt_packet_rcv
  */
@@ -42,11 +309,28 @@ static int rt_packet_rcv(struct rtskb *skb, struct rtpacket_type *pt)
 	int ifindex = sock->prot.packet.ifindex;
 	void (*callback_func)(struct rtdm_fd *, void *);
 	void *callback_arg;
+	struct rt_packet_ring *ring;
 	rtdm_lockctx_t context;
+	int ret;
 
 	if (unlikely((ifindex != 0) && (ifindex != skb->rtdev->ifindex)))
 		return -EUNATCH;
 
+	ring = READ_ONCE(sock->prot.packet.rx_ring);
+	if (ring) {
+		ret = rt_packet_ring_rcv(ring, skb,
+					 rtdm_fd_to_context(rt_socket_fd(sock))
+						 ->device->driver->socket_type);
+#ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
+		/* Frames to ETH_P_ALL listeners are shared, see below. */
+		if (pt->type != htons(ETH_P_ALL))
+#endif /* CONFIG_XENO_DRIVERS_NET_ETH_P_ALL */
+			kfree_rtskb(skb);
+		if (ret)
+			goto out;
+		goto notify;
+	}
+
 #ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
 	if (pt->type == htons(ETH_P_ALL)) {
 		struct rtskb *clone_skb = rtskb_clone(skb, &sock->skb_pool);
@@ -63,6 +347,7 @@ static int rt_packet_rcv(struct rtskb *skb, struct rtpacket_type *pt)
 	rtskb_queue_tail(&sock->incoming, skb);
 	rtdm_sem_up(&sock->pending_sem);
 
+notify:
 	rtdm_lock_get_irqsave(&sock->param_lock, context);
 	callback_func = sock->callback_func;
 	callback_arg = sock->callback_arg;
@@ -197,6 +482,109 @@ static int rt_packet_getsockname(struct rtdm_fd *fd, struct rtsocket *sock,
 	return rtnet_put_arg(fd, addrlen, namelen, sizeof(*namelen));
 }
 
+/***
+ *  rt_packet_setsockopt
+ */
+static int rt_packet_setsockopt(struct rtdm_fd *fd, struct rtsocket *sock,
+				int level, int optname,
+				const void __user *optval, socklen_t optlen)
+{
+	int _version, *version;
+
+	if (level != SOL_PACKET)
+		return -ENOPROTOOPT;
+
+	switch (optname) {
+	case PACKET_VERSION:
+		/* Rings always use the TPACKET_V2 frame layout. */
+		if (optlen < sizeof(int))
+			return -EINVAL;
+		version = rtnet_get_arg(fd, &_version, optval, sizeof(_version));
+		if (IS_ERR(version))
+			return PTR_ERR(version);
+		return *version == TPACKET_V2 ? 0 : -EINVAL;
+
+	case PACKET_RX_RING:
+		return rt_packet_ring_create(fd, sock, &sock->prot.packet.rx_ring,
+					     optval, optlen);
+
+	case PACKET_TX_RING:
+		return rt_packet_ring_create(fd, sock, &sock->prot.packet.tx_ring,
+					     optval, optlen);
+
+	default:
+		return -ENOPROTOOPT;
+	}
+}
+
+/***
+ *  rt_packet_mmap - maps the RX ring, then the TX ring
+ */
+static int rt_packet_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+	struct rtsocket *sock = rtdm_fd_to_private(fd);
+	struct rt_packet_ring *rings[2] = {
+		sock->prot.packet.rx_ring,
+		sock->prot.packet.tx_ring,
+	};
+	unsigned long addr = vma->vm_start;
+	size_t size = 0, off;
+	int n, ret;
+
+	for (n = 0; n < 2; n++)
+		if (rings[n])
+			size += rings[n]->size;
+
+	if (size == 0 || vma->vm_pgoff != 0 ||
+	    vma->vm_end - vma->vm_start != size)
+		return -EINVAL;
+
+	for (n = 0; n < 2; n++) {
+		if (rings[n] == NULL)
+			continue;
+		for (off = 0; off < rings[n]->size; off += PAGE_SIZE) {
+			ret = vm_insert_page(vma, addr,
+					     vmalloc_to_page(rings[n]->frames + off));
+			if (ret)
+				return ret;
+			addr += PAGE_SIZE;
+		}
+	}
+
+	return 0;
+}
+
+/***
+ *  rt_packet_select
+ */
+static int rt_packet_select(struct rtdm_fd *fd, rtdm_selector_t *selector,
+			    enum rtdm_selecttype type, unsigned fd_index)
+{
+	struct rtsocket *sock = rtdm_fd_to_private(fd);
+	struct rt_packet_ring *ring = sock->prot.packet.rx_ring;
+	struct xnselect_binding *binding;
+	spl_t s;
+	int ret;
+
+	if (ring == NULL || type != XNSELECT_READ)
+		return rt_socket_select_bind(fd, selector, type, fd_index);
+
+	binding = xnmalloc(sizeof(*binding));
+	if (binding == NULL)
+		return -ENOMEM;
+
+	/* Readiness follows the ring state, not past wakeups. */
+	cobalt_atomic_enter(s);
+	ret = xnselect_bind(&ring->select_block, binding, selector, type,
+			    fd_index, rt_packet_ring_pending(ring));
+	cobalt_atomic_leave(s);
+
+	if (ret)
+		xnfree(binding);
+
+	return ret;
+}
+
 /***
  * rt_packet_socket - initialize a packet socket
  */
@@ -210,6 +598,8 @@ static int rt_packet_socket(struct rtdm_fd *fd, int protocol)
 
 	sock->prot.packet.packet_type.type = protocol;
 	sock->prot.packet.ifindex = 0;
+	sock->prot.packet.rx_ring = NULL;
+	sock->prot.packet.tx_ring = NULL;
 	sock->prot.packet.packet_type.trylock = rt_packet_trylock;
 	sock->prot.packet.packet_type.unlock = rt_packet_unlock;
 
@@ -252,6 +642,12 @@ static void rt_packet_close(struct rtdm_fd *fd)
 		kfree_rtskb(del);
 	}
 
+	/* The pages stay around until user space unmaps them. */
+	if (sock->prot.packet.rx_ring)
+		rt_packet_ring_destroy(sock->prot.packet.rx_ring);
+	if (sock->prot.packet.tx_ring)
+		rt_packet_ring_destroy(sock->prot.packet.tx_ring);
+
 	rt_socket_cleanup(fd);
 }
 
@@ -266,6 +662,8 @@ static int rt_packet_ioctl(struct rtdm_fd *fd, unsigned int request,
 	struct _rtdm_setsockaddr_args _setaddr;
 	const struct _rtdm_getsockaddr_args *getaddr;
 	struct _rtdm_getsockaddr_args _getaddr;
+	const struct _rtdm_setsockopt_args *setopt;
+	struct _rtdm_setsockopt_args _setopt;
 
 	/* fast path for common socket IOCTLs */
 	if (_IOC_TYPE(request) == RTIOC_TYPE_NETWORK)
@@ -286,6 +684,14 @@ static int rt_packet_ioctl(struct rtdm_fd *fd, unsigned int request,
 		return rt_packet_getsockname(fd, sock, getaddr->addr,
 					     getaddr->addrlen);
 
+	case _RTIOC_SETSOCKOPT:
+		setopt = rtnet_get_arg(fd, &_setopt, arg, sizeof(_setopt));
+		if (IS_ERR(setopt))
+			return PTR_ERR(setopt);
+		return rt_packet_setsockopt(fd, sock, setopt->level,
+					    setopt->optname, setopt->optval,
+					    setopt->optlen);
+
 	default:
 		return rt_socket_if_ioctl(fd, request, arg);
 	}
@@ -307,6 +713,14 @@ static ssize_t rt_packet_recvmsg(struct rtdm_fd *fd, struct user_msghdr *msg,
 	socklen_t namelen;
 	struct iovec iov_fast[RTDM_IOV_FASTMAX], *iov;
 
+	/* non-blocking receive? */
+	if (msg_flags & MSG_DONTWAIT)
+		timeout = -1;
+
+	/* Frames go to the RX ring only, just wait for some. */
+	if (sock->prot.packet.rx_ring)
+		return rt_packet_ring_wait(sock->prot.packet.rx_ring, timeout);
+
 	if (msg->msg_iovlen < 0)
 		return -EINVAL;
 
@@ -317,10 +731,6 @@ static ssize_t rt_packet_recvmsg(struct rtdm_fd *fd, struct user_msghdr *msg,
 	if (ret)
 		return ret;
 
-	/* non-blocking receive? */
-	if (msg_flags & MSG_DONTWAIT)
-		timeout = -1;
-
 	ret = rtdm_sem_timeddown(&sock->pending_sem, timeout, NULL);
 	if (unlikely(ret < 0))
 		switch (ret) {
@@ -399,94 +809,79 @@ fail:
 }
 
 /***
- *  rt_packet_sendmsg
+ *  rt_packet_get_dest - resolves the device and address to send to
  */
-static ssize_t rt_packet_sendmsg(struct rtdm_fd *fd,
-				 const struct user_msghdr *msg, int msg_flags)
+static struct rtnet_device *rt_packet_get_dest(struct rtdm_fd *fd,
+					       struct rtsocket *sock,
+					       const struct user_msghdr *msg,
+					       struct sockaddr_ll *_sll,
+					       unsigned short *proto,
+					       unsigned char **addr)
 {
-	struct rtsocket *sock = rtdm_fd_to_private(fd);
-	size_t len;
-	struct sockaddr_ll _sll, *sll;
+	struct sockaddr_ll *sll;
 	struct rtnet_device *rtdev;
-	struct rtskb *rtskb;
-	unsigned short proto;
-	unsigned char *addr;
 	int ifindex;
-	ssize_t ret;
-	struct iovec iov_fast[RTDM_IOV_FASTMAX], *iov;
-
-	if (msg_flags & MSG_OOB) /* Mirror BSD error message compatibility */
-		return -EOPNOTSUPP;
-	if (msg_flags & ~MSG_DONTWAIT)
-		return -EINVAL;
-
-	if (msg->msg_iovlen < 0)
-		return -EINVAL;
-
-	if (msg->msg_iovlen == 0)
-		return 0;
-
-	ret = rtdm_get_iovec(fd, &iov, msg, iov_fast);
-	if (ret)
-		return ret;
 
 	if (msg->msg_name == NULL) {
 		/* Note: We do not care about races with rt_packet_bind here -
 	   the user has to do so. */
 		ifindex = sock->prot.packet.ifindex;
-		proto = sock->prot.packet.packet_type.type;
-		addr = NULL;
+		*proto = sock->prot.packet.packet_type.type;
+		*addr = NULL;
 		sll = NULL;
 	} else {
-		sll = rtnet_get_arg(fd, &_sll, msg->msg_name, sizeof(_sll));
-		if (IS_ERR(sll)) {
-			ret = PTR_ERR(sll);
-			goto abort;
-		}
+		sll = rtnet_get_arg(fd, _sll, msg->msg_name, sizeof(*_sll));
+		if (IS_ERR(sll))
+			return ERR_CAST(sll);
 
 		if ((msg->msg_namelen < sizeof(struct sockaddr_ll)) ||
 		    (msg->msg_namelen <
 		     (sll->sll_halen +
 		      offsetof(struct sockaddr_ll, sll_addr))) ||
 		    ((sll->sll_family != AF_PACKET) &&
-		     (sll->sll_family != AF_UNSPEC))) {
-			ret = -EINVAL;
-			goto abort;
-		}
+		     (sll->sll_family != AF_UNSPEC)))
+			return ERR_PTR(-EINVAL);
 
 		ifindex = sll->sll_ifindex;
-		proto = sll->sll_protocol;
-		addr = sll->sll_addr;
+		*proto = sll->sll_protocol;
+		*addr = sll->sll_addr;
 	}
 
-	if ((rtdev = rtdev_get_by_index(ifindex)) == NULL) {
-		ret = -ENODEV;
-		goto abort;
+	if ((rtdev = rtdev_get_by_index(ifindex)) == NULL)
+		return ERR_PTR(-ENODEV);
+
+	if ((sll != NULL) && (sll->sll_halen != rtdev->addr_len)) {
+		rtdev_dereference(rtdev);
+		return ERR_PTR(-EINVAL);
 	}
 
-	len = rtdm_get_iov_flatlen(iov, msg->msg_iovlen);
+	return rtdev;
+}
+
+/***
+ *  rt_packet_alloc_skb - prepares an rtskb for @len bytes of payload
+ */
+static struct rtskb *rt_packet_alloc_skb(struct rtdm_fd *fd,
+					 struct rtsocket *sock,
+					 struct rtnet_device *rtdev,
+					 unsigned short proto,
+					 unsigned char *addr, size_t len)
+{
+	int socket_type = rtdm_fd_to_context(fd)->device->driver->socket_type;
+	struct rtskb *rtskb;
+	int hdr_len;
+
 	rtskb = alloc_rtskb(rtdev->hard_header_len + len, &sock->skb_pool);
-	if (rtskb == NULL) {
-		ret = -ENOBUFS;
-		goto out;
-	}
+	if (rtskb == NULL)
+		return ERR_PTR(-ENOBUFS);
 
 	/* If an RTmac discipline is active, this becomes a pure sanity check to
        avoid writing beyond rtskb boundaries. The hard check is then performed
        upon rtdev_xmit() by the discipline's xmit handler. */
-	if (len >
-	    rtdev->mtu +
-		    ((rtdm_fd_to_context(fd)->device->driver->socket_type ==
-		      SOCK_RAW) ?
-			     rtdev->hard_header_len :
-			     0)) {
-		ret = -EMSGSIZE;
-		goto err;
-	}
-
-	if ((sll != NULL) && (sll->sll_halen != rtdev->addr_len)) {
-		ret = -EINVAL;
-		goto err;
+	if (len > rtdev->mtu + ((socket_type == SOCK_RAW) ?
+					rtdev->hard_header_len : 0)) {
+		kfree_rtskb(rtskb);
+		return ERR_PTR(-EMSGSIZE);
 	}
 
 	rtskb_reserve(rtskb, rtdev->hard_header_len);
@@ -495,29 +890,163 @@ static ssize_t rt_packet_sendmsg(struct rtdm_fd *fd,
 	rtskb->priority = sock->priority;
 
 	if (rtdev->hard_header) {
-		int hdr_len;
-
-		ret = -EINVAL;
 		hdr_len = rtdev->hard_header(rtskb, rtdev, ntohs(proto), addr,
 					     NULL, len);
-		if (rtdm_fd_to_context(fd)->device->driver->socket_type !=
-		    SOCK_DGRAM) {
+		if (socket_type != SOCK_DGRAM) {
 			rtskb->tail = rtskb->data;
 			rtskb->len = 0;
-		} else if (hdr_len < 0)
-			goto err;
+		} else if (hdr_len < 0) {
+			kfree_rtskb(rtskb);
+			return ERR_PTR(-EINVAL);
+		}
+	}
+
+	return rtskb;
+}
+
+static int rt_packet_xmit(struct rtskb *rtskb)
+{
+	if ((rtskb->rtdev->flags & IFF_UP) == 0) {
+		kfree_rtskb(rtskb);
+		return -ENETDOWN;
+	}
+
+	return rtdev_xmit(rtskb);
+}
+
+/***
+ *  rt_packet_ring_send - transmits all frames pending in the TX ring
+ */
+static ssize_t rt_packet_ring_send(struct rtdm_fd *fd, struct rtsocket *sock,
+				   struct rt_packet_ring *ring,
+				   const struct user_msghdr *msg)
+{
+	struct tpacket2_hdr *hdr;
+	struct rtnet_device *rtdev;
+	struct sockaddr_ll _sll;
+	rtdm_lockctx_t context;
+	unsigned short proto;
+	unsigned char *addr;
+	struct rtskb *rtskb;
+	ssize_t sent = 0;
+	unsigned int len;
+	int ret = 0;
+
+	rtdev = rt_packet_get_dest(fd, sock, msg, &_sll, &proto, &addr);
+	if (IS_ERR(rtdev))
+		return PTR_ERR(rtdev);
+
+	for (;;) {
+		/*
+		 * Claim the frame and its rtskb under lock, so that
+		 * concurrent senders neither pick the same frame nor
+		 * skip one we could not get an rtskb for.
+		 */
+		rtdm_lock_get_irqsave(&ring->lock, context);
+
+		hdr = rt_packet_ring_frame(ring, ring->head);
+		if (READ_ONCE(hdr->tp_status) != TP_STATUS_SEND_REQUEST) {
+			rtdm_lock_put_irqrestore(&ring->lock, context);
+			break;
+		}
+
+		/* Read the frame only once the user has released it. */
+		smp_rmb();
+		len = READ_ONCE(hdr->tp_len);
+		if (len > ring->frame_size - RT_PACKET_TX_DATA)
+			rtskb = ERR_PTR(-EMSGSIZE);
+		else
+			rtskb = rt_packet_alloc_skb(fd, sock, rtdev, proto,
+						    addr, len);
+		if (IS_ERR(rtskb)) {
+			ret = PTR_ERR(rtskb);
+			/* Out of rtskbs, leave the frame for the next round. */
+			if (ret != -ENOBUFS) {
+				WRITE_ONCE(hdr->tp_status,
+					   TP_STATUS_WRONG_FORMAT);
+				ring->head = rt_packet_ring_next(ring, ring->head);
+			}
+			rtdm_lock_put_irqrestore(&ring->lock, context);
+			break;
+		}
+
+		WRITE_ONCE(hdr->tp_status, TP_STATUS_SENDING);
+		ring->head = rt_packet_ring_next(ring, ring->head);
+
+		rtdm_lock_put_irqrestore(&ring->lock, context);
+
+		memcpy(rtskb_put(rtskb, len),
+		       (unsigned char *)hdr + RT_PACKET_TX_DATA, len);
+		smp_wmb();
+		WRITE_ONCE(hdr->tp_status, TP_STATUS_AVAILABLE);
+
+		ret = rt_packet_xmit(rtskb);
+		if (ret)
+			break;
+
+		sent += len;
+	}
+
+	rtdev_dereference(rtdev);
+
+	return sent ? sent : ret;
+}
+
+/***
+ *  rt_packet_sendmsg
+ */
+static ssize_t rt_packet_sendmsg(struct rtdm_fd *fd,
+				 const struct user_msghdr *msg, int msg_flags)
+{
+	struct rtsocket *sock = rtdm_fd_to_private(fd);
+	size_t len;
+	struct sockaddr_ll _sll;
+	struct rtnet_device *rtdev;
+	struct rtskb *rtskb;
+	unsigned short proto;
+	unsigned char *addr;
+	ssize_t ret;
+	struct iovec iov_fast[RTDM_IOV_FASTMAX], *iov;
+
+	if (msg_flags & MSG_OOB) /* Mirror BSD error message compatibility */
+		return -EOPNOTSUPP;
+	if (msg_flags & ~MSG_DONTWAIT)
+		return -EINVAL;
+
+	if (msg->msg_iovlen < 0)
+		return -EINVAL;
+
+	if (msg->msg_iovlen == 0) {
+		/* A payload-less send flushes the TX ring. */
+		if (sock->prot.packet.tx_ring)
+			return rt_packet_ring_send(fd, sock,
+						   sock->prot.packet.tx_ring,
+						   msg);
+		return 0;
+	}
+
+	ret = rtdm_get_iovec(fd, &iov, msg, iov_fast);
+	if (ret)
+		return ret;
+
+	rtdev = rt_packet_get_dest(fd, sock, msg, &_sll, &proto, &addr);
+	if (IS_ERR(rtdev)) {
+		ret = PTR_ERR(rtdev);
+		goto abort;
+	}
+
+	len = rtdm_get_iov_flatlen(iov, msg->msg_iovlen);
+	rtskb = rt_packet_alloc_skb(fd, sock, rtdev, proto, addr, len);
+	if (IS_ERR(rtskb)) {
+		ret = PTR_ERR(rtskb);
+		goto out;
 	}
 
 	ret = rtnet_read_from_iov(fd, iov, msg->msg_iovlen,
 				  rtskb_put(rtskb, len), len);
 
-	if ((rtdev->flags & IFF_UP) != 0) {
-		if ((ret = rtdev_xmit(rtskb)) == 0)
-			ret = len;
-	} else {
-		ret = -ENETDOWN;
-		goto err;
-	}
+	if ((ret = rt_packet_xmit(rtskb)) == 0)
+		ret = len;
 
 out:
 	rtdev_dereference(rtdev);
@@ -525,9 +1054,6 @@ abort:
 	rtdm_drop_iovec(iov, iov_fast);
 
 	return ret;
-err:
-	kfree_rtskb(rtskb);
-	goto out;
 }
 
 static struct rtdm_driver packet_proto_drv = {
@@ -550,7 +1076,8 @@ static struct rtdm_driver packet_proto_drv = {
 	.ioctl_nrt =    rt_packet_ioctl,
 	.recvmsg_rt =   rt_packet_recvmsg,
 	.sendmsg_rt =   rt_packet_sendmsg,
-	.select =       rt_socket_select_bind,
+	.select =       rt_packet_select,
+	.mmap =         rt_packet_mmap,
     },
 };
 
@@ -578,7 +1105,8 @@ static struct rtdm_driver raw_packet_proto_drv = {
 	.ioctl_nrt =    rt_packet_ioctl,
 	.recvmsg_rt =   rt_packet_recvmsg,
 	.sendmsg_rt =   rt_packet_sendmsg,
-	.select =       rt_socket_select_bind,
+	.select =       rt_packet_select,
+	.mmap =         rt_packet_mmap,
     },
 };
 
@@ -126,9 +126,11 @@ static struct xnvfile_regular rtnet_devices_vfile = {
 
 static int rtnet_rtskb_show(struct xnvfile_regular_iterator *it, void *data)
 {
+	unsigned long hits, misses, steals;
 	unsigned int rtskb_len;
 
 	rtskb_len = ALIGN_RTSKB_STRUCT_LEN + SKB_DATA_ALIGN(RTSKB_SIZE);
+	rtskb_cache_read_stats(&hits, &misses, &steals);
 
 	xnvfile_printf(it,
 		       "Statistics\t\tCurrent\tMaximum\n"
@@ -138,6 +140,12 @@ static int rtnet_rtskb_show(struct xnvfile_regular_iterator *it, void *data)
 		       rtskb_pools, rtskb_pools_max, rtskb_amount,
 		       rtskb_amount_max, rtskb_amount * rtskb_len,
 		       rtskb_amount_max * rtskb_len);
+	xnvfile_printf(it,
+		       "\nPer-CPU caches\n"
+		       "hits\t\t\t%lu\n"
+		       "misses\t\t\t%lu\n"
+		       "steals\t\t\t%lu\n",
+		       hits, misses, steals);
 	return 0;
 }
 
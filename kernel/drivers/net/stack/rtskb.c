@@ -22,6 +22,7 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <rtnet_checksum.h>
 
@@ -35,6 +36,12 @@ module_param(global_rtskbs, uint, 0444);
 MODULE_PARM_DESC(global_rtskbs,
 		 "Number of realtime socket buffers in global pool");
 
+static unsigned int rtskb_cache_batch = 8;
+module_param(rtskb_cache_batch, uint, 0444);
+MODULE_PARM_DESC(rtskb_cache_batch,
+		 "Number of rtskbs moved at once between a pool and its "
+		 "per-CPU caches (0 disables the caches)");
+
 /* Linux slab pool for rtskbs */
 static struct kmem_cache *rtskb_slab_pool;
 
@@ -48,6 +55,14 @@ unsigned int rtskb_pools_max = 0;
 unsigned int rtskb_amount = 0;
 unsigned int rtskb_amount_max = 0;
 
+struct rtskb_cache_stats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long steals;
+};
+
+static DEFINE_PER_CPU(struct rtskb_cache_stats, rtskb_cache_stats);
+
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_RTCAP)
 /* RTcap interface */
 rtdm_lock_t rtcap_lock;
@@ -162,37 +177,270 @@ static struct rtskb *__rtskb_pool_dequeue(struct rtskb_pool *pool)
 	return skb;
 }
 
-struct rtskb *rtskb_pool_dequeue(struct rtskb_pool *pool)
+static void __rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb)
+{
+	struct rtskb_queue *queue = &pool->queue;
+
+	__rtskb_queue_tail(queue, skb);
+	if (pool->lock_ops)
+		pool->lock_ops->unlock(pool->lock_cookie);
+}
+
+/*
+ * Per-CPU pool caches. A cache is a singly linked list of free rtskbs
+ * which only its owning CPU pushes to, always with hard irqs off. Any
+ * other CPU may only take over the whole list by swapping its head
+ * with NULL. As nobody can push to a cache while its owner pops from
+ * it, popping with cmpxchg does not suffer from ABA. The count is
+ * only maintained by the owner and serves as a hint for spilling.
+ */
+static struct rtskb *rtskb_cache_pop(struct rtskb_pool_cache *cache)
+{
+	struct rtskb *skb, *next;
+
+	do {
+		skb = READ_ONCE(cache->head);
+		if (skb == NULL)
+			return NULL;
+		next = READ_ONCE(skb->next);
+	} while (cmpxchg(&cache->head, skb, next) != skb);
+
+	skb->next = NULL;
+	if (cache->count > 0)
+		cache->count--;
+
+	return skb;
+}
+
+static void rtskb_cache_push(struct rtskb_pool_cache *cache,
+			     struct rtskb *first, struct rtskb *last,
+			     unsigned int count)
+{
+	struct rtskb *head;
+
+	do {
+		head = READ_ONCE(cache->head);
+		last->next = head;
+	} while (cmpxchg(&cache->head, head, first) != head);
+
+	cache->count = head ? cache->count + count : count;
+}
+
+/* Hand a list of cached rtskbs back to the pool queue. */
+static void rtskb_cache_flush(struct rtskb_pool *pool, struct rtskb *first)
 {
 	struct rtskb_queue *queue = &pool->queue;
 	rtdm_lockctx_t context;
-	struct rtskb *skb;
+	struct rtskb *last;
+
+	for (last = first; last->next; last = last->next)
+		;
 
 	rtdm_lock_get_irqsave(&queue->lock, context);
-	skb = __rtskb_pool_dequeue(pool);
+	if (queue->first == NULL)
+		queue->first = first;
+	else
+		queue->last->next = first;
+	queue->last = last;
 	rtdm_lock_put_irqrestore(&queue->lock, context);
+}
+
+/*
+ * Called with hard irqs off on a cache miss. Returns one rtskb and
+ * moves up to a batch more into the local cache, either from the pool
+ * queue or, if that one ran dry, from the cache of another CPU.
+ */
+static struct rtskb *rtskb_cache_refill(struct rtskb_pool *pool,
+					struct rtskb_pool_cache *cache)
+{
+	struct rtskb_queue *queue = &pool->queue;
+	struct rtskb *skb, *first = NULL, *last = NULL;
+	unsigned int count = 0;
+	int cpu;
+
+	rtdm_lock_get(&queue->lock);
+	skb = __rtskb_dequeue(queue);
+	if (skb) {
+		first = queue->first;
+		if (first) {
+			for (last = first, count = 1;
+			     count < pool->cache_batch && last->next; count++)
+				last = last->next;
+			queue->first = last->next;
+		}
+	}
+	rtdm_lock_put(&queue->lock);
+
+	if (skb == NULL) {
+		for_each_possible_cpu (cpu) {
+			skb = xchg(&per_cpu_ptr(pool->cache, cpu)->head, NULL);
+			if (skb)
+				break;
+		}
+		if (skb == NULL)
+			return NULL;
+
+		raw_cpu_ptr(&rtskb_cache_stats)->steals++;
+
+		first = skb->next;
+		if (first) {
+			for (last = first, count = 1; last->next; count++)
+				last = last->next;
+		}
+	}
+
+	skb->next = NULL;
+	if (first) {
+		last->next = NULL;
+		rtskb_cache_push(cache, first, last, count);
+	}
 
 	return skb;
 }
-EXPORT_SYMBOL_GPL(rtskb_pool_dequeue);
 
-static void __rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb)
+/* Called with hard irqs off when the local cache grew too large. */
+static void rtskb_cache_spill(struct rtskb_pool *pool,
+			      struct rtskb_pool_cache *cache)
 {
-	struct rtskb_queue *queue = &pool->queue;
+	struct rtskb *first, *last, *rest;
+	unsigned int count;
+
+	first = xchg(&cache->head, NULL);
+	if (first == NULL) {
+		cache->count = 0;
+		return;
+	}
+
+	for (last = first, count = 1;
+	     count < pool->cache_batch && last->next; count++)
+		last = last->next;
+	rest = last->next;
+	last->next = NULL;
+
+	rtskb_cache_push(cache, first, last, count);
+
+	if (rest)
+		rtskb_cache_flush(pool, rest);
+}
+
+/* Move all cached rtskbs back to the pool queue, non-RT only. */
+static void rtskb_cache_drain(struct rtskb_pool *pool)
+{
+	struct rtskb_pool_cache *cache;
+	struct rtskb *first;
+	int cpu;
+
+	if (pool->cache == NULL)
+		return;
+
+	for_each_possible_cpu (cpu) {
+		cache = per_cpu_ptr(pool->cache, cpu);
+		first = xchg(&cache->head, NULL);
+		if (first)
+			rtskb_cache_flush(pool, first);
+	}
+}
+
+void rtskb_cache_read_stats(unsigned long *hits, unsigned long *misses,
+			    unsigned long *steals)
+{
+	struct rtskb_cache_stats *stats;
+	int cpu;
+
+	*hits = *misses = *steals = 0;
+
+	for_each_possible_cpu (cpu) {
+		stats = per_cpu_ptr(&rtskb_cache_stats, cpu);
+		*hits += READ_ONCE(stats->hits);
+		*misses += READ_ONCE(stats->misses);
+		*steals += READ_ONCE(stats->steals);
+	}
+}
+EXPORT_SYMBOL_GPL(rtskb_cache_read_stats);
+
+/* Called with hard irqs off. */
+static struct rtskb *__rtskb_pool_get(struct rtskb_pool *pool)
+{
+	struct rtskb_pool_cache *cache;
+	struct rtskb *skb;
+
+	if (pool->cache == NULL) {
+		rtdm_lock_get(&pool->queue.lock);
+		skb = __rtskb_pool_dequeue(pool);
+		rtdm_lock_put(&pool->queue.lock);
+		return skb;
+	}
+
+	if (pool->lock_ops && !pool->lock_ops->trylock(pool->lock_cookie))
+		return NULL;
+
+	cache = raw_cpu_ptr(pool->cache);
+	skb = rtskb_cache_pop(cache);
+	if (skb) {
+		raw_cpu_ptr(&rtskb_cache_stats)->hits++;
+		return skb;
+	}
+
+	raw_cpu_ptr(&rtskb_cache_stats)->misses++;
+	cache->count = 0;
+
+	skb = rtskb_cache_refill(pool, cache);
+	if (skb == NULL && pool->lock_ops)
+		pool->lock_ops->unlock(pool->lock_cookie);
+
+	return skb;
+}
+
+/* Called with hard irqs off. */
+static void __rtskb_pool_put(struct rtskb_pool *pool, struct rtskb *skb)
+{
+	struct rtskb_pool_cache *cache;
+	struct rtskb *last, *chain_end;
+	unsigned int count = 1;
+
+	if (pool->cache == NULL) {
+		rtdm_lock_get(&pool->queue.lock);
+		__rtskb_pool_queue_tail(pool, skb);
+		rtdm_lock_put(&pool->queue.lock);
+		return;
+	}
+
+	/* Cached rtskbs are kept unchained. */
+	chain_end = skb->chain_end;
+	for (last = skb; last != chain_end; last = last->next, count++)
+		last->chain_end = last;
+	last->chain_end = last;
+
+	cache = raw_cpu_ptr(pool->cache);
+	rtskb_cache_push(cache, skb, last, count);
 
-	__rtskb_queue_tail(queue, skb);
 	if (pool->lock_ops)
 		pool->lock_ops->unlock(pool->lock_cookie);
+
+	if (cache->count > 2 * pool->cache_batch)
+		rtskb_cache_spill(pool, cache);
+}
+
+struct rtskb *rtskb_pool_dequeue(struct rtskb_pool *pool)
+{
+	rtdm_lockctx_t context;
+	struct rtskb *skb;
+
+	rtdm_lock_irqsave(context);
+	skb = __rtskb_pool_get(pool);
+	rtdm_lock_irqrestore(context);
+
+	return skb;
 }
+EXPORT_SYMBOL_GPL(rtskb_pool_dequeue);
 
 void rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb)
 {
-	struct rtskb_queue *queue = &pool->queue;
 	rtdm_lockctx_t context;
 
-	rtdm_lock_get_irqsave(&queue->lock, context);
-	__rtskb_pool_queue_tail(pool, skb);
-	rtdm_lock_put_irqrestore(&queue->lock, context);
+	rtdm_lock_irqsave(context);
+	__rtskb_pool_put(pool, skb);
+	rtdm_lock_irqrestore(context);
 }
 EXPORT_SYMBOL_GPL(rtskb_pool_queue_tail);
 
@@ -298,9 +546,18 @@ unsigned int rtskb_pool_init(struct rtskb_pool *pool, unsigned int initial_size,
 	unsigned int i;
 
 	rtskb_queue_init(&pool->queue);
+	pool->cache = NULL;
+	pool->cache_batch = 0;
 
 	i = rtskb_pool_extend(pool, initial_size);
 
+	/* Pools which failed to fill up are not necessarily released. */
+	if (rtskb_cache_batch > 0 && i > 0) {
+		pool->cache = alloc_percpu(struct rtskb_pool_cache);
+		if (pool->cache)
+			pool->cache_batch = rtskb_cache_batch;
+	}
+
 	rtskb_pools++;
 	if (rtskb_pools > rtskb_pools_max)
 		rtskb_pools_max = rtskb_pools;
@@ -349,12 +606,17 @@ void rtskb_pool_release(struct rtskb_pool *pool)
 {
 	struct rtskb *skb;
 
+	rtskb_cache_drain(pool);
+
 	while ((skb = rtskb_dequeue(&pool->queue)) != NULL) {
 		rtdev_unmap_rtskb(skb);
 		kmem_cache_free(rtskb_slab_pool, skb);
 		rtskb_amount--;
 	}
 
+	free_percpu(pool->cache);
+	pool->cache = NULL;
+
 	rtskb_pools--;
 }
 
@@ -406,6 +668,8 @@ unsigned int rtskb_pool_shrink(struct rtskb_pool *pool, unsigned int rem_rtskbs)
 	unsigned int i;
 	struct rtskb *skb;
 
+	rtskb_cache_drain(pool);
+
 	for (i = 0; i < rem_rtskbs; i++) {
 		if ((skb = rtskb_dequeue(&pool->queue)) == NULL)
 			break;
@@ -425,24 +689,20 @@ int rtskb_acquire(struct rtskb *rtskb, struct rtskb_pool *comp_pool)
 	struct rtskb_pool *release_pool;
 	rtdm_lockctx_t context;
 
-	rtdm_lock_get_irqsave(&comp_pool->queue.lock, context);
+	rtdm_lock_irqsave(context);
 
-	comp_rtskb = __rtskb_pool_dequeue(comp_pool);
+	comp_rtskb = __rtskb_pool_get(comp_pool);
 	if (!comp_rtskb) {
-		rtdm_lock_put_irqrestore(&comp_pool->queue.lock, context);
+		rtdm_lock_irqrestore(context);
 		return -ENOMEM;
 	}
 
-	rtdm_lock_put(&comp_pool->queue.lock);
-
 	comp_rtskb->chain_end = comp_rtskb;
 	comp_rtskb->pool = release_pool = rtskb->pool;
 
-	rtdm_lock_get(&release_pool->queue.lock);
-
-	__rtskb_pool_queue_tail(release_pool, comp_rtskb);
+	__rtskb_pool_put(release_pool, comp_rtskb);
 
-	rtdm_lock_put_irqrestore(&release_pool->queue.lock, context);
+	rtdm_lock_irqrestore(context);
 
 	rtskb->pool = comp_pool;
 
@@ -23,6 +23,10 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/jhash.h>
+#include <linux/ip.h>
+#include <linux/in.h>
+#include <asm/unaligned.h>
 
 #include <rtdev.h>
 #include <rtnet_internal.h>
@@ -33,11 +37,33 @@ static unsigned int stack_mgr_prio = RTNET_DEF_STACK_PRIORITY;
 module_param(stack_mgr_prio, uint, 0444);
 MODULE_PARM_DESC(stack_mgr_prio, "Priority of the stack manager task");
 
+static unsigned int rx_queues = CONFIG_XENO_DRIVERS_NET_RX_QUEUES;
+module_param(rx_queues, uint, 0444);
+MODULE_PARM_DESC(rx_queues, "Number of RX dispatch queues, "
+			    "each served by a stack manager task");
+
 #if (CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE &                                    \
      (CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE - 1)) != 0
 #error CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE must be power of 2!
 #endif
-static DECLARE_RTSKB_FIFO(rx, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+
+/*
+ * One RX dispatch queue per stack manager task. Queue #0 is served by
+ * the manager passed to rt_stack_mgr_init() (i.e. STACK_manager),
+ * which drivers connect to. Additional queues bring their own.
+ */
+struct rt_stack_rxq {
+	DECLARE_RTSKB_FIFO(rx, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+	struct rtnet_mgr *mgr;
+	struct rtnet_mgr __mgr;
+} ____cacheline_aligned_in_smp;
+
+static struct rt_stack_rxq rxqs[CONFIG_XENO_DRIVERS_NET_RX_QUEUES];
+
+#if CONFIG_XENO_DRIVERS_NET_RX_QUEUES > 1
+/* Queues which received frames since the last rt_mark_stack_mgr(). */
+static unsigned long rxq_pending;
+#endif
 
 struct list_head rt_packets[RTPACKET_HASH_TBL_SIZE];
 #ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
@@ -99,6 +125,60 @@ void rtdev_remove_pack(struct rtpacket_type *pt)
 
 EXPORT_SYMBOL_GPL(rtdev_remove_pack);
 
+#if CONFIG_XENO_DRIVERS_NET_RX_QUEUES > 1
+
+/*
+ * Pick the dispatch queue of a frame. IPv4 frames are spread by flow
+ * so that frames from a given flow are always processed in order by
+ * the same stack manager. Ports are left out for fragments, so that
+ * all fragments of a datagram meet in the same queue. Anything else
+ * (ARP, RTmac, RTcfg, ...) goes to queue #0, as it used to.
+ */
+static inline unsigned int rt_stack_rxq_select(struct rtskb *skb)
+{
+	struct iphdr *iph;
+	u32 ports = 0;
+
+	if (rx_queues == 1 || skb->protocol != htons(ETH_P_IP) ||
+	    skb->len < sizeof(struct iphdr))
+		return 0;
+
+	iph = (struct iphdr *)skb->data;
+	/* The port words may be misaligned. */
+	if ((iph->protocol == IPPROTO_UDP || iph->protocol == IPPROTO_TCP) &&
+	    !(iph->frag_off & htons(IP_MF | IP_OFFSET)) && iph->ihl >= 5 &&
+	    skb->len >= iph->ihl * 4 + sizeof(ports))
+		ports = get_unaligned((u32 *)(skb->data + iph->ihl * 4));
+
+	return reciprocal_scale(jhash_3words(iph->saddr, iph->daddr,
+					     ports ^ iph->protocol, 0),
+				rx_queues);
+}
+
+/***
+ *  rt_stack_mark_pending: kick the stack managers of all queues which
+ *  received frames, on behalf of rt_mark_stack_mgr().
+ */
+void rt_stack_mark_pending(void)
+{
+	unsigned int n;
+
+	for (n = 0; n < rx_queues; n++)
+		if (test_and_clear_bit(n, &rxq_pending))
+			rtdm_event_signal(&rxqs[n].mgr->event);
+}
+
+EXPORT_SYMBOL_GPL(rt_stack_mark_pending);
+
+#else /* CONFIG_XENO_DRIVERS_NET_RX_QUEUES == 1 */
+
+static inline unsigned int rt_stack_rxq_select(struct rtskb *skb)
+{
+	return 0;
+}
+
+#endif /* CONFIG_XENO_DRIVERS_NET_RX_QUEUES == 1 */
+
 /***
  *  rtnetif_rx: will be called from the driver interrupt handler
  *  (IRQs disabled!) and send a message to rtdev-owned stack-manager
@@ -107,13 +187,21 @@ EXPORT_SYMBOL_GPL(rtdev_remove_pack);
  */
 void rtnetif_rx(struct rtskb *skb)
 {
+	unsigned int n;
+
 	RTNET_ASSERT(skb != NULL, return;);
 	RTNET_ASSERT(skb->rtdev != NULL, return;);
 
-	if (unlikely(rtskb_fifo_insert_inirq(&rx.fifo, skb) < 0)) {
+	n = rt_stack_rxq_select(skb);
+	if (unlikely(rtskb_fifo_insert_inirq(&rxqs[n].rx.fifo, skb) < 0)) {
 		rtdm_printk("RTnet: dropping packet in %s()\n", __FUNCTION__);
 		kfree_rtskb(skb);
+		return;
 	}
+#if CONFIG_XENO_DRIVERS_NET_RX_QUEUES > 1
+	if (n > 0)
+		set_bit(n, &rxq_pending);
+#endif
 }
 
 EXPORT_SYMBOL_GPL(rtnetif_rx);
@@ -192,7 +280,8 @@ EXPORT_SYMBOL_GPL(rt_stack_deliver);
 
 static void rt_stack_mgr_task(void *arg)
 {
-	rtdm_event_t *mgr_event = &((struct rtnet_mgr *)arg)->event;
+	struct rt_stack_rxq *rxq = arg;
+	rtdm_event_t *mgr_event = &rxq->mgr->event;
 	struct rtskb *rtskb;
 
 	while (!rtdm_task_should_stop()) {
@@ -200,7 +289,7 @@ static void rt_stack_mgr_task(void *arg)
 			break;
 
 		/* we are the only reader => no locking required */
-		while ((rtskb = __rtskb_fifo_remove(&rx.fifo)))
+		while ((rtskb = __rtskb_fifo_remove(&rxq->rx.fifo)))
 			rt_stack_deliver(rtskb);
 	}
 }
@@ -225,14 +314,52 @@ void rt_stack_disconnect(struct rtnet_device *rtdev)
 
 EXPORT_SYMBOL_GPL(rt_stack_disconnect);
 
+static void rt_stack_rxq_delete(struct rt_stack_rxq *rxq)
+{
+	rtdm_event_destroy(&rxq->mgr->event);
+	rtdm_task_destroy(&rxq->mgr->task);
+}
+
+/*
+ * Queue #n gets pinned to the n-th CPU available to the real-time
+ * core, wrapping around if there are more queues than CPUs. A single
+ * queue keeps the stack manager free to run anywhere.
+ */
+static int rt_stack_rxq_init(struct rt_stack_rxq *rxq, unsigned int n)
+{
+	char name[XNOBJECT_NAME_LEN];
+	const cpumask_t *affinity;
+	cpumask_t rtcpus;
+	unsigned int cpu;
+
+	rtskb_fifo_init(&rxq->rx.fifo, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+	rtdm_event_init(&rxq->mgr->event, 0);
+
+	if (rx_queues == 1) {
+		affinity = cpu_all_mask;
+		strcpy(name, "rtnet-stack");
+	} else {
+		cpumask_and(&rtcpus, &cobalt_cpu_affinity, cpu_online_mask);
+		cpu = cpumask_first(&rtcpus);
+		while (n-- > 0) {
+			cpu = cpumask_next(cpu, &rtcpus);
+			if (cpu >= nr_cpu_ids)
+				cpu = cpumask_first(&rtcpus);
+		}
+		affinity = cpumask_of(cpu);
+		snprintf(name, sizeof(name), "rtnet-stack/%u", cpu);
+	}
+
+	return rtdm_task_init_on(&rxq->mgr->task, name, rt_stack_mgr_task,
+				 rxq, stack_mgr_prio, 0, affinity);
+}
+
 /***
  *  rt_stack_mgr_init
  */
 int rt_stack_mgr_init(struct rtnet_mgr *mgr)
 {
-	int i;
-
-	rtskb_fifo_init(&rx.fifo, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+	int i, ret;
 
 	for (i = 0; i < RTPACKET_HASH_TBL_SIZE; i++)
 		INIT_LIST_HEAD(&rt_packets[i]);
@@ -240,10 +367,21 @@ int rt_stack_mgr_init(struct rtnet_mgr *mgr)
 	INIT_LIST_HEAD(&rt_packets_all);
 #endif /* CONFIG_XENO_DRIVERS_NET_ETH_P_ALL */
 
-	rtdm_event_init(&mgr->event, 0);
+	if (rx_queues == 0 || rx_queues > CONFIG_XENO_DRIVERS_NET_RX_QUEUES)
+		rx_queues = CONFIG_XENO_DRIVERS_NET_RX_QUEUES;
+
+	for (i = 0; i < rx_queues; i++) {
+		rxqs[i].mgr = i ? &rxqs[i].__mgr : mgr;
+		ret = rt_stack_rxq_init(&rxqs[i], i);
+		if (ret) {
+			rtdm_event_destroy(&rxqs[i].mgr->event);
+			while (--i >= 0)
+				rt_stack_rxq_delete(&rxqs[i]);
+			return ret;
+		}
+	}
 
-	return rtdm_task_init(&mgr->task, "rtnet-stack", rt_stack_mgr_task, mgr,
-			      stack_mgr_prio, 0);
+	return 0;
 }
 
 /***
@@ -251,6 +389,8 @@ int rt_stack_mgr_init(struct rtnet_mgr *mgr)
  */
 void rt_stack_mgr_delete(struct rtnet_mgr *mgr)
 {
-	rtdm_event_destroy(&mgr->event);
-	rtdm_task_destroy(&mgr->task);
+	int i;
+
+	for (i = rx_queues - 1; i >= 0; i--)
+		rt_stack_rxq_delete(&rxqs[i]);
 }
@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/module.h>
+#include <linux/vmalloc.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <cobalt/kernel/clock.h>
+#include <rtdm/testing.h>
+#include <rtdm/driver.h>
+#include <ipv4/route_trie.h>
+
+#define complain(__fmt, __args...)	\
+	printk(XENO_WARNING "route bench: " __fmt "\n", ##__args)
+
+#define MAX_ROUTES	4096
+#define MAX_LOOPS	1000000
+/* Samples collected with hard irqs off in a row. */
+#define BATCH		256
+/* All routes live in 10.0.0.0/8. */
+#define NET_BASE	0x0a000000
+
+struct bench_data {
+	struct rt_net_trie trie;
+	struct rt_net_route_entry *routes;
+	u32 *addrs;
+};
+
+static u32 rand_state;
+
+/* Keeps the compiler from dropping the timed lookups. */
+static const struct rt_net_route_entry *sink;
+
+/* Deterministic xorshift, runs are reproducible. */
+static inline u32 bench_rand(void)
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state;
+}
+
+/*
+ * The same longest-prefix match done the naive way, as a reference
+ * both for checking the trie and for timing.
+ */
+static const struct rt_net_route_entry *
+linear_lookup(const struct rt_net_route_entry *routes, int nr, u32 daddr)
+{
+	const struct rt_net_route_entry *best = NULL;
+	u32 best_mask = 0;
+	int n;
+
+	for (n = 0; n < nr; n++)
+		if ((daddr & routes[n].dest_net_mask) == routes[n].dest_net_ip &&
+		    (best == NULL ||
+		     ntohl(routes[n].dest_net_mask) > ntohl(best_mask))) {
+			best = routes + n;
+			best_mask = routes[n].dest_net_mask;
+		}
+
+	return best;
+}
+
+static void make_routes(struct rt_net_route_entry *routes, int nr)
+{
+	u32 mask, dest;
+	int n, m;
+
+	for (n = 0; n < nr; n++) {
+	retry:
+		mask = ~0U << (32 - (8 + bench_rand() % 23));
+		dest = (NET_BASE | (bench_rand() & 0x00ffffff)) & mask;
+		for (m = 0; m < n; m++)
+			if (routes[m].dest_net_ip == htonl(dest) &&
+			    routes[m].dest_net_mask == htonl(mask))
+				goto retry;
+		routes[n].dest_net_ip = htonl(dest);
+		routes[n].dest_net_mask = htonl(mask);
+		routes[n].gw_ip = htonl(NET_BASE | (n + 1));
+	}
+}
+
+static int run_bench(struct rttst_route_bench *b, struct bench_data *d)
+{
+	xnticks_t t0, t1, dt, calib = (xnticks_t)-1;
+	xnticks_t trie_sum = 0, trie_max = 0;
+	xnticks_t linear_sum = 0, linear_max = 0;
+	const struct rt_net_route_entry *rt, *ref;
+	int n, i, loops, ret;
+	spl_t s;
+
+	rand_state = 0x2545f491;
+	make_routes(d->routes, b->nr_routes);
+
+	d->trie.max_routes = b->nr_routes;
+	ret = rt_net_trie_build(&d->trie, d->routes, b->nr_routes);
+	if (ret)
+		return ret;
+
+	b->trie_nodes = d->trie.nr_nodes;
+	b->trie_leaves = d->trie.nr_leaves;
+
+	/* Half of the destinations hit some route, half are random. */
+	for (n = 0; n < BATCH; n++) {
+		d->addrs[n] = htonl(NET_BASE | (bench_rand() & 0x00ffffff));
+		if (n & 1) {
+			ref = d->routes + bench_rand() % b->nr_routes;
+			d->addrs[n] = ref->dest_net_ip |
+				(d->addrs[n] & ~ref->dest_net_mask);
+		}
+		ref = linear_lookup(d->routes, b->nr_routes, d->addrs[n]);
+		rt = rt_net_trie_lookup(&d->trie, d->addrs[n]);
+		if ((rt == NULL) != (ref == NULL) ||
+		    (rt && rt->gw_ip != ref->gw_ip)) {
+			complain("wrong route to %pI4", &d->addrs[n]);
+			return -EPROTO;
+		}
+	}
+
+	/* Figure out the cost of reading the clock. */
+	for (n = 0; n < 100; n++) {
+		splhigh(s);
+		t0 = xnclock_read_raw(&nkclock);
+		t1 = xnclock_read_raw(&nkclock);
+		splexit(s);
+		if (t1 - t0 < calib)
+			calib = t1 - t0;
+	}
+
+	loops = roundup(b->loops, BATCH);
+
+	for (n = 0; n < loops; n += BATCH) {
+		splhigh(s);
+		for (i = 0; i < BATCH; i++) {
+			t0 = xnclock_read_raw(&nkclock);
+			WRITE_ONCE(sink, rt_net_trie_lookup(&d->trie, d->addrs[i]));
+			t1 = xnclock_read_raw(&nkclock);
+			dt = t1 - t0 > calib ? t1 - t0 - calib : 0;
+			trie_sum += dt;
+			if (dt > trie_max)
+				trie_max = dt;
+			t0 = xnclock_read_raw(&nkclock);
+			WRITE_ONCE(sink, linear_lookup(d->routes, b->nr_routes,
+						       d->addrs[i]));
+			t1 = xnclock_read_raw(&nkclock);
+			dt = t1 - t0 > calib ? t1 - t0 - calib : 0;
+			linear_sum += dt;
+			if (dt > linear_max)
+				linear_max = dt;
+		}
+		splexit(s);
+	}
+
+	b->trie_avg_ns = div_s64(xnclock_ticks_to_ns(&nkclock, trie_sum), loops);
+	b->trie_max_ns = xnclock_ticks_to_ns(&nkclock, trie_max);
+	b->linear_avg_ns = div_s64(xnclock_ticks_to_ns(&nkclock, linear_sum), loops);
+	b->linear_max_ns = xnclock_ticks_to_ns(&nkclock, linear_max);
+
+	return 0;
+}
+
+static int bench_route_lookup(struct rttst_route_bench *b)
+{
+	struct bench_data d;
+	int ret = -ENOMEM;
+
+	if (b->nr_routes == 0 || b->nr_routes > MAX_ROUTES)
+		return -EINVAL;
+
+	if (b->loops == 0 || b->loops > MAX_LOOPS)
+		b->loops = MAX_LOOPS;
+
+	d.trie.nodes = vmalloc(sizeof(*d.trie.nodes) *
+			       RT_NET_TRIE_NODES(b->nr_routes));
+	d.trie.leaves = vmalloc(sizeof(*d.trie.leaves) *
+				RT_NET_TRIE_LEAVES(b->nr_routes));
+	d.trie.routes = vmalloc(sizeof(*d.trie.routes) * (b->nr_routes + 1));
+	d.routes = vmalloc(sizeof(*d.routes) * b->nr_routes);
+	d.addrs = vmalloc(sizeof(*d.addrs) * BATCH);
+
+	if (d.trie.nodes && d.trie.leaves && d.trie.routes &&
+	    d.routes && d.addrs)
+		ret = run_bench(b, &d);
+
+	vfree(d.addrs);
+	vfree(d.routes);
+	vfree(d.trie.routes);
+	vfree(d.trie.leaves);
+	vfree(d.trie.nodes);
+
+	return ret;
+}
+
+static int routebench_ioctl(struct rtdm_fd *fd,
+			    unsigned int request, void __user *arg)
+{
+	struct rttst_route_bench b;
+	int ret;
+
+	switch (request) {
+	case RTTST_RTIOC_ROUTE_BENCH:
+		ret = rtdm_copy_from_user(fd, &b, arg, sizeof(b));
+		if (ret)
+			return ret;
+		ret = bench_route_lookup(&b);
+		if (ret)
+			return ret;
+		ret = rtdm_copy_to_user(fd, arg, &b, sizeof(b));
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static struct rtdm_driver routebench_driver = {
+	.profile_info		= RTDM_PROFILE_INFO(route_bench,
+						    RTDM_CLASS_TESTING,
+						    RTDM_SUBCLASS_ROUTEBENCH,
+						    RTTST_PROFILE_VER),
+	.device_flags		= RTDM_NAMED_DEVICE | RTDM_EXCLUSIVE,
+	.device_count		= 1,
+	.ops = {
+		.ioctl_nrt	= routebench_ioctl,
+	},
+};
+
+static struct rtdm_device routebench_device = {
+	.driver = &routebench_driver,
+	.label = "routebench",
+};
+
+static int __init routebench_init(void)
+{
+	return rtdm_dev_register(&routebench_device);
+}
+
+static void __exit routebench_exit(void)
+{
+	rtdm_dev_unregister(&routebench_device);
+}
+
+module_init(routebench_init);
+module_exit(routebench_exit);
+
+MODULE_LICENSE("GPL");
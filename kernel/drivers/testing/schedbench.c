@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/module.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <cobalt/kernel/sched.h>
+#include <cobalt/kernel/clock.h>
+#include <rtdm/testing.h>
+#include <rtdm/driver.h>
+
+#define complain(__fmt, __args...)	\
+	printk(XENO_WARNING "sched bench: " __fmt "\n", ##__args)
+
+#define MAX_THREADS	4096
+/* The common POSIX SCHED_FIFO range. */
+#define MAX_PRIOS	99
+#define MAX_LOOPS	1000000
+/* Samples collected with hard irqs off in a row. */
+#define BATCH		256
+
+/*
+ * We run the queueing primitives of the real-time class over a
+ * private run queue populated with dummy threads, which is what
+ * xnsched_pick_next() does for the current CPU, minus the class
+ * cascading: pick the heading thread, then requeue it as the
+ * preempted thread would be.
+ */
+static int run_bench(struct rttst_sched_bench *b)
+{
+	xnticks_t t0, t1, t2, d, calib = (xnticks_t)-1;
+	xnticks_t pick_sum = 0, pick_max = 0;
+	xnticks_t requeue_sum = 0, requeue_max = 0;
+	struct xnthread *threads, *thread;
+	xnsched_queue_t *q;
+	int n, i, ret = 0;
+	spl_t s;
+
+	if (b->nr_threads == 0 || b->nr_threads > MAX_THREADS)
+		return -EINVAL;
+
+	if (b->nr_prios == 0)
+		b->nr_prios = 1;
+	else if (b->nr_prios > MAX_PRIOS)
+		b->nr_prios = MAX_PRIOS;
+
+	if (b->loops == 0 || b->loops > MAX_LOOPS)
+		b->loops = MAX_LOOPS;
+
+	q = kmalloc(sizeof(*q), GFP_KERNEL);
+	if (q == NULL)
+		return -ENOMEM;
+
+	threads = vzalloc(sizeof(*threads) * b->nr_threads);
+	if (threads == NULL) {
+		kfree(q);
+		return -ENOMEM;
+	}
+
+	xnsched_initq(q);
+
+	for (n = 0; n < b->nr_threads; n++) {
+		thread = threads + n;
+		thread->cprio = XNSCHED_FIFO_MIN_PRIO + n % b->nr_prios;
+		thread->sched_class = &xnsched_class_rt;
+		xnsched_addq_tail(q, thread);
+	}
+
+	/* Figure out the cost of reading the clock. */
+	for (n = 0; n < 100; n++) {
+		splhigh(s);
+		t0 = xnclock_read_raw(&nkclock);
+		t1 = xnclock_read_raw(&nkclock);
+		splexit(s);
+		if (t1 - t0 < calib)
+			calib = t1 - t0;
+	}
+
+	for (n = 0; n < b->loops; n += BATCH) {
+		splhigh(s);
+		for (i = 0; i < BATCH; i++) {
+			t0 = xnclock_read_raw(&nkclock);
+			thread = xnsched_getq(q);
+			t1 = xnclock_read_raw(&nkclock);
+			xnsched_addq_tail(q, thread);
+			t2 = xnclock_read_raw(&nkclock);
+			d = t1 - t0 > calib ? t1 - t0 - calib : 0;
+			pick_sum += d;
+			if (d > pick_max)
+				pick_max = d;
+			d = t2 - t1 > calib ? t2 - t1 - calib : 0;
+			requeue_sum += d;
+			if (d > requeue_max)
+				requeue_max = d;
+		}
+		splexit(s);
+	}
+
+	/* Make sure the queue did not lose track of any thread. */
+	for (n = 0; xnsched_getq(q); n++)
+		;
+	if (n != b->nr_threads) {
+		complain("run queue corrupted (%d threads queued, %d found)",
+			 b->nr_threads, n);
+		ret = -EPROTO;
+	}
+
+	n = roundup(b->loops, BATCH);
+	b->pick_avg_ns = div_s64(xnclock_ticks_to_ns(&nkclock, pick_sum), n);
+	b->pick_max_ns = xnclock_ticks_to_ns(&nkclock, pick_max);
+	b->requeue_avg_ns = div_s64(xnclock_ticks_to_ns(&nkclock, requeue_sum), n);
+	b->requeue_max_ns = xnclock_ticks_to_ns(&nkclock, requeue_max);
+#if defined(CONFIG_XENO_OPT_SCHED_BITMAP)
+	b->queue_type = RTTST_SCHEDBENCH_BITMAP;
+#elif defined(CONFIG_XENO_OPT_SCALABLE_SCHED)
+	b->queue_type = RTTST_SCHEDBENCH_MULTILEVEL;
+#else
+	b->queue_type = RTTST_SCHEDBENCH_LINEAR;
+#endif
+
+	vfree(threads);
+	kfree(q);
+
+	return ret;
+}
+
+static int schedbench_ioctl(struct rtdm_fd *fd,
+			    unsigned int request, void __user *arg)
+{
+	struct rttst_sched_bench b;
+	int ret;
+
+	switch (request) {
+	case RTTST_RTIOC_SCHED_BENCH:
+		ret = rtdm_copy_from_user(fd, &b, arg, sizeof(b));
+		if (ret)
+			return ret;
+		ret = run_bench(&b);
+		if (ret)
+			return ret;
+		ret = rtdm_copy_to_user(fd, arg, &b, sizeof(b));
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static struct rtdm_driver schedbench_driver = {
+	.profile_info		= RTDM_PROFILE_INFO(sched_bench,
+						    RTDM_CLASS_TESTING,
+						    RTDM_SUBCLASS_SCHEDBENCH,
+						    RTTST_PROFILE_VER),
+	.device_flags		= RTDM_NAMED_DEVICE | RTDM_EXCLUSIVE,
+	.device_count		= 1,
+	.ops = {
+		.ioctl_nrt	= schedbench_ioctl,
+	},
+};
+
+static struct rtdm_device schedbench_device = {
+	.driver = &schedbench_driver,
+	.label = "schedbench",
+};
+
+static int __init schedbench_init(void)
+{
+	return rtdm_dev_register(&schedbench_device);
+}
+
+static void __exit schedbench_exit(void)
+{
+	rtdm_dev_unregister(&schedbench_device);
+}
+
+module_init(schedbench_init);
+module_exit(schedbench_exit);
+
+MODULE_LICENSE("GPL");
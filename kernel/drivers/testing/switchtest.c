@@ -17,6 +17,7 @@
  */
 #include <linux/module.h>
 #include <linux/vmalloc.h>
+#include <linux/slab.h>
 #include <linux/semaphore.h>
 #include <cobalt/kernel/sched.h>
 #include <cobalt/kernel/synch.h>
@@ -62,6 +63,24 @@ struct rtswitch_context {
 	rtdm_nrtsig_t wake_utask;
 };
 
+struct rtswitch_bench;
+
+struct rtswitch_bench_task {
+	rtdm_task_t task;
+	rtdm_event_t synch;
+	struct rtswitch_bench_task *peer;
+	struct rtswitch_bench *bench;
+};
+
+struct rtswitch_bench {
+	struct rtswitch_bench_task tasks[2];
+	nanosecs_abs_t start;
+	nanosecs_abs_t end;
+	nanosecs_abs_t deadline;
+	unsigned long long switches;
+	int done;
+};
+
 static int fp_features;
 
 static int report(const char *fmt, ...)
@@ -522,6 +541,93 @@ static int rtswitch_create_ktask(struct rtswitch_context *ctx,
 	return err;
 }
 
+static void rtswitch_bench_task(void *arg)
+{
+	struct rtswitch_bench_task *self = arg;
+	struct rtswitch_bench *bench = self->bench;
+	nanosecs_abs_t now;
+
+	while (rtdm_event_wait(&self->synch) == 0) {
+		if (bench->done) {
+			rtdm_event_signal(&self->peer->synch);
+			break;
+		}
+		now = rtdm_clock_read_monotonic();
+		if (now >= bench->deadline) {
+			bench->end = now;
+			bench->done = 1;
+			rtdm_event_signal(&self->peer->synch);
+			break;
+		}
+		bench->switches++;
+		rtdm_event_signal(&self->peer->synch);
+	}
+}
+
+/*
+ * Ping-pong between a pair of kernel tasks pinned to ctx->cpu for the
+ * given duration, counting the context switches. Running this
+ * concurrently over several CPUs measures how the switch rate of
+ * each CPU degrades as more CPUs compete for the core locks.
+ */
+static int rtswitch_run_bench(struct rtswitch_context *ctx,
+			      struct rttst_swtest_bench *p)
+{
+	struct rtswitch_bench_task *t;
+	struct rtswitch_bench *bench;
+	char name[32];
+	int ret, n;
+
+	/* Keep the CPU hog below the watchdog trigger. */
+	if (p->duration_ms == 0 || p->duration_ms > 1000)
+		return -EINVAL;
+
+	bench = kzalloc(sizeof(*bench), GFP_KERNEL);
+	if (bench == NULL)
+		return -ENOMEM;
+
+	for (n = 0; n < 2; n++) {
+		t = &bench->tasks[n];
+		t->bench = bench;
+		t->peer = &bench->tasks[!n];
+		rtdm_event_init(&t->synch, 0);
+	}
+
+	for (n = 0; n < 2; n++) {
+		t = &bench->tasks[n];
+		ksformat(name, sizeof(name), "rtbench%d/%u", n, ctx->cpu);
+		ret = rtdm_task_init_on(&t->task, name, rtswitch_bench_task, t,
+					RTDM_TASK_HIGHEST_PRIORITY, 0,
+					cpumask_of(ctx->cpu));
+		if (ret) {
+			/* Release the first task if already started. */
+			bench->done = 1;
+			if (n > 0) {
+				rtdm_event_signal(&bench->tasks[0].synch);
+				rtdm_task_join(&bench->tasks[0].task);
+			}
+			goto out;
+		}
+	}
+
+	bench->start = rtdm_clock_read_monotonic();
+	bench->deadline = bench->start + p->duration_ms * 1000000ULL;
+	rtdm_event_signal(&bench->tasks[0].synch);
+
+	rtdm_task_join(&bench->tasks[0].task);
+	rtdm_task_join(&bench->tasks[1].task);
+
+	p->switches = bench->switches;
+	p->elapsed_ns = bench->end - bench->start;
+out:
+	for (n = 0; n < 2; n++)
+		rtdm_event_destroy(&bench->tasks[n].synch);
+
+	kfree(bench);
+
+	return ret;
+}
+
 static void rtswitch_utask_waker(rtdm_nrtsig_t *sig, void *arg)
 {
 	struct rtswitch_context *ctx = (struct rtswitch_context *)arg;
@@ -575,6 +681,7 @@ static int rtswitch_ioctl_nrt(struct rtdm_fd *fd,
 			      void *arg)
 {
 	struct rtswitch_context *ctx = rtdm_fd_to_private(fd);
+	struct rttst_swtest_bench bench;
 	struct rttst_swtest_task task;
 	struct rttst_swtest_dir fromto;
 	__u32 count;
@@ -668,6 +775,22 @@ static int rtswitch_ioctl_nrt(struct rtdm_fd *fd,
 
 		return 0;
 
+	case RTTST_RTIOC_SWTEST_BENCH:
+		if (!rtdm_rw_user_ok(fd, arg, sizeof(bench)))
+			return -EFAULT;
+
+		rtdm_copy_from_user(fd, &bench, arg, sizeof(bench));
+
+		err = rtswitch_run_bench(ctx, &bench);
+
+		if (!err)
+			rtdm_copy_to_user(fd,
+					  arg,
+					  &bench,
+					  sizeof(bench));
+
+		return err;
+
 	default:
 		return -ENOSYS;
 	}
@@ -158,6 +158,207 @@ static void buffer_finalize(struct syncobj *sobj)
 }
 fnref_register(libalchemy, buffer_finalize);
 
+/* Read from the buffer in a circular way. */
+static void read_chunk(struct alchemy_buffer *bcb, void *ptr, size_t len)
+{
+	size_t rdoff = bcb->rdoff, rbytes = len, n;
+	void *p = ptr;
+
+	do {
+		if (rdoff + rbytes > bcb->bufsz)
+			n = bcb->bufsz - rdoff;
+		else
+			n = rbytes;
+		memcpy(p, __mptr(bcb->buf) + rdoff, n);
+		p += n;
+		rdoff = (rdoff + n) % bcb->bufsz;
+		rbytes -= n;
+	} while (rbytes > 0);
+
+	bcb->fillsz -= len;
+	bcb->rdoff = rdoff;
+}
+
+/* Write to the buffer in a circular way. */
+static void write_chunk(struct alchemy_buffer *bcb,
+			const void *ptr, size_t len)
+{
+	size_t wroff = bcb->wroff, rbytes = len, n;
+	const void *p = ptr;
+
+	do {
+		if (wroff + rbytes > bcb->bufsz)
+			n = bcb->bufsz - wroff;
+		else
+			n = rbytes;
+		memcpy(__mptr(bcb->buf) + wroff, p, n);
+		p += n;
+		wroff = (wroff + n) % bcb->bufsz;
+		rbytes -= n;
+	} while (rbytes > 0);
+
+	bcb->fillsz += len;
+	bcb->wroff = wroff;
+}
+
+static void wake_writers(struct alchemy_buffer *bcb)
+{
+	struct alchemy_buffer_wait *wait;
+	struct threadobj *thobj;
+
+	/*
+	 * Wake up all threads waiting for the buffer to drain, if we
+	 * freed enough room for the leading one to post its message.
+	 */
+	thobj = syncobj_peek_drain(&bcb->sobj);
+	if (thobj == NULL)
+		return;
+
+	wait = threadobj_get_wait(thobj);
+	if (wait->size + bcb->fillsz <= bcb->bufsz)
+		syncobj_drain(&bcb->sobj);
+}
+
+static void wake_readers(struct alchemy_buffer *bcb)
+{
+	struct alchemy_buffer_wait *wait;
+	struct threadobj *thobj;
+
+	/*
+	 * Wake up all threads waiting for input, if we accumulated
+	 * enough data to feed the leading one.
+	 */
+	thobj = syncobj_peek_grant(&bcb->sobj);
+	if (thobj == NULL)
+		return;
+
+	wait = threadobj_get_wait(thobj);
+	if (wait->size <= bcb->fillsz)
+		syncobj_grant_all(&bcb->sobj);
+}
+
+/*
+ * Read a single message, waiting for it to be complete if need be.
+ * Called with the buffer locked, returns with the buffer unlocked
+ * only if -EIDRM is received.
+ */
+static ssize_t buffer_read(struct alchemy_buffer *bcb,
+			   void *ptr, size_t len,
+			   const struct timespec *abs_timeout,
+			   struct syncstate *syns,
+			   struct alchemy_buffer_wait **waitp)
+{
+	int ret;
+
+	/*
+	 * We may only return complete messages to readers, so there
+	 * is no point in waiting for messages which are larger than
+	 * what the buffer can hold.
+	 */
+	if (len > bcb->bufsz)
+		return -EINVAL;
+
+	for (;;) {
+		/*
+		 * We should be able to read a complete message of the
+		 * requested length, or block.
+		 */
+		if (bcb->fillsz >= len) {
+			read_chunk(bcb, ptr, len);
+			wake_writers(bcb);
+			return (ssize_t)len;
+		}
+
+		if (alchemy_poll_mode(abs_timeout))
+			return -EWOULDBLOCK;
+
+		/*
+		 * Check whether writers are already waiting for
+		 * sending data, while we are about to wait for
+		 * receiving some. In such a case, we have a
+		 * pathological use of the buffer. We must allow for a
+		 * short read to prevent a deadlock.
+		 */
+		if (bcb->fillsz > 0 && syncobj_count_drain(&bcb->sobj)) {
+			len = bcb->fillsz;
+			continue;
+		}
+
+		if (*waitp == NULL)
+			*waitp = threadobj_prepare_wait(struct alchemy_buffer_wait);
+
+		(*waitp)->size = len;
+
+		ret = syncobj_wait_grant(&bcb->sobj, abs_timeout, syns);
+		if (ret)
+			return ret;
+	}
+}
+
+/*
+ * Write a single message, waiting for enough room if need be.
+ * Called with the buffer locked, returns with the buffer unlocked
+ * only if -EIDRM is received.
+ */
+static ssize_t buffer_write(struct alchemy_buffer *bcb,
+			    const void *ptr, size_t len,
+			    const struct timespec *abs_timeout,
+			    struct syncstate *syns,
+			    struct alchemy_buffer_wait **waitp)
+{
+	int ret;
+
+	/*
+	 * We may only send complete messages, so there is no point in
+	 * accepting messages which are larger than what the buffer
+	 * can hold.
+	 */
+	if (len > bcb->bufsz)
+		return -EINVAL;
+
+	for (;;) {
+		/*
+		 * We should be able to write the entire message at
+		 * once, or block.
+		 */
+		if (bcb->fillsz + len <= bcb->bufsz) {
+			write_chunk(bcb, ptr, len);
+			wake_readers(bcb);
+			return (ssize_t)len;
+		}
+
+		if (alchemy_poll_mode(abs_timeout))
+			return -EWOULDBLOCK;
+
+		if (*waitp == NULL)
+			*waitp = threadobj_prepare_wait(struct alchemy_buffer_wait);
+
+		(*waitp)->size = len;
+
+		/*
+		 * Check whether readers are already waiting for
+		 * receiving data, while we are about to wait for
+		 * sending some. In such a case, we have the converse
+		 * pathological use of the buffer. We must kick
+		 * readers to allow for a short read to prevent a
+		 * deadlock.
+		 *
+		 * XXX: instead of broadcasting a general wake up
+		 * event, we could be smarter and wake up only the
+		 * number of waiters required to consume the amount of
+		 * data we want to send, but this does not seem worth
+		 * the burden: this is an error condition, we just
+		 * have to mitigate its effect, avoiding a deadlock.
+		 */
+		if (bcb->fillsz > 0 && syncobj_count_grant(&bcb->sobj))
+			syncobj_grant_all(&bcb->sobj);
+
+		ret = syncobj_wait_drain(&bcb->sobj, abs_timeout, syns);
+		if (ret)
+			return ret;
+	}
+}
+
 /**
  * @fn int rt_buffer_create(RT_BUFFER *bf, const char *name, size_t bufsz, int mode)
  * @brief Create an IPC buffer.
@@ -456,16 +657,12 @@ ssize_t rt_buffer_read_timed(RT_BUFFER *bf,
 {
 	struct alchemy_buffer_wait *wait = NULL;
 	struct alchemy_buffer *bcb;
-	struct threadobj *thobj;
-	size_t len, rbytes, n;
 	struct syncstate syns;
 	struct service svc;
-	size_t rdoff;
-	int ret = 0;
-	void *p;
+	ssize_t ret;
+	int err = 0;
 
-	len = size;
-	if (len == 0)
+	if (size == 0)
 		return 0;
 
 	if (!threadobj_current_p() && !alchemy_poll_mode(abs_timeout))
@@ -473,92 +670,123 @@ ssize_t rt_buffer_read_timed(RT_BUFFER *bf,
 
 	CANCEL_DEFER(svc);
 
-	bcb = get_alchemy_buffer(bf, &syns, &ret);
-	if (bcb == NULL)
+	bcb = get_alchemy_buffer(bf, &syns, &err);
+	if (bcb == NULL) {
+		ret = err;
 		goto out;
-
-	/*
-	 * We may only return complete messages to readers, so there
-	 * is no point in waiting for messages which are larger than
-	 * what the buffer can hold.
-	 */
-	if (len > bcb->bufsz) {
-		ret = -EINVAL;
-		goto done;
 	}
-redo:
-	for (;;) {
-		/*
-		 * We should be able to read a complete message of the
-		 * requested length, or block.
-		 */
-		if (bcb->fillsz < len)
-			goto wait;
-
-		/* Read from the buffer in a circular way. */
-		rdoff = bcb->rdoff;
-		rbytes = len;
-		p = ptr;
-
-		do {
-			if (rdoff + rbytes > bcb->bufsz)
-				n = bcb->bufsz - rdoff;
-			else
-				n = rbytes;
-			memcpy(p, __mptr(bcb->buf) + rdoff, n);
-			p += n;
-			rdoff = (rdoff + n) % bcb->bufsz;
-			rbytes -= n;
-		} while (rbytes > 0);
-
-		bcb->fillsz -= len;
-		bcb->rdoff = rdoff;
-		ret = (ssize_t)len;
 
-		/*
-		 * Wake up all threads waiting for the buffer to
-		 * drain, if we freed enough room for the leading one
-		 * to post its message.
-		 */
-		thobj = syncobj_peek_drain(&bcb->sobj);
-		if (thobj == NULL)
-			goto done;
+	ret = buffer_read(bcb, ptr, size, abs_timeout, &syns, &wait);
+	if (ret != -EIDRM)
+		put_alchemy_buffer(bcb, &syns);
+out:
+	if (wait)
+		threadobj_finish_wait();
 
-		wait = threadobj_get_wait(thobj);
-		if (wait->size + bcb->fillsz <= bcb->bufsz)
-			syncobj_drain(&bcb->sobj);
+	CANCEL_RESTORE(svc);
 
-		goto done;
-	wait:
-		if (alchemy_poll_mode(abs_timeout)) {
-			ret = -EWOULDBLOCK;
-			goto done;
-		}
+	return ret;
+}
 
-		/*
-		 * Check whether writers are already waiting for
-		 * sending data, while we are about to wait for
-		 * receiving some. In such a case, we have a
-		 * pathological use of the buffer. We must allow for a
-		 * short read to prevent a deadlock.
-		 */
-		if (bcb->fillsz > 0 && syncobj_count_drain(&bcb->sobj)) {
-			len = bcb->fillsz;
-			goto redo;
-		}
+/**
+ * @fn ssize_t rt_buffer_readv(RT_BUFFER *bf, const struct iovec *iov, int iovlen, RTIME timeout)
+ * @brief Read multiple messages from an IPC buffer (with relative scalar timeout).
+ *
+ * This routine is a variant of rt_buffer_readv_timed() accepting a
+ * relative timeout specification expressed as a scalar value.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
 
-		if (wait == NULL)
-			wait = threadobj_prepare_wait(struct alchemy_buffer_wait);
+/**
+ * @fn ssize_t rt_buffer_readv_until(RT_BUFFER *bf, const struct iovec *iov, int iovlen, RTIME abs_timeout)
+ * @brief Read multiple messages from an IPC buffer (with absolute scalar timeout).
+ *
+ * This routine is a variant of rt_buffer_readv_timed() accepting an
+ * absolute timeout specification expressed as a scalar value.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
 
-		wait->size = len;
+/**
+ * @fn ssize_t rt_buffer_readv_timed(RT_BUFFER *bf, const struct iovec *iov, int iovlen, const struct timespec *abs_timeout)
+ * @brief Read multiple messages from an IPC buffer.
+ *
+ * This routine reads a series of messages from the specified buffer
+ * into the memory areas described by @a iov, the length of each
+ * area defining the length of the corresponding message. The first
+ * message is read exactly like rt_buffer_read_timed() would do,
+ * blocking the caller until it is complete if need be. Then, the
+ * following messages which are entirely available from the buffer
+ * at that point are read without blocking, under the same
+ * acquisition of the buffer lock.
+ *
+ * @param bf The buffer descriptor.
+ *
+ * @param iov An array of @a iovlen memory areas to read messages to.
+ *
+ * @param iovlen The number of items in @a iov.
+ *
+ * @param abs_timeout An absolute date expressed in seconds /
+ * nanoseconds, based on the Alchemy clock, specifying a time limit
+ * to wait for the first message to be available from the buffer,
+ * with the same meaning as for rt_buffer_read_timed().
+ *
+ * @return The total number of bytes read from the buffer is returned
+ * upon success. Otherwise, the same error codes as
+ * rt_buffer_read_timed() may be returned, along with -EINVAL if @a
+ * iovlen is not positive.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
+ssize_t rt_buffer_readv_timed(RT_BUFFER *bf,
+			      const struct iovec *iov, int iovlen,
+			      const struct timespec *abs_timeout)
+{
+	struct alchemy_buffer_wait *wait = NULL;
+	struct alchemy_buffer *bcb;
+	struct syncstate syns;
+	struct service svc;
+	ssize_t ret;
+	int err = 0, n;
+	size_t len;
+
+	if (iovlen <= 0)
+		return -EINVAL;
+
+	if (iov[0].iov_len == 0)
+		return 0;
+
+	if (!threadobj_current_p() && !alchemy_poll_mode(abs_timeout))
+		return -EPERM;
 
-		ret = syncobj_wait_grant(&bcb->sobj, abs_timeout, &syns);
-		if (ret) {
-			if (ret == -EIDRM)
-				goto out;
+	CANCEL_DEFER(svc);
+
+	bcb = get_alchemy_buffer(bf, &syns, &err);
+	if (bcb == NULL) {
+		ret = err;
+		goto out;
+	}
+
+	ret = buffer_read(bcb, iov[0].iov_base, iov[0].iov_len,
+			  abs_timeout, &syns, &wait);
+	if (ret == -EIDRM)
+		goto out;
+
+	/* Stop on error or short read. */
+	if (ret < (ssize_t)iov[0].iov_len)
+		goto done;
+
+	for (n = 1; n < iovlen; n++) {
+		len = iov[n].iov_len;
+		if (len > bcb->fillsz)
 			break;
-		}
+		read_chunk(bcb, iov[n].iov_base, len);
+		ret += len;
 	}
+
+	if (n > 1)
+		wake_writers(bcb);
 done:
 	put_alchemy_buffer(bcb, &syns);
 out:
@@ -675,16 +903,12 @@ ssize_t rt_buffer_write_timed(RT_BUFFER *bf,
 {
 	struct alchemy_buffer_wait *wait = NULL;
 	struct alchemy_buffer *bcb;
-	struct threadobj *thobj;
-	size_t len, rbytes, n;
 	struct syncstate syns;
 	struct service svc;
-	const void *p;
-	size_t wroff;
-	int ret = 0;
+	ssize_t ret;
+	int err = 0;
 
-	len = size;
-	if (len == 0)
+	if (size == 0)
 		return 0;
 
 	if (!threadobj_current_p() && !alchemy_poll_mode(abs_timeout))
@@ -692,98 +916,122 @@ ssize_t rt_buffer_write_timed(RT_BUFFER *bf,
 
 	CANCEL_DEFER(svc);
 
-	bcb = get_alchemy_buffer(bf, &syns, &ret);
-	if (bcb == NULL)
+	bcb = get_alchemy_buffer(bf, &syns, &err);
+	if (bcb == NULL) {
+		ret = err;
 		goto out;
-
-	/*
-	 * We may only send complete messages, so there is no point in
-	 * accepting messages which are larger than what the buffer
-	 * can hold.
-	 */
-	if (len > bcb->bufsz) {
-		ret = -EINVAL;
-		goto done;
 	}
 
-	for (;;) {
-		/*
-		 * We should be able to write the entire message at
-		 * once, or block.
-		 */
-		if (bcb->fillsz + len > bcb->bufsz)
-			goto wait;
-
-		/* Write to the buffer in a circular way. */
-		wroff = bcb->wroff;
-		rbytes = len;
-		p = ptr;
-
-		do {
-			if (wroff + rbytes > bcb->bufsz)
-				n = bcb->bufsz - wroff;
-			else
-				n = rbytes;
-
-			memcpy(__mptr(bcb->buf) + wroff, p, n);
-			p += n;
-			wroff = (wroff + n) % bcb->bufsz;
-			rbytes -= n;
-		} while (rbytes > 0);
-
-		bcb->fillsz += len;
-		bcb->wroff = wroff;
-		ret = (ssize_t)len;
+	ret = buffer_write(bcb, ptr, size, abs_timeout, &syns, &wait);
+	if (ret != -EIDRM)
+		put_alchemy_buffer(bcb, &syns);
+out:
+	if (wait)
+		threadobj_finish_wait();
 
-		/*
-		 * Wake up all threads waiting for input, if we
-		 * accumulated enough data to feed the leading one.
-		 */
-		thobj = syncobj_peek_grant(&bcb->sobj);
-		if (thobj == NULL)
-			goto done;
+	CANCEL_RESTORE(svc);
 
-		wait = threadobj_get_wait(thobj);
-		if (wait->size <= bcb->fillsz)
-			syncobj_grant_all(&bcb->sobj);
+	return ret;
+}
 
-		goto done;
-	wait:
-		if (alchemy_poll_mode(abs_timeout)) {
-			ret = -EWOULDBLOCK;
-			goto done;
-		}
+/**
+ * @fn ssize_t rt_buffer_writev(RT_BUFFER *bf, const struct iovec *iov, int iovlen, RTIME timeout)
+ * @brief Write multiple messages to an IPC buffer (with relative scalar timeout).
+ *
+ * This routine is a variant of rt_buffer_writev_timed() accepting a
+ * relative timeout specification expressed as a scalar value.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
 
-		if (wait == NULL)
-			wait = threadobj_prepare_wait(struct alchemy_buffer_wait);
+/**
+ * @fn ssize_t rt_buffer_writev_until(RT_BUFFER *bf, const struct iovec *iov, int iovlen, RTIME abs_timeout)
+ * @brief Write multiple messages to an IPC buffer (with absolute scalar timeout).
+ *
+ * This routine is a variant of rt_buffer_writev_timed() accepting an
+ * absolute timeout specification expressed as a scalar value.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
 
-		wait->size = len;
+/**
+ * @fn ssize_t rt_buffer_writev_timed(RT_BUFFER *bf, const struct iovec *iov, int iovlen, const struct timespec *abs_timeout)
+ * @brief Write multiple messages to an IPC buffer.
+ *
+ * This routine writes a series of messages to the specified buffer
+ * from the memory areas described by @a iov, each area forming a
+ * message. The first message is written exactly like
+ * rt_buffer_write_timed() would do, blocking the caller until enough
+ * room is available if need be. Then, the following messages which
+ * entirely fit into the buffer at that point are written without
+ * blocking, under the same acquisition of the buffer lock.
+ *
+ * @param bf The buffer descriptor.
+ *
+ * @param iov An array of @a iovlen memory areas to write messages
+ * from.
+ *
+ * @param iovlen The number of items in @a iov.
+ *
+ * @param abs_timeout An absolute date expressed in seconds /
+ * nanoseconds, based on the Alchemy clock, specifying a time limit
+ * to wait for enough room to write the first message, with the same
+ * meaning as for rt_buffer_write_timed().
+ *
+ * @return The total number of bytes written to the buffer is
+ * returned upon success. Otherwise, the same error codes as
+ * rt_buffer_write_timed() may be returned, along with -EINVAL if @a
+ * iovlen is not positive.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
+ssize_t rt_buffer_writev_timed(RT_BUFFER *bf,
+			       const struct iovec *iov, int iovlen,
+			       const struct timespec *abs_timeout)
+{
+	struct alchemy_buffer_wait *wait = NULL;
+	struct alchemy_buffer *bcb;
+	struct syncstate syns;
+	struct service svc;
+	ssize_t ret;
+	int err = 0, n;
+	size_t len;
 
-		/*
-		 * Check whether readers are already waiting for
-		 * receiving data, while we are about to wait for
-		 * sending some. In such a case, we have the converse
-		 * pathological use of the buffer. We must kick
-		 * readers to allow for a short read to prevent a
-		 * deadlock.
-		 *
-		 * XXX: instead of broadcasting a general wake up
-		 * event, we could be smarter and wake up only the
-		 * number of waiters required to consume the amount of
-		 * data we want to send, but this does not seem worth
-		 * the burden: this is an error condition, we just
-		 * have to mitigate its effect, avoiding a deadlock.
-		 */
-		if (bcb->fillsz > 0 && syncobj_count_grant(&bcb->sobj))
-			syncobj_grant_all(&bcb->sobj);
+	if (iovlen <= 0)
+		return -EINVAL;
 
-		ret = syncobj_wait_drain(&bcb->sobj, abs_timeout, &syns);
-		if (ret) {
-			if (ret == -EIDRM)
-				goto out;
+	if (iov[0].iov_len == 0)
+		return 0;
+
+	if (!threadobj_current_p() && !alchemy_poll_mode(abs_timeout))
+		return -EPERM;
+
+	CANCEL_DEFER(svc);
+
+	bcb = get_alchemy_buffer(bf, &syns, &err);
+	if (bcb == NULL) {
+		ret = err;
+		goto out;
+	}
+
+	ret = buffer_write(bcb, iov[0].iov_base, iov[0].iov_len,
+			   abs_timeout, &syns, &wait);
+	if (ret == -EIDRM)
+		goto out;
+
+	if (ret < 0)
+		goto done;
+
+	for (n = 1; n < iovlen; n++) {
+		len = iov[n].iov_len;
+		if (len == 0 || bcb->fillsz + len > bcb->bufsz)
 			break;
-		}
+		write_chunk(bcb, iov[n].iov_base, len);
+		ret += len;
 	}
+
+	if (n > 1)
+		wake_readers(bcb);
 done:
 	put_alchemy_buffer(bcb, &syns);
 out:
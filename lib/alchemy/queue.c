@@ -17,6 +17,7 @@
  */
 #include <errno.h>
 #include <string.h>
+#include <boilerplate/atomic.h>
 #include <copperplate/threadobj.h>
 #include <copperplate/heapobj.h>
 #include <copperplate/registry-obstack.h>
@@ -46,6 +47,20 @@ static DEFINE_NAME_GENERATOR(queue_namegen, "queue",
 
 DEFINE_SYNC_LOOKUP(queue, RT_QUEUE);
 
+DEFINE_LOOKUP_PRIVATE(queue, RT_QUEUE);
+
+static inline unsigned int queue_count(struct alchemy_queue *qcb)
+{
+	struct alchemy_queue_ring *ring;
+
+	if ((qcb->mode & Q_SPSC) == 0)
+		return qcb->mcount;
+
+	ring = __mptr(qcb->ring);
+
+	return ACCESS_ONCE(ring->head) - ACCESS_ONCE(ring->tail);
+}
+
 #ifdef CONFIG_XENO_REGISTRY
 
 static int prepare_waiter_cache(struct fsobstack *o,
@@ -93,7 +108,7 @@ static int queue_registry_open(struct fsobj *fsobj, void *priv)
 	usable_mem = heapobj_size(&qcb->hobj);
 	used_mem = heapobj_inquire(&qcb->hobj);
 	limit = qcb->limit;
-	mcount = qcb->mcount;
+	mcount = queue_count(qcb);
 	mode = qcb->mode;
 
 	syncobj_unlock(&qcb->sobj, &syns);
@@ -135,10 +150,315 @@ static void queue_finalize(struct syncobj *sobj)
 	qcb = container_of(sobj, struct alchemy_queue, sobj);
 	registry_destroy_file(&qcb->fsobj);
 	heapobj_destroy(&qcb->hobj);
+	if (qcb->mode & Q_SPSC)
+		xnfree(__mptr(qcb->ring));
 	xnfree(qcb);
 }
 fnref_register(libalchemy, queue_finalize);
 
+/* Copy the message payload out, then release the message. */
+static size_t copy_message(struct alchemy_queue *qcb,
+			   struct alchemy_queue_msg *msg,
+			   void *buf, size_t size)
+{
+	if (size > msg->size)
+		size = msg->size;
+
+	if (size > 0)
+		memcpy(buf, msg + 1, size);
+
+	heapobj_free(&qcb->hobj, msg);
+
+	return size;
+}
+
+/*
+ * Q_SPSC queues convey messages through a ring of pre-allocated
+ * slots, which a single producer fills in and a single consumer
+ * drains without locking. Small messages are copied inline into the
+ * slots, larger ones and those sent with rt_queue_send() are
+ * referred to by the slot instead. The syncobj is only involved
+ * when the consumer has to wait for the ring to fill.
+ */
+static int ring_init(struct alchemy_queue *qcb, size_t slotsz)
+{
+	struct alchemy_queue_ring *ring;
+	unsigned int nslots = 1;
+	size_t stride;
+
+	while (nslots < qcb->limit)
+		nslots <<= 1;
+
+	stride = sizeof(struct alchemy_queue_slot) + slotsz;
+	stride = (stride + sizeof(long) - 1) & ~(sizeof(long) - 1);
+
+	ring = xnmalloc(sizeof(*ring) + nslots * stride);
+	if (ring == NULL)
+		return -ENOMEM;
+
+	ring->head = 0;
+	ring->tail = 0;
+	ring->waiting = 0;
+	ring->mask = nslots - 1;
+	ring->slotsz = slotsz;
+	ring->stride = stride;
+	qcb->ring = __moff(ring);
+
+	return 0;
+}
+
+static inline struct alchemy_queue_slot *
+get_slot(struct alchemy_queue_ring *ring, unsigned int pos)
+{
+	return (struct alchemy_queue_slot *)
+		((char *)(ring + 1) + (pos & ring->mask) * ring->stride);
+}
+
+static struct alchemy_queue_slot *
+ring_reserve(struct alchemy_queue *qcb, struct alchemy_queue_ring *ring)
+{
+	if (ring->head - ACCESS_ONCE(ring->tail) >= qcb->limit)
+		return NULL;
+
+	/* Do not overwrite the slot before the consumer is done. */
+	smp_mb();
+	compiler_barrier();
+
+	return get_slot(ring, ring->head);
+}
+
+static int ring_commit(struct alchemy_queue *qcb,
+		       struct alchemy_queue_ring *ring)
+{
+	struct syncstate syns;
+	int ret = 0;
+
+	smp_wmb();
+	compiler_barrier();
+	ACCESS_ONCE(ring->head) = ring->head + 1;
+	/* Order the head update with the check for a sleeper. */
+	smp_mb();
+	compiler_barrier();
+
+	if (!ACCESS_ONCE(ring->waiting))
+		return 0;
+
+	/*
+	 * The consumer holds the syncobj lock from the time it raises
+	 * the waiting flag until it sleeps, and clears the flag before
+	 * releasing the lock if it does not, so the flag is stable
+	 * under lock.
+	 */
+	if (syncobj_lock(&qcb->sobj, &syns))
+		return 0;
+
+	if (ring->waiting && syncobj_grant_one(&qcb->sobj))
+		ret = 1;
+
+	syncobj_unlock(&qcb->sobj, &syns);
+
+	return ret;
+}
+
+static struct alchemy_queue_slot *
+ring_peek(struct alchemy_queue_ring *ring)
+{
+	if (ACCESS_ONCE(ring->head) == ring->tail)
+		return NULL;
+
+	smp_rmb();
+	compiler_barrier();
+
+	return get_slot(ring, ring->tail);
+}
+
+static void ring_release(struct alchemy_queue_ring *ring)
+{
+	/* Done with the slot before the producer may reuse it. */
+	smp_mb();
+	compiler_barrier();
+	ACCESS_ONCE(ring->tail) = ring->tail + 1;
+}
+
+static int ring_wait(struct alchemy_queue *qcb,
+		     struct alchemy_queue_ring *ring,
+		     const struct timespec *abs_timeout,
+		     struct alchemy_queue_slot **slotp)
+{
+	struct syncstate syns;
+	int ret;
+
+	if (alchemy_poll_mode(abs_timeout))
+		return -EWOULDBLOCK;
+
+	if (syncobj_lock(&qcb->sobj, &syns))
+		return -EINVAL;
+
+	for (;;) {
+		ring->waiting = 1;
+		smp_mb();
+		compiler_barrier();
+		*slotp = ring_peek(ring);
+		if (*slotp) {
+			ret = 0;
+			break;
+		}
+		ret = syncobj_wait_grant(&qcb->sobj, abs_timeout, &syns);
+		if (ret == -EIDRM)
+			return ret;
+		if (ret)
+			break;
+	}
+
+	ring->waiting = 0;
+	syncobj_unlock(&qcb->sobj, &syns);
+
+	return ret;
+}
+
+static int ring_send(struct alchemy_queue *qcb,
+		     struct alchemy_queue_msg *msg, size_t size, int mode)
+{
+	struct alchemy_queue_ring *ring = __mptr(qcb->ring);
+	struct alchemy_queue_slot *slot;
+
+	if (mode)
+		return -EINVAL;
+
+	if (msg->refcount == 0)
+		return -EINVAL;
+
+	slot = ring_reserve(qcb, ring);
+	if (slot == NULL)
+		return -ENOMEM;
+
+	msg->refcount--;
+	msg->size = size;
+	slot->msg = __moff(msg);
+	slot->size = size;
+
+	return ring_commit(qcb, ring);
+}
+
+static int ring_write(struct alchemy_queue *qcb,
+		      const void *buf, size_t size, int mode)
+{
+	struct alchemy_queue_ring *ring = __mptr(qcb->ring);
+	struct alchemy_queue_slot *slot;
+	struct alchemy_queue_msg *msg;
+
+	if (mode)
+		return -EINVAL;
+
+	slot = ring_reserve(qcb, ring);
+	if (slot == NULL)
+		return -ENOMEM;
+
+	if (size <= ring->slotsz) {
+		slot->msg = __moff_nullable(NULL);
+		if (size > 0)
+			memcpy(slot + 1, buf, size);
+	} else {
+		msg = heapobj_alloc(&qcb->hobj, size + sizeof(*msg));
+		if (msg == NULL)
+			return -ENOMEM;
+		msg->size = size;
+		msg->refcount = 0;
+		memcpy(msg + 1, buf, size);
+		slot->msg = __moff(msg);
+	}
+
+	slot->size = size;
+
+	return ring_commit(qcb, ring);
+}
+
+static ssize_t ring_receive(struct alchemy_queue *qcb, void **bufp,
+			    const struct timespec *abs_timeout)
+{
+	struct alchemy_queue_ring *ring = __mptr(qcb->ring);
+	struct alchemy_queue_slot *slot;
+	struct alchemy_queue_msg *msg;
+	int ret;
+
+	slot = ring_peek(ring);
+	if (slot == NULL) {
+		ret = ring_wait(qcb, ring, abs_timeout, &slot);
+		if (ret)
+			return ret;
+	}
+
+	msg = __mptr_nullable(slot->msg);
+	if (msg == NULL) {
+		/*
+		 * Inline message, which has to move to a buffer the
+		 * caller may keep until rt_queue_free() is called.
+		 */
+		msg = heapobj_alloc(&qcb->hobj, slot->size + sizeof(*msg));
+		if (msg == NULL)
+			return -ENOMEM;
+		msg->size = slot->size;
+		msg->refcount = 0;
+		if (slot->size > 0)
+			memcpy(msg + 1, slot + 1, slot->size);
+	}
+
+	ring_release(ring);
+	msg->refcount++;
+	*bufp = msg + 1;
+
+	return (ssize_t)msg->size;
+}
+
+static ssize_t ring_read(struct alchemy_queue *qcb,
+			 void *buf, size_t size,
+			 const struct timespec *abs_timeout)
+{
+	struct alchemy_queue_ring *ring = __mptr(qcb->ring);
+	struct alchemy_queue_slot *slot;
+	struct alchemy_queue_msg *msg;
+	ssize_t ret;
+	void *data;
+
+	slot = ring_peek(ring);
+	if (slot == NULL) {
+		ret = ring_wait(qcb, ring, abs_timeout, &slot);
+		if (ret)
+			return ret;
+	}
+
+	msg = __mptr_nullable(slot->msg);
+	data = msg ? (void *)(msg + 1) : (void *)(slot + 1);
+	ret = (ssize_t)(slot->size > size ? size : slot->size);
+	if (ret > 0)
+		memcpy(buf, data, ret);
+
+	ring_release(ring);
+
+	if (msg)
+		heapobj_free(&qcb->hobj, msg);
+
+	return ret;
+}
+
+static int ring_flush(struct alchemy_queue *qcb)
+{
+	struct alchemy_queue_ring *ring = __mptr(qcb->ring);
+	struct alchemy_queue_slot *slot;
+	struct alchemy_queue_msg *msg;
+	int count = 0;
+
+	while ((slot = ring_peek(ring)) != NULL) {
+		msg = __mptr_nullable(slot->msg);
+		ring_release(ring);
+		if (msg)
+			heapobj_free(&qcb->hobj, msg);
+		count++;
+	}
+
+	return count;
+}
+
 /**
  * @fn int rt_queue_create(RT_QUEUE *q, const char *name, size_t poolsize, size_t qlimit, int mode)
  * @brief Create a message queue.
@@ -172,9 +492,20 @@ fnref_register(libalchemy, queue_finalize);
  *
  * - Q_PRIO makes tasks pend in priority order on the queue.
  *
+ * - Q_SPSC creates a queue for a single producer and a single
+ * consumer task, which exchange messages through a pre-allocated
+ * ring of @a qlimit slots without locking. Messages up to @a
+ * poolsize / @a qlimit bytes are copied to the ring by
+ * rt_queue_write(), larger ones and those sent by rt_queue_send()
+ * are taken from the buffer pool. Only the consumer ever blocks, and
+ * Q_URGENT or Q_BROADCAST modes are not available. The producer and
+ * the consumer must serialize with rt_queue_delete(), and
+ * rt_queue_flush() may only be called from the consumer side.
+ *
  * @return Zero is returned upon success. Otherwise:
  *
- * - -EINVAL is returned if @a mode is invalid or @a poolsize is zero.
+ * - -EINVAL is returned if @a mode is invalid or @a poolsize is zero,
+ * or if Q_SPSC is set in @a mode with an unlimited @a qlimit.
  *
  * - -ENOMEM is returned if the system fails to get memory from the
  * main heap in order to create the queue.
@@ -211,7 +542,10 @@ int rt_queue_create(RT_QUEUE *queue, const char *name,
 	if (threadobj_irq_p())
 		return -EPERM;
 
-	if (poolsize == 0 || (mode & ~Q_PRIO) != 0)
+	if (poolsize == 0 || (mode & ~(Q_PRIO|Q_SPSC)) != 0)
+		return -EINVAL;
+
+	if ((mode & Q_SPSC) && qlimit == Q_UNLIMITED)
 		return -EINVAL;
 
 	CANCEL_DEFER(svc);
@@ -246,6 +580,12 @@ int rt_queue_create(RT_QUEUE *queue, const char *name,
 	list_init(&qcb->mq);
 	qcb->mcount = 0;
 
+	if (mode & Q_SPSC) {
+		ret = ring_init(qcb, poolsize / qlimit);
+		if (ret)
+			goto fail_ringalloc;
+	}
+
 	if (mode & Q_PRIO)
 		sobj_flags = SYNCOBJ_PRIO;
 
@@ -277,6 +617,9 @@ fail_register:
 	registry_destroy_file(&qcb->fsobj);
 	syncobj_uninit(&qcb->sobj);
 fail_syncinit:
+	if (mode & Q_SPSC)
+		xnfree(__mptr(qcb->ring));
+fail_ringalloc:
 	heapobj_destroy(&qcb->hobj);
 fail_bufalloc:
 	xnfree(qcb);
@@ -491,7 +834,8 @@ out:
  * codes is returned:
  *
  * - -EINVAL is returned if @a q is not a message queue descriptor, @a
- * mode is invalid, or @a buf is NULL.
+ * mode is invalid, or @a buf is NULL. Q_URGENT and Q_BROADCAST are
+ * invalid with Q_SPSC queues.
  *
  * - -ENOMEM is returned if queuing the message would exceed the limit
  * defined for the queue at creation.
@@ -516,6 +860,12 @@ int rt_queue_send(RT_QUEUE *queue,
 
 	CANCEL_DEFER(svc);
 
+	qcb = find_alchemy_queue(queue, &ret);
+	if (qcb && (qcb->mode & Q_SPSC)) {
+		ret = ring_send(qcb, msg, size, mode);
+		goto out;
+	}
+
 	qcb = get_alchemy_queue(queue, &syns, &ret);
 	if (qcb == NULL)
 		goto out;
@@ -606,7 +956,8 @@ out:
  * codes is returned:
  *
  * - -EINVAL is returned if @a mode is invalid, @a buf is NULL with a
- * non-zero @a size, or @a q is not a essage queue descriptor.
+ * non-zero @a size, or @a q is not a essage queue descriptor. Q_URGENT
+ * and Q_BROADCAST are invalid with Q_SPSC queues.
  *
  * - -ENOMEM is returned if queuing the message would exceed the limit
  * defined for the queue at creation, or if no memory can be obtained
@@ -614,30 +965,15 @@ out:
  *
  * @apitags{unrestricted, switch-primary}
  */
-int rt_queue_write(RT_QUEUE *queue,
-		   const void *buf, size_t size, int mode)
+static int queue_write(struct alchemy_queue *qcb,
+		       const void *buf, size_t size, int mode)
 {
 	struct alchemy_queue_wait *wait;
 	struct alchemy_queue_msg *msg;
-	struct alchemy_queue *qcb;
 	struct threadobj *waiter;
-	struct syncstate syns;
-	int ret = 0, nwaiters;
-	struct service svc;
+	int ret, nwaiters;
 	size_t bufsz;
 
-	if (mode & ~(Q_URGENT|Q_BROADCAST))
-		return -EINVAL;
-
-	if (buf == NULL && size > 0)
-		return -EINVAL;
-
-	CANCEL_DEFER(svc);
-
-	qcb = get_alchemy_queue(queue, &syns, &ret);
-	if (qcb == NULL)
-		goto out;
-
 	if (mode & Q_BROADCAST)
 		/* No buffer-to-buffer copy in broadcast mode. */
 		goto enqueue;
@@ -660,22 +996,20 @@ int rt_queue_write(RT_QUEUE *queue,
 			memcpy(wait->local_buf, buf, size);
 		wait->local_bufsz = size;
 		syncobj_grant_to(&qcb->sobj, waiter);
-		ret = 1;
-		goto done;
+		return 1;
 	}
 
 enqueue:
 	nwaiters = syncobj_count_grant(&qcb->sobj);
 	if (nwaiters == 0 && (mode & Q_BROADCAST) != 0)
-		goto done;
+		return 0;
 
-	ret = -ENOMEM;
 	if (qcb->limit && qcb->mcount >= qcb->limit)
-		goto done;
+		return -ENOMEM;
 
 	msg = heapobj_alloc(&qcb->hobj, size + sizeof(*msg));
 	if (msg == NULL)
-		goto done;
+		return -ENOMEM;
 
 	msg->size = size;
 	msg->refcount = 0;
@@ -689,7 +1023,7 @@ enqueue:
 			list_prepend(&msg->next, &qcb->mq);
 		else
 			list_append(&msg->next, &qcb->mq);
-		goto done;
+		return 0;
 	}
 
 	do {
@@ -701,8 +1035,121 @@ enqueue:
 		msg->refcount++;
 		ret++;
 	} while (mode & Q_BROADCAST);
-done:
+
+	return ret;
+}
+
+int rt_queue_write(RT_QUEUE *queue,
+		   const void *buf, size_t size, int mode)
+{
+	struct alchemy_queue *qcb;
+	struct syncstate syns;
+	struct service svc;
+	int ret = 0;
+
+	if (mode & ~(Q_URGENT|Q_BROADCAST))
+		return -EINVAL;
+
+	if (buf == NULL && size > 0)
+		return -EINVAL;
+
+	CANCEL_DEFER(svc);
+
+	qcb = find_alchemy_queue(queue, &ret);
+	if (qcb && (qcb->mode & Q_SPSC)) {
+		ret = ring_write(qcb, buf, size, mode);
+		goto out;
+	}
+
+	qcb = get_alchemy_queue(queue, &syns, &ret);
+	if (qcb == NULL)
+		goto out;
+
+	ret = queue_write(qcb, buf, size, mode);
+
+	put_alchemy_queue(qcb, &syns);
+out:
+	CANCEL_RESTORE(svc);
+
+	return ret;
+}
+
+/**
+ * @fn int rt_queue_write_multi(RT_QUEUE *q, const struct iovec *iov, int iovlen, int mode)
+ * @brief Write a series of messages to a queue.
+ *
+ * This service builds one message out of each raw data buffer
+ * described by @a iov, then sends them in order to a given queue,
+ * as if rt_queue_write() was called for each of them, except that
+ * the queue is locked only once for the whole series.
+ *
+ * @param q The queue descriptor.
+ *
+ * @param iov An array of @a iovlen memory areas, each holding the
+ * payload of one message. A zero-sized area is valid, in which case
+ * an empty message is queued.
+ *
+ * @param iovlen The number of items in @a iov.
+ *
+ * @param mode A set of flags affecting the operation, with the same
+ * meaning as for rt_queue_write(). Q_URGENT applies to each message
+ * in turn, so that the series is queued in reverse order.
+ *
+ * @return Upon success, this service returns the number of messages
+ * written to the queue, which may be less than @a iovlen if the
+ * queue fills up during the operation. If no message could be
+ * written, one of the error codes defined for rt_queue_write() is
+ * returned.
+ *
+ * @apitags{unrestricted, switch-primary}
+ */
+int rt_queue_write_multi(RT_QUEUE *queue,
+			 const struct iovec *iov, int iovlen, int mode)
+{
+	struct alchemy_queue *qcb;
+	struct syncstate syns;
+	struct service svc;
+	int ret = 0, n;
+
+	if (mode & ~(Q_URGENT|Q_BROADCAST))
+		return -EINVAL;
+
+	if (iovlen <= 0)
+		return -EINVAL;
+
+	for (n = 0; n < iovlen; n++) {
+		if (iov[n].iov_base == NULL && iov[n].iov_len > 0)
+			return -EINVAL;
+	}
+
+	CANCEL_DEFER(svc);
+
+	qcb = find_alchemy_queue(queue, &ret);
+	if (qcb && (qcb->mode & Q_SPSC)) {
+		for (n = 0; n < iovlen; n++) {
+			ret = ring_write(qcb, iov[n].iov_base,
+					 iov[n].iov_len, mode);
+			if (ret < 0)
+				break;
+		}
+		goto count;
+	}
+
+	qcb = get_alchemy_queue(queue, &syns, &ret);
+	if (qcb == NULL)
+		goto out;
+
+	for (n = 0; n < iovlen; n++) {
+		ret = queue_write(qcb, iov[n].iov_base,
+				  iov[n].iov_len, mode);
+		if (ret < 0)
+			break;
+	}
+
 	put_alchemy_queue(qcb, &syns);
+count:
+	if (n > 0)
+		ret = n;
 out:
 	CANCEL_RESTORE(svc);
 
@@ -813,6 +1260,12 @@ ssize_t rt_queue_receive_timed(RT_QUEUE *queue, void **bufp,
 
 	CANCEL_DEFER(svc);
 
+	qcb = find_alchemy_queue(queue, &err);
+	if (qcb && (qcb->mode & Q_SPSC)) {
+		ret = ring_receive(qcb, bufp, abs_timeout);
+		goto out;
+	}
+
 	qcb = get_alchemy_queue(queue, &syns, &err);
 	if (qcb == NULL) {
 		ret = err;
@@ -977,6 +1430,12 @@ ssize_t rt_queue_read_timed(RT_QUEUE *queue,
 
 	CANCEL_DEFER(svc);
 
+	qcb = find_alchemy_queue(queue, &err);
+	if (qcb && (qcb->mode & Q_SPSC)) {
+		ret = ring_read(qcb, buf, size, abs_timeout);
+		goto out;
+	}
+
 	qcb = get_alchemy_queue(queue, &syns, &err);
 	if (qcb == NULL) {
 		ret = err;
@@ -1009,10 +1468,7 @@ wait:
 	} else if (__mptr_nullable(wait->msg)) {
 		msg = __mptr(wait->msg);
 	transfer:
-		ret = (ssize_t)(msg->size > size ? size : msg->size);
-		if (ret > 0) 
-			memcpy(buf, msg + 1, ret);
-		heapobj_free(&qcb->hobj, msg);
+		ret = (ssize_t)copy_message(qcb, msg, buf, size);
 	} else	/* A direct copy took place. */
 		ret = (ssize_t)wait->local_bufsz;
 
@@ -1025,6 +1481,157 @@ out:
 	return ret;
 }
 
+/**
+ * @fn ssize_t rt_queue_read_multi(RT_QUEUE *q, struct iovec *iov, int iovlen, RTIME timeout)
+ * @brief Read a series of messages from a queue (with relative scalar timeout).
+ *
+ * This routine is a variant of rt_queue_read_multi_timed() accepting
+ * a relative timeout specification expressed as a scalar value.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
+
+/**
+ * @fn ssize_t rt_queue_read_multi_until(RT_QUEUE *q, struct iovec *iov, int iovlen, RTIME abs_timeout)
+ * @brief Read a series of messages from a queue (with absolute scalar timeout).
+ *
+ * This routine is a variant of rt_queue_read_multi_timed() accepting
+ * an absolute timeout specification expressed as a scalar value.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
+
+/**
+ * @fn ssize_t rt_queue_read_multi_timed(RT_QUEUE *q, struct iovec *iov, int iovlen, const struct timespec *abs_timeout)
+ * @brief Read a series of messages from a queue.
+ *
+ * This service reads up to @a iovlen messages from a given queue,
+ * copying each of them to the corresponding memory area described
+ * by @a iov. The caller waits for the first message as with
+ * rt_queue_read_timed(), then any message which is already pending
+ * in the queue at that point is received under the same acquisition
+ * of the queue lock, until @a iov is filled up or the queue is
+ * empty.
+ *
+ * @param q The queue descriptor.
+ *
+ * @param iov An array of @a iovlen memory areas to copy the received
+ * messages to. Messages larger than their receiving area are
+ * truncated appropriately. Upon success, the @a iov_len field of
+ * each area which received a message is updated with the number of
+ * bytes copied. The same restriction on the origin of the memory
+ * areas applies as with rt_queue_read_timed() when --enable-pshared
+ * is set.
+ *
+ * @param iovlen The number of items in @a iov.
+ *
+ * @param abs_timeout An absolute date expressed in seconds /
+ * nanoseconds, based on the Alchemy clock, specifying a time limit
+ * to wait for the first message to be available from the queue,
+ * with the same meaning as for rt_queue_read_timed().
+ *
+ * @return The number of messages received is returned upon
+ * success. Otherwise, the same error codes as rt_queue_read_timed()
+ * may be returned, along with -EINVAL if @a iovlen is not positive.
+ *
+ * @apitags{xthread-nowait, switch-primary}
+ */
+ssize_t rt_queue_read_multi_timed(RT_QUEUE *queue,
+				  struct iovec *iov, int iovlen,
+				  const struct timespec *abs_timeout)
+{
+	struct alchemy_queue_wait *wait;
+	struct alchemy_queue_msg *msg;
+	struct alchemy_queue *qcb;
+	const struct timespec ts = {
+		.tv_sec = 0, .tv_nsec = 0
+	};
+	struct syncstate syns;
+	struct service svc;
+	ssize_t ret;
+	int err = 0, n;
+
+	if (!threadobj_current_p() && !alchemy_poll_mode(abs_timeout))
+		return -EPERM;
+
+	if (iovlen <= 0)
+		return -EINVAL;
+
+	CANCEL_DEFER(svc);
+
+	qcb = find_alchemy_queue(queue, &err);
+	if (qcb && (qcb->mode & Q_SPSC)) {
+		for (n = 0; n < iovlen; n++) {
+			ret = ring_read(qcb, iov[n].iov_base, iov[n].iov_len,
+					n ? &ts : abs_timeout);
+			if (ret < 0)
+				break;
+			iov[n].iov_len = ret;
+		}
+		if (n > 0)
+			ret = n;
+		goto out;
+	}
+
+	qcb = get_alchemy_queue(queue, &syns, &err);
+	if (qcb == NULL) {
+		ret = err;
+		goto out;
+	}
+
+	if (list_empty(&qcb->mq))
+		goto wait;
+
+	msg = list_pop_entry(&qcb->mq, struct alchemy_queue_msg, next);
+	qcb->mcount--;
+	goto transfer;
+wait:
+	if (alchemy_poll_mode(abs_timeout)) {
+		ret = -EWOULDBLOCK;
+		goto done;
+	}
+
+	wait = threadobj_prepare_wait(struct alchemy_queue_wait);
+	wait->local_buf = iov[0].iov_base;
+	wait->local_bufsz = iov[0].iov_len;
+	wait->msg = __moff_nullable(NULL);
+
+	ret = syncobj_wait_grant(&qcb->sobj, abs_timeout, &syns);
+	if (ret) {
+		threadobj_finish_wait();
+		if (ret == -EIDRM)
+			goto out;
+		goto done;
+	}
+
+	if (__mptr_nullable(wait->msg) == NULL) {
+		/* A direct copy took place. */
+		iov[0].iov_len = wait->local_bufsz;
+		threadobj_finish_wait();
+		goto drain;
+	}
+
+	msg = __mptr(wait->msg);
+	threadobj_finish_wait();
+transfer:
+	iov[0].iov_len = copy_message(qcb, msg,
+				      iov[0].iov_base, iov[0].iov_len);
+drain:
+	for (n = 1; n < iovlen && !list_empty(&qcb->mq); n++) {
+		msg = list_pop_entry(&qcb->mq, struct alchemy_queue_msg, next);
+		qcb->mcount--;
+		iov[n].iov_len = copy_message(qcb, msg,
+					      iov[n].iov_base, iov[n].iov_len);
+	}
+	ret = n;
+done:
+	put_alchemy_queue(qcb, &syns);
+out:
+	CANCEL_RESTORE(svc);
+
+	return ret;
+}
+
 /**
  * @fn int rt_queue_flush(RT_QUEUE *q)
  * @brief Flush pending messages from a queue.
@@ -1050,6 +1657,12 @@ int rt_queue_flush(RT_QUEUE *queue)
 
 	CANCEL_DEFER(svc);
 
+	qcb = find_alchemy_queue(queue, &ret);
+	if (qcb && (qcb->mode & Q_SPSC)) {
+		ret = ring_flush(qcb);
+		goto out;
+	}
+
 	qcb = get_alchemy_queue(queue, &syns, &ret);
 	if (qcb == NULL)
 		goto out;
@@ -1110,7 +1723,7 @@ int rt_queue_inquire(RT_QUEUE *queue, RT_QUEUE_INFO *info)
 		goto out;
 
 	info->nwaiters = syncobj_count_grant(&qcb->sobj);
-	info->nmessages = qcb->mcount;
+	info->nmessages = queue_count(qcb);
 	info->mode = qcb->mode;
 	info->qlimit = qcb->limit;
 	info->poolsize = heapobj_size(&qcb->hobj);
@@ -36,6 +36,7 @@ struct alchemy_queue {
 	struct clusterobj cobj;
 	struct listobj mq;
 	unsigned int mcount;
+	dref_type(struct alchemy_queue_ring *) ring;
 	struct fsobj fsobj;
 };
 
@@ -48,6 +49,29 @@ struct alchemy_queue_msg {
 	/* Payload data follows. */
 };
 
+struct alchemy_queue_slot {
+	dref_type(struct alchemy_queue_msg *) msg;
+	size_t size;
+	/* Inline payload data follows, unless msg is set. */
+};
+
+/*
+ * Message ring of Q_SPSC queues. The producer only updates the
+ * head index, the consumer only updates the tail index and the
+ * waiting flag, which live in distinct cachelines.
+ */
+struct alchemy_queue_ring {
+	unsigned int head;
+	char __pad1[64 - sizeof(unsigned int)];
+	unsigned int tail;
+	int waiting;
+	char __pad2[64 - 2 * sizeof(int)];
+	unsigned int mask;
+	size_t slotsz;
+	size_t stride;
+	/* Slots follow. */
+};
+
 struct alchemy_queue_wait {
 	dref_type(struct alchemy_queue_msg *) msg;
 	void *local_buf;
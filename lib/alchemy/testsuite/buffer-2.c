@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <copperplate/traceobj.h>
+#include <alchemy/task.h>
+#include <alchemy/buffer.h>
+
+/*
+ * Move series of messages through a buffer in a single call, first
+ * with a reader waiting for input, then with data already pending.
+ */
+
+#define BUFSZ  16
+
+static struct traceobj trobj;
+
+static RT_BUFFER buffer;
+
+static RT_TASK t_reader;
+
+static void reader_task(void *arg)
+{
+	char s[3][4];
+	struct iovec iov[3] = {
+		{ .iov_base = s[0], .iov_len = 4 },
+		{ .iov_base = s[1], .iov_len = 4 },
+		{ .iov_base = s[2], .iov_len = 4 },
+	};
+	ssize_t ret;
+
+	traceobj_enter(&trobj);
+
+	ret = rt_buffer_readv(&buffer, iov, 3, TM_INFINITE);
+	traceobj_assert(&trobj, ret == 12);
+	traceobj_assert(&trobj, memcmp(s, "AAAABBBBCCCC", 12) == 0);
+
+	traceobj_exit(&trobj);
+}
+
+static void main_task(void *arg)
+{
+	struct iovec iov[4];
+	char s[BUFSZ * 2];
+	ssize_t ret;
+	int n;
+
+	traceobj_enter(&trobj);
+
+	ret = rt_buffer_create(&buffer, "BUFFER", BUFSZ, B_FIFO);
+	traceobj_check(&trobj, ret, 0);
+
+	ret = rt_task_spawn(&t_reader, "reader", 0, 20, T_JOINABLE,
+			    reader_task, NULL);
+	traceobj_check(&trobj, ret, 0);
+
+	for (n = 0; n < 3; n++) {
+		iov[n].iov_base = (void *)"AAAABBBBCCCC" + n * 4;
+		iov[n].iov_len = 4;
+	}
+	ret = rt_buffer_writev(&buffer, iov, 3, TM_INFINITE);
+	traceobj_assert(&trobj, ret == 12);
+
+	ret = rt_task_join(&t_reader);
+	traceobj_check(&trobj, ret, 0);
+
+	/* The last message does not fit, stop before it. */
+	iov[3].iov_base = (void *)"DDDDDDDD";
+	iov[3].iov_len = 8;
+	ret = rt_buffer_writev(&buffer, iov, 4, TM_NONBLOCK);
+	traceobj_assert(&trobj, ret == 12);
+
+	/* The last message is incomplete, stop before it. */
+	iov[0].iov_base = s;
+	iov[1].iov_base = s + 4;
+	iov[2].iov_base = s + 8;
+	iov[2].iov_len = 8;
+	ret = rt_buffer_readv(&buffer, iov, 3, TM_NONBLOCK);
+	traceobj_assert(&trobj, ret == 8);
+	traceobj_assert(&trobj, memcmp(s, "AAAABBBB", 8) == 0);
+
+	ret = rt_buffer_readv(&buffer, iov, 3, TM_NONBLOCK);
+	traceobj_assert(&trobj, ret == 4);
+	traceobj_assert(&trobj, memcmp(s, "CCCC", 4) == 0);
+
+	ret = rt_buffer_readv(&buffer, iov, 3, TM_NONBLOCK);
+	traceobj_check(&trobj, ret, -EWOULDBLOCK);
+
+	iov[0].iov_base = s;
+	iov[0].iov_len = BUFSZ + 1;
+	ret = rt_buffer_writev(&buffer, iov, 1, TM_NONBLOCK);
+	traceobj_check(&trobj, ret, -EINVAL);
+
+	ret = rt_buffer_delete(&buffer);
+	traceobj_check(&trobj, ret, 0);
+
+	traceobj_exit(&trobj);
+}
+
+int main(int argc, char *const argv[])
+{
+	RT_TASK t_main;
+	int ret;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	ret = rt_task_create(&t_main, "main_task", 0, 10, 0);
+	traceobj_check(&trobj, ret, 0);
+
+	ret = rt_task_start(&t_main, main_task, NULL);
+	traceobj_check(&trobj, ret, 0);
+
+	traceobj_join(&trobj);
+
+	exit(0);
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <copperplate/traceobj.h>
+#include <boilerplate/tunables.h>
+#include <alchemy/task.h>
+#include <alchemy/queue.h>
+#include <alchemy/timer.h>
+
+/*
+ * Stream messages from a producer to a consumer task through a
+ * regular queue, then through a Q_SPSC one, reporting the message
+ * rate and the enqueue-to-dequeue latency in both cases.
+ */
+
+#define NMESSAGES  100000
+#define QLIMIT     64
+
+struct message {
+	unsigned int seq;
+	RTIME stamp;
+	char payload[40];
+};
+
+static struct traceobj trobj;
+
+static RT_QUEUE q;
+
+static RT_TASK t_producer, t_consumer;
+
+static struct {
+	RTIME total, max;
+} lat;
+
+static void producer_task(void *arg)
+{
+	int zerocopy = (int)(long)arg;
+	struct message msg, *buf;
+	unsigned int seq;
+	int ret;
+
+	traceobj_enter(&trobj);
+
+	memset(&msg, 0, sizeof(msg));
+
+	for (seq = 0; seq < NMESSAGES; seq++) {
+		msg.seq = seq;
+		for (;;) {
+			msg.stamp = rt_timer_read();
+			if (zerocopy) {
+				buf = rt_queue_alloc(&q, sizeof(*buf));
+				if (buf == NULL)
+					ret = -ENOMEM;
+				else {
+					*buf = msg;
+					ret = rt_queue_send(&q, buf, sizeof(*buf),
+							    Q_NORMAL);
+					if (ret == -ENOMEM)
+						rt_queue_free(&q, buf);
+				}
+			} else
+				ret = rt_queue_write(&q, &msg, sizeof(msg), Q_NORMAL);
+			if (ret != -ENOMEM)
+				break;
+			/* Queue or pool full, let the consumer catch up. */
+			rt_task_yield();
+		}
+		traceobj_assert(&trobj, ret >= 0);
+	}
+
+	traceobj_exit(&trobj);
+}
+
+static void consumer_task(void *arg)
+{
+	int zerocopy = (int)(long)arg;
+	struct message msg, *buf;
+	unsigned int seq;
+	RTIME delta;
+	ssize_t ret;
+
+	traceobj_enter(&trobj);
+
+	for (seq = 0; seq < NMESSAGES; seq++) {
+		if (zerocopy) {
+			ret = rt_queue_receive(&q, (void **)&buf, TM_INFINITE);
+			traceobj_assert(&trobj, ret == sizeof(msg));
+			msg = *buf;
+			traceobj_check(&trobj, rt_queue_free(&q, buf), 0);
+		} else {
+			ret = rt_queue_read(&q, &msg, sizeof(msg), TM_INFINITE);
+			traceobj_assert(&trobj, ret == sizeof(msg));
+		}
+		traceobj_assert(&trobj, msg.seq == seq);
+		delta = rt_timer_read() - msg.stamp;
+		lat.total += delta;
+		if (delta > lat.max)
+			lat.max = delta;
+	}
+
+	traceobj_exit(&trobj);
+}
+
+static void run_stream(const char *label, int mode, int zerocopy)
+{
+	RTIME start, elapsed;
+	int ret;
+
+	ret = rt_queue_create(&q, "QUEUE", QLIMIT * sizeof(struct message),
+			      QLIMIT, mode);
+	traceobj_check(&trobj, ret, 0);
+
+	lat.total = lat.max = 0;
+	start = rt_timer_read();
+
+	ret = rt_task_create(&t_consumer, "consumer", 0, 50, 0);
+	traceobj_check(&trobj, ret, 0);
+
+	ret = rt_task_create(&t_producer, "producer", 0, 50, 0);
+	traceobj_check(&trobj, ret, 0);
+
+	ret = rt_task_start(&t_consumer, consumer_task, (void *)(long)zerocopy);
+	traceobj_check(&trobj, ret, 0);
+
+	ret = rt_task_start(&t_producer, producer_task, (void *)(long)zerocopy);
+	traceobj_check(&trobj, ret, 0);
+
+	traceobj_join(&trobj);
+
+	elapsed = rt_timer_ticks2ns(rt_timer_read() - start);
+
+	ret = rt_queue_delete(&q);
+	traceobj_check(&trobj, ret, 0);
+
+	if (get_runtime_tunable(verbosity_level) > 0)
+		printf("%-22s %8.0f msg/s, latency avg %6Lu ns, max %8Lu ns\n",
+		       label, NMESSAGES * 1e9 / elapsed,
+		       rt_timer_ticks2ns(lat.total) / NMESSAGES,
+		       rt_timer_ticks2ns(lat.max));
+}
+
+int main(int argc, char *const argv[])
+{
+	int ret;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	ret = rt_queue_create(&q, "QUEUE", 64, Q_UNLIMITED, Q_SPSC);
+	traceobj_check(&trobj, ret, -EINVAL);
+
+	run_stream("write/read", Q_FIFO, 0);
+	run_stream("write/read, spsc", Q_SPSC, 0);
+	run_stream("send/receive", Q_FIFO, 1);
+	run_stream("send/receive, spsc", Q_SPSC, 1);
+
+	exit(0);
+}
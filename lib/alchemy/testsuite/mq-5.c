@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <copperplate/traceobj.h>
+#include <alchemy/task.h>
+#include <alchemy/queue.h>
+
+/*
+ * Post and receive series of messages to/from a queue in a single
+ * call, first with a reader waiting for input, then with messages
+ * already pending in regular and Q_SPSC queues.
+ */
+
+#define QLIMIT  4
+
+static struct traceobj trobj;
+
+static RT_QUEUE q;
+
+static RT_TASK t_reader;
+
+static void fill_iov(struct iovec *iov, int *msgs, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		iov[i].iov_base = &msgs[i];
+		iov[i].iov_len = sizeof(msgs[i]);
+	}
+}
+
+static void reader_task(void *arg)
+{
+	struct iovec iov[QLIMIT * 2];
+	int msgs[QLIMIT * 2], n;
+	ssize_t ret;
+
+	traceobj_enter(&trobj);
+
+	fill_iov(iov, msgs, QLIMIT * 2);
+	/* The first message is copied directly, the rest is drained. */
+	ret = rt_queue_read_multi(&q, iov, QLIMIT * 2, TM_INFINITE);
+	traceobj_assert(&trobj, ret == QLIMIT);
+	for (n = 0; n < QLIMIT; n++) {
+		traceobj_assert(&trobj, iov[n].iov_len == sizeof(int));
+		traceobj_assert(&trobj, msgs[n] == n);
+	}
+
+	traceobj_exit(&trobj);
+}
+
+static void check_pending(int mode)
+{
+	struct iovec iov[QLIMIT * 2];
+	int msgs[QLIMIT * 2], n;
+	char c;
+	int ret;
+
+	ret = rt_queue_create(&q, "QUEUE", QLIMIT * 64, QLIMIT, mode);
+	traceobj_check(&trobj, ret, 0);
+
+	for (n = 0; n < QLIMIT * 2; n++)
+		msgs[n] = n;
+
+	fill_iov(iov, msgs, QLIMIT * 2);
+	/* Only QLIMIT messages fit. */
+	ret = rt_queue_write_multi(&q, iov, QLIMIT * 2, Q_NORMAL);
+	traceobj_assert(&trobj, ret == QLIMIT);
+
+	ret = rt_queue_write_multi(&q, iov, 1, Q_NORMAL);
+	traceobj_check(&trobj, ret, -ENOMEM);
+
+	memset(msgs, 0, sizeof(msgs));
+	fill_iov(iov, msgs, QLIMIT * 2);
+	/* The last message is truncated to a single byte. */
+	iov[QLIMIT - 1].iov_base = &c;
+	iov[QLIMIT - 1].iov_len = 1;
+	ret = rt_queue_read_multi(&q, iov, QLIMIT * 2, TM_NONBLOCK);
+	traceobj_assert(&trobj, ret == QLIMIT);
+	for (n = 0; n < QLIMIT - 1; n++) {
+		traceobj_assert(&trobj, iov[n].iov_len == sizeof(int));
+		traceobj_assert(&trobj, msgs[n] == n);
+	}
+	traceobj_assert(&trobj, iov[QLIMIT - 1].iov_len == 1);
+
+	ret = rt_queue_read_multi(&q, iov, QLIMIT * 2, TM_NONBLOCK);
+	traceobj_check(&trobj, ret, -EWOULDBLOCK);
+
+	ret = rt_queue_delete(&q);
+	traceobj_check(&trobj, ret, 0);
+}
+
+static void main_task(void *arg)
+{
+	struct iovec iov[QLIMIT];
+	int msgs[QLIMIT], n;
+	int ret;
+
+	traceobj_enter(&trobj);
+
+	ret = rt_queue_create(&q, "QUEUE", QLIMIT * 64, QLIMIT, Q_FIFO);
+	traceobj_check(&trobj, ret, 0);
+
+	ret = rt_task_spawn(&t_reader, "reader", 0, 20, T_JOINABLE,
+			    reader_task, NULL);
+	traceobj_check(&trobj, ret, 0);
+
+	for (n = 0; n < QLIMIT; n++)
+		msgs[n] = n;
+
+	fill_iov(iov, msgs, QLIMIT);
+	ret = rt_queue_write_multi(&q, iov, QLIMIT, Q_NORMAL);
+	traceobj_assert(&trobj, ret == QLIMIT);
+
+	ret = rt_task_join(&t_reader);
+	traceobj_check(&trobj, ret, 0);
+
+	ret = rt_queue_delete(&q);
+	traceobj_check(&trobj, ret, 0);
+
+	check_pending(Q_FIFO);
+	check_pending(Q_SPSC);
+
+	traceobj_exit(&trobj);
+}
+
+int main(int argc, char *const argv[])
+{
+	RT_TASK t_main;
+	int ret;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	ret = rt_task_create(&t_main, "main_task", 0, 10, 0);
+	traceobj_check(&trobj, ret, 0);
+
+	ret = rt_task_start(&t_main, main_task, NULL);
+	traceobj_check(&trobj, ret, 0);
+
+	traceobj_join(&trobj);
+
+	exit(0);
+}
@@ -346,6 +346,103 @@ int a4l_mmap(a4l_desc_t * dsc,
 	return ret;
 }
 
+/**
+ * @brief Split the asynchronous ring-buffer into segments
+ *
+ * Once the buffer is segmented, drivers supporting it transfer whole
+ * segments in place (e.g. through scatter-gather DMA) and notify the
+ * application once per completed segment. The application accesses
+ * the segments in place through the mapping set up by a4l_mmap(),
+ * using a4l_wait_segments() instead of a4l_async_read() /
+ * a4l_async_write().
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in] size Segment size, which must be a multiple of the page
+ * size dividing the buffer size. Passing 0 switches back to the
+ * byte-oriented mode
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong (Please,
+ *    type "dmesg" for more info)
+ * - -EFAULT is returned if a user <-> kernel transfer went wrong
+ * - -EBUSY is returned if an asynchronous operation is in progress
+ *
+ */
+int a4l_set_segsize(a4l_desc_t * dsc, unsigned long size)
+{
+	a4l_segcfg_t cfg = { .seg_size = size };
+
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	return __sys_ioctl(dsc->fd, A4L_SEGCFG, &cfg);
+}
+
+/**
+ * @brief Release consumed segments and wait for ready ones
+ *
+ * For an input subdevice, ready segments hold acquired data; for an
+ * output subdevice, they are free segments the application may
+ * fill. The ready area returned is always contiguous within the
+ * mapping; it may end before the last ready segment when the ring
+ * wraps around, the remaining segments being reported by the next
+ * call.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in] idx_subd Index of the concerned subdevice
+ * @param[in] release Number of segments, among the ones previously
+ * reported ready, the application is done with
+ * @param[in] ms_timeout The number of miliseconds to wait for some
+ * segment to be ready. Passing A4L_INFINITE causes the caller to
+ * block indefinitely until some segment is ready. Passing
+ * A4L_NONBLOCK causes the function to return immediately
+ * @param[out] offset Offset of the first ready segment within the
+ * mapping
+ * @param[out] count Amount of bytes ready from this offset; 0 once a
+ * finite input acquisition is over
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong, or if
+ *    the buffer is not segmented (Please, type "dmesg" for more info)
+ * - -ENOENT is returned if the subdevice is idle
+ * - -EFAULT is returned if a user <-> kernel transfer went wrong
+ * - -EINTR is returned if calling task has been unblocked by a signal
+ * - -EPIPE is returned if the driver reported a transfer error
+ *
+ */
+int a4l_wait_segments(a4l_desc_t * dsc,
+		      unsigned int idx_subd, unsigned long release,
+		      unsigned long ms_timeout,
+		      unsigned long *offset, unsigned long *count)
+{
+	a4l_segwait_t wait = {
+		.idx_subd = idx_subd,
+		.release = release,
+		.timeout = ms_timeout,
+	};
+	int ret;
+
+	/* Basic checkings */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	if (offset == NULL || count == NULL)
+		return -EINVAL;
+
+	ret = __sys_ioctl(dsc->fd, A4L_SEGWAIT, &wait);
+	if (ret == 0) {
+		*offset = wait.offset;
+		*count = wait.count;
+	}
+
+	return ret;
+}
+
 /** @} Command syscall API */
 
 /**
@@ -16,8 +16,14 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
  */
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "boilerplate/atomic.h"
 #include "boilerplate/lock.h"
 #include "boilerplate/hash.h"
 #include "boilerplate/debug.h"
@@ -51,6 +57,9 @@ static inline int store_key(struct hashobj *obj,
 static inline void drop_key(struct hashobj *obj,
 			    const struct hash_operations *hops);
 
+static inline void *alloc_segment(size_t size,
+				  const struct hash_operations *hops);
+
 #define GOLDEN_HASH_RATIO  0x9e3779b9  /* Arbitrary value. */
 
 unsigned int __hash_key(const void *key, size_t length, unsigned int c)
@@ -91,6 +100,74 @@ unsigned int __hash_key(const void *key, size_t length, unsigned int c)
 	return c;
 }
 
+static unsigned int hash_seed(void *t)
+{
+	struct timespec now;
+	unsigned int v[3];
+
+	/*
+	 * Tables are seeded individually, so that a given set of keys
+	 * does not collide the same way in every table.
+	 */
+	__STD(clock_gettime(CLOCK_MONOTONIC, &now));
+	v[0] = (unsigned int)now.tv_nsec;
+	v[1] = (unsigned int)getpid();
+	v[2] = (unsigned int)(uintptr_t)t;
+
+	return __hash_key(v, sizeof(v), (unsigned int)now.tv_sec);
+}
+
+static void init_geometry(struct hash_geometry *geo, void *t)
+{
+	geo->seed = hash_seed(t);
+	geo->mask = HASHSLOTS - 1;
+	geo->split = 0;
+	geo->nobjs = 0;
+	geo->seq = 0;
+}
+
+static inline unsigned int hash_index(const struct hash_geometry *geo,
+				      unsigned int hash)
+{
+	unsigned int idx = hash & geo->mask;
+
+	/* Buckets below the split point use one more hash bit. */
+	if (idx < geo->split)
+		idx = hash & ((geo->mask << 1) | 1);
+
+	return idx;
+}
+
+static inline unsigned int hash_size(const struct hash_geometry *geo)
+{
+	return geo->mask + 1 + geo->split;
+}
+
+static inline bool hash_overloaded(const struct hash_geometry *geo)
+{
+	return geo->nobjs > hash_size(geo) * HASH_LOADFACTOR &&
+		hash_size(geo) < HASHSLOTS * HASH_MAXSEGS;
+}
+
+/*
+ * Updaters run under the table lock, bumping the sequence count
+ * around any change to the bucket lists or geometry, so that
+ * lockless readers may detect concurrent updates.
+ */
+static inline void write_seq_begin(struct hash_geometry *geo)
+{
+	geo->seq++;
+	smp_wmb();
+	compiler_barrier();
+}
+
+static inline void write_seq_end(struct hash_geometry *geo)
+{
+	compiler_barrier();
+	smp_wmb();
+	geo->seq++;
+}
+
 void __hash_init(void *heap, struct hash_table *t)
 {
 	pthread_mutexattr_t mattr;
@@ -99,6 +176,11 @@ void __hash_init(void *heap, struct hash_table *t)
 	for (n = 0; n < HASHSLOTS; n++)
 		__list_init(heap, &t->table[n].obj_list);
 
+	for (n = 0; n < HASH_MAXSEGS; n++)
+		t->segments[n] = 0;
+
+	init_geometry(&t->geo, t);
+
 	pthread_mutexattr_init(&mattr);
 	pthread_mutexattr_settype(&mattr, mutex_type_attribute);
 	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
@@ -107,16 +189,81 @@ void __hash_init(void *heap, struct hash_table *t)
 	pthread_mutexattr_destroy(&mattr);
 }
 
-void hash_destroy(struct hash_table *t)
+static inline struct hash_bucket *get_bucket(struct hash_table *t,
+					     unsigned int idx)
 {
-	__RT(pthread_mutex_destroy(&t->lock));
+	unsigned int seg = idx >> HASH_SEGSHIFT;
+	struct hash_bucket *base;
+
+	base = seg ? __mptr(t->segments[seg]) : t->table;
+
+	return base + (idx & (HASHSLOTS - 1));
 }
 
-static struct hash_bucket *do_hash(struct hash_table *t,
+static inline struct hash_bucket *do_hash(struct hash_table *t,
+					  unsigned int hash)
+{
+	return get_bucket(t, hash_index(&t->geo, hash));
+}
+
+static inline unsigned int hash_of(struct hash_table *t,
 				   const void *key, size_t len)
 {
-	unsigned int hash = __hash_key(key, len, 0);
-	return &t->table[hash & (HASHSLOTS-1)];
+	return __hash_key(key, len, t->geo.seed);
+}
+
+static void grow_table(struct hash_table *t,
+		       const struct hash_operations *hops)
+{
+	struct hash_geometry *geo = &t->geo;
+	struct hash_bucket *src, *dst, *seg;
+	unsigned int newidx, newmask, n;
+	struct hashobj *obj, *tmp;
+
+	if (!hash_overloaded(geo))
+		return;
+
+	newidx = hash_size(geo);
+	if ((newidx & (HASHSLOTS - 1)) == 0 &&
+	    t->segments[newidx >> HASH_SEGSHIFT] == 0) {
+		/*
+		 * Out of buckets, populate the next segment. If this
+		 * fails, we just keep on with longer chains.
+		 */
+		seg = alloc_segment(sizeof(*seg) * HASHSLOTS, hops);
+		if (seg == NULL)
+			return;
+		for (n = 0; n < HASHSLOTS; n++)
+			list_init(&seg[n].obj_list);
+		t->segments[newidx >> HASH_SEGSHIFT] = __moff(seg);
+	}
+
+	/*
+	 * Split the bucket under the split point, moving the objects
+	 * which hash to the upper half of the next round to the new
+	 * bucket.
+	 */
+	src = get_bucket(t, geo->split);
+	dst = get_bucket(t, newidx);
+	newmask = (geo->mask << 1) | 1;
+
+	write_seq_begin(geo);
+
+	if (!list_empty(&src->obj_list)) {
+		list_for_each_entry_safe(obj, tmp, &src->obj_list, link) {
+			if ((obj->hash & newmask) != geo->split) {
+				list_remove(&obj->link);
+				list_append(&obj->link, &dst->obj_list);
+			}
+		}
+	}
+
+	if (++geo->split > geo->mask) {
+		geo->mask = newmask;
+		geo->split = 0;
+	}
+
+	write_seq_end(geo);
 }
 
 int __hash_enter(struct hash_table *t,
@@ -134,12 +281,15 @@ int __hash_enter(struct hash_table *t,
 	if (ret)
 		return ret;
 
-	bucket = do_hash(t, key, len);
+	newobj->hash = hash_of(t, key, len);
 	write_lock_nocancel(&t->lock);
 
+	bucket = do_hash(t, newobj->hash);
+
 	if (nodup && !list_empty(&bucket->obj_list)) {
 		list_for_each_entry(obj, &bucket->obj_list, link) {
-			if (obj->len != newobj->len)
+			if (obj->hash != newobj->hash ||
+			    obj->len != newobj->len)
 				continue;
 			if (hops->compare(__mptr(obj->key), __mptr(newobj->key),
 					  obj->len) == 0) {
@@ -150,7 +300,12 @@ int __hash_enter(struct hash_table *t,
 		}
 	}
 
+	write_seq_begin(&t->geo);
 	list_append(&newobj->link, &bucket->obj_list);
+	t->geo.nobjs++;
+	write_seq_end(&t->geo);
+
+	grow_table(t, hops);
 out:
 	write_unlock(&t->lock);
 
@@ -164,14 +319,17 @@ int hash_remove(struct hash_table *t, struct hashobj *delobj,
 	struct hashobj *obj;
 	int ret = -ESRCH;
 
-	bucket = do_hash(t, __mptr(delobj->key), delobj->len);
-
 	write_lock_nocancel(&t->lock);
 
+	bucket = do_hash(t, delobj->hash);
+
 	if (!list_empty(&bucket->obj_list)) {
 		list_for_each_entry(obj, &bucket->obj_list, link) {
 			if (obj == delobj) {
+				write_seq_begin(&t->geo);
 				list_remove_init(&obj->link);
+				t->geo.nobjs--;
+				write_seq_end(&t->geo);
 				drop_key(obj, hops);
 				ret = 0;
 				goto out;
@@ -184,19 +342,21 @@ out:
 	return __bt(ret);
 }
 
-struct hashobj *hash_search(struct hash_table *t, const void *key,
-			    size_t len, const struct hash_operations *hops)
+static struct hashobj *search_locked(struct hash_table *t,
+				     const void *key, size_t len,
+				     unsigned int hash,
+				     const struct hash_operations *hops)
 {
 	struct hash_bucket *bucket;
 	struct hashobj *obj;
 
-	bucket = do_hash(t, key, len);
-
 	read_lock_nocancel(&t->lock);
 
+	bucket = do_hash(t, hash);
+
 	if (!list_empty(&bucket->obj_list)) {
 		list_for_each_entry(obj, &bucket->obj_list, link) {
-			if (obj->len != len)
+			if (obj->hash != hash || obj->len != len)
 				continue;
 			if (hops->compare(__mptr(obj->key), key, len) == 0)
 				goto out;
@@ -213,12 +373,13 @@ int hash_walk(struct hash_table *t, hash_walk_op walk, void *arg)
 {
 	struct hash_bucket *bucket;
 	struct hashobj *obj, *tmp;
-	int ret, n;
+	unsigned int n;
+	int ret;
 
 	read_lock_nocancel(&t->lock);
 
-	for (n = 0; n < HASHSLOTS; n++) {
-		bucket = &t->table[n];
+	for (n = 0; n < hash_size(&t->geo); n++) {
+		bucket = get_bucket(t, n);
 		if (list_empty(&bucket->obj_list))
 			continue;
 		list_for_each_entry_safe(obj, tmp, &bucket->obj_list, link) {
@@ -237,6 +398,18 @@ int hash_walk(struct hash_table *t, hash_walk_op walk, void *arg)
 
 #ifdef CONFIG_XENO_PSHARED
 
+static inline void *alloc_segment(size_t size,
+				  const struct hash_operations *hops)
+{
+	return hops->alloc(size);
+}
+
+static inline void free_segment(void *seg,
+				const struct hash_operations *hops)
+{
+	hops->free(seg);
+}
+
 static inline int store_key(struct hashobj *obj,
 			    const void *key, size_t len,
 			    const struct hash_operations *hops)
@@ -269,6 +442,76 @@ static inline void drop_key(struct hashobj *obj,
 		hops->free((void *)key);
 }
 
+static inline unsigned int read_seq_begin(const struct hash_geometry *geo)
+{
+	unsigned int seq = ACCESS_ONCE(geo->seq);
+
+	smp_rmb();
+	compiler_barrier();
+
+	return seq;
+}
+
+static inline bool read_seq_retry(const struct hash_geometry *geo,
+				  unsigned int seq)
+{
+	smp_rmb();
+	compiler_barrier();
+
+	return (seq & 1) || ACCESS_ONCE(geo->seq) != seq;
+}
+
+#define HASH_READ_RETRIES  4
+
+/*
+ * Shared tables live in the session heap, which remains mapped for
+ * the lifetime of the process, so we may search them locklessly:
+ * any data we read is validated against the update sequence before
+ * being used as a reference to follow, so that we never chase a
+ * pointer picked from an object which has been unlinked meanwhile.
+ * Readers which keep racing with updaters eventually fall back to
+ * locking the table.
+ */
+struct hashobj *hash_search(struct hash_table *t, const void *key,
+			    size_t len, const struct hash_operations *hops)
+{
+	unsigned int hash = hash_of(t, key, len), seq;
+	struct hash_bucket *bucket;
+	struct holder *head, *pos;
+	struct hashobj *obj;
+	const void *okey;
+	int retries;
+
+	for (retries = 0; retries < HASH_READ_RETRIES; retries++) {
+		seq = read_seq_begin(&t->geo);
+		bucket = do_hash(t, hash);
+		if (read_seq_retry(&t->geo, seq))
+			continue;
+		head = &bucket->obj_list.head;
+		pos = __mptr(head->next);
+		for (;;) {
+			if (read_seq_retry(&t->geo, seq))
+				goto retry;
+			if (pos == head)
+				return NULL;
+			obj = container_of(pos, struct hashobj, link);
+			okey = __mptr(obj->key);
+			if (obj->hash == hash && obj->len == len &&
+			    !read_seq_retry(&t->geo, seq) &&
+			    hops->compare(okey, key, len) == 0) {
+				if (read_seq_retry(&t->geo, seq))
+					goto retry;
+				return obj;
+			}
+			pos = __mptr(pos->next);
+		}
+	retry:
+		cpu_relax();
+	}
+
+	return search_locked(t, key, len, hash, hops);
+}
+
 int __hash_enter_probe(struct hash_table *t,
 		       const void *key, size_t len,
 		       struct hashobj *newobj,
@@ -285,13 +528,16 @@ int __hash_enter_probe(struct hash_table *t,
 	if (ret)
 		return ret;
 
-	bucket = do_hash(t, key, len);
+	newobj->hash = hash_of(t, key, len);
 	CANCEL_DEFER(svc);
 	write_lock(&t->lock);
 
+	bucket = do_hash(t, newobj->hash);
+
 	if (!list_empty(&bucket->obj_list)) {
 		list_for_each_entry_safe(obj, tmp, &bucket->obj_list, link) {
-			if (obj->len != newobj->len)
+			if (obj->hash != newobj->hash ||
+			    obj->len != newobj->len)
 				continue;
 			if (hops->compare(__mptr(obj->key),
 					  __mptr(newobj->key), obj->len) == 0) {
@@ -303,13 +549,21 @@ int __hash_enter_probe(struct hash_table *t,
 					}
 					continue;
 				}
+				write_seq_begin(&t->geo);
 				list_remove_init(&obj->link);
+				t->geo.nobjs--;
+				write_seq_end(&t->geo);
 				drop_key(obj, hops);
 			}
 		}
 	}
 
+	write_seq_begin(&t->geo);
 	list_append(&newobj->link, &bucket->obj_list);
+	t->geo.nobjs++;
+	write_seq_end(&t->geo);
+
+	grow_table(t, hops);
 out:
 	write_unlock(&t->lock);
 	CANCEL_RESTORE(svc);
@@ -321,22 +575,26 @@ struct hashobj *hash_search_probe(struct hash_table *t,
 				  const void *key, size_t len,
 				  const struct hash_operations *hops)
 {
+	unsigned int hash = hash_of(t, key, len);
 	struct hash_bucket *bucket;
 	struct hashobj *obj, *tmp;
 	struct service svc;
 
-	bucket = do_hash(t, key, len);
-
 	CANCEL_DEFER(svc);
 	write_lock(&t->lock);
 
+	bucket = do_hash(t, hash);
+
 	if (!list_empty(&bucket->obj_list)) {
 		list_for_each_entry_safe(obj, tmp, &bucket->obj_list, link) {
-			if (obj->len != len)
+			if (obj->hash != hash || obj->len != len)
 				continue;
 			if (hops->compare(__mptr(obj->key), key, len) == 0) {
 				if (!hops->probe(obj)) {
+					write_seq_begin(&t->geo);
 					list_remove_init(&obj->link);
+					t->geo.nobjs--;
+					write_seq_end(&t->geo);
 					drop_key(obj, hops);
 					continue;
 				}
@@ -360,6 +618,11 @@ void pvhash_init(struct pvhash_table *t)
 	for (n = 0; n < HASHSLOTS; n++)
 		pvlist_init(&t->table[n].obj_list);
 
+	for (n = 0; n < HASH_MAXSEGS; n++)
+		t->segments[n] = NULL;
+
+	init_geometry(&t->geo, t);
+
 	pthread_mutexattr_init(&mattr);
 	pthread_mutexattr_settype(&mattr, mutex_type_attribute);
 	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
@@ -368,11 +631,73 @@ void pvhash_init(struct pvhash_table *t)
 	pthread_mutexattr_destroy(&mattr);
 }
 
-static struct pvhash_bucket *do_pvhash(struct pvhash_table *t,
-				       const void *key, size_t len)
+void pvhash_destroy(struct pvhash_table *t)
+{
+	int n;
+
+	for (n = 1; n < HASH_MAXSEGS; n++) {
+		if (t->segments[n])
+			free(t->segments[n]);
+	}
+
+	__RT(pthread_mutex_destroy(&t->lock));
+}
+
+static inline struct pvhash_bucket *get_pvbucket(struct pvhash_table *t,
+						 unsigned int idx)
 {
-	unsigned int hash = __hash_key(key, len, 0);
-	return &t->table[hash & (HASHSLOTS-1)];
+	unsigned int seg = idx >> HASH_SEGSHIFT;
+	struct pvhash_bucket *base;
+
+	base = seg ? t->segments[seg] : t->table;
+
+	return base + (idx & (HASHSLOTS - 1));
+}
+
+static inline struct pvhash_bucket *do_pvhash(struct pvhash_table *t,
+					      unsigned int hash)
+{
+	return get_pvbucket(t, hash_index(&t->geo, hash));
+}
+
+static void grow_pvtable(struct pvhash_table *t)
+{
+	struct hash_geometry *geo = &t->geo;
+	struct pvhash_bucket *src, *dst, *seg;
+	unsigned int newidx, newmask, n;
+	struct pvhashobj *obj, *tmp;
+
+	if (!hash_overloaded(geo))
+		return;
+
+	newidx = hash_size(geo);
+	if ((newidx & (HASHSLOTS - 1)) == 0 &&
+	    t->segments[newidx >> HASH_SEGSHIFT] == NULL) {
+		seg = malloc(sizeof(*seg) * HASHSLOTS);
+		if (seg == NULL)
+			return;
+		for (n = 0; n < HASHSLOTS; n++)
+			pvlist_init(&seg[n].obj_list);
+		t->segments[newidx >> HASH_SEGSHIFT] = seg;
+	}
+
+	src = get_pvbucket(t, geo->split);
+	dst = get_pvbucket(t, newidx);
+	newmask = (geo->mask << 1) | 1;
+
+	if (!pvlist_empty(&src->obj_list)) {
+		pvlist_for_each_entry_safe(obj, tmp, &src->obj_list, link) {
+			if ((obj->hash & newmask) != geo->split) {
+				pvlist_remove(&obj->link);
+				pvlist_append(&obj->link, &dst->obj_list);
+			}
+		}
+	}
+
+	if (++geo->split > geo->mask) {
+		geo->mask = newmask;
+		geo->split = 0;
+	}
 }
 
 int __pvhash_enter(struct pvhash_table *t,
@@ -388,13 +713,16 @@ int __pvhash_enter(struct pvhash_table *t,
 	pvholder_init(&newobj->link);
 	newobj->key = key;
 	newobj->len = len;
-	bucket = do_pvhash(t, key, len);
+	newobj->hash = __hash_key(key, len, t->geo.seed);
 
 	write_lock_nocancel(&t->lock);
 
+	bucket = do_pvhash(t, newobj->hash);
+
 	if (nodup && !pvlist_empty(&bucket->obj_list)) {
 		pvlist_for_each_entry(obj, &bucket->obj_list, link) {
-			if (obj->len != newobj->len)
+			if (obj->hash != newobj->hash ||
+			    obj->len != newobj->len)
 				continue;
 			if (hops->compare(obj->key, newobj->key, len) == 0) {
 				ret = -EEXIST;
@@ -404,6 +732,8 @@ int __pvhash_enter(struct pvhash_table *t,
 	}
 
 	pvlist_append(&newobj->link, &bucket->obj_list);
+	t->geo.nobjs++;
+	grow_pvtable(t);
 out:
 	write_unlock(&t->lock);
 
@@ -417,14 +747,15 @@ int pvhash_remove(struct pvhash_table *t, struct pvhashobj *delobj,
 	struct pvhashobj *obj;
 	int ret = -ESRCH;
 
-	bucket = do_pvhash(t, delobj->key, delobj->len);
-
 	write_lock_nocancel(&t->lock);
 
+	bucket = do_pvhash(t, delobj->hash);
+
 	if (!pvlist_empty(&bucket->obj_list)) {
 		pvlist_for_each_entry(obj, &bucket->obj_list, link) {
 			if (obj == delobj) {
 				pvlist_remove_init(&obj->link);
+				t->geo.nobjs--;
 				ret = 0;
 				goto out;
 			}
@@ -440,16 +771,17 @@ struct pvhashobj *pvhash_search(struct pvhash_table *t,
 				const void *key, size_t len,
 				const struct pvhash_operations *hops)
 {
+	unsigned int hash = __hash_key(key, len, t->geo.seed);
 	struct pvhash_bucket *bucket;
 	struct pvhashobj *obj;
 
-	bucket = do_pvhash(t, key, len);
-
 	read_lock_nocancel(&t->lock);
 
+	bucket = do_pvhash(t, hash);
+
 	if (!pvlist_empty(&bucket->obj_list)) {
 		pvlist_for_each_entry(obj, &bucket->obj_list, link) {
-			if (obj->len != len)
+			if (obj->hash != hash || obj->len != len)
 				continue;
 			if (hops->compare(obj->key, key, len) == 0)
 				goto out;
@@ -466,12 +798,13 @@ int pvhash_walk(struct pvhash_table *t,	pvhash_walk_op walk, void *arg)
 {
 	struct pvhash_bucket *bucket;
 	struct pvhashobj *obj, *tmp;
-	int ret, n;
+	unsigned int n;
+	int ret;
 
 	read_lock_nocancel(&t->lock);
 
-	for (n = 0; n < HASHSLOTS; n++) {
-		bucket = &t->table[n];
+	for (n = 0; n < hash_size(&t->geo); n++) {
+		bucket = get_pvbucket(t, n);
 		if (pvlist_empty(&bucket->obj_list))
 			continue;
 		pvlist_for_each_entry_safe(obj, tmp, &bucket->obj_list, link) {
@@ -490,6 +823,18 @@ int pvhash_walk(struct pvhash_table *t,	pvhash_walk_op walk, void *arg)
 
 #else /* !CONFIG_XENO_PSHARED */
 
+static inline void *alloc_segment(size_t size,
+				  const struct hash_operations *hops)
+{
+	return malloc(size);
+}
+
+static inline void free_segment(void *seg,
+				const struct hash_operations *hops)
+{
+	free(seg);
+}
+
 static inline int store_key(struct hashobj *obj,
 			    const void *key, size_t len,
 			    const struct hash_operations *hops)
@@ -504,4 +849,23 @@ static inline void drop_key(struct hashobj *obj,
 			    const struct hash_operations *hops)
 { }
 
+struct hashobj *hash_search(struct hash_table *t, const void *key,
+			    size_t len, const struct hash_operations *hops)
+{
+	return search_locked(t, key, len, hash_of(t, key, len), hops);
+}
+
 #endif /* !CONFIG_XENO_PSHARED */
+
+void hash_destroy(struct hash_table *t,
+		  const struct hash_operations *hops)
+{
+	int n;
+
+	for (n = 1; n < HASH_MAXSEGS; n++) {
+		if (t->segments[n])
+			free_segment(__mptr(t->segments[n]), hops);
+	}
+
+	__RT(pthread_mutex_destroy(&t->lock));
+}
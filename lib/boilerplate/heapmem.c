@@ -420,11 +420,107 @@ found:
 	return pagenr_to_addr(ext, pg);
 }
 
-void *heapmem_alloc(struct heap_memory *heap, size_t size)
+static void *alloc_bucket_block(struct heap_memory *heap,
+				int log2size, size_t bsize)
 {
 	struct heapmem_extent *ext;
-	int log2size, ilog, pg, b;
+	int ilog, pg, b;
 	uint32_t bmask;
+	void *block;
+
+	ilog = log2size - HEAPMEM_MIN_LOG2;
+	assert(ilog >= 0 && ilog < HEAPMEM_MAX);
+
+	pvlist_for_each_entry(ext, &heap->extents, next) {
+		pg = heap->buckets[ilog];
+		if (pg < 0) /* Empty page list? */
+			continue;
+
+		/*
+		 * Find a block in the heading page. If there is none,
+		 * there won't be any down the list: add a new page
+		 * right away.
+		 */
+		bmask = ext->pagemap[pg].map;
+		if (bmask == -1U)
+			break;
+		b = xenomai_count_trailing_zeros(~bmask);
+
+		/*
+		 * Got one block from the heading per-bucket page, tag
+		 * it as busy in the per-page allocation map.
+		 */
+		ext->pagemap[pg].map |= (1U << b);
+		heap->used_size += bsize;
+		block = ext->membase +
+			(pg << HEAPMEM_PAGE_SHIFT) +
+			(b << log2size);
+		if (ext->pagemap[pg].map == -1U)
+			move_page_back(heap, ext, pg, log2size);
+
+		return block;
+	}
+
+	/* No free block in bucketed memory, add one page. */
+	return add_free_range(heap, bsize, log2size);
+}
+
+static inline struct heapmem_magazine *
+get_magazine(struct heap_memory *heap)
+{
+	uintptr_t h = (uintptr_t)pthread_self();
+
+	/*
+	 * pthread_t values are descriptor addresses which usually
+	 * differ by large power-of-2 strides, scramble them a bit.
+	 */
+	h ^= h >> 7;
+	h ^= h >> 15;
+	h ^= h >> 23;
+
+	return heap->magazines + (h & (HEAPMEM_MAG_STRIPES - 1));
+}
+
+static void *alloc_cached_block(struct heap_memory *heap,
+				int log2size, size_t bsize)
+{
+	int ilog = log2size - HEAPMEM_MIN_LOG2, n;
+	struct heapmem_magazine *mag;
+	void *block;
+
+	mag = get_magazine(heap);
+	write_lock_nocancel(&mag->lock);
+
+	if (mag->count[ilog] == 0) {
+		/*
+		 * Refill half of the magazine in a single pass over
+		 * the heap lock, so that the next frees may be
+		 * absorbed without draining.
+		 */
+		write_lock_nocancel(&heap->lock);
+		for (n = 0; n < HEAPMEM_MAG_BATCH; n++) {
+			block = alloc_bucket_block(heap, log2size, bsize);
+			if (block == NULL)
+				break;
+			mag->blocks[ilog][n] = block;
+		}
+		write_unlock(&heap->lock);
+		mag->count[ilog] = n;
+		if (n == 0) {
+			write_unlock(&mag->lock);
+			return NULL;
+		}
+	}
+
+	block = mag->blocks[ilog][--mag->count[ilog]];
+	write_unlock(&mag->lock);
+
+	return block;
+}
+
+void *heapmem_alloc(struct heap_memory *heap, size_t size)
+{
+	int log2size;
 	size_t bsize;
 	void *block;
 
@@ -448,7 +544,8 @@ void *heapmem_alloc(struct heap_memory *heap, size_t size)
 	/*
 	 * Allocate entire pages directly from the pool whenever the
 	 * block is larger or equal to HEAPMEM_PAGE_SIZE.  Otherwise,
-	 * use bucketed memory.
+	 * use bucketed memory, going through the magazine layer if
+	 * enabled.
 	 *
 	 * NOTE: Fully busy pages from bucketed memory are moved back
 	 * at the end of the per-bucket page list, so that we may
@@ -458,64 +555,29 @@ void *heapmem_alloc(struct heap_memory *heap, size_t size)
 	 * page.
 	 */
 	if (bsize < HEAPMEM_PAGE_SIZE) {
-		ilog = log2size - HEAPMEM_MIN_LOG2;
-		assert(ilog >= 0 && ilog < HEAPMEM_MAX);
-
+		if (heap->magazines)
+			return alloc_cached_block(heap, log2size, bsize);
 		write_lock_nocancel(&heap->lock);
-
-		pvlist_for_each_entry(ext, &heap->extents, next) {
-			pg = heap->buckets[ilog];
-			if (pg < 0) /* Empty page list? */
-				continue;
-
-			/*
-			 * Find a block in the heading page. If there
-			 * is none, there won't be any down the list:
-			 * add a new page right away.
-			 */
-			bmask = ext->pagemap[pg].map;
-			if (bmask == -1U)
-				break;
-			b = xenomai_count_trailing_zeros(~bmask);
-
-			/*
-			 * Got one block from the heading per-bucket
-			 * page, tag it as busy in the per-page
-			 * allocation map.
-			 */
-			ext->pagemap[pg].map |= (1U << b);
-			heap->used_size += bsize;
-			block = ext->membase +
-				(pg << HEAPMEM_PAGE_SHIFT) +
-				(b << log2size);
-			if (ext->pagemap[pg].map == -1U)
-				move_page_back(heap, ext, pg, log2size);
-			goto out;
-		}
-
-		/* No free block in bucketed memory, add one page. */
-		block = add_free_range(heap, bsize, log2size);
+		block = alloc_bucket_block(heap, log2size, bsize);
 	} else {
 		write_lock_nocancel(&heap->lock);
 		/* Add a range of contiguous free pages. */
 		block = add_free_range(heap, bsize, 0);
 	}
-out:
+
 	write_unlock(&heap->lock);
 
 	return block;
 }
 
-int heapmem_free(struct heap_memory *heap, void *block)
+static int free_block(struct heap_memory *heap, void *block)
 {
-	int log2size, ret = 0, pg, n;
+	int log2size, pg, n;
 	struct heapmem_extent *ext;
 	memoff_t pgoff, boff;
 	uint32_t oldmap;
 	size_t bsize;
 
-	write_lock_nocancel(&heap->lock);
-
 	/*
 	 * Find the extent from which the returned block is
 	 * originating from.
@@ -525,13 +587,13 @@ int heapmem_free(struct heap_memory *heap, void *block)
 			goto found;
 	}
 
-	goto bad;
+	return -EINVAL;
 found:
 	/* Compute the heading page number in the page map. */
 	pgoff = block - ext->membase;
 	pg = pgoff >> HEAPMEM_PAGE_SHIFT;
 	if (!page_is_valid(ext, pg))
-		goto bad;
+		return -EINVAL;
 	
 	switch (ext->pagemap[pg].type) {
 	case page_list:
@@ -546,7 +608,7 @@ found:
 		assert(bsize < HEAPMEM_PAGE_SIZE);
 		boff = pgoff & ~HEAPMEM_PAGE_MASK;
 		if ((boff & (bsize - 1)) != 0) /* Not at block start? */
-			goto bad;
+			return -EINVAL;
 
 		n = boff >> log2size; /* Block position in page. */
 		oldmap = ext->pagemap[pg].map;
@@ -568,13 +630,86 @@ found:
 	}
 
 	heap->used_size -= bsize;
-out:
+
+	return 0;
+}
+
+static int get_cached_log2size(struct heap_memory *heap, void *block)
+{
+	struct heapmem_extent *ext;
+	memoff_t pgoff;
+	int log2size;
+
+	/*
+	 * We may walk the extent list locklessly: it only grows, and
+	 * the block being released was allocated from an extent we
+	 * can already see. Likewise, the page type cannot change
+	 * while some block it contains is busy.
+	 */
+	pvlist_for_each_entry(ext, &heap->extents, next) {
+		if (block >= ext->membase && block < ext->memlim)
+			goto found;
+	}
+
+	return -1;
+found:
+	pgoff = block - ext->membase;
+	if (!page_is_valid(ext, pgoff >> HEAPMEM_PAGE_SHIFT))
+		return -1;
+
+	log2size = ext->pagemap[pgoff >> HEAPMEM_PAGE_SHIFT].type;
+	if (log2size < HEAPMEM_MIN_LOG2 || log2size >= HEAPMEM_PAGE_SHIFT)
+		return 0; /* Page range, not cached. */
+
+	if ((pgoff & ~HEAPMEM_PAGE_MASK) & ((1 << log2size) - 1))
+		return -1;
+
+	return log2size;
+}
+
+static void drain_magazine(struct heap_memory *heap,
+			   struct heapmem_magazine *mag, int ilog, int nr)
+{
+	int n = mag->count[ilog];
+
+	write_lock_nocancel(&heap->lock);
+
+	while (nr-- > 0 && n > 0)
+		free_block(heap, mag->blocks[ilog][--n]);
+
+	write_unlock(&heap->lock);
+
+	mag->count[ilog] = n;
+}
+
+int heapmem_free(struct heap_memory *heap, void *block)
+{
+	struct heapmem_magazine *mag;
+	int ret, log2size, ilog;
+
+	if (heap->magazines) {
+		log2size = get_cached_log2size(heap, block);
+		if (log2size < 0)
+			return __bt(-EINVAL);
+		if (log2size > 0) {
+			ilog = log2size - HEAPMEM_MIN_LOG2;
+			mag = get_magazine(heap);
+			write_lock_nocancel(&mag->lock);
+			/* Full magazine: spill half of it in one go. */
+			if (mag->count[ilog] == HEAPMEM_MAG_DEPTH)
+				drain_magazine(heap, mag, ilog,
+					       HEAPMEM_MAG_BATCH);
+			mag->blocks[ilog][mag->count[ilog]++] = block;
+			write_unlock(&mag->lock);
+			return 0;
+		}
+	}
+
+	write_lock_nocancel(&heap->lock);
+	ret = free_block(heap, block);
 	write_unlock(&heap->lock);
 
 	return __bt(ret);
-bad:
-	ret = -EINVAL;
-	goto out;
 }
 
 static inline int compare_range_by_size(const struct avlh *l, const struct avlh *r)
@@ -693,6 +828,7 @@ int heapmem_init(struct heap_memory *heap, void *mem, size_t size)
 	heap->used_size = 0;
 	heap->usable_size = 0;
 	heap->arena_size = 0;
+	heap->magazines = NULL;
 	pvlist_init(&heap->extents);
 
 	pthread_mutexattr_init(&mattr);
@@ -722,7 +858,69 @@ int heapmem_extend(struct heap_memory *heap, void *mem, size_t size)
 	return add_extent(heap, mem, size);
 }
 
+int heapmem_enable_magazines(struct heap_memory *heap)
+{
+	struct heapmem_magazine *mags;
+	pthread_mutexattr_t mattr;
+	int ret = 0, n;
+
+	if (heap->magazines)
+		return 0;
+
+	mags = malloc(sizeof(*mags) * HEAPMEM_MAG_STRIPES);
+	if (mags == NULL)
+		return -ENOMEM;
+
+	pthread_mutexattr_init(&mattr);
+	pthread_mutexattr_settype(&mattr, mutex_type_attribute);
+	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+	pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_PRIVATE);
+
+	for (n = 0; n < HEAPMEM_MAG_STRIPES; n++) {
+		memset(mags[n].count, 0, sizeof(mags[n].count));
+		ret = __bt(-__RT(pthread_mutex_init(&mags[n].lock, &mattr)));
+		if (ret) {
+			while (--n >= 0)
+				__RT(pthread_mutex_destroy(&mags[n].lock));
+			free(mags);
+			goto out;
+		}
+	}
+
+	heap->magazines = mags;
+out:
+	pthread_mutexattr_destroy(&mattr);
+
+	return ret;
+}
+
+void heapmem_flush_magazines(struct heap_memory *heap)
+{
+	struct heapmem_magazine *mag;
+	int n, ilog;
+
+	if (heap->magazines == NULL)
+		return;
+
+	for (n = 0; n < HEAPMEM_MAG_STRIPES; n++) {
+		mag = heap->magazines + n;
+		write_lock_nocancel(&mag->lock);
+		for (ilog = 0; ilog < HEAPMEM_MAX; ilog++)
+			drain_magazine(heap, mag, ilog, HEAPMEM_MAG_DEPTH);
+		write_unlock(&mag->lock);
+	}
+}
+
 void heapmem_destroy(struct heap_memory *heap)
 {
+	int n;
+
+	if (heap->magazines) {
+		for (n = 0; n < HEAPMEM_MAG_STRIPES; n++)
+			__RT(pthread_mutex_destroy(&heap->magazines[n].lock));
+		free(heap->magazines);
+		heap->magazines = NULL;
+	}
+
 	__RT(pthread_mutex_destroy(&heap->lock));
 }
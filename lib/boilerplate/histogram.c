@@ -0,0 +1,277 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <boilerplate/histogram.h>
+
+/*
+ * Bucket layout for magnitudes: [0, 2^s) maps 1:1 to the first 2^s
+ * buckets, then each power of two [2^(s+g-1), 2^(s+g)), g >= 1, is
+ * split into 2^(s-1) buckets of width 2^g.
+ */
+static inline int get_index(int sigbits, uint64_t v)
+{
+	int msb, g;
+
+	if (v < (1ULL << sigbits))
+		return (int)v;
+
+	msb = 63 - __builtin_clzll(v);
+	g = msb - sigbits + 1;
+
+	return (1 << sigbits) + (g - 1) * (1 << (sigbits - 1)) +
+		(int)((v >> g) - (1ULL << (sigbits - 1)));
+}
+
+static inline uint64_t get_lowest(int sigbits, int index)
+{
+	int half = 1 << (sigbits - 1), g;
+
+	if (index < (1 << sigbits))
+		return index;
+
+	index -= 1 << sigbits;
+	g = index / half + 1;
+
+	return (uint64_t)(half + index % half) << g;
+}
+
+static inline uint64_t get_highest(int sigbits, int index)
+{
+	int half = 1 << (sigbits - 1), g;
+
+	if (index < (1 << sigbits))
+		return index;
+
+	g = (index - (1 << sigbits)) / half + 1;
+
+	return get_lowest(sigbits, index) + (1ULL << g) - 1;
+}
+
+int histogram_init(struct histogram *h, int64_t limit, int sigbits)
+{
+	if (limit <= 0 || sigbits < 2 || sigbits > 16)
+		return -EINVAL;
+
+	h->sigbits = sigbits;
+	h->limit = limit;
+	h->nbuckets = get_index(sigbits, limit) + 1;
+	h->counts = calloc(h->nbuckets * 2, sizeof(h->counts[0]));
+	if (h->counts == NULL)
+		return -ENOMEM;
+
+	histogram_reset(h);
+
+	return 0;
+}
+
+void histogram_destroy(struct histogram *h)
+{
+	free(h->counts);
+	h->counts = NULL;
+}
+
+void histogram_reset(struct histogram *h)
+{
+	memset(h->counts, 0, h->nbuckets * 2 * sizeof(h->counts[0]));
+	h->total = 0;
+	h->min = INT64_MAX;
+	h->max = INT64_MIN;
+	h->sum = 0;
+	h->sumsq = 0;
+}
+
+void histogram_add_count(struct histogram *h,
+			 int64_t value, uint64_t count)
+{
+	int64_t v = value;
+
+	if (count == 0)
+		return;
+
+	/* Out of range values go to the outermost buckets. */
+	if (v > h->limit)
+		v = h->limit;
+	else if (v < -h->limit)
+		v = -h->limit;
+
+	if (v >= 0)
+		h->counts[h->nbuckets + get_index(h->sigbits, v)] += count;
+	else
+		h->counts[h->nbuckets - 1 - get_index(h->sigbits, -v)] += count;
+
+	if (value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+
+	h->total += count;
+	h->sum += (double)value * count;
+	h->sumsq += (double)value * value * count;
+}
+
+int histogram_merge(struct histogram *dst,
+		    const struct histogram *src)
+{
+	int n;
+
+	if (dst->sigbits != src->sigbits || dst->limit != src->limit)
+		return -EINVAL;
+
+	if (src->total == 0)
+		return 0;
+
+	for (n = 0; n < dst->nbuckets * 2; n++)
+		dst->counts[n] += src->counts[n];
+
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+
+	dst->total += src->total;
+	dst->sum += src->sum;
+	dst->sumsq += src->sumsq;
+
+	return 0;
+}
+
+/* Highest value equivalent to the contents of bucket @n. */
+static int64_t bucket_value(const struct histogram *h, int n)
+{
+	if (n >= h->nbuckets)
+		return get_highest(h->sigbits, n - h->nbuckets);
+
+	return -(int64_t)get_lowest(h->sigbits, h->nbuckets - 1 - n);
+}
+
+int64_t histogram_percentile(const struct histogram *h, double percent)
+{
+	uint64_t target, sum = 0;
+	int64_t value;
+	double rank;
+	int n;
+
+	if (h->total == 0)
+		return 0;
+
+	rank = percent / 100.0 * h->total;
+	target = (uint64_t)rank;
+	if (target < rank || target == 0)
+		target++;
+	if (target > h->total)
+		target = h->total;
+
+	for (n = 0; n < h->nbuckets * 2; n++) {
+		sum += h->counts[n];
+		if (sum >= target)
+			break;
+	}
+
+	/* The outermost buckets also hold the out of range values. */
+	if (n == 0)
+		return h->min;
+	if (n == h->nbuckets * 2 - 1)
+		return h->max;
+
+	value = bucket_value(h, n);
+	if (value > h->max)
+		value = h->max;
+	if (value < h->min)
+		value = h->min;
+
+	return value;
+}
+
+double histogram_mean(const struct histogram *h)
+{
+	return h->total ? h->sum / h->total : 0;
+}
+
+/* Newton's method, so that we do not depend on libm. */
+static double square_root(double x)
+{
+	double r = x >= 1 ? x : 1, next;
+
+	if (x <= 0)
+		return 0;
+
+	for (;;) {
+		next = (r + x / r) / 2;
+		if (next >= r)
+			return r;
+		r = next;
+	}
+}
+
+double histogram_stddev(const struct histogram *h)
+{
+	double var;
+
+	if (h->total < 2)
+		return 0;
+
+	/* Unbiased form. */
+	var = (h->sumsq - h->sum * h->sum / h->total) / (h->total - 1);
+
+	return square_root(var);
+}
+
+/*
+ * Write the histogram as a JSON object. Only non-empty buckets are
+ * listed, as [lowest, highest, count] triplets, so that histograms
+ * collected with the same geometry on different machines can be
+ * merged by summing the counts of identical buckets.
+ */
+int histogram_dump_json(const struct histogram *h,
+			FILE *fp, const char *name)
+{
+	static const double pcts[] = { 50, 90, 99, 99.9, 99.99, 99.999 };
+	const char *sep = "";
+	int64_t lo, hi;
+	int n;
+
+	fprintf(fp, "{");
+	if (name)
+		fprintf(fp, "\"name\":\"%s\",", name);
+
+	fprintf(fp, "\"sigbits\":%d,\"limit\":%lld,\"total\":%llu,",
+		h->sigbits, (long long)h->limit,
+		(unsigned long long)h->total);
+
+	if (h->total > 0)
+		fprintf(fp, "\"min\":%lld,\"max\":%lld,",
+			(long long)h->min, (long long)h->max);
+
+	fprintf(fp, "\"mean\":%.3f,\"stddev\":%.3f,\"percentiles\":{",
+		histogram_mean(h), histogram_stddev(h));
+
+	for (n = 0; n < sizeof(pcts) / sizeof(pcts[0]); n++) {
+		fprintf(fp, "%s\"%g\":%lld", sep, pcts[n],
+			(long long)histogram_percentile(h, pcts[n]));
+		sep = ",";
+	}
+
+	fprintf(fp, "},\"buckets\":[");
+
+	for (n = 0, sep = ""; n < h->nbuckets * 2; n++) {
+		if (h->counts[n] == 0)
+			continue;
+		if (n >= h->nbuckets) {
+			lo = get_lowest(h->sigbits, n - h->nbuckets);
+			hi = get_highest(h->sigbits, n - h->nbuckets);
+		} else {
+			lo = -(int64_t)get_highest(h->sigbits, h->nbuckets - 1 - n);
+			hi = -(int64_t)get_lowest(h->sigbits, h->nbuckets - 1 - n);
+		}
+		fprintf(fp, "%s[%lld,%lld,%llu]", sep, (long long)lo,
+			(long long)hi, (unsigned long long)h->counts[n]);
+		sep = ",";
+	}
+
+	fprintf(fp, "]}");
+
+	return ferror(fp) ? -EIO : 0;
+}
@@ -162,6 +162,20 @@ struct cobalt_monitor_state *get_monitor_state(cobalt_monitor_t *mon)
 		cobalt_umm_private + mon->state_offset;
 }
 
+/*
+ * A signal pending on the monitor requires a syscall to be sent
+ * only if some thread waits for that particular kind of signal.
+ */
+static inline int monitor_must_sync(struct cobalt_monitor_state *state)
+{
+	unsigned int flags = state->flags;
+
+	return ((flags & COBALT_MONITOR_GRANTED) &&
+		(flags & COBALT_MONITOR_GRANTWAIT)) ||
+		((flags & COBALT_MONITOR_DRAINED) &&
+		 (flags & COBALT_MONITOR_DRAINWAIT));
+}
+
 int cobalt_monitor_init(cobalt_monitor_t *mon, clockid_t clk_id, int flags)
 {
 	struct cobalt_monitor_state *state;
@@ -204,7 +218,9 @@ int cobalt_monitor_enter(cobalt_monitor_t *mon)
 	cur = cobalt_get_current();
 	ret = xnsynch_fast_acquire(&state->owner, cur);
 	if (ret == 0) {
-		state->flags &= ~(COBALT_MONITOR_SIGNALED|COBALT_MONITOR_BROADCAST);
+		/* A timed out waiter may update the wait bits meanwhile. */
+		__sync_and_and_fetch(&state->flags,
+				     ~(COBALT_MONITOR_SIGNALED|COBALT_MONITOR_BROADCAST));
 		return 0;
 	}
 syscall:
@@ -232,8 +248,7 @@ int cobalt_monitor_exit(cobalt_monitor_t *mon)
 	__sync_synchronize();
 
 	state = get_monitor_state(mon);
-	if ((state->flags & COBALT_MONITOR_PENDED) &&
-	    (state->flags & COBALT_MONITOR_SIGNALED))
+	if (monitor_must_sync(state))
 		goto syscall;
 
 	status = cobalt_get_current_mode();
@@ -283,7 +298,11 @@ void cobalt_monitor_grant(cobalt_monitor_t *mon,
 {
 	struct cobalt_monitor_state *state = get_monitor_state(mon);
 
-	state->flags |= COBALT_MONITOR_GRANTED;
+	/*
+	 * Atomic update: the kernel may clear the waiter bits
+	 * concurrently from a timed out waiter.
+	 */
+	__sync_or_and_fetch(&state->flags, COBALT_MONITOR_GRANTED);
 	u_window->grant_value = 1;
 }
 
@@ -295,7 +314,7 @@ int cobalt_monitor_grant_sync(cobalt_monitor_t *mon,
 
 	cobalt_monitor_grant(mon, u_window);
 
-	if ((state->flags & COBALT_MONITOR_PENDED) == 0)
+	if (!monitor_must_sync(state))
 		return 0;
 
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
@@ -314,7 +333,8 @@ void cobalt_monitor_grant_all(cobalt_monitor_t *mon)
 {
 	struct cobalt_monitor_state *state = get_monitor_state(mon);
 
-	state->flags |= COBALT_MONITOR_GRANTED|COBALT_MONITOR_BROADCAST;
+	__sync_or_and_fetch(&state->flags,
+			    COBALT_MONITOR_GRANTED|COBALT_MONITOR_BROADCAST);
 }
 
 int cobalt_monitor_grant_all_sync(cobalt_monitor_t *mon)
@@ -324,7 +344,7 @@ int cobalt_monitor_grant_all_sync(cobalt_monitor_t *mon)
 
 	cobalt_monitor_grant_all(mon);
 
-	if ((state->flags & COBALT_MONITOR_PENDED) == 0)
+	if (!monitor_must_sync(state))
 		return 0;
 
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
@@ -343,7 +363,7 @@ void cobalt_monitor_drain(cobalt_monitor_t *mon)
 {
 	struct cobalt_monitor_state *state = get_monitor_state(mon);
 
-	state->flags |= COBALT_MONITOR_DRAINED;
+	__sync_or_and_fetch(&state->flags, COBALT_MONITOR_DRAINED);
 }
 
 int cobalt_monitor_drain_sync(cobalt_monitor_t *mon)
@@ -353,7 +373,7 @@ int cobalt_monitor_drain_sync(cobalt_monitor_t *mon)
 
 	cobalt_monitor_drain(mon);
 
-	if ((state->flags & COBALT_MONITOR_PENDED) == 0)
+	if (!monitor_must_sync(state))
 		return 0;
 
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
@@ -372,7 +392,8 @@ void cobalt_monitor_drain_all(cobalt_monitor_t *mon)
 {
 	struct cobalt_monitor_state *state = get_monitor_state(mon);
 
-	state->flags |= COBALT_MONITOR_DRAINED|COBALT_MONITOR_BROADCAST;
+	__sync_or_and_fetch(&state->flags,
+			    COBALT_MONITOR_DRAINED|COBALT_MONITOR_BROADCAST);
 }
 
 int cobalt_monitor_drain_all_sync(cobalt_monitor_t *mon)
@@ -382,7 +403,7 @@ int cobalt_monitor_drain_all_sync(cobalt_monitor_t *mon)
 
 	cobalt_monitor_drain_all(mon);
 
-	if ((state->flags & COBALT_MONITOR_PENDED) == 0)
+	if (!monitor_must_sync(state))
 		return 0;
 
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
@@ -472,6 +493,10 @@ int cobalt_event_post(cobalt_event_t *event, unsigned int bits)
 	if ((state->flags & COBALT_EVENT_PENDED) == 0)
 		return 0;
 
+	/* Nobody sleeps on any of the posted bits. */
+	if ((state->waitmask & bits) == 0)
+		return 0;
+
 	return XENOMAI_SYSCALL1(sc_cobalt_event_sync, event);
 }
 
@@ -479,7 +504,33 @@ int cobalt_event_wait(cobalt_event_t *event,
 		      unsigned int bits, unsigned int *bits_r,
 		      int mode, const struct timespec *timeout)
 {
-	int ret, oldtype;
+	struct cobalt_event_state *state;
+	unsigned int rbits, testval;
+	int ret, oldtype, status;
+
+	/*
+	 * Waiting does not consume the bits, so a request the flag
+	 * group already satisfies can be served locally. A relaxed
+	 * caller still goes through the syscall, which switches it
+	 * back to primary mode.
+	 */
+	status = cobalt_get_current_mode();
+	if ((status & (XNRELAX|XNWEAK|XNDEBUG)) == 0) {
+		state = get_event_state(event);
+		if (bits == 0) {
+			*bits_r = state->value;
+			return 0;
+		}
+		rbits = state->value & bits;
+		testval = mode & COBALT_EVENT_ANY ? rbits : bits;
+		if (rbits && rbits == testval) {
+			__sync_synchronize();
+			*bits_r = rbits;
+			return 0;
+		}
+		if (timeout && timeout->tv_sec == 0 && timeout->tv_nsec == 0)
+			return -EWOULDBLOCK;
+	}
 
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
@@ -71,6 +71,9 @@
  * - @a mq_maxmsg is the maximum number of messages in the queue (128 by
  *   default);
  * - @a mq_msgsize is the maximum size of each message (128 by default).
+ * - @a mq_flags may have the COBALT_MQ_ZEROCOPY bit set, so that
+ *   messages can be passed by slot instead of being copied (see
+ *   mq_slot_alloc_np()).
  *
  * @a name may be any arbitrary string, in which slashes have no particular
  * meaning. However, for portability, using a name which starts with a slash and
@@ -586,4 +589,205 @@ COBALT_IMPL(int, mq_notify, (mqd_t mqd, const struct sigevent *evp))
 	return 0;
 }
 
+/**
+ * Reserve a message slot in a zero-copy message queue.
+ *
+ * A message queue created with the COBALT_MQ_ZEROCOPY bit set in the
+ * @a mq_flags attribute lays its message slots out in the Cobalt
+ * heap shared by all processes. Messages can then be exchanged by
+ * slot instead of being copied in and out of the queue: the sender
+ * reserves a slot with mq_slot_alloc_np(), builds the message in
+ * place, then queues it with mq_slot_send_np(); the receiver obtains
+ * the slot with mq_slot_receive_np(), reads the message in place,
+ * then hands the slot back with mq_slot_free_np(). The regular
+ * mq_send() and mq_receive() services remain available on such
+ * queue.
+ *
+ * The payload area is accessible to every Cobalt process, and the
+ * shared heap must be large enough to hold all the slots (see
+ * CONFIG_XENO_OPT_SHARED_HEAPSZ). A slot belongs to the descriptor
+ * it was obtained through, only this descriptor may send or free
+ * it. Slots still held when the descriptor is closed, including
+ * when the owner process exits, are given back to the queue.
+ *
+ * If no slot is available and the flag @a O_NONBLOCK is not set for
+ * the descriptor, the caller waits for a slot to be freed or
+ * received, until @a abs_timeout expires if not NULL.
+ *
+ * @param q message queue descriptor;
+ *
+ * @param bufp address where the slot address is stored on success;
+ *
+ * @param abs_timeout the timeout, expressed as an absolute value of
+ * the CLOCK_REALTIME clock, or NULL to wait indefinitely.
+ *
+ * @return the slot index on success;
+ * @return -1 with @a errno set if:
+ * - EBADF, @a q is not a valid message queue descriptor open for writing;
+ * - EOPNOTSUPP, the message queue was not created in zero-copy mode;
+ * - EAGAIN, the flag O_NONBLOCK is set for the descriptor @a q and
+ *   no slot is available;
+ * - EPERM, the caller context is invalid;
+ * - ETIMEDOUT, the specified timeout expired;
+ * - EINTR, the service was interrupted by a signal.
+ *
+ * @apitags{xthread-only, switch-primary}
+ */
+int mq_slot_alloc_np(mqd_t q, void **bufp,
+		     const struct timespec *abs_timeout)
+{
+	struct cobalt_mq_slot zs = { .timeout = 0 };
+	int err, oldtype;
+
+	if (abs_timeout)
+		zs.timeout = (__u64)abs_timeout->tv_sec * 1000000000ULL +
+			abs_timeout->tv_nsec;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	err = XENOMAI_SYSCALL2(sc_cobalt_mq_slot_alloc, q, &zs);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	if (err) {
+		errno = -err;
+		return -1;
+	}
+
+	*bufp = cobalt_umm_shared + zs.offset;
+
+	return zs.slot;
+}
+
+/**
+ * Send a message built in place in a zero-copy message queue slot.
+ *
+ * @param q message queue descriptor;
+ *
+ * @param slot index of a slot obtained from mq_slot_alloc_np() or
+ * mq_slot_receive_np();
+ *
+ * @param len length of the message;
+ *
+ * @param prio priority of the message.
+ *
+ * @return 0 on success, the slot then belongs to the queue;
+ * @return -1 with @a errno set if:
+ * - EBADF, @a q is not a valid message queue descriptor open for writing;
+ * - EOPNOTSUPP, the message queue was not created in zero-copy mode;
+ * - EINVAL, @a slot is not held through @a q, or @a prio is invalid;
+ * - EMSGSIZE, @a len exceeds the @a mq_msgsize attribute of the
+ *   message queue;
+ * - EPERM, the caller context is invalid.
+ *
+ * @apitags{xthread-only, switch-primary}
+ */
+int mq_slot_send_np(mqd_t q, int slot, size_t len, unsigned prio)
+{
+	int err;
+
+	err = XENOMAI_SYSCALL4(sc_cobalt_mq_slot_send, q, slot, len, prio);
+	if (err) {
+		errno = -err;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Receive a message in place from a zero-copy message queue.
+ *
+ * This service is equivalent to mq_timedreceive(), except that the
+ * message is not copied: the slot holding it is handed over to the
+ * caller, which should release it with mq_slot_free_np() once done,
+ * or forward it with mq_slot_send_np().
+ *
+ * @param q the queue descriptor;
+ *
+ * @param slotp address where the slot index is stored on success;
+ *
+ * @param bufp address where the slot address is stored on success;
+ *
+ * @param prio address where the priority of the received message
+ * will be stored on success, or NULL;
+ *
+ * @param abs_timeout the timeout, expressed as an absolute value of
+ * the CLOCK_REALTIME clock, or NULL to wait indefinitely.
+ *
+ * @return the message length on success;
+ * @return -1 with no message unqueued and @a errno set if:
+ * - EBADF, @a q is not a valid descriptor open for reading;
+ * - EOPNOTSUPP, the message queue was not created in zero-copy mode;
+ * - EAGAIN, the queue is empty, and the flag @a O_NONBLOCK is set for the
+ *   descriptor @a q;
+ * - EPERM, the caller context is invalid;
+ * - ETIMEDOUT, the specified timeout expired;
+ * - EINTR, the service was interrupted by a signal.
+ *
+ * @apitags{xthread-only, switch-primary}
+ */
+ssize_t mq_slot_receive_np(mqd_t q, int *slotp, void **bufp,
+			   unsigned *prio,
+			   const struct timespec *abs_timeout)
+{
+	struct cobalt_mq_slot zs = { .timeout = 0 };
+	int err, oldtype;
+
+	if (abs_timeout)
+		zs.timeout = (__u64)abs_timeout->tv_sec * 1000000000ULL +
+			abs_timeout->tv_nsec;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	err = XENOMAI_SYSCALL2(sc_cobalt_mq_slot_receive, q, &zs);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	if (err) {
+		errno = -err;
+		return -1;
+	}
+
+	*slotp = zs.slot;
+	*bufp = cobalt_umm_shared + zs.offset;
+	if (prio)
+		*prio = zs.prio;
+
+	return zs.len;
+}
+
+/**
+ * Release a zero-copy message queue slot.
+ *
+ * The slot is returned to the queue, or passed to a sender waiting
+ * in mq_slot_alloc_np() or mq_send().
+ *
+ * @param q the queue descriptor;
+ *
+ * @param slot index of a slot obtained from mq_slot_alloc_np() or
+ * mq_slot_receive_np().
+ *
+ * @return 0 on success;
+ * @return -1 with @a errno set if:
+ * - EBADF, @a q is not a valid message queue descriptor;
+ * - EOPNOTSUPP, the message queue was not created in zero-copy mode;
+ * - EINVAL, @a slot is not held through @a q;
+ * - EPERM, the caller context is invalid.
+ *
+ * @apitags{xthread-only, switch-primary}
+ */
+int mq_slot_free_np(mqd_t q, int slot)
+{
+	int err;
+
+	err = XENOMAI_SYSCALL2(sc_cobalt_mq_slot_free, q, slot);
+	if (err) {
+		errno = -err;
+		return -1;
+	}
+
+	return 0;
+}
+
 /** @}*/
@@ -0,0 +1,147 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <cobalt/sys/cobalt.h>
+#include <asm/xenomai/syscall.h>
+#include "internal.h"
+
+/**
+ * @ingroup cobalt_api
+ * @defgroup cobalt_api_poller Event polling
+ *
+ * Cobalt-specific event polling services
+ *
+ * A poller is a persistent set of RTDM descriptors a thread is
+ * interested in, such as sockets, message queue or timerfd
+ * descriptors. Descriptors are registered once with
+ * cobalt_poller_ctl(), then cobalt_poller_wait() returns the ready
+ * ones only. Unlike select(), the cost of waiting does not depend on
+ * the number of descriptors watched, which is not limited by
+ * FD_SETSIZE either.
+ *
+ * Pollers are level-triggered: a descriptor is reported by every
+ * wait until the condition it signaled is cleared. A descriptor
+ * closed while registered is reported once with COBALT_POLLHUP, then
+ * at every wait until removed from the set. Pollers are released by
+ * close().
+ *
+ *@{
+ */
+
+/**
+ * Create a poller.
+ *
+ * @param size the maximum number of descriptors the poller may
+ * watch, up to COBALT_POLLER_MAX.
+ *
+ * @param flags zero, or O_CLOEXEC.
+ *
+ * @return a file descriptor referring to the poller on success,
+ * otherwise:
+ * - -EINVAL, @a size or @a flags is invalid;
+ * - -ENOMEM, not enough memory in the Cobalt system heap;
+ * - -EMFILE, too many open file descriptors.
+ *
+ * @apitags{thread-unrestricted, switch-secondary}
+ */
+int cobalt_poller_create(int size, int flags)
+{
+	return XENOMAI_SYSCALL2(sc_cobalt_poller_create, size, flags);
+}
+
+/**
+ * Update the interest set of a poller.
+ *
+ * @param pfd the poller descriptor.
+ *
+ * @param op COBALT_POLLER_ADD for watching @a fd, COBALT_POLLER_MOD
+ * for changing the events watched on @a fd, or COBALT_POLLER_DEL for
+ * not watching @a fd anymore.
+ *
+ * @param fd the RTDM descriptor to watch.
+ *
+ * @param event a combination of COBALT_POLLIN, COBALT_POLLOUT and
+ * COBALT_POLLPRI in @a event->events, and the value to be returned
+ * with the events of @a fd in @a event->data. Ignored with
+ * COBALT_POLLER_DEL.
+ *
+ * @return 0 on success, otherwise:
+ * - -EBADF, @a pfd is not a poller descriptor, or @a fd does not
+ *   support one of the events requested;
+ * - -EPERM, @a fd is not an RTDM descriptor;
+ * - -EEXIST, @a fd is already watched (COBALT_POLLER_ADD);
+ * - -ENOENT, @a fd is not watched (COBALT_POLLER_MOD/DEL);
+ * - -ENOSPC, the poller is full;
+ * - -EINVAL, @a op, @a fd or @a event->events is invalid.
+ *
+ * @apitags{xthread-only, switch-primary}
+ */
+int cobalt_poller_ctl(int pfd, int op, int fd,
+		      const struct cobalt_poll_event *event)
+{
+	return XENOMAI_SYSCALL4(sc_cobalt_poller_ctl, pfd, op, fd, event);
+}
+
+/**
+ * Wait for events on a poller.
+ *
+ * @param pfd the poller descriptor.
+ *
+ * @param events the array receiving the events of the ready
+ * descriptors, and the @a data value they were registered with.
+ *
+ * @param maxevents the size of @a events. If more descriptors are
+ * ready, the next calls report the others first.
+ *
+ * @param timeout the maximum time to wait, measured against
+ * CLOCK_MONOTONIC. NULL means waiting indefinitely, a zero value
+ * means not waiting at all.
+ *
+ * @return the number of events copied to @a events, zero on timeout,
+ * otherwise:
+ * - -EBADF, @a pfd is not a poller descriptor;
+ * - -EINVAL, @a maxevents or @a timeout is invalid;
+ * - -EINTR, the caller was interrupted by a signal while waiting;
+ * - -EFAULT, invalid memory area.
+ *
+ * @apitags{xthread-only, switch-primary}
+ */
+int cobalt_poller_wait(int pfd, struct cobalt_poll_event *events,
+		       int maxevents, const struct timespec *timeout)
+{
+	int64_t ns, *nsp = NULL;
+	int ret, oldtype;
+
+	if (timeout) {
+		if (timeout->tv_sec < 0 ||
+		    (unsigned long)timeout->tv_nsec >= ONE_BILLION)
+			return -EINVAL;
+		ns = (int64_t)timeout->tv_sec * ONE_BILLION + timeout->tv_nsec;
+		nsp = &ns;
+	}
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	ret = XENOMAI_SYSCALL4(sc_cobalt_poller_wait, pfd,
+			       events, maxevents, nsp);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	return ret;
+}
+
+/** @} */
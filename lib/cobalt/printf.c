@@ -16,6 +16,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
  */
 
+#include <ctype.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -23,6 +24,7 @@
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -43,15 +45,45 @@
 
 #define RT_PRINT_MODE_FORMAT		0
 #define RT_PRINT_MODE_FWRITE		1
+#define RT_PRINT_MODE_DEFER		2
+
+#define RT_PRINT_SPEC_MAX		32
 
 struct entry_head {
 	FILE *dest;
 	uint32_t seq_no;
 	int priority;
+	int deferred;
 	size_t len;
 	char data[0];
 } __attribute__((packed));
 
+/*
+ * Argument classes of conversion specs, as laid out in the payload
+ * of deferred entries after the format pointer.
+ */
+enum print_arg_type {
+	PRINT_ARG_NONE,
+	PRINT_ARG_INT,
+	PRINT_ARG_LONG,
+	PRINT_ARG_LLONG,
+	PRINT_ARG_INTMAX,
+	PRINT_ARG_SIZE,
+	PRINT_ARG_PTRDIFF,
+	PRINT_ARG_DOUBLE,
+	PRINT_ARG_LDOUBLE,
+	PRINT_ARG_PTR,
+	PRINT_ARG_STRING,
+};
+
+struct print_spec {
+	const char *start;
+	const char *end;
+	int nstars;
+	int prec;
+	enum print_arg_type type;
+};
+
 struct print_buffer {
 	off_t write_pos;
 
@@ -75,6 +107,15 @@ int __cobalt_print_bufcount = RT_PRINT_DEFAULT_BUFFERS_COUNT;
 
 int __cobalt_print_syncdelay = RT_PRINT_DEFAULT_SYNCDELAY;
 
+/*
+ * In deferred mode, the rt_printf() family only logs the format
+ * pointer and the raw arguments, leaving the formatting work to the
+ * printer thread (see rt_vfprintf()). The libc wrappers always
+ * format in place, their callers expect the character count back
+ * and may pass transient format strings.
+ */
+int __cobalt_print_deferred;
+
 static struct print_buffer *first_buffer;
 static int buffers;
 static uint32_t seq_no;
@@ -88,12 +129,373 @@ static atomic_long_t *pool_bitmap;
 static unsigned pool_bitmap_len;
 static unsigned pool_buf_size;
 static unsigned long pool_start, pool_len;
+static struct print_buffer **print_heap;
+static int print_heap_len;
+static char *deferred_line;
 
 static void release_buffer(struct print_buffer *buffer);
 static void print_buffers(void);
 
 /* *** rt_print API *** */
 
+/*
+ * Parse the next conversion spec from @fmt. Returns 1 if one was
+ * found, 0 at end of string, or -1 if the spec cannot be deferred,
+ * i.e. it has side-effects at formatting time (%n, %m), refers to
+ * positional or wide character arguments, or is unknown to us.
+ */
+static int parse_spec(const char *fmt, struct print_spec *spec)
+{
+	const char *p = strchr(fmt, '%');
+	int lmod = 0;
+
+	if (p == NULL)
+		return 0;
+
+	spec->start = p++;
+	spec->nstars = 0;
+	spec->prec = -1;
+
+	while (*p && strchr("-+ #0'I", *p))
+		p++;
+
+	if (*p == '*') {
+		spec->nstars++;
+		p++;
+	} else
+		while (isdigit((unsigned char)*p))
+			p++;
+
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->nstars++;
+			spec->prec = -2;
+			p++;
+		} else {
+			spec->prec = 0;
+			while (isdigit((unsigned char)*p))
+				spec->prec = spec->prec * 10 + *p++ - '0';
+		}
+	}
+
+	/* Positional arguments are not supported. */
+	if (*p == '$' || isdigit((unsigned char)*p))
+		return -1;
+
+	switch (*p) {
+	case 'h':
+		if (*++p == 'h')
+			p++;
+		break;
+	case 'l':
+		lmod = 'l';
+		if (*++p == 'l') {
+			lmod = 'q';
+			p++;
+		}
+		break;
+	case 'q':
+	case 'L':
+		lmod = 'q';
+		p++;
+		break;
+	case 'j':
+	case 'z':
+	case 'Z':
+	case 't':
+		lmod = *p++;
+		break;
+	}
+
+	switch (*p) {
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		switch (lmod) {
+		case 'l':
+			spec->type = PRINT_ARG_LONG;
+			break;
+		case 'q':
+			spec->type = PRINT_ARG_LLONG;
+			break;
+		case 'j':
+			spec->type = PRINT_ARG_INTMAX;
+			break;
+		case 'z':
+		case 'Z':
+			spec->type = PRINT_ARG_SIZE;
+			break;
+		case 't':
+			spec->type = PRINT_ARG_PTRDIFF;
+			break;
+		default:
+			spec->type = PRINT_ARG_INT;
+		}
+		break;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		spec->type = lmod == 'q' ? PRINT_ARG_LDOUBLE : PRINT_ARG_DOUBLE;
+		break;
+	case 'c':
+		if (lmod == 'l')
+			return -1;
+		spec->type = PRINT_ARG_INT;
+		break;
+	case 's':
+		if (lmod == 'l')
+			return -1;
+		spec->type = PRINT_ARG_STRING;
+		break;
+	case 'p':
+		spec->type = PRINT_ARG_PTR;
+		break;
+	case '%':
+		spec->type = PRINT_ARG_NONE;
+		break;
+	default:
+		return -1;
+	}
+
+	spec->end = p + 1;
+	if (spec->end - spec->start >= RT_PRINT_SPEC_MAX)
+		return -1;
+
+	return 1;
+}
+
+#define pack_arg(__p, __end, __args, __type)			\
+	({							\
+		__type __v = va_arg(__args, __type);		\
+		int __ret = -1;					\
+		if ((__end) - (__p) >= sizeof(__v)) {		\
+			memcpy(__p, &__v, sizeof(__v));		\
+			(__p) += sizeof(__v);			\
+			__ret = 0;				\
+		}						\
+		__ret;						\
+	})
+
+/*
+ * Store the format pointer and the raw arguments it refers to into
+ * @data, for the printer thread to format them later on. Strings are
+ * copied, everything else is stored in binary form. Returns the
+ * number of bytes used, or -1 if the format cannot be deferred or
+ * does not fit into @len bytes.
+ */
+static int pack_args(char *data, int len,
+		     const char *format, va_list args)
+{
+	char *p = data, *end = data + len;
+	struct print_spec spec;
+	const char *fmt, *s;
+	int ret, n, star;
+	size_t slen;
+
+	if (len < (int)sizeof(format))
+		return -1;
+
+	memcpy(p, &format, sizeof(format));
+	p += sizeof(format);
+
+	for (fmt = format;; fmt = spec.end) {
+		ret = parse_spec(fmt, &spec);
+		if (ret <= 0)
+			return ret ?: p - data;
+
+		for (n = 0; n < spec.nstars; n++) {
+			star = va_arg(args, int);
+			if (end - p < (int)sizeof(star))
+				return -1;
+			memcpy(p, &star, sizeof(star));
+			p += sizeof(star);
+			if (spec.prec == -2 && n == spec.nstars - 1)
+				spec.prec = star;
+		}
+
+		switch (spec.type) {
+		case PRINT_ARG_NONE:
+			ret = 0;
+			break;
+		case PRINT_ARG_INT:
+			ret = pack_arg(p, end, args, int);
+			break;
+		case PRINT_ARG_LONG:
+			ret = pack_arg(p, end, args, long);
+			break;
+		case PRINT_ARG_LLONG:
+			ret = pack_arg(p, end, args, long long);
+			break;
+		case PRINT_ARG_INTMAX:
+			ret = pack_arg(p, end, args, intmax_t);
+			break;
+		case PRINT_ARG_SIZE:
+			ret = pack_arg(p, end, args, size_t);
+			break;
+		case PRINT_ARG_PTRDIFF:
+			ret = pack_arg(p, end, args, ptrdiff_t);
+			break;
+		case PRINT_ARG_DOUBLE:
+			ret = pack_arg(p, end, args, double);
+			break;
+		case PRINT_ARG_LDOUBLE:
+			ret = pack_arg(p, end, args, long double);
+			break;
+		case PRINT_ARG_PTR:
+			ret = pack_arg(p, end, args, void *);
+			break;
+		case PRINT_ARG_STRING:
+			s = va_arg(args, const char *);
+			if (s == NULL)
+				s = "(null)";
+			/* The precision may bound a non-terminated string. */
+			slen = spec.prec >= 0 ? strnlen(s, spec.prec) : strlen(s);
+			if (end - p < slen + 1)
+				return -1;
+			memcpy(p, s, slen);
+			p[slen] = '\0';
+			p += slen + 1;
+			ret = 0;
+			break;
+		}
+
+		if (ret)
+			return -1;
+	}
+}
+
+#define unpack_arg(__p, __type)					\
+	({							\
+		__type __v;					\
+		memcpy(&__v, __p, sizeof(__v));			\
+		(__p) += sizeof(__v);				\
+		__v;						\
+	})
+
+#define format_arg(__out, __size, __spec, __nstars, __star, __v)	\
+	((__nstars) == 0 ?						\
+	 snprintf(__out, __size, __spec, __v) :				\
+	 (__nstars) == 1 ?						\
+	 snprintf(__out, __size, __spec, (__star)[0], __v) :		\
+	 snprintf(__out, __size, __spec, (__star)[0], (__star)[1], __v))
+
+/*
+ * Format a deferred entry into @out, which must be at least one byte
+ * long. Returns the length of the output, truncated to @size - 1.
+ */
+static size_t format_deferred(char *out, size_t size,
+			      const char *data)
+{
+	char specbuf[RT_PRINT_SPEC_MAX];
+	const char *p = data, *fmt, *s;
+	struct print_spec spec;
+	size_t pos = 0, n;
+	int star[2], i;
+	long len;
+
+	memcpy(&fmt, p, sizeof(fmt));
+	p += sizeof(fmt);
+
+	for (;;) {
+		if (parse_spec(fmt, &spec) <= 0)
+			spec.start = fmt + strlen(fmt);
+
+		/* Copy the literal text up to the next spec. */
+		n = spec.start - fmt;
+		if (n > size - pos - 1)
+			n = size - pos - 1;
+		memcpy(out + pos, fmt, n);
+		pos += n;
+
+		if (*spec.start == '\0' || pos == size - 1)
+			break;
+
+		for (i = 0; i < spec.nstars; i++)
+			star[i] = unpack_arg(p, int);
+
+		n = spec.end - spec.start;
+		memcpy(specbuf, spec.start, n);
+		specbuf[n] = '\0';
+
+		switch (spec.type) {
+		case PRINT_ARG_NONE:
+			len = snprintf(out + pos, size - pos, "%%");
+			break;
+		case PRINT_ARG_INT:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star, unpack_arg(p, int));
+			break;
+		case PRINT_ARG_LONG:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star, unpack_arg(p, long));
+			break;
+		case PRINT_ARG_LLONG:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star,
+					 unpack_arg(p, long long));
+			break;
+		case PRINT_ARG_INTMAX:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star,
+					 unpack_arg(p, intmax_t));
+			break;
+		case PRINT_ARG_SIZE:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star, unpack_arg(p, size_t));
+			break;
+		case PRINT_ARG_PTRDIFF:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star,
+					 unpack_arg(p, ptrdiff_t));
+			break;
+		case PRINT_ARG_DOUBLE:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star, unpack_arg(p, double));
+			break;
+		case PRINT_ARG_LDOUBLE:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star,
+					 unpack_arg(p, long double));
+			break;
+		case PRINT_ARG_PTR:
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star, unpack_arg(p, void *));
+			break;
+		case PRINT_ARG_STRING:
+		default:
+			s = p;
+			p += strlen(s) + 1;
+			len = format_arg(out + pos, size - pos, specbuf,
+					 spec.nstars, star, s);
+			break;
+		}
+
+		if (len < 0)
+			break;
+
+		if (len >= size - pos) {
+			pos = size - 1;
+			break;
+		}
+
+		pos += len;
+		fmt = spec.end;
+	}
+
+	out[pos] = '\0';
+
+	return pos;
+}
+
 static int 
 vprint_to_buffer(FILE *stream, int fortify_level, int priority, 
 		 unsigned int mode, size_t sz, const char *format, va_list args)
@@ -102,7 +504,9 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 	off_t write_pos, read_pos;
 	struct entry_head *head;
 	int len, str_len;
+	int deferred = 0;
 	int res = 0;
+	va_list aq;
 
 	if (!buffer) {
 		res = rt_print_init(0, NULL);
@@ -150,7 +554,27 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 
 	head = buffer->ring + write_pos;
 
-	if (mode == RT_PRINT_MODE_FORMAT) {
+	if (mode == RT_PRINT_MODE_DEFER) {
+		/*
+		 * Leave formatting to the printer thread if we can, or
+		 * fall back to formatting in place.
+		 */
+		if (__cobalt_print_deferred) {
+			va_copy(aq, args);
+			res = pack_args(head->data, len, format, aq);
+			va_end(aq);
+			if (res > 0) {
+				deferred = 1;
+				len = res;
+				res = 0;
+			}
+		}
+		mode = RT_PRINT_MODE_FORMAT;
+	}
+
+	if (deferred)
+		;
+	else if (mode == RT_PRINT_MODE_FORMAT) {
 		if (stream != RT_PRINT_SYSLOG_STREAM) {
 			/* We do not need the terminating \0 */
 #ifdef CONFIG_XENO_FORTIFY
@@ -205,6 +629,7 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 	if (len > 0) {
 		head->seq_no = ++seq_no;
 		head->priority = priority;
+		head->deferred = deferred;
 		head->dest = stream;
 		head->len = len;
 
@@ -245,10 +670,37 @@ static int print_to_buffer(FILE *stream, int priority, unsigned int mode,
 	return ret;
 }
 
+/**
+ * @brief Print formatted output through the relay buffer of the caller.
+ *
+ * rt_vfprintf(), rt_fprintf(), rt_vprintf() and rt_printf() format
+ * the output into a per-thread ring, which a low priority printer
+ * thread flushes to @a stream, so that callers never block on the
+ * output.
+ *
+ * With --print-deferred, or the print_deferred tunable set, these
+ * calls only record the format pointer and the arguments in the
+ * ring, string arguments being copied, and the printer thread does
+ * the formatting. In that case:
+ *
+ * - @a format must remain valid and unchanged until the output is
+ * flushed, e.g. a string literal. Output built in a local buffer
+ * should go through "%s" instead.
+ *
+ * - the return value is zero instead of the number of characters
+ * printed.
+ *
+ * Formats which cannot be deferred (%n, %m, positional or wide
+ * character arguments) and output which does not fit in the ring in
+ * binary form are still formatted by the caller.
+ *
+ * @return the number of characters printed, zero for deferred
+ * output, or a negative value on error, with errno set.
+ */
 int rt_vfprintf(FILE *stream, const char *format, va_list args)
 {
 	return vprint_to_buffer(stream, 0, 0,
-				RT_PRINT_MODE_FORMAT, 0, format, args);
+				RT_PRINT_MODE_DEFER, 0, format, args);
 }
 
 #ifdef CONFIG_XENO_FORTIFY
@@ -368,8 +820,11 @@ static void set_buffer_name(struct print_buffer *buffer, const char *name)
 	}
 }
 
-static void rt_print_init_inner(struct print_buffer *buffer, size_t size)
+static int rt_print_init_inner(struct print_buffer *buffer, size_t size)
 {
+	struct print_buffer **heap;
+	int len;
+
 	buffer->size = size;
 
 	memset(buffer->ring, 0, size);
@@ -381,6 +836,19 @@ static void rt_print_init_inner(struct print_buffer *buffer, size_t size)
 
 	pthread_mutex_lock(&buffer_lock);
 
+	/* Make room in the merge heap for one more buffer. */
+	if (buffers >= print_heap_len) {
+		len = print_heap_len ? print_heap_len * 2 :
+			RT_PRINT_DEFAULT_BUFFERS_COUNT;
+		heap = realloc(print_heap, len * sizeof(*heap));
+		if (heap == NULL) {
+			pthread_mutex_unlock(&buffer_lock);
+			return ENOMEM;
+		}
+		print_heap = heap;
+		print_heap_len = len;
+	}
+
 	buffer->next = first_buffer;
 	if (first_buffer)
 		first_buffer->prev = buffer;
@@ -390,6 +858,8 @@ static void rt_print_init_inner(struct print_buffer *buffer, size_t size)
 	pthread_cond_signal(&printer_wakeup);
 
 	pthread_mutex_unlock(&buffer_lock);
+
+	return 0;
 }
 
 int rt_print_init(size_t buffer_size, const char *buffer_name)
@@ -398,6 +868,7 @@ int rt_print_init(size_t buffer_size, const char *buffer_name)
 	size_t size = buffer_size;
 	unsigned long old_bitmap;
 	unsigned j;
+	int ret;
 
 	if (!size)
 		size = __cobalt_print_bufsz;
@@ -453,7 +924,12 @@ int rt_print_init(size_t buffer_size, const char *buffer_name)
 		if (!buffer->ring)
 			return ENOMEM;
 
-		rt_print_init_inner(buffer, size);
+		ret = rt_print_init_inner(buffer, size);
+		if (ret) {
+			free(buffer->ring);
+			free(buffer);
+			return ret;
+		}
 	}
 
 	set_buffer_name(buffer, buffer_name);
@@ -558,65 +1034,117 @@ static inline uint32_t get_next_seq_no(struct print_buffer *buffer)
 	return head->seq_no;
 }
 
-static struct print_buffer *get_next_buffer(void)
+static void sift_down(int nr, int i)
 {
-	struct print_buffer *pos = first_buffer;
-	struct print_buffer *buffer = NULL;
-	uint32_t next_seq_no = 0; /* silence gcc... */
+	struct print_buffer *buffer = print_heap[i];
+	uint32_t seq = get_next_seq_no(buffer);
+	int child;
 
-	while (pos) {
-		if (pos->read_pos != pos->write_pos &&
-		    (!buffer || get_next_seq_no(pos) < next_seq_no)) {
-			buffer = pos;
-			next_seq_no = get_next_seq_no(pos);
-		}
-		pos = pos->next;
+	for (;;) {
+		child = 2 * i + 1;
+		if (child >= nr)
+			break;
+		if (child + 1 < nr &&
+		    get_next_seq_no(print_heap[child + 1]) <
+		    get_next_seq_no(print_heap[child]))
+			child++;
+		if (seq <= get_next_seq_no(print_heap[child]))
+			break;
+		print_heap[i] = print_heap[child];
+		i = child;
 	}
 
-	return buffer;
+	print_heap[i] = buffer;
 }
 
-static void print_buffers(void)
+/*
+ * Collect all buffers with pending output into a min-heap ordered by
+ * the sequence number of their oldest entry. Returns the heap size.
+ */
+static int fill_heap(void)
+{
+	struct print_buffer *pos;
+	int nr = 0, i;
+
+	for (pos = first_buffer; pos; pos = pos->next) {
+		if (pos->read_pos != pos->write_pos)
+			print_heap[nr++] = pos;
+	}
+
+	/* Read the entry heads only after write_pos. */
+	smp_rmb();
+
+	for (i = nr / 2 - 1; i >= 0; i--)
+		sift_down(nr, i);
+
+	return nr;
+}
+
+static void print_entry(struct print_buffer *buffer)
 {
-	struct print_buffer *buffer;
 	struct entry_head *head;
 	off_t read_pos;
-	int len, ret;
+	size_t len;
+	char *data;
+	int ret;
 
-	while (1) {
-		buffer = get_next_buffer();
-		if (!buffer)
-			break;
+	read_pos = buffer->read_pos;
+	head = buffer->ring + read_pos;
+	len = head->len;
+
+	if (len) {
+		data = head->data;
+		if (head->deferred) {
+			len = format_deferred(deferred_line,
+					      __cobalt_print_bufsz, data);
+			data = deferred_line;
+		}
+		/* Print out non-empty entry and proceed */
+		/* Check if output goes to syslog */
+		if (head->dest == RT_PRINT_SYSLOG_STREAM) {
+			syslog(head->priority, "%s", data);
+		} else if (len > 0) {
+			ret = fwrite(data, len, 1, head->dest);
+			(void)ret;
+		}
 
-		read_pos = buffer->read_pos;
-		head = buffer->ring + read_pos;
-		len = head->len;
+		read_pos += sizeof(*head) + head->len;
+	} else {
+		/* Emptry entries mark the wrap-around */
+		read_pos = 0;
+	}
 
-		if (len) {
-			/* Print out non-empty entry and proceed */
-			/* Check if output goes to syslog */
-			if (head->dest == RT_PRINT_SYSLOG_STREAM) {
-				syslog(head->priority,
-				       "%s", head->data);
-			} else {
-				ret = fwrite(head->data,
-					     head->len, 1, head->dest);
-				(void)ret;
-			}
+	/* Make sure we have read the entry competely before
+	   forwarding read_pos */
+	smp_rmb();
+	buffer->read_pos = read_pos;
 
-			read_pos += sizeof(*head) + len;
-		} else {
-			/* Emptry entries mark the wrap-around */
-			read_pos = 0;
-		}
+	/* Enforce the read_pos update before proceeding */
+	smp_wmb();
+}
 
-		/* Make sure we have read the entry competely before
-		   forwarding read_pos */
-		smp_rmb();
-		buffer->read_pos = read_pos;
+static void print_buffers(void)
+{
+	struct print_buffer *buffer;
+	int nr;
 
-		/* Enforce the read_pos update before proceeding */
-		smp_wmb();
+	/*
+	 * Merge the output from all buffers by sequence number,
+	 * picking the oldest entry from the heap top each time.
+	 * Output logged in the meantime to buffers which were empty
+	 * when the heap was filled is caught by the next round.
+	 */
+	while ((nr = fill_heap()) > 0) {
+		do {
+			buffer = print_heap[0];
+			print_entry(buffer);
+			if (buffer->read_pos == buffer->write_pos)
+				print_heap[0] = print_heap[--nr];
+			else
+				smp_rmb();
+			if (nr > 0)
+				sift_down(nr, 0);
+		} while (nr > 0);
 	}
 }
 
@@ -693,6 +1221,10 @@ void cobalt_print_init(void)
 	syncdelay.tv_nsec = (__cobalt_print_syncdelay % 1000) * 1000000;
 
 	/* Fill the buffer pool */
+	deferred_line = malloc(__cobalt_print_bufsz);
+	if (!deferred_line)
+		early_panic("error allocating print relay buffers");
+
 	pool_bitmap_len = (__cobalt_print_bufcount+LONG_BIT-1)/LONG_BIT;
 	if (!pool_bitmap_len)
 		goto done;
@@ -720,7 +1252,8 @@ void cobalt_print_init(void)
 		
 		buffer->ring = (char *)(buffer + 1);
 
-		rt_print_init_inner(buffer, __cobalt_print_bufsz);
+		if (rt_print_init_inner(buffer, __cobalt_print_bufsz))
+			early_panic("error allocating print relay buffers");
 	}
 done:
 	pthread_mutex_init(&buffer_lock, NULL);
@@ -737,7 +1270,9 @@ done:
 COBALT_IMPL(int, vfprintf, (FILE *stream, const char *fmt, va_list args))
 {
 	if (!cobalt_is_relaxed())
-		return rt_vfprintf(stream, fmt, args);
+		/* Never deferred, see __cobalt_print_deferred. */
+		return vprint_to_buffer(stream, 0, 0,
+					RT_PRINT_MODE_FORMAT, 0, fmt, args);
 	else {
 		rt_print_flush_buffers();
 		return __STD(vfprintf(stream, fmt, args));
@@ -151,7 +151,7 @@ redo:
 	 * whole process.
 	 */
 	if (ret == -EEXIST) {
-		hash_destroy(&d->table);
+		hash_destroy(&d->table, &hash_operations);
 		xnfree(d);
 		goto redo;
 	}
@@ -275,7 +275,7 @@ redo:
 	 * creating the cluster.
 	 */
 	if (ret == -EEXIST) {
-		hash_destroy(&d->table);
+		hash_destroy(&d->table, &hash_operations);
 		xnfree(d);
 		goto redo;
 	}
@@ -418,7 +418,7 @@ int pvcluster_init(struct pvcluster *c, const char *name)
 
 void pvcluster_destroy(struct pvcluster *c)
 {
-	/* nop */
+	pvhash_destroy(&c->table);
 }
 
 int pvcluster_addobj(struct pvcluster *c, const char *name,
@@ -483,11 +483,15 @@ int pvsyncluster_init(struct pvsyncluster *sc, const char *name)
 		return ret;
 
 	/*
-	 * Assuming pvcluster_destroy() is a nop, so we don't need to
-	 * run any finalizer.
+	 * The table is still empty, so pvcluster_destroy() will do
+	 * the cleanup, no finalizer needed.
 	 */
-	return syncobj_init(&sc->sobj, CLOCK_COPPERPLATE,
-			    SYNCOBJ_FIFO, fnref_null);
+	ret = syncobj_init(&sc->sobj, CLOCK_COPPERPLATE,
+			   SYNCOBJ_FIFO, fnref_null);
+	if (ret)
+		pvcluster_destroy(&sc->c);
+
+	return ret;
 }
 
 void pvsyncluster_destroy(struct pvsyncluster *sc)
@@ -499,6 +503,7 @@ void pvsyncluster_destroy(struct pvsyncluster *sc)
 
 	/* No finalizer, we just destroy the synchro. */
 	syncobj_destroy(&sc->sobj, &syns);
+	pvcluster_destroy(&sc->c);
 }
 
 int pvsyncluster_addobj(struct pvsyncluster *sc, const char *name,
@@ -114,5 +114,14 @@ int heapobj_pkg_init_private(void)
 		return ret;
 	}
 
+	if (__copperplate_setup_data.mem_magazines) {
+		ret = heapmem_enable_magazines(&heapmem_main);
+		if (ret) {
+			heapmem_destroy(&heapmem_main);
+			free(mem);
+			return ret;
+		}
+	}
+
 	return 0;
 }
@@ -1217,6 +1217,11 @@ void xnfree(void *ptr)
 	sheapmem_free(&main_heap.heap, ptr);
 }
 
+size_t xnvalidate(void *ptr)
+{
+	return heapobj_validate(&main_pool, ptr);
+}
+
 char *xnstrdup(const char *ptr)
 {
 	char *str;
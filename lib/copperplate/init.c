@@ -36,6 +36,7 @@
 
 struct copperplate_setup_data __copperplate_setup_data = {
 	.mem_pool = 1024 * 1024, /* Default, 1Mb. */
+	.mem_magazines = 0,
 	.no_registry = 0,
 	.registry_root = DEFAULT_REGISTRY_ROOT,
 	.session_label = NULL,
@@ -77,6 +78,13 @@ static const struct option copperplate_options[] = {
 		.flag = &__copperplate_setup_data.shared_registry,
 		.val = 1,
 	},
+	{
+#define mem_magazines_opt	5
+		.name = "mem-magazines",
+		.has_arg = no_argument,
+		.flag = &__copperplate_setup_data.mem_magazines,
+		.val = 1,
+	},
 	{ /* Sentinel */ }
 };
 
@@ -274,6 +282,7 @@ static int copperplate_parse_option(int optnum, const char *optarg)
 		break;
 	case shared_registry_opt:
 	case no_registry_opt:
+	case mem_magazines_opt:
 		break;
 	default:
 		/* Paranoid, can't happen. */
@@ -286,6 +295,7 @@ static int copperplate_parse_option(int optnum, const char *optarg)
 static void copperplate_help(void)
 {
 	fprintf(stderr, "--mem-pool-size=<size[K|M|G]> 	size of the main heap\n");
+	fprintf(stderr, "--mem-magazines			enable per-thread caches on the main heap\n");
         fprintf(stderr, "--no-registry			suppress object registration\n");
         fprintf(stderr, "--shared-registry		enable public access to registry\n");
         fprintf(stderr, "--registry-root=<path>		root path of registry\n");
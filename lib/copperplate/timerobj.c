@@ -29,6 +29,8 @@
 #include "boilerplate/list.h"
 #include "boilerplate/signal.h"
 #include "boilerplate/lock.h"
+#include "boilerplate/time.h"
+#include "boilerplate/compiler.h"
 #include "copperplate/threadobj.h"
 #include "copperplate/timerobj.h"
 #include "copperplate/clockobj.h"
@@ -41,8 +43,6 @@ static pthread_t svthread;
 
 static pid_t svpid;
 
-static DEFINE_PRIVATE_LIST(svtimers);
-
 #ifdef CONFIG_XENO_COBALT
 
 static inline void timersv_init_corespec(void) { }
@@ -61,29 +61,183 @@ static inline void timersv_init_corespec(void)
 #endif /* CONFIG_XENO_MERCURY */
 
 /*
- * XXX: at some point, we may consider using a timer wheel instead of
- * a simple linked list to index timers. The latter method is
- * efficient for up to ten outstanding timers or so, which should be
- * enough for most applications. However, there exist poorly designed
- * apps involving dozens of active timers, particularly in the legacy
- * embedded world.
+ * Outstanding timers are indexed by a hierarchical timing wheel, so
+ * that arming and cancelling a timer is O(1) regardless of the number
+ * of timers in flight. Level #0 has TW_SLOTS slots, each spanning
+ * 2^TW_TICK_SHIFT nanoseconds; each upper level spans TW_SLOTS times
+ * the range of the level below it. Timers are cascaded down to the
+ * lower levels as the wheel base moves forward, and picked from
+ * level #0 when due.
+ *
+ * The wheel only tells the server which timers are due, the actual
+ * wakeup is still triggered by the POSIX timer attached to each
+ * timerobj, so the slot granularity has no effect on the timer
+ * precision.
  */
+#define TW_TICK_SHIFT	16	/* ~65 us per level #0 slot */
+#define TW_LEVEL_BITS	6
+#define TW_SLOTS	(1 << TW_LEVEL_BITS)
+#define TW_SLOT_MASK	(TW_SLOTS - 1)
+#define TW_LEVELS	6
+#define TW_MAX_DELTA	((1ULL << (TW_LEVELS * TW_LEVEL_BITS)) - 1)
+#define TW_UNQUEUED	-1
+
+static struct {
+	ticks_t base;
+	unsigned long long bitmap[TW_LEVELS];
+	struct pvlistobj slots[TW_LEVELS * TW_SLOTS];
+} svwheel;
+
+static inline ticks_t timerobj_date(const struct timerobj *tmobj)
+{
+	return (ticks_t)timespec_scalar(&tmobj->itspec.it_value) >> TW_TICK_SHIFT;
+}
+
 static void timerobj_enqueue(struct timerobj *tmobj)
 {
-	struct timerobj *__tmobj;
+	ticks_t expires = timerobj_date(tmobj), delta;
+	int level = 0, spot;
+
+	if ((sticks_t)(expires - svwheel.base) <= 0)
+		/* Already due, queue to the current slot. */
+		spot = svwheel.base & TW_SLOT_MASK;
+	else {
+		delta = expires - svwheel.base;
+		if (delta > TW_MAX_DELTA) {
+			/* Cascaded again from the top level when reached. */
+			delta = TW_MAX_DELTA;
+			expires = svwheel.base + delta;
+		}
+		level = (63 - xenomai_count_leading_zeros(delta)) / TW_LEVEL_BITS;
+		spot = (expires >> (level * TW_LEVEL_BITS)) & TW_SLOT_MASK;
+	}
+
+	svwheel.bitmap[level] |= 1ULL << spot;
+	spot += level * TW_SLOTS;
+	pvlist_append(&tmobj->next, &svwheel.slots[spot]);
+	tmobj->spot = spot;
+}
+
+static void timerobj_dequeue(struct timerobj *tmobj)
+{
+	int spot = tmobj->spot;
+
+	pvlist_remove_init(&tmobj->next);
 
-	if (pvlist_empty(&svtimers)) {
-		pvlist_append(&tmobj->next, &svtimers);
+	/* Timers pulled out of the wheel for firing are unqueued. */
+	if (spot == TW_UNQUEUED)
 		return;
+
+	tmobj->spot = TW_UNQUEUED;
+	if (pvlist_empty(&svwheel.slots[spot]))
+		svwheel.bitmap[spot / TW_SLOTS] &= ~(1ULL << (spot % TW_SLOTS));
+}
+
+static void timerobj_cascade(void)
+{
+	struct timerobj *tmobj;
+	struct pvlistobj *slot;
+	DEFINE_PRIVATE_LIST(tmp);
+	int level, spot;
+
+	for (level = 1; level < TW_LEVELS; level++) {
+		if (svwheel.base & ((1ULL << (level * TW_LEVEL_BITS)) - 1))
+			break;
+		spot = (svwheel.base >> (level * TW_LEVEL_BITS)) & TW_SLOT_MASK;
+		slot = &svwheel.slots[level * TW_SLOTS + spot];
+		if (pvlist_empty(slot))
+			continue;
+		/*
+		 * Detach the slot first, timers clamped to the top
+		 * level may be requeued to the very same slot.
+		 */
+		pvlist_join(slot, &tmp);
+		pvlist_init(slot);
+		svwheel.bitmap[level] &= ~(1ULL << spot);
+		while (!pvlist_empty(&tmp)) {
+			tmobj = pvlist_pop_entry(&tmp, struct timerobj, next);
+			timerobj_enqueue(tmobj);
+		}
+	}
+}
+
+/*
+ * Return the next wheel date at which something may happen, i.e. a
+ * non-empty level #0 slot to fire or an upper level slot to cascade.
+ * All lower level stops precede any upper level stop, so the lowest
+ * non-empty level decides.
+ */
+static ticks_t timerobj_next_stop(void)
+{
+	ticks_t base = svwheel.base;
+	unsigned long long pending;
+	int level, shift, index;
+
+	for (level = 0; level < TW_LEVELS; level++) {
+		if (svwheel.bitmap[level] == 0)
+			continue;
+		shift = level * TW_LEVEL_BITS;
+		index = (base >> shift) & TW_SLOT_MASK;
+		pending = svwheel.bitmap[level] & ~((2ULL << index) - 1);
+		if (pending)
+			return (((base >> shift) & ~(ticks_t)TW_SLOT_MASK) |
+				xenomai_count_trailing_zeros(pending)) << shift;
+		/* Slots behind the current index belong to the next turn. */
+		return (((base >> shift) | TW_SLOT_MASK) + 1) << shift;
 	}
 
-	pvlist_for_each_entry_reverse(__tmobj, &svtimers, next) {
+	return base + TW_MAX_DELTA + 1;
+}
+
+static void timerobj_sort_expired(struct timerobj *tmobj,
+				  struct pvlistobj *expired)
+{
+	struct timerobj *__tmobj;
+
+	/*
+	 * Timers sharing a slot are not sorted, so order the (short)
+	 * list of due timers by date, FIFO among equals.
+	 */
+	pvlist_for_each_entry_reverse(__tmobj, expired, next) {
 		if (timespec_before_or_same(&__tmobj->itspec.it_value,
-					    &tmobj->itspec.it_value))
-			break;
+					    &tmobj->itspec.it_value)) {
+			atpvh(&__tmobj->next, &tmobj->next);
+			return;
+		}
+	}
+
+	pvlist_prepend(&tmobj->next, expired);
+}
+
+static void timerobj_collect(const struct timespec *now,
+			     struct pvlistobj *expired)
+{
+	ticks_t date = (ticks_t)timespec_scalar(now) >> TW_TICK_SHIFT, next;
+	struct timerobj *tmobj, *tmp;
+	struct pvlistobj *slot;
+
+	while ((sticks_t)(date - svwheel.base) > 0) {
+		/* Anything queued to a past slot is due. */
+		slot = &svwheel.slots[svwheel.base & TW_SLOT_MASK];
+		while (!pvlist_empty(slot)) {
+			tmobj = pvlist_first_entry(slot, typeof(*tmobj), next);
+			timerobj_dequeue(tmobj);
+			timerobj_sort_expired(tmobj, expired);
+		}
+		next = timerobj_next_stop();
+		if ((sticks_t)(next - date) > 0)
+			next = date;
+		svwheel.base = next;
+		timerobj_cascade();
 	}
 
-	atpvh(&__tmobj->next, &tmobj->next);
+	slot = &svwheel.slots[svwheel.base & TW_SLOT_MASK];
+	pvlist_for_each_entry_safe(tmobj, tmp, slot, next) {
+		if (timespec_after(&tmobj->itspec.it_value, now))
+			continue;
+		timerobj_dequeue(tmobj);
+		timerobj_sort_expired(tmobj, expired);
+	}
 }
 
 static int server_prologue(void *arg)
@@ -100,6 +254,7 @@ static void *timerobj_server(void *arg)
 {
 	void (*handler)(struct timerobj *tmobj);
 	struct timespec now, value, interval;
+	DEFINE_PRIVATE_LIST(expired);
 	struct timerobj *tmobj;
 	sigset_t set;
 	int sig, ret;
@@ -119,24 +274,31 @@ static void *timerobj_server(void *arg)
 
 		__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
 
-		while (!pvlist_empty(&svtimers)) {
-			tmobj = pvlist_first_entry(&svtimers, typeof(*tmobj),
-						   next);
-
-			value = tmobj->itspec.it_value;
-			interval = tmobj->itspec.it_interval;
-			handler = tmobj->handler;
-			if (timespec_after(&value, &now))
+		/*
+		 * Periodic timers may be due again by the time we are
+		 * done with the current batch, keep collecting until
+		 * nothing is left to fire.
+		 */
+		for (;;) {
+			timerobj_collect(&now, &expired);
+			if (pvlist_empty(&expired))
 				break;
-			pvlist_remove_init(&tmobj->next);
-			if (interval.tv_sec > 0 || interval.tv_nsec > 0) {
-				timespec_add(&tmobj->itspec.it_value,
-					     &value, &interval);
-				timerobj_enqueue(tmobj);
-			}
-			write_unlock(&svlock);
-			handler(tmobj);
-			write_lock_nocancel(&svlock);
+			do {
+				tmobj = pvlist_first_entry(&expired,
+							   typeof(*tmobj), next);
+				pvlist_remove_init(&tmobj->next);
+				value = tmobj->itspec.it_value;
+				interval = tmobj->itspec.it_interval;
+				handler = tmobj->handler;
+				if (interval.tv_sec > 0 || interval.tv_nsec > 0) {
+					timespec_add(&tmobj->itspec.it_value,
+						     &value, &interval);
+					timerobj_enqueue(tmobj);
+				}
+				write_unlock(&svlock);
+				handler(tmobj);
+				write_lock_nocancel(&svlock);
+			} while (!pvlist_empty(&expired));
 		}
 
 		write_unlock(&svlock);
@@ -183,6 +345,7 @@ int timerobj_init(struct timerobj *tmobj)
 		return __bt(-EAGAIN);
 
 	tmobj->handler = NULL;
+	tmobj->spot = TW_UNQUEUED;
 	pvholder_init(&tmobj->next); /* so we may use pvholder_linked() */
 
 	memset(&sev, 0, sizeof(sev));
@@ -210,7 +373,7 @@ void timerobj_destroy(struct timerobj *tmobj) /* lock held, dropped */
 	write_lock_nocancel(&svlock);
 
 	if (pvholder_linked(&tmobj->next))
-		pvlist_remove_init(&tmobj->next);
+		timerobj_dequeue(tmobj);
 
 	write_unlock(&svlock);
 
@@ -236,8 +399,8 @@ int timerobj_start(struct timerobj *tmobj,
 	 */
 	write_lock_nocancel(&svlock);
 
-       if (pvholder_linked(&tmobj->next))
-               pvlist_remove_init(&tmobj->next);
+	if (pvholder_linked(&tmobj->next))
+		timerobj_dequeue(tmobj);
 
 	tmobj->handler = handler;
 	tmobj->itspec = *it;
@@ -262,7 +425,7 @@ int timerobj_stop(struct timerobj *tmobj) /* lock held, dropped */
 	write_lock_nocancel(&svlock);
 
 	if (pvholder_linked(&tmobj->next))
-		pvlist_remove_init(&tmobj->next);
+		timerobj_dequeue(tmobj);
 
 	__RT(timer_settime(tmobj->timer, 0, &itimer_stop, NULL));
 	tmobj->handler = NULL;
@@ -275,7 +438,14 @@ int timerobj_stop(struct timerobj *tmobj) /* lock held, dropped */
 int timerobj_pkg_init(void)
 {
 	pthread_mutexattr_t mattr;
-	int ret;
+	struct timespec now;
+	int ret, n;
+
+	for (n = 0; n < TW_LEVELS * TW_SLOTS; n++)
+		pvlist_init(&svwheel.slots[n]);
+
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
+	svwheel.base = (ticks_t)timespec_scalar(&now) >> TW_TICK_SHIFT;
 
 	pthread_mutexattr_init(&mattr);
 	pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
@@ -244,7 +244,8 @@ u_long q_vident(const char *name, u_long node, u_long *qid_r)
 }
 
 static u_long __q_send_inner(struct psos_queue *q, unsigned long flags,
-			     u_long *buffer, u_long bytes)
+			     u_long *buffer, u_long bytes,
+			     struct msgholder *loan)
 {
 	struct psos_queue_wait *wait;
 	struct threadobj *thobj;
@@ -253,31 +254,41 @@ static u_long __q_send_inner(struct psos_queue *q, unsigned long flags,
 
 	thobj = syncobj_peek_grant(&q->sobj);
 	if (thobj && threadobj_local_p(thobj)) {
-		/* Fast path: direct copy to the receiver's buffer. */
 		wait = threadobj_get_wait(thobj);
-		maxbytes = wait->size;
-		if (bytes > maxbytes)
-			bytes = maxbytes;
-		if (bytes > 0)
-			memcpy(__mptr(wait->ptr), buffer, bytes);
-		wait->size = bytes;
-		goto done;
+		/*
+		 * Fast path: direct copy to the receiver's buffer,
+		 * unless it waits for a loaned one.
+		 */
+		if (__mptr_nullable(wait->ptr)) {
+			maxbytes = wait->size;
+			if (bytes > maxbytes)
+				bytes = maxbytes;
+			if (bytes > 0)
+				memcpy(__mptr(wait->ptr), buffer, bytes);
+			wait->size = bytes;
+			if (loan)
+				xnfree(loan);
+			goto done;
+		}
 	}
 
 	if ((q->flags & Q_LIMIT) && q->msgcount >= q->maxmsg)
 		return ERR_QFULL;
 
-	msg = xnmalloc(bytes + sizeof(*msg));
-	if (msg == NULL)
-		return ERR_NOMGB;
+	if (loan)
+		msg = loan;
+	else {
+		msg = xnmalloc(bytes + sizeof(*msg));
+		if (msg == NULL)
+			return ERR_NOMGB;
+		if (bytes > 0)
+			memcpy(msg + 1, buffer, bytes);
+	}
 
 	q->msgcount++;
 	msg->size = bytes;
 	holder_init(&msg->link);
 
-	if (bytes > 0)
-		memcpy(msg + 1, buffer, bytes);
-
 	if (flags & Q_JAMMED)
 		list_prepend(&msg->link, &q->msg_list);
 	else
@@ -299,7 +310,8 @@ done:
 	return SUCCESS;
 }
 
-static u_long __q_send(u_long qid, u_long flags, u_long *buffer, u_long bytes)
+static u_long __q_send(u_long qid, u_long flags, u_long *buffer, u_long bytes,
+		       struct msgholder *loan)
 {
 	struct syncstate syns;
 	struct psos_queue *q;
@@ -327,7 +339,7 @@ static u_long __q_send(u_long qid, u_long flags, u_long *buffer, u_long bytes)
 		goto fail;
 	}
 
-	ret = __q_send_inner(q, flags, buffer, bytes);
+	ret = __q_send_inner(q, flags, buffer, bytes, loan);
 fail:
 	syncobj_unlock(&q->sobj, &syns);
 out:
@@ -338,22 +350,22 @@ out:
 
 u_long q_send(u_long qid, u_long msgbuf[4])
 {
-	return __q_send(qid, 0, msgbuf, sizeof(u_long[4]));
+	return __q_send(qid, 0, msgbuf, sizeof(u_long[4]), NULL);
 }
 
 u_long q_vsend(u_long qid, void *msgbuf, u_long msglen)
 {
-	return __q_send(qid, Q_VARIABLE, msgbuf, msglen);
+	return __q_send(qid, Q_VARIABLE, msgbuf, msglen, NULL);
 }
 
 u_long q_urgent(u_long qid, u_long msgbuf[4])
 {
-	return __q_send(qid, Q_JAMMED, msgbuf, sizeof(u_long[4]));
+	return __q_send(qid, Q_JAMMED, msgbuf, sizeof(u_long[4]), NULL);
 }
 
 u_long q_vurgent(u_long qid, void *msgbuf, u_long msglen)
 {
-	return __q_send(qid, Q_VARIABLE | Q_JAMMED, msgbuf, msglen);
+	return __q_send(qid, Q_VARIABLE | Q_JAMMED, msgbuf, msglen, NULL);
 }
 
 static u_long __q_broadcast(u_long qid, u_long flags,
@@ -388,7 +400,7 @@ static u_long __q_broadcast(u_long qid, u_long flags,
 	/* Release all pending tasks atomically. */
 	*count_r = 0;
 	while (syncobj_grant_wait_p(&q->sobj)) {
-		ret = __q_send_inner(q, flags, buffer, bytes);
+		ret = __q_send_inner(q, flags, buffer, bytes, NULL);
 		if (ret)
 			break;
 		(*count_r)++;
@@ -412,7 +424,8 @@ u_long q_vbroadcast(u_long qid, void *msgbuf, u_long msglen, u_long *count_r)
 }
 
 static u_long __q_receive(u_long qid, u_long flags, u_long timeout,
-			  void *buffer, u_long msglen, u_long *msglen_r)
+			  void *buffer, u_long msglen, u_long *msglen_r,
+			  void **bufp)
 {
 	struct psos_queue_wait *wait = NULL;
 	struct timespec ts, *timespec;
@@ -443,6 +456,11 @@ retry:
 		q->msgcount--;
 		msg = list_pop_entry(&q->msg_list, struct msgholder, link);
 		nbytes = msg->size;
+		if (bufp) {
+			/* The caller gets the message buffer on loan. */
+			*bufp = msg + 1;
+			goto done;
+		}
 		if (nbytes > msglen)
 			nbytes = msglen;
 		if (nbytes > 0)
@@ -462,8 +480,12 @@ retry:
 	} else
 		timespec = NULL;
 
+	/*
+	 * A NULL buffer tells the sender not to copy the message
+	 * directly, but to queue it for us to pick it up.
+	 */
 	wait = threadobj_prepare_wait(struct psos_queue_wait);
-	wait->ptr = __moff(buffer);
+	wait->ptr = __moff_nullable(buffer);
 	wait->size = msglen;
 
 	ret = syncobj_wait_grant(&q->sobj, timespec, &syns);
@@ -496,12 +518,121 @@ out:
 u_long q_receive(u_long qid, u_long flags, u_long timeout, u_long msgbuf[4])
 {
 	return __q_receive(qid, flags & ~Q_VARIABLE,
-			   timeout, msgbuf, sizeof(u_long[4]), NULL);
+			   timeout, msgbuf, sizeof(u_long[4]), NULL, NULL);
 }
 
 u_long q_vreceive(u_long qid, u_long flags, u_long timeout,
 		  void *msgbuf, u_long msglen, u_long *msglen_r)
 {
 	return __q_receive(qid, flags | Q_VARIABLE,
-			   timeout, msgbuf, msglen, msglen_r);
+			   timeout, msgbuf, msglen, msglen_r, NULL);
+}
+
+/*
+ * The following calls are Xenomai extensions to variable-length
+ * queues, which let the sender build a message directly into a
+ * buffer obtained from the message storage, and the receiver pick
+ * the message up from that same buffer, so that no copy is
+ * involved. Such buffers are released by q_vretbuf(), or when sent
+ * by q_vsendbuf().
+ */
+u_long q_vgetbuf(u_long qid, u_long msglen, void **bufaddr)
+{
+	struct msgholder *msg;
+	struct psos_queue *q;
+	struct service svc;
+	int ret;
+
+	q = get_queue_from_id(qid, &ret);
+	if (q == NULL)
+		return ret;
+
+	if ((q->flags & Q_VARIABLE) == 0)
+		return ERR_NOTVARQ;
+
+	if (msglen > q->maxlen)
+		return ERR_MSGSIZ;
+
+	CANCEL_DEFER(svc);
+	msg = xnmalloc(msglen + sizeof(*msg));
+	CANCEL_RESTORE(svc);
+	if (msg == NULL)
+		return ERR_NOMGB;
+
+	msg->size = msglen;
+	*bufaddr = msg + 1;
+
+	return SUCCESS;
+}
+
+static struct msgholder *get_loaned_msg(void *buf)
+{
+	struct msgholder *msg;
+	size_t bsize;
+
+	if (buf == NULL)
+		return NULL;
+
+	/*
+	 * Loaned buffers are obtained from q_vgetbuf() or
+	 * q_vreceivebuf(), both pulling them from the main heap.
+	 */
+	msg = (struct msgholder *)buf - 1;
+	bsize = xnvalidate(msg);
+	if (bsize < sizeof(*msg) || msg->size > bsize - sizeof(*msg))
+		return NULL;
+
+	return msg;
+}
+
+u_long q_vsendbuf(u_long qid, void *buf, u_long msglen)
+{
+	struct msgholder *msg;
+	struct service svc;
+
+	CANCEL_DEFER(svc);
+	msg = get_loaned_msg(buf);
+	CANCEL_RESTORE(svc);
+	if (msg == NULL)
+		return ERR_BUFADDR;
+
+	/* Upon failure, the buffer remains on loan to the caller. */
+	if (msglen > msg->size)
+		return ERR_MSGSIZ;
+
+	return __q_send(qid, Q_VARIABLE, buf, msglen, msg);
+}
+
+u_long q_vreceivebuf(u_long qid, u_long flags, u_long timeout,
+		     void **bufaddr, u_long *msglen_r)
+{
+	return __q_receive(qid, flags | Q_VARIABLE,
+			   timeout, NULL, 0, msglen_r, bufaddr);
+}
+
+u_long q_vretbuf(u_long qid, void *buf)
+{
+	struct msgholder *msg;
+	struct psos_queue *q;
+	struct service svc;
+	int ret;
+
+	q = get_queue_from_id(qid, &ret);
+	if (q == NULL)
+		return ret;
+
+	CANCEL_DEFER(svc);
+
+	msg = get_loaned_msg(buf);
+	if (msg == NULL) {
+		ret = ERR_BUFADDR;
+		goto out;
+	}
+
+	xnfree(msg);
+	ret = SUCCESS;
+out:
+	CANCEL_RESTORE(svc);
+
+	return ret;
 }
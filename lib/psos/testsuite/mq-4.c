@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <copperplate/traceobj.h>
+#include <boilerplate/tunables.h>
+#include <psos/psos.h>
+
+/*
+ * Stream large frames between two tasks, copying them in and out
+ * of a variable-length queue, then getting buffers on loan from the
+ * queue instead.
+ */
+
+#define NFRAMES    20000
+#define QDEPTH     8
+#define MAXFRAME   (64 * 1024)
+
+static struct traceobj trobj;
+
+static u_long qid;
+
+static void producer_task(u_long framesz, u_long zerocopy,
+			  u_long a2, u_long a3)
+{
+	static char frame[MAXFRAME];
+	u_long seq;
+	void *buf;
+	int ret;
+
+	traceobj_enter(&trobj);
+
+	for (seq = 0; seq < NFRAMES; seq++) {
+		for (;;) {
+			if (zerocopy) {
+				ret = q_vgetbuf(qid, framesz, &buf);
+				if (ret == ERR_NOMGB)
+					ret = ERR_QFULL;
+				else {
+					traceobj_assert(&trobj, ret == SUCCESS);
+					*(u_long *)buf = seq;
+					ret = q_vsendbuf(qid, buf, framesz);
+					if (ret == ERR_QFULL)
+						q_vretbuf(qid, buf);
+				}
+			} else {
+				*(u_long *)frame = seq;
+				ret = q_vsend(qid, frame, framesz);
+			}
+			if (ret != ERR_QFULL)
+				break;
+			/* Queue full, let the consumer catch up. */
+			tm_wkafter(0);
+		}
+		traceobj_assert(&trobj, ret == SUCCESS);
+	}
+
+	traceobj_exit(&trobj);
+}
+
+static void consumer_task(u_long framesz, u_long zerocopy,
+			  u_long a2, u_long a3)
+{
+	static char frame[MAXFRAME];
+	u_long seq, len;
+	void *buf;
+	int ret;
+
+	traceobj_enter(&trobj);
+
+	for (seq = 0; seq < NFRAMES; seq++) {
+		if (zerocopy) {
+			ret = q_vreceivebuf(qid, Q_WAIT, 0, &buf, &len);
+			traceobj_assert(&trobj, ret == SUCCESS && len == framesz);
+			traceobj_assert(&trobj, *(u_long *)buf == seq);
+			ret = q_vretbuf(qid, buf);
+			traceobj_assert(&trobj, ret == SUCCESS);
+		} else {
+			ret = q_vreceive(qid, Q_WAIT, 0, frame, framesz, &len);
+			traceobj_assert(&trobj, ret == SUCCESS && len == framesz);
+			traceobj_assert(&trobj, *(u_long *)frame == seq);
+		}
+	}
+
+	traceobj_exit(&trobj);
+}
+
+static void run_stream(u_long framesz, u_long zerocopy)
+{
+	u_long args[] = { framesz, zerocopy, 0, 0 }, ctid, ptid;
+	struct timespec start, end;
+	double elapsed;
+	int ret;
+
+	ret = q_vcreate("QUEUE", Q_LIMIT, QDEPTH, framesz, &qid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	ret = t_create("CONS", 10, 0, 0, 0, &ctid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = t_start(ctid, 0, consumer_task, args);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = t_create("PROD", 10, 0, 0, 0, &ptid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = t_start(ptid, 0, producer_task, args);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	traceobj_join(&trobj);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9;
+
+	ret = q_vdelete(qid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	if (get_runtime_tunable(verbosity_level) > 0)
+		printf("%2lu KB frames, %-9s %8.0f frames/s, %6.0f MB/s\n",
+		       framesz / 1024, zerocopy ? "loaned:" : "copied:",
+		       NFRAMES / elapsed, NFRAMES * framesz / elapsed / 1e6);
+}
+
+int main(int argc, char *const argv[])
+{
+	void *buf;
+	int ret;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	ret = q_vcreate("QUEUE", Q_LIMIT, 1, 16, &qid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = q_vgetbuf(qid, 32, &buf);
+	traceobj_assert(&trobj, ret == ERR_MSGSIZ);
+
+	ret = q_vgetbuf(qid, 16, &buf);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = q_vsendbuf(qid, buf, 16);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = q_vreceivebuf(qid, Q_NOWAIT, 0, &buf, NULL);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = q_vretbuf(qid, buf);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = q_vdelete(qid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	run_stream(8 * 1024, 0);
+	run_stream(8 * 1024, 1);
+	run_stream(64 * 1024, 0);
+	run_stream(64 * 1024, 1);
+
+	exit(0);
+}
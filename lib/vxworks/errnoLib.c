@@ -78,6 +78,9 @@ void printErrno(int status)
 	case S_memLib_NOT_ENOUGH_MEMORY:
 		msg = "S_memLib_NOT_ENOUGH_MEMORY";
 		break;
+	case S_memLib_BLOCK_ERROR:
+		msg = "S_memLib_BLOCK_ERROR";
+		break;
 	default:
 		if (strerror_r(status, buf, sizeof(buf)))
 			msg = "Unknown error";
@@ -164,7 +164,8 @@ STATUS msgQDelete(MSG_Q_ID msgQId)
 	return OK;
 }
 
-int msgQReceive(MSG_Q_ID msgQId, char *buffer, UINT maxNBytes, int timeout)
+static int __msgQReceive(MSG_Q_ID msgQId, char *buffer, UINT maxNBytes,
+			 int timeout, char **bufp)
 {
 	struct wind_queue_wait *wait = NULL;
 	struct timespec ts, *timespec;
@@ -198,6 +199,12 @@ retry:
 		mq->msgcount--;
 		msg = list_pop_entry(&mq->msg_list, struct msgholder, link);
 		nbytes = msg->size;
+		if (bufp) {
+			/* The caller gets the message buffer on loan. */
+			*bufp = (char *)(msg + 1);
+			syncobj_drain(&mq->sobj);
+			goto done;
+		}
 		if (nbytes > maxNBytes)
 			nbytes = maxNBytes;
 		if (nbytes > 0)
@@ -218,8 +225,12 @@ retry:
 	} else
 		timespec = NULL;
 
+	/*
+	 * A NULL buffer tells the sender not to copy the message
+	 * directly, but to queue it for us to pick it up.
+	 */
 	wait = threadobj_prepare_wait(struct wind_queue_wait);
-	wait->ptr = __moff(buffer);
+	wait->ptr = __moff_nullable(buffer);
 	wait->size = maxNBytes;
 
 	ret = syncobj_wait_grant(&mq->sobj, timespec, &syns);
@@ -231,9 +242,9 @@ retry:
 		errno = S_objLib_OBJ_TIMEOUT;
 		goto done;
 	}
-	nbytes = wait->size;
-	if (nbytes == -1L)	/* No direct copy? */
+	if (wait->size == -1UL)	/* No direct copy? */
 		goto retry;
+	nbytes = wait->size;
 	syncobj_drain(&mq->sobj);
 done:
 	syncobj_unlock(&mq->sobj, &syns);
@@ -246,8 +257,18 @@ out:
 	return nbytes;
 }
 
-STATUS msgQSend(MSG_Q_ID msgQId, const char *buffer, UINT bytes,
-		int timeout, int prio)
+int msgQReceive(MSG_Q_ID msgQId, char *buffer, UINT maxNBytes, int timeout)
+{
+	return __msgQReceive(msgQId, buffer, maxNBytes, timeout, NULL);
+}
+
+int msgQReceiveBuf(MSG_Q_ID msgQId, char **bufp, int timeout)
+{
+	return __msgQReceive(msgQId, NULL, 0, timeout, bufp);
+}
+
+static STATUS __msgQSend(MSG_Q_ID msgQId, const char *buffer, UINT bytes,
+			 int timeout, int prio, struct msgholder *loan)
 {
 	struct timespec ts, *timespec;
 	struct wind_queue_wait *wait;
@@ -277,17 +298,25 @@ STATUS msgQSend(MSG_Q_ID msgQId, const char *buffer, UINT bytes,
 		goto fail;
 	}
 
+retry:
 	thobj = syncobj_peek_grant(&mq->sobj);
 	if (thobj && threadobj_local_p(thobj)) {
-		/* Fast path: direct copy to the receiver's buffer. */
 		wait = threadobj_get_wait(thobj);
-		maxbytes = wait->size;
-		if (bytes > maxbytes)
-			bytes = maxbytes;
-		if (bytes > 0)
-			memcpy(__mptr(wait->ptr), buffer, bytes);
-		wait->size = bytes;
-		goto done;
+		/*
+		 * Fast path: direct copy to the receiver's buffer,
+		 * unless it waits for a loaned one.
+		 */
+		if (__mptr_nullable(wait->ptr)) {
+			maxbytes = wait->size;
+			if (bytes > maxbytes)
+				bytes = maxbytes;
+			if (bytes > 0)
+				memcpy(__mptr(wait->ptr), buffer, bytes);
+			wait->size = bytes;
+			if (loan)
+				heapobj_free(&mq->pool, loan);
+			goto done;
+		}
 	}
 
 	if (mq->msgcount < mq->maxmsg)
@@ -323,12 +352,21 @@ STATUS msgQSend(MSG_Q_ID msgQId, const char *buffer, UINT bytes,
 		}
 	} while (mq->msgcount >= mq->maxmsg);
 
+	/* A receiver may have started waiting meanwhile. */
+	goto retry;
+
 enqueue:
-	msg = heapobj_alloc(&mq->pool, bytes + sizeof(*msg));
-	if (msg == NULL) {
-		errno = S_memLib_NOT_ENOUGH_MEMORY;
-		ret = ERROR;
-		goto fail;
+	if (loan)
+		msg = loan;
+	else {
+		msg = heapobj_alloc(&mq->pool, bytes + sizeof(*msg));
+		if (msg == NULL) {
+			errno = S_memLib_NOT_ENOUGH_MEMORY;
+			ret = ERROR;
+			goto fail;
+		}
+		if (bytes > 0)
+			memcpy(msg + 1, buffer, bytes);
 	}
 
 	mq->msgcount++;
@@ -336,9 +374,6 @@ enqueue:
 	msg->size = bytes;
 	holder_init(&msg->link);
 
-	if (bytes > 0)
-		memcpy(msg + 1, buffer, bytes);
-
 	if (prio == MSG_PRI_NORMAL)
 		list_append(&msg->link, &mq->msg_list);
 	else
@@ -366,6 +401,115 @@ out:
 	return ret;
 }
 
+STATUS msgQSend(MSG_Q_ID msgQId, const char *buffer, UINT bytes,
+		int timeout, int prio)
+{
+	return __msgQSend(msgQId, buffer, bytes, timeout, prio, NULL);
+}
+
+/*
+ * The following calls are Xenomai extensions, which let the sender
+ * build a message directly into a buffer loaned from the queue
+ * pool, and the receiver pick the message up from that same buffer,
+ * so that no copy is involved. Loaned buffers are returned to the
+ * pool by msgQFreeBuf(), or when sent by msgQSendBuf().
+ */
+char *msgQAllocBuf(MSG_Q_ID msgQId, UINT bytes)
+{
+	struct msgholder *msg;
+	struct wind_mq *mq;
+	struct service svc;
+
+	mq = find_mq_from_id(msgQId);
+	if (mq == NULL) {
+		errno = S_objLib_OBJ_ID_ERROR;
+		return NULL;
+	}
+
+	if (bytes > mq->msgsize) {
+		errno = S_msgQLib_INVALID_MSG_LENGTH;
+		return NULL;
+	}
+
+	CANCEL_DEFER(svc);
+	msg = heapobj_alloc(&mq->pool, bytes + sizeof(*msg));
+	CANCEL_RESTORE(svc);
+	if (msg == NULL) {
+		errno = S_memLib_NOT_ENOUGH_MEMORY;
+		return NULL;
+	}
+
+	msg->size = bytes;
+
+	return (char *)(msg + 1);
+}
+
+static struct msgholder *get_loaned_msg(struct wind_mq *mq, char *buffer)
+{
+	struct msgholder *msg;
+
+	if (buffer == NULL)
+		return NULL;
+
+	msg = (struct msgholder *)buffer - 1;
+	if (!heapobj_validate(&mq->pool, msg))
+		return NULL;
+
+	return msg;
+}
+
+STATUS msgQSendBuf(MSG_Q_ID msgQId, char *buffer, UINT bytes,
+		   int timeout, int prio)
+{
+	struct msgholder *msg;
+	struct wind_mq *mq;
+
+	mq = find_mq_from_id(msgQId);
+	if (mq == NULL) {
+		errno = S_objLib_OBJ_ID_ERROR;
+		return ERROR;
+	}
+
+	msg = get_loaned_msg(mq, buffer);
+	if (msg == NULL) {
+		errno = S_memLib_BLOCK_ERROR;
+		return ERROR;
+	}
+
+	/* Upon failure, the buffer remains on loan to the caller. */
+	if (bytes > msg->size) {
+		errno = S_msgQLib_INVALID_MSG_LENGTH;
+		return ERROR;
+	}
+
+	return __msgQSend(msgQId, buffer, bytes, timeout, prio, msg);
+}
+
+STATUS msgQFreeBuf(MSG_Q_ID msgQId, char *buffer)
+{
+	struct msgholder *msg;
+	struct wind_mq *mq;
+	struct service svc;
+
+	mq = find_mq_from_id(msgQId);
+	if (mq == NULL) {
+		errno = S_objLib_OBJ_ID_ERROR;
+		return ERROR;
+	}
+
+	msg = get_loaned_msg(mq, buffer);
+	if (msg == NULL) {
+		errno = S_memLib_BLOCK_ERROR;
+		return ERROR;
+	}
+
+	CANCEL_DEFER(svc);
+	heapobj_free(&mq->pool, msg);
+	CANCEL_RESTORE(svc);
+
+	return OK;
+}
+
 int msgQNumMsgs(MSG_Q_ID msgQId)
 {
 	struct syncstate syns;
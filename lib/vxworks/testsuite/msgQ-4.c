@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <copperplate/traceobj.h>
+#include <boilerplate/tunables.h>
+#include <vxworks/errnoLib.h>
+#include <vxworks/taskLib.h>
+#include <vxworks/msgQLib.h>
+
+/*
+ * Stream large frames between two tasks, copying them in and out
+ * of the queue, then loaning buffers from the queue pool instead.
+ * The producer writes each frame entirely and the consumer checks
+ * it entirely in both modes, so that only the transfer cost differs.
+ */
+
+#define NFRAMES    20000
+#define QDEPTH     8
+#define MAXFRAME   (64 * 1024)
+
+static struct traceobj trobj;
+
+static MSG_Q_ID qid;
+
+static long framesz;
+
+static int zerocopy;
+
+static void fill_frame(char *buf, int seq)
+{
+	int *p = (int *)buf, n;
+
+	for (n = 0; n < framesz / (long)sizeof(int); n++)
+		p[n] = seq + n;
+}
+
+static int check_frame(const char *buf, int seq)
+{
+	const int *p = (const int *)buf;
+	int n;
+
+	for (n = 0; n < framesz / (long)sizeof(int); n++)
+		if (p[n] != seq + n)
+			return 0;
+
+	return 1;
+}
+
+static void producerTask(long arg, ...)
+{
+	static char frame[MAXFRAME];
+	int ret, seq;
+	char *buf;
+
+	traceobj_enter(&trobj);
+
+	for (seq = 0; seq < NFRAMES; seq++) {
+		if (zerocopy) {
+			/* Pool exhausted, let the consumer catch up. */
+			while ((buf = msgQAllocBuf(qid, framesz)) == NULL) {
+				traceobj_assert(&trobj, errno == S_memLib_NOT_ENOUGH_MEMORY);
+				taskDelay(0);
+			}
+			fill_frame(buf, seq);
+			ret = msgQSendBuf(qid, buf, framesz,
+					  WAIT_FOREVER, MSG_PRI_NORMAL);
+		} else {
+			fill_frame(frame, seq);
+			ret = msgQSend(qid, frame, framesz,
+				       WAIT_FOREVER, MSG_PRI_NORMAL);
+		}
+		traceobj_assert(&trobj, ret == OK);
+	}
+
+	traceobj_exit(&trobj);
+}
+
+static void consumerTask(long arg, ...)
+{
+	static char frame[MAXFRAME];
+	int ret, seq;
+	char *buf;
+
+	traceobj_enter(&trobj);
+
+	for (seq = 0; seq < NFRAMES; seq++) {
+		if (zerocopy) {
+			ret = msgQReceiveBuf(qid, &buf, WAIT_FOREVER);
+			traceobj_assert(&trobj, ret == framesz);
+			traceobj_assert(&trobj, check_frame(buf, seq));
+			ret = msgQFreeBuf(qid, buf);
+			traceobj_assert(&trobj, ret == OK);
+		} else {
+			ret = msgQReceive(qid, frame, framesz, WAIT_FOREVER);
+			traceobj_assert(&trobj, ret == framesz);
+			traceobj_assert(&trobj, check_frame(frame, seq));
+		}
+	}
+
+	traceobj_exit(&trobj);
+}
+
+static void run_stream(long size, int loan)
+{
+	char cname[32], pname[32];
+	struct timespec start, end;
+	static int runs;
+	TASK_ID ctid, ptid;
+	double elapsed;
+	int ret;
+
+	/*
+	 * Tasks of the previous run may not be unregistered yet,
+	 * although they are done.
+	 */
+	sprintf(cname, "consumerTask%d", runs);
+	sprintf(pname, "producerTask%d", runs++);
+
+	framesz = size;
+	zerocopy = loan;
+
+	qid = msgQCreate(QDEPTH, framesz, MSG_Q_FIFO);
+	traceobj_assert(&trobj, qid != 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	ctid = taskSpawn(cname, 50, 0, 0, consumerTask,
+			 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	traceobj_assert(&trobj, ctid != ERROR);
+
+	ptid = taskSpawn(pname, 50, 0, 0, producerTask,
+			 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	traceobj_assert(&trobj, ptid != ERROR);
+
+	traceobj_join(&trobj);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9;
+
+	ret = msgQDelete(qid);
+	traceobj_assert(&trobj, ret == OK);
+
+	if (get_runtime_tunable(verbosity_level) > 0)
+		printf("%2ld KB frames, %-9s %8.0f frames/s, %6.0f MB/s\n",
+		       framesz / 1024, zerocopy ? "loaned:" : "copied:",
+		       NFRAMES / elapsed, NFRAMES * framesz / elapsed / 1e6);
+}
+
+int main(int argc, char *const argv[])
+{
+	char *buf;
+	int ret;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	qid = msgQCreate(1, 16, MSG_Q_FIFO);
+	traceobj_assert(&trobj, qid != 0);
+
+	buf = msgQAllocBuf(qid, 32);
+	traceobj_assert(&trobj, buf == NULL &&
+			errno == S_msgQLib_INVALID_MSG_LENGTH);
+
+	buf = msgQAllocBuf(qid, 16);
+	traceobj_assert(&trobj, buf != NULL);
+	ret = msgQFreeBuf(qid, buf);
+	traceobj_assert(&trobj, ret == OK);
+
+	ret = msgQDelete(qid);
+	traceobj_assert(&trobj, ret == OK);
+
+	run_stream(8 * 1024, 0);
+	run_stream(8 * 1024, 1);
+	run_stream(64 * 1024, 0);
+	run_stream(64 * 1024, 1);
+
+	exit(0);
+}
@@ -31,6 +31,7 @@
 #include <sys/time.h>
 #include <boilerplate/ancillaries.h>
 #include <boilerplate/atomic.h>
+#include <boilerplate/histogram.h>
 #include <cobalt/uapi/kernel/vdso.h>
 #include <xeno_config.h>
 
@@ -56,6 +57,9 @@ pthread_mutex_t lock;
 static uint64_t last_common = 0;
 static clockid_t clock_id = CLOCK_REALTIME;
 static cpu_set_t cpu_realtime_set, cpu_online_set;
+static const char *real_clock_name = "CLOCK_REALTIME";
+static const char *json_file;
+static int max_cpu, cpus;
 
 struct per_cpu_data {
 	uint64_t first_tod, first_clock;
@@ -64,6 +68,8 @@ struct per_cpu_data {
 	double drift;
 	unsigned long warps;
 	uint64_t max_warp;
+	/* Deltas between successive readings across CPUs, in ns. */
+	struct histogram deltas;
 	pthread_t thread;
 } *per_cpu_data;
 
@@ -185,6 +191,8 @@ static void check_time_warps(struct per_cpu_data *per_cpu_data)
 		release_lock(&lock);
 
 		incr = now - last;
+		if (last)
+			histogram_add(&per_cpu_data->deltas, incr);
 		if (incr < 0) {
 			acquire_lock(&lock);
 			per_cpu_data->warps++;
@@ -226,6 +234,57 @@ static void sighand(int signal)
 	exit(0);
 }
 
+static void dump_deltas(void)
+{
+	const char *sep = "";
+	struct histogram *h;
+	FILE *fp = NULL;
+	char name[16];
+	int i;
+
+	if (json_file) {
+		if (strcmp(json_file, "-") == 0)
+			fp = stdout;
+		else
+			fp = fopen(json_file, "w");
+		if (fp == NULL)
+			warning("cannot open %s: %s", json_file, strerror(errno));
+	}
+
+	/* Skip the live table first. */
+	printf("\033[%dB\n", cpus);
+	printf("CPU    samples  delta p50 [us]  delta p99 [us] p99.999 [us] min delta [us]\n"
+	       "--- ---------- --------------- --------------- ------------ --------------\n");
+
+	if (fp)
+		fprintf(fp, "{\"tool\":\"clocktest\",\"clock\":\"%s\","
+			"\"unit\":\"ns\",\"histograms\":[", real_clock_name);
+
+	for (i = 0; i <= max_cpu; i++) {
+		if (!CPU_ISSET(i, &cpu_realtime_set))
+			continue;
+		h = &per_cpu_data[i].deltas;
+		printf("%3d %10llu %15.3f %15.3f %12.3f %14.3f\n", i,
+		       (unsigned long long)h->total,
+		       histogram_percentile(h, 50) / 1000.0,
+		       histogram_percentile(h, 99) / 1000.0,
+		       histogram_percentile(h, 99.999) / 1000.0,
+		       h->total ? h->min / 1000.0 : 0.0);
+		if (fp) {
+			snprintf(name, sizeof(name), "cpu%d", i);
+			fputs(sep, fp);
+			histogram_dump_json(h, fp, name);
+			sep = ",";
+		}
+	}
+
+	if (fp) {
+		fprintf(fp, "]}\n");
+		if (fp != stdout)
+			fclose(fp);
+	}
+}
+
 static clockid_t resolve_clock_name(const char *name,
 				    const char **real_name, int ext)
 {
@@ -299,14 +358,13 @@ static clockid_t resolve_clock_name(const char *name,
 
 int main(int argc, char *argv[])
 {
-	const char *clock_name = NULL, *real_clock_name = "CLOCK_REALTIME";
-	int max_cpu, cpus;
+	const char *clock_name = NULL;
 	int i;
 	int c;
 	int d = 0;
 	int ext = 0;
 
-	while ((c = getopt(argc, argv, "C:ET:D")) != EOF)
+	while ((c = getopt(argc, argv, "C:ET:Dj:")) != EOF)
 		switch (c) {
 		case 'C':
 			clock_name = optarg;
@@ -324,12 +382,17 @@ int main(int argc, char *argv[])
 			d = 1;
 			break;
 
+		case 'j':
+			json_file = optarg;
+			break;
+
 		default:
 			fprintf(stderr, "usage: clocktest [options]\n"
 				"  [-C <clock_id|clock_name>]   # tested clock, defaults to CLOCK_REALTIME\n"
 				"  [-E]                         # -C specifies extension clock\n"
 				"  [-T <test_duration_seconds>] # default=0, so ^C to end\n"
-				"  [-D]                         # print extra diagnostics for CLOCK_HOST_REALTIME\n");
+				"  [-D]                         # print extra diagnostics for CLOCK_HOST_REALTIME\n"
+				"  [-j <file>]                  # dump clock delta histograms to <file> in JSON format\n");
 			exit(2);
 		}
 
@@ -371,10 +434,15 @@ int main(int argc, char *argv[])
 		if (!CPU_ISSET(i, &cpu_realtime_set))
 			continue;
 		per_cpu_data[i].first_round = 1;
+		if (histogram_init(&per_cpu_data[i].deltas, 1000000000,
+				   HISTOGRAM_DEFAULT_SIGBITS))
+			error(1, ENOMEM, "histogram_init");
 		pthread_create(&per_cpu_data[i].thread, NULL, cpu_thread,
 			       (void *)(long)i);
 	}
 
+	atexit(dump_deltas);
+
 	printf("== Testing %s %s (%d)\n",
 	       ext ? "extension" : "built-in", real_clock_name, clock_id);
 	printf("CPU      ToD offset [us] ToD drift [us/s]      warps max delta [us]\n"
@@ -38,6 +38,7 @@
 #include <rtdm/testing.h>
 #include <rtdm/gpio.h>
 #include <boilerplate/trace.h>
+#include <boilerplate/histogram.h>
 #include <xenomai/init.h>
 #include <sys/mman.h>
 #include <getopt.h>
@@ -77,6 +78,9 @@ struct test_stat {
 	double outer_avg;
 	long *outer_hist_array;
 	long outer_hist_overflow;
+	/* Log-bucketed histograms, in nanoseconds. */
+	struct histogram inner_hdr;
+	struct histogram outer_hdr;
 };
 
 /* Struct for information */
@@ -92,6 +96,7 @@ struct test_info {
 	int fd_dev_intr;
 	int fd_dev_out;
 	char pin_controller[32];
+	const char *json_file;
 	pthread_t gpio_task;
 	int gpio_intr;
 	int gpio_out;
@@ -125,7 +130,8 @@ static void display_help(void)
 	       "                            default=0\n"
 	       "-k       --clockid          0 is CLOCK_REALTIME\n"
 	       "                            1 is CLOCK_MONOTONIC,\n"
-	       "                            default=1\n\n"
+	       "                            default=1\n"
+	       "-j       --json=FILE        dump latency histograms to FILE in JSON format\n\n"
 
 	       "e.g.     gpiobench -o 20 -i 21 -c pinctrl-bcm2835\n"
 		);
@@ -134,7 +140,7 @@ static void display_help(void)
 static void process_options(int argc, char *argv[])
 {
 	int c = 0;
-	static const char optstring[] = "h:p:m:l:c:b:i:o:k:q";
+	static const char optstring[] = "h:p:m:l:c:b:i:o:k:qj:";
 
 	struct option long_options[] = {
 		{ "bracetrace", required_argument, 0, 'b'},
@@ -147,6 +153,7 @@ static void process_options(int argc, char *argv[])
 		{ "pinctrl", required_argument, 0, 'c'},
 		{ "testmode", required_argument, 0, 'm'},
 		{ "clockid", required_argument, 0, 'k'},
+		{ "json", required_argument, 0, 'j'},
 		{ 0, 0, 0, 0},
 	};
 
@@ -195,6 +202,10 @@ static void process_options(int argc, char *argv[])
 				CLOCK_MONOTONIC : CLOCK_REALTIME;
 			break;
 
+		case 'j':
+			ti.json_file = optarg;
+			break;
+
 		default:
 			display_help();
 			exit(2);
@@ -214,6 +225,12 @@ static void process_options(int argc, char *argv[])
 		MAX_HIST : ti.max_histogram;
 	ti.ts.inner_hist_array = calloc(ti.max_histogram, sizeof(long));
 	ti.ts.outer_hist_array = calloc(ti.max_histogram, sizeof(long));
+
+	if (histogram_init(&ti.ts.inner_hdr, NS_PER_S, HISTOGRAM_DEFAULT_SIGBITS) ||
+	    histogram_init(&ti.ts.outer_hdr, NS_PER_S, HISTOGRAM_DEFAULT_SIGBITS)) {
+		printf("can't allocate histograms\n");
+		exit(1);
+	}
 }
 
 static int thread_msleep(unsigned int ms)
@@ -319,6 +336,9 @@ static int rw_gpio(int value, int index)
 	clock_gettime(ti.clockid, &timestamp);
 	gpio_read = calc_us(timestamp);
 
+	histogram_add(&ti.ts.inner_hdr, rdo.timestamp - gpio_write);
+	histogram_add(&ti.ts.outer_hdr, gpio_read - gpio_write);
+
 	inner_diff = (rdo.timestamp - gpio_write) / 1000;
 	outer_diff = (gpio_read - gpio_write) / 1000;
 
@@ -489,6 +509,38 @@ static void init_ti(void)
 	ti.ts.inner_avg = ti.ts.outer_avg = 0.0;
 }
 
+static void print_percentiles(struct histogram *h)
+{
+	printf("# Percentiles (p50 p99 p99.9 p99.999):");
+	printf(" %.3f %.3f %.3f %.3f",
+	       histogram_percentile(h, 50) / 1000.0,
+	       histogram_percentile(h, 99) / 1000.0,
+	       histogram_percentile(h, 99.9) / 1000.0,
+	       histogram_percentile(h, 99.999) / 1000.0);
+	printf("\n");
+}
+
+static void dump_json(void)
+{
+	FILE *fp;
+
+	fp = strcmp(ti.json_file, "-") ? fopen(ti.json_file, "w") : stdout;
+	if (fp == NULL) {
+		printf("can't open %s\n", ti.json_file);
+		return;
+	}
+
+	fprintf(fp, "{\"tool\":\"gpiobench\",\"cycles\":%lu,"
+		"\"unit\":\"ns\",\"histograms\":[", ti.total_cycles);
+	histogram_dump_json(&ti.ts.inner_hdr, fp, "inner");
+	fputc(',', fp);
+	histogram_dump_json(&ti.ts.outer_hdr, fp, "outer");
+	fprintf(fp, "]}\n");
+
+	if (fp != stdout)
+		fclose(fp);
+}
+
 static void print_hist(void)
 {
 	int i;
@@ -531,6 +583,7 @@ static void print_hist(void)
 	printf("# Max Latencies:");
 	printf(" %05lu", ti.ts.inner_max);
 	printf("\n");
+	print_percentiles(&ti.ts.inner_hdr);
 
 	printf("\n");
 	printf("\n");
@@ -561,6 +614,10 @@ static void print_hist(void)
 	printf("# Max Latencies:");
 	printf(" %05lu", ti.ts.outer_max);
 	printf("\n");
+	print_percentiles(&ti.ts.outer_hdr);
+
+	if (ti.json_file)
+		dump_json();
 }
 
 static void cleanup(void)
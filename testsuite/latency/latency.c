@@ -38,6 +38,7 @@
 #include <xeno_config.h>
 #include <rtdm/testing.h>
 #include <boilerplate/trace.h>
+#include <boilerplate/histogram.h>
 #include <xenomai/init.h>
 
 pthread_t latency_task, display_task;
@@ -86,11 +87,17 @@ int test_loops = 0;		/* outer loop count */
 int histogram_size = HISTOGRAM_CELLS;
 int32_t *histogram_avg = NULL, *histogram_max = NULL, *histogram_min = NULL;
 
-char *do_gnuplot = NULL;
+char *do_gnuplot = NULL, *do_json = NULL;
 int do_histogram = 0, do_stats = 0, finished = 0;
 int bucketsize = 1000;		/* default = 1000ns, -B <size> to override */
 
-#define need_histo() (do_histogram || do_stats || do_gnuplot)
+/*
+ * Log-bucketed histograms in nanoseconds, for percentiles and JSON
+ * export. Unlike the linear ones above, they never saturate.
+ */
+struct histogram hdr_avg, hdr_max, hdr_min;
+
+#define need_histo() (do_histogram || do_stats || do_gnuplot || do_json)
 
 static inline void add_histogram(int32_t *histogram, int32_t addval)
 {
@@ -196,14 +203,18 @@ static void *latency(void *cookie)
 				gmaxjitter = dt;
 			}
 
-			if (!(finished || warmup) && need_histo())
+			if (!(finished || warmup) && need_histo()) {
 				add_histogram(histogram_avg, dt);
+				histogram_add(&hdr_avg, dt);
+			}
 		}
 
 		if (!warmup) {
 			if (!finished && need_histo()) {
 				add_histogram(histogram_max, maxj);
 				add_histogram(histogram_min, minj);
+				histogram_add(&hdr_max, maxj);
+				histogram_add(&hdr_min, minj);
 			}
 
 			minjitter = minj;
@@ -458,6 +469,59 @@ static void dump_stats(int32_t *histogram, char *kind, double avg)
 	       kind, total_hits, avg, variance);
 }
 
+/*
+ * The in-kernel samplers only return the linear histograms, feed the
+ * log-bucketed ones with the center value of each linear bucket.
+ */
+static void import_histogram(struct histogram *h, int32_t *histogram)
+{
+	int n;
+
+	for (n = 0; n < histogram_size; n++)
+		histogram_add_count(h, (int64_t)n * bucketsize + bucketsize / 2,
+				    histogram[n]);
+}
+
+static void dump_percentiles(struct histogram *h, char *kind)
+{
+	printf("HSP|    %s| %9llu| %10.3f| %10.3f| %10.3f| %10.3f\n",
+	       kind, (unsigned long long)h->total,
+	       histogram_percentile(h, 50) / 1000.0,
+	       histogram_percentile(h, 99) / 1000.0,
+	       histogram_percentile(h, 99.9) / 1000.0,
+	       histogram_percentile(h, 99.999) / 1000.0);
+}
+
+static void dump_histo_json(time_t duration)
+{
+	FILE *fp;
+
+	if (strcmp(do_json, "-") == 0)
+		fp = stdout;
+	else {
+		fp = fopen(do_json, "w");
+		if (fp == NULL) {
+			warning("cannot open %s: %s", do_json, strerror(errno));
+			return;
+		}
+	}
+
+	fprintf(fp, "{\"tool\":\"latency\",\"mode\":\"%s\","
+		"\"period_ns\":%Ld,\"priority\":%d,\"duration\":%ld,"
+		"\"overruns\":%d,\"unit\":\"ns\",\"histograms\":[",
+		test_mode_names[test_mode], period_ns, priority,
+		(long)duration, goverrun);
+	histogram_dump_json(&hdr_min, fp, "min");
+	fputc(',', fp);
+	histogram_dump_json(&hdr_avg, fp, "avg");
+	fputc(',', fp);
+	histogram_dump_json(&hdr_max, fp, "max");
+	fprintf(fp, "]}\n");
+
+	if (fp != stdout)
+		fclose(fp);
+}
+
 static void dump_hist_stats(time_t duration)
 {
 	double minavg, maxavg, avgavg;
@@ -473,8 +537,18 @@ static void dump_hist_stats(time_t duration)
 	dump_stats(histogram_avg, "avg", avgavg);
 	dump_stats(histogram_max, "max", maxavg);
 
+	if (do_stats) {
+		printf("HSP|--param|--samples-|----p50----|----p99----|---p99.9---|--p99.999--\n");
+		dump_percentiles(&hdr_min, "min");
+		dump_percentiles(&hdr_avg, "avg");
+		dump_percentiles(&hdr_max, "max");
+	}
+
 	if (do_gnuplot)
 		dump_histo_gnuplot(histogram_avg, duration);
+
+	if (do_json)
+		dump_histo_json(duration);
 }
 
 static void cleanup(void)
@@ -502,6 +576,11 @@ static void cleanup(void)
 		overall.histogram_max = histogram_max;
 		overall.histogram_avg = histogram_avg;
 		ioctl(benchdev, RTTST_RTIOC_TMBENCH_STOP, &overall);
+		if (need_histo()) {
+			import_histogram(&hdr_min, histogram_min);
+			import_histogram(&hdr_avg, histogram_avg);
+			import_histogram(&hdr_max, histogram_max);
+		}
 		gminjitter = overall.result.min;
 		gmaxjitter = overall.result.max;
 		gavgjitter = overall.result.avg;
@@ -534,6 +613,10 @@ static void cleanup(void)
 	if (histogram_min)
 		free(histogram_min);
 
+	histogram_destroy(&hdr_avg);
+	histogram_destroy(&hdr_max);
+	histogram_destroy(&hdr_min);
+
 	exit(0);
 }
 
@@ -599,7 +682,8 @@ void application_usage(void)
 	fprintf(stderr,
 		"-h                              print histograms of min, avg, max latencies\n"
 		"-g <file>                       dump histogram to <file> in gnuplot format\n"
-		"-s                              print statistics of min, avg, max latencies\n"
+		"-s                              print statistics and percentiles of min, avg, max latencies\n"
+		"-j <file>                       dump log-bucketed histograms to <file> in JSON format\n"
 		"-H <histogram-size>             default = 200, increase if your last bucket is full\n"
 		"-B <bucket-size>                default = 1000ns, decrease for more resolution\n"
 		"-p <period_us>                  sampling period\n"
@@ -646,12 +730,16 @@ int main(int argc, char *const *argv)
 	cpu_set_t cpus;
 	sigset_t mask;
 
-	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:P:b")) != EOF)
+	while ((c = getopt(argc, argv, "g:j:hp:l:T:qH:B:sD:t:fc:P:b")) != EOF)
 		switch (c) {
 		case 'g':
 			do_gnuplot = strdup(optarg);
 			break;
 
+		case 'j':
+			do_json = strdup(optarg);
+			break;
+
 		case 'h':
 
 			do_histogram = 1;
@@ -747,6 +835,12 @@ int main(int argc, char *const *argv)
 	if (!(histogram_avg && histogram_max && histogram_min))
 		cleanup();
 
+	/* Allow for 1s worth of latency, the sampling period limit. */
+	if (histogram_init(&hdr_avg, ONE_BILLION, HISTOGRAM_DEFAULT_SIGBITS) ||
+	    histogram_init(&hdr_max, ONE_BILLION, HISTOGRAM_DEFAULT_SIGBITS) ||
+	    histogram_init(&hdr_min, ONE_BILLION, HISTOGRAM_DEFAULT_SIGBITS))
+		error(1, ENOMEM, "histogram_init()");
+
 	if (period_ns == 0)
 		period_ns = CONFIG_XENO_DEFAULT_PERIOD;	/* ns */
 
@@ -13,15 +13,36 @@
 #include <pthread.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <smokey/smokey.h>
 #include <rtdm/ipc.h>
 
 smokey_test_plugin(bufp,
-		   SMOKEY_NOARGS,
-		   "Check RTIPC/BUFP protocol."
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(chunk),
+			   SMOKEY_INT(megabytes),
+		   ),
+		   "Check RTIPC/BUFP protocol, then compare the throughput of\n"
+		   "\tthe copying and shared ring data paths.\n"
+		   "\tchunk=<bytes>, size of each transfer (default 1024)\n"
+		   "\tmegabytes=<n>, amount of data to stream (default 16)"
 );
 
 #define BUFP_SVPORT 12
+#define BUFP_BENCH_PORT 13
+#define BUFP_BENCH_BUFSZ 65536
+
+struct bench_context {
+	int s;
+	size_t chunk;
+	size_t total;
+	struct bufp_ring *ring;
+	void *mem;
+	int ret;
+};
 
 static pthread_t svtid, cltid;
 
@@ -132,12 +153,338 @@ static void *client(void *arg)
 	return NULL;
 }
 
+static void create_fifo_thread(pthread_t *tid, int prio,
+			       void *(*fn)(void *), void *arg)
+{
+	struct sched_param param = {.sched_priority = prio };
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+
+	errno = pthread_create(tid, &attr, fn, arg);
+	if (errno)
+		fail("pthread_create");
+
+	pthread_attr_destroy(&attr);
+}
+
+static void *copy_reader(void *arg)
+{
+	struct bench_context *b = arg;
+	size_t received = 0;
+	char *buf;
+	ssize_t n;
+
+	buf = malloc(b->chunk);
+	if (buf == NULL) {
+		b->ret = -ENOMEM;
+		return NULL;
+	}
+
+	while (received < b->total) {
+		n = read(b->s, buf, b->chunk);
+		if (n < 0) {
+			b->ret = -errno;
+			break;
+		}
+		if (buf[0] != (char)(received / b->chunk)) {
+			b->ret = -EPROTO;
+			break;
+		}
+		received += n;
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+static void *copy_writer(void *arg)
+{
+	struct bench_context *b = arg;
+	size_t sent = 0;
+	char *buf;
+	ssize_t n;
+
+	buf = malloc(b->chunk);
+	if (buf == NULL) {
+		b->ret = -ENOMEM;
+		return NULL;
+	}
+
+	memset(buf, 0, b->chunk);
+
+	while (sent < b->total) {
+		buf[0] = (char)(sent / b->chunk);
+		n = write(b->s, buf, b->chunk);
+		if (n < 0) {
+			b->ret = -errno;
+			break;
+		}
+		sent += n;
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+static int ring_wait(int s, unsigned int events, size_t len)
+{
+	struct bufp_ring_wait rwait = {
+		.events = events,
+		.len = len,
+	};
+
+	return ioctl(s, BUFP_RTIOC_WAIT, &rwait) ? -errno : 0;
+}
+
+static int ring_wake(int s, uint32_t *waiting, int events)
+{
+	/*
+	 * Order the index update before the waiter test, pairing
+	 * with the barrier the kernel issues after raising the flag.
+	 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(waiting, __ATOMIC_RELAXED) == 0)
+		return 0;
+
+	return ioctl(s, BUFP_RTIOC_WAKE, &events) ? -errno : 0;
+}
+
+static void *ring_reader(void *arg)
+{
+	struct bench_context *b = arg;
+	struct bufp_ring *ring = b->ring;
+	uint32_t head, tail, mask;
+	size_t received = 0;
+	char *data;
+	int ret;
+
+	data = (char *)ring + ring->offset;
+	mask = ring->size - 1;
+
+	while (received < b->total) {
+		tail = ring->tail;
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		if (head - tail < b->chunk) {
+			ret = ring_wait(b->s, BUFP_RING_WAIT_READ, b->chunk);
+			if (ret) {
+				b->ret = ret;
+				break;
+			}
+			continue;
+		}
+		/* Consume the chunk in place. */
+		if (data[tail & mask] != (char)(received / b->chunk)) {
+			b->ret = -EPROTO;
+			break;
+		}
+		__atomic_store_n(&ring->tail, tail + b->chunk, __ATOMIC_RELEASE);
+		received += b->chunk;
+		ret = ring_wake(b->s, &ring->wr_waiting, BUFP_RING_WAIT_WRITE);
+		if (ret) {
+			b->ret = ret;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void *ring_writer(void *arg)
+{
+	struct bench_context *b = arg;
+	struct bufp_ring *ring = b->ring;
+	uint32_t head, tail, mask, off;
+	size_t sent = 0, n;
+	char *data, *buf;
+	int ret;
+
+	buf = malloc(b->chunk);
+	if (buf == NULL) {
+		b->ret = -ENOMEM;
+		return NULL;
+	}
+
+	memset(buf, 0, b->chunk);
+	data = (char *)ring + ring->offset;
+	mask = ring->size - 1;
+
+	while (sent < b->total) {
+		head = ring->head;
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		if (ring->size - (head - tail) < b->chunk) {
+			ret = ring_wait(b->s, BUFP_RING_WAIT_WRITE, b->chunk);
+			if (ret) {
+				b->ret = ret;
+				break;
+			}
+			continue;
+		}
+		buf[0] = (char)(sent / b->chunk);
+		off = head & mask;
+		n = ring->size - off;
+		if (n > b->chunk)
+			n = b->chunk;
+		memcpy(data + off, buf, n);
+		memcpy(data, buf + n, b->chunk - n);
+		__atomic_store_n(&ring->head, head + b->chunk, __ATOMIC_RELEASE);
+		sent += b->chunk;
+		ret = ring_wake(b->s, &ring->rd_waiting, BUFP_RING_WAIT_READ);
+		if (ret) {
+			b->ret = ret;
+			break;
+		}
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+static int bind_bench_socket(int mapped)
+{
+	struct sockaddr_ipc saddr;
+	size_t bufsz;
+	int ret, s;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (s < 0)
+		return -errno;
+
+	bufsz = BUFP_BENCH_BUFSZ;
+	ret = setsockopt(s, SOL_BUFP, BUFP_BUFSZ, &bufsz, sizeof(bufsz));
+	if (ret)
+		goto fail;
+
+	if (mapped) {
+		ret = setsockopt(s, SOL_BUFP, BUFP_MMAP,
+				 &mapped, sizeof(mapped));
+		if (ret)
+			goto fail;
+	}
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = BUFP_BENCH_PORT;
+	ret = bind(s, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		goto fail;
+
+	return s;
+fail:
+	ret = -errno;
+	close(s);
+
+	return ret;
+}
+
+static int run_bench(const char *name, struct bench_context *b,
+		     void *(*reader)(void *), void *(*writer)(void *))
+{
+	struct bench_context rb = *b, wb = *b;
+	struct timespec start, end;
+	pthread_t rtid, wtid;
+	long long ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	create_fifo_thread(&rtid, 71, reader, &rb);
+	create_fifo_thread(&wtid, 70, writer, &wb);
+	pthread_join(wtid, NULL);
+	if (wb.ret)
+		/* Unblock the reader if the writer bailed out early. */
+		pthread_cancel(rtid);
+	pthread_join(rtid, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (wb.ret || rb.ret) {
+		smokey_warning("%s: transfer failed: %s", name,
+			       strerror(-(wb.ret ?: rb.ret)));
+		return wb.ret ?: rb.ret;
+	}
+
+	ns = (end.tv_sec - start.tv_sec) * 1000000000LL +
+		end.tv_nsec - start.tv_nsec;
+	smokey_trace("%s: %zu bytes in %zu-byte chunks, %lld us, %lld MB/s",
+		     name, b->total, b->chunk, ns / 1000,
+		     ns > 0 ? (long long)b->total * 1000 / ns : 0LL);
+
+	return 0;
+}
+
+static int bench_copy(struct bench_context *b)
+{
+	int ret;
+
+	b->s = bind_bench_socket(0);
+	if (b->s < 0)
+		return b->s;
+
+	/* The bound socket sends to itself by default. */
+	ret = run_bench("copy", b, copy_reader, copy_writer);
+	close(b->s);
+
+	return ret;
+}
+
+static int bench_ring(struct bench_context *b)
+{
+	size_t len;
+	int ret;
+
+	b->s = bind_bench_socket(1);
+	if (b->s < 0) {
+		if (b->s == -EINVAL) {
+			smokey_note("bufp: shared ring mode not supported");
+			return 0;
+		}
+		return b->s;
+	}
+
+	len = getpagesize() + BUFP_BENCH_BUFSZ;
+	b->mem = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, b->s, 0);
+	if (b->mem == MAP_FAILED) {
+		ret = -errno;
+		goto out;
+	}
+
+	b->ring = b->mem;
+	ret = run_bench("shared ring", b, ring_reader, ring_writer);
+	munmap(b->mem, len);
+out:
+	close(b->s);
+
+	return ret;
+}
+
 static int run_bufp(struct smokey_test *t, int argc, char *const argv[])
 {
+	struct bench_context b = {
+		.chunk = 1024,
+		.total = 16 << 20,
+	};
 	struct sched_param svparam = {.sched_priority = 71 };
 	struct sched_param clparam = {.sched_priority = 70 };
 	pthread_attr_t svattr, clattr;
-	int s;
+	int ret, s;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(bufp, chunk))
+		b.chunk = SMOKEY_ARG_INT(bufp, chunk);
+	if (SMOKEY_ARG_ISSET(bufp, megabytes))
+		b.total = (size_t)SMOKEY_ARG_INT(bufp, megabytes) << 20;
+
+	if (b.chunk == 0 || b.chunk > BUFP_BENCH_BUFSZ || b.total < b.chunk)
+		return -EINVAL;
+
+	/* Stream whole chunks only. */
+	b.total -= b.total % b.chunk;
 
 	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
 	if (s < 0) {
@@ -170,5 +517,9 @@ static int run_bufp(struct smokey_test *t, int argc, char *const argv[])
 	pthread_cancel(svtid);
 	pthread_join(svtid, NULL);
 
-	return 0;
+	ret = bench_copy(&b);
+	if (ret)
+		return ret;
+
+	return bench_ring(&b);
 }
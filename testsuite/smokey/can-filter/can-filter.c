@@ -0,0 +1,251 @@
+/*
+ * RT-Socket-CAN receive filter benchmark over the virtual CAN bus
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <rtdm/can.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(can_filter,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(max_filters),
+			   SMOKEY_INT(loops),
+		   ),
+		   "Measure the delivery latency of CAN frames between the\n"
+		   "\trtcan0 and rtcan1 devices of the virtual CAN driver as\n"
+		   "\tthe number of receive filters grows (modprobe\n"
+		   "\txeno_can_virt).\n"
+		   "\tmax_filters=<N>\tlargest filter count (default 256)\n"
+		   "\tloops=<N>\tframes per measurement (default 10000)"
+);
+
+#define TEST_ID		0x7a5
+
+/*
+ * The measuring socket has an exact ID filter, a mask filter and an
+ * inverted filter accepting the test frame, plus an inverted filter
+ * rejecting it: every frame must be delivered three times.
+ */
+static struct can_filter test_filters[] = {
+	{ .can_id = TEST_ID, .can_mask = CAN_SFF_MASK },
+	{ .can_id = TEST_ID & 0x700, .can_mask = 0x700 },
+	{ .can_id = 0x001 | CAN_INV_FILTER, .can_mask = CAN_SFF_MASK },
+	{ .can_id = TEST_ID | CAN_INV_FILTER, .can_mask = CAN_SFF_MASK },
+};
+
+#define TEST_COPIES	3
+
+static int get_ifindex(int s, const char *name)
+{
+	struct can_ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+	if (__RT(ioctl(s, SIOCGIFINDEX, &ifr)))
+		return -errno;
+
+	ifr.ifr_ifru.mode = CAN_MODE_START;
+	if (__RT(ioctl(s, SIOCSCANMODE, &ifr)))
+		return -errno;
+
+	return ifr.ifr_ifindex;
+}
+
+static int open_bound(int ifindex, const struct can_filter *filters,
+		      int nr_filters)
+{
+	struct sockaddr_can addr;
+	int s, ret;
+
+	s = __RT(socket(PF_CAN, SOCK_RAW, CAN_RAW));
+	if (s < 0)
+		return -errno;
+
+	ret = __RT(setsockopt(s, SOL_CAN_RAW, CAN_RAW_FILTER, filters,
+			      nr_filters * sizeof(*filters)));
+	if (ret)
+		goto fail;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.can_family = AF_CAN;
+	addr.can_ifindex = ifindex;
+	ret = __RT(bind(s, (struct sockaddr *)&addr, sizeof(addr)));
+	if (ret)
+		goto fail;
+
+	return s;
+fail:
+	ret = -errno;
+	__RT(close(s));
+	return ret;
+}
+
+/*
+ * Filler filters never match the test frame: mostly exact IDs, with a
+ * mask filter out of eight spread over a few distinct masks.
+ */
+static void make_fillers(struct can_filter *filters, int nr_filters)
+{
+	int i;
+
+	for (i = 0; i < nr_filters; i++) {
+		filters[i].can_id = 0x100 + (i % 0x600);
+		if (i % 8 == 7)
+			filters[i].can_mask = 0x7f0 | ((i >> 3) & 0x3);
+		else
+			filters[i].can_mask = CAN_SFF_MASK;
+	}
+}
+
+static inline long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int measure(int txs, int rxs, int loops, long long *avg_ns,
+		   long long *max_ns)
+{
+	long long start, delta, sum = 0, max = 0;
+	struct can_frame frame;
+	int n, i, ret;
+
+	for (n = 0; n < loops; n++) {
+		memset(&frame, 0, sizeof(frame));
+		frame.can_id = TEST_ID;
+		frame.can_dlc = 8;
+		memcpy(frame.data, &n, sizeof(n));
+
+		start = now_ns();
+		ret = __RT(send(txs, &frame, sizeof(frame), 0));
+		if (ret != sizeof(frame))
+			return ret < 0 ? -errno : -EIO;
+		for (i = 0; i < TEST_COPIES; i++) {
+			ret = __RT(recv(rxs, &frame, sizeof(frame), 0));
+			if (ret < 0)
+				return -errno;
+			if (!smokey_assert(frame.can_id == TEST_ID &&
+					   !memcmp(frame.data, &n, sizeof(n))))
+				return -EPROTO;
+		}
+		delta = now_ns() - start;
+
+		sum += delta;
+		if (delta > max)
+			max = delta;
+	}
+
+	*avg_ns = sum / loops;
+	*max_ns = max;
+
+	return 0;
+}
+
+static int run_can_filter(struct smokey_test *t, int argc, char *const argv[])
+{
+	int txs, rxs = -1, fills = -1, tx_ifindex, rx_ifindex, ret;
+	int max_filters = 256, loops = 10000, n, nr;
+	nanosecs_rel_t timeout = 1000000000;
+	struct can_filter *fillers;
+	long long avg_ns = 0, max_ns = 0;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(can_filter, max_filters))
+		max_filters = SMOKEY_ARG_INT(can_filter, max_filters);
+	if (SMOKEY_ARG_ISSET(can_filter, loops))
+		loops = SMOKEY_ARG_INT(can_filter, loops);
+	if (max_filters < 0 || loops <= 0)
+		return -EINVAL;
+
+	txs = __RT(socket(PF_CAN, SOCK_RAW, CAN_RAW));
+	if (txs < 0) {
+		smokey_note("can_filter: RT-Socket-CAN not available, skipping");
+		return -ENOSYS;
+	}
+
+	tx_ifindex = get_ifindex(txs, "rtcan0");
+	rx_ifindex = get_ifindex(txs, "rtcan1");
+	if (tx_ifindex < 0 || rx_ifindex < 0) {
+		smokey_note("can_filter: virtual CAN devices not available, "
+			    "skipping (modprobe xeno_can_virt?)");
+		__RT(close(txs));
+		return -ENOSYS;
+	}
+	__RT(close(txs));
+
+	fillers = calloc(max_filters ?: 1, sizeof(*fillers));
+	if (fillers == NULL)
+		return -ENOMEM;
+	make_fillers(fillers, max_filters);
+
+	txs = open_bound(tx_ifindex, NULL, 0);
+	if (!__Fassert(txs < 0)) {
+		ret = txs;
+		goto out;
+	}
+
+	rxs = open_bound(rx_ifindex, test_filters,
+			 sizeof(test_filters) / sizeof(test_filters[0]));
+	if (!__Fassert(rxs < 0)) {
+		ret = rxs;
+		goto out;
+	}
+
+	if (!__Terrno(ret, __RT(ioctl(rxs, RTCAN_RTIOC_RCV_TIMEOUT,
+					 &timeout))))
+		goto out;
+
+	smokey_trace("%8s %10s %10s", "filters", "avg (ns)", "max (ns)");
+
+	for (n = 0;; n = n ? n * 2 : 8) {
+		nr = n < max_filters ? n : max_filters;
+		if (fills >= 0)
+			__RT(close(fills));
+		fills = -1;
+		if (nr > 0) {
+			fills = open_bound(rx_ifindex, fillers, nr);
+			if (fills == -ENOSPC || fills == -EINVAL) {
+				smokey_note("can_filter: device filter table "
+					    "full at %d filters "
+					    "(CONFIG_XENO_DRIVERS_CAN_MAX_RECEIVERS)",
+					    nr);
+				ret = 0;
+				break;
+			}
+			if (!__Fassert(fills < 0)) {
+				ret = fills;
+				break;
+			}
+		}
+
+		ret = measure(txs, rxs, loops, &avg_ns, &max_ns);
+		if (ret)
+			break;
+
+		smokey_trace("%8d %10lld %10lld", nr, avg_ns, max_ns);
+
+		if (nr == max_filters)
+			break;
+	}
+out:
+	if (fills >= 0)
+		__RT(close(fills));
+	if (rxs >= 0)
+		__RT(close(rxs));
+	if (txs >= 0)
+		__RT(close(txs));
+	free(fillers);
+
+	return ret;
+}
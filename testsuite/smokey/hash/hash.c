@@ -0,0 +1,244 @@
+/*
+ * Copperplate hash table benchmark.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <boilerplate/hash.h>
+#include <copperplate/heapobj.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(hash,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(objects),
+			   SMOKEY_INT(readers),
+		   ),
+		   "Register a large number of named objects into a hash table,\n"
+		   "\tthen time lookups, including with concurrent updates.\n"
+		   "\tobjects=<N>\tnumber of objects (default 100000)\n"
+		   "\treaders=<N>\tconcurrent reader threads (default 2)"
+);
+
+struct named_object {
+	struct hashobj hobj;
+	char name[16];
+};
+
+static const struct hash_operations hops = {
+	.compare = memcmp,
+#ifdef CONFIG_XENO_PSHARED
+	.alloc = xnmalloc,
+	.free = xnfree,
+#endif
+};
+
+static struct hash_table table;
+
+static struct named_object **objects;
+
+static int nrobjects;
+
+static volatile int stop_readers;
+
+static inline long long diff_ts(const struct timespec *left,
+				const struct timespec *right)
+{
+	return (long long)(left->tv_sec - right->tv_sec) * 1000000000LL
+		+ left->tv_nsec - right->tv_nsec;
+}
+
+static struct hashobj *lookup(int n, const char *prefix)
+{
+	char name[16];
+	int len;
+
+	len = snprintf(name, sizeof(name), "%s%d", prefix, n);
+
+	return hash_search(&table, name, len, &hops);
+}
+
+static int enter_object(struct named_object *obj, int n)
+{
+	int len;
+
+	len = snprintf(obj->name, sizeof(obj->name), "obj%d", n);
+
+	return hash_enter(&table, obj->name, len, &obj->hobj, &hops);
+}
+
+static void *reader_thread(void *arg)
+{
+	long misses = 0;
+	int n = 0;
+
+	/*
+	 * The lower half of the objects stays registered for the
+	 * whole test, so lookups must succeed, while the upper half
+	 * is being removed and registered again.
+	 */
+	while (!stop_readers) {
+		if (lookup(n, "obj") == NULL)
+			misses++;
+		if (++n >= nrobjects / 2)
+			n = 0;
+	}
+
+	return (void *)misses;
+}
+
+static int run_hash(struct smokey_test *t, int argc, char *const argv[])
+{
+	int n, ret = 0, nrreaders = 2, found;
+	struct timespec start, end;
+	struct named_object *dup;
+	pthread_t *readers;
+	long long ns;
+	void *status;
+
+	smokey_parse_args(t, argc, argv);
+
+	nrobjects = 100000;
+	if (SMOKEY_ARG_ISSET(hash, objects) &&
+	    SMOKEY_ARG_INT(hash, objects) > 1)
+		nrobjects = SMOKEY_ARG_INT(hash, objects);
+
+	if (SMOKEY_ARG_ISSET(hash, readers) &&
+	    SMOKEY_ARG_INT(hash, readers) >= 0)
+		nrreaders = SMOKEY_ARG_INT(hash, readers);
+
+	objects = malloc(sizeof(*objects) * nrobjects);
+	if (objects == NULL)
+		return -ENOMEM;
+
+	/*
+	 * Descriptors must live in the main heap if shared. Grab a
+	 * spare one for testing duplicates before filling up.
+	 */
+	dup = xnmalloc(sizeof(*dup));
+	if (dup == NULL) {
+		free(objects);
+		return -ENOMEM;
+	}
+
+	for (n = 0; n < nrobjects; n++) {
+		objects[n] = xnmalloc(sizeof(struct named_object));
+		if (objects[n] == NULL) {
+			if (n < 2) {
+				ret = -ENOMEM;
+				goto out_free;
+			}
+			smokey_note("hash: only %d objects fit in the main heap"
+				    " (see --mem-pool-size)", n);
+			nrobjects = n;
+			break;
+		}
+	}
+
+	hash_init(&table);
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &start));
+	for (n = 0; n < nrobjects; n++) {
+		ret = enter_object(objects[n], n);
+		if (!smokey_assert(ret == 0))
+			goto out;
+	}
+	__RT(clock_gettime(CLOCK_MONOTONIC, &end));
+	ns = diff_ts(&end, &start);
+	smokey_trace("register %d objects: %.3f ms (%.1f ns/object)",
+		     nrobjects, ns / 1e6, (double)ns / nrobjects);
+
+	if (!smokey_assert(hash_count(&table) == nrobjects)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Entering a duplicate name must fail. */
+	ret = enter_object(dup, 0);
+	if (!smokey_assert(ret == -EEXIST)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &start));
+	for (n = 0, found = 0; n < nrobjects; n++) {
+		if (lookup(n, "obj") == &objects[n]->hobj)
+			found++;
+	}
+	__RT(clock_gettime(CLOCK_MONOTONIC, &end));
+	ns = diff_ts(&end, &start);
+	smokey_trace("lookup (hit): %.1f ns/lookup", (double)ns / nrobjects);
+	if (!smokey_assert(found == nrobjects)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &start));
+	for (n = 0, found = 0; n < nrobjects; n++) {
+		if (lookup(n, "nil") != NULL)
+			found++;
+	}
+	__RT(clock_gettime(CLOCK_MONOTONIC, &end));
+	ns = diff_ts(&end, &start);
+	smokey_trace("lookup (miss): %.1f ns/lookup", (double)ns / nrobjects);
+	if (!smokey_assert(found == 0)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (nrreaders == 0)
+		goto out;
+
+	readers = malloc(sizeof(*readers) * nrreaders);
+	if (readers == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	stop_readers = 0;
+	for (n = 0; n < nrreaders; n++) {
+		ret = -__RT(pthread_create(&readers[n], NULL,
+					   reader_thread, NULL));
+		if (ret) {
+			nrreaders = n;
+			break;
+		}
+	}
+
+	for (n = nrobjects / 2; n < nrobjects; n++) {
+		hash_remove(&table, &objects[n]->hobj, &hops);
+		if (!smokey_assert(lookup(n, "obj") == NULL))
+			ret = -EINVAL;
+	}
+
+	for (n = nrobjects / 2; n < nrobjects; n++) {
+		if (!smokey_assert(enter_object(objects[n], n) == 0))
+			ret = -EINVAL;
+	}
+
+	stop_readers = 1;
+	for (n = 0; n < nrreaders; n++) {
+		__RT(pthread_join(readers[n], &status));
+		if (!smokey_assert(status == NULL))
+			ret = -EINVAL;
+	}
+
+	free(readers);
+out:
+	for (n = 0; n < nrobjects; n++)
+		hash_remove(&table, &objects[n]->hobj, &hops);
+
+	hash_destroy(&table, &hops);
+out_free:
+	for (n = 0; n < nrobjects && objects[n]; n++)
+		xnfree(objects[n]);
+
+	xnfree(dup);
+	free(objects);
+
+	return ret;
+}
@@ -13,16 +13,41 @@
 #include <pthread.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
 #include <smokey/smokey.h>
 #include <rtdm/ipc.h>
 
 smokey_test_plugin(iddp,
-		   SMOKEY_NOARGS,
-		   "Check RTIPC/IDDP protocol."
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(receivers),
+			   SMOKEY_INT(loops),
+		   ),
+		   "Check RTIPC/IDDP protocol, then compare delivering the\n"
+		   "\tsame datagrams to several ports with per-port sends and\n"
+		   "\twith a fan-out set.\n"
+		   "\treceivers=<n>, number of receiving ports (default 4)\n"
+		   "\tloops=<n>, number of datagrams per port (default 10000)"
 );
 
 #define IDDP_SVPORT 12
 #define IDDP_CLPORT 13
+#define IDDP_BENCH_MAXRCV 16
+#define IDDP_BENCH_MSGSZ 64
+
+struct bench_receiver {
+	pthread_t tid;
+	int s;
+	int loops;
+	int ret;
+};
+
+struct bench_sender {
+	int fanout;
+	int nr;
+	int loops;
+	struct sockaddr_ipc addrs[IDDP_BENCH_MAXRCV];
+	int ret;
+};
 
 static pthread_t svtid, cltid;
 
@@ -136,13 +161,216 @@ static void *client(void *arg)
 	return NULL;
 }
 
+static void create_fifo_thread(pthread_t *tid, int prio,
+			       void *(*fn)(void *), void *arg)
+{
+	struct sched_param param = {.sched_priority = prio };
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+
+	errno = pthread_create(tid, &attr, fn, arg);
+	if (errno)
+		fail("pthread_create");
+
+	pthread_attr_destroy(&attr);
+}
+
+static void *bench_receive(void *arg)
+{
+	struct bench_receiver *r = arg;
+	char buf[IDDP_BENCH_MSGSZ];
+	int n;
+
+	for (n = 0; n < r->loops; n++) {
+		if (read(r->s, buf, sizeof(buf)) < 0) {
+			r->ret = -errno;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void *bench_send(void *arg)
+{
+	struct bench_sender *b = arg;
+	struct iddp_fanout fanout;
+	char buf[IDDP_BENCH_MSGSZ];
+	int s, n, m;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (s < 0) {
+		b->ret = -errno;
+		return NULL;
+	}
+
+	if (b->fanout) {
+		memset(&fanout, 0, sizeof(fanout));
+		fanout.nr_ports = b->nr;
+		for (m = 0; m < b->nr; m++)
+			fanout.ports[m] = b->addrs[m].sipc_port;
+		if (setsockopt(s, SOL_IDDP, IDDP_FANOUT,
+			       &fanout, sizeof(fanout))) {
+			b->ret = -errno;
+			goto out;
+		}
+	}
+
+	memset(buf, 0, sizeof(buf));
+
+	for (n = 0; n < b->loops; n++) {
+		if (b->fanout) {
+			if (write(s, buf, sizeof(buf)) < 0) {
+				b->ret = -errno;
+				break;
+			}
+			continue;
+		}
+		for (m = 0; m < b->nr; m++) {
+			if (sendto(s, buf, sizeof(buf), 0,
+				   (struct sockaddr *)&b->addrs[m],
+				   sizeof(b->addrs[m])) < 0) {
+				b->ret = -errno;
+				goto out;
+			}
+		}
+	}
+out:
+	close(s);
+
+	return NULL;
+}
+
+static int bind_bench_receiver(struct sockaddr_ipc *saddr)
+{
+	size_t poolsz = 16384, msgsz = IDDP_BENCH_MSGSZ;
+	socklen_t addrlen;
+	int ret, s;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (s < 0)
+		return -errno;
+
+	ret = setsockopt(s, SOL_IDDP, IDDP_POOLSZ, &poolsz, sizeof(poolsz));
+	if (ret)
+		goto fail;
+
+	/* Use fixed-size slabs if available. */
+	ret = setsockopt(s, SOL_IDDP, IDDP_MSGSZ, &msgsz, sizeof(msgsz));
+	if (ret && errno != EINVAL)
+		goto fail;
+
+	memset(saddr, 0, sizeof(*saddr));
+	saddr->sipc_family = AF_RTIPC;
+	saddr->sipc_port = -1;	/* Pick a free port. */
+	ret = bind(s, (struct sockaddr *)saddr, sizeof(*saddr));
+	if (ret)
+		goto fail;
+
+	addrlen = sizeof(*saddr);
+	ret = getsockname(s, (struct sockaddr *)saddr, &addrlen);
+	if (ret)
+		goto fail;
+
+	return s;
+fail:
+	ret = -errno;
+	close(s);
+
+	return ret;
+}
+
+static int run_bench(int fanout, int nr, int loops)
+{
+	struct bench_receiver rcv[IDDP_BENCH_MAXRCV];
+	const char *name = fanout ? "fan-out" : "per-port";
+	struct timespec start, end;
+	struct bench_sender snd;
+	pthread_t sndtid;
+	int n, ret = 0;
+	long long ns;
+
+	memset(&snd, 0, sizeof(snd));
+	snd.fanout = fanout;
+	snd.nr = nr;
+	snd.loops = loops;
+
+	for (n = 0; n < nr; n++) {
+		rcv[n].s = bind_bench_receiver(&snd.addrs[n]);
+		if (rcv[n].s < 0) {
+			ret = rcv[n].s;
+			while (--n >= 0)
+				close(rcv[n].s);
+			return ret;
+		}
+		rcv[n].loops = loops;
+		rcv[n].ret = 0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (n = 0; n < nr; n++)
+		create_fifo_thread(&rcv[n].tid, 71, bench_receive, &rcv[n]);
+
+	create_fifo_thread(&sndtid, 70, bench_send, &snd);
+	pthread_join(sndtid, NULL);
+
+	for (n = 0; n < nr; n++) {
+		if (snd.ret)
+			/* Receivers would wait forever. */
+			pthread_cancel(rcv[n].tid);
+		pthread_join(rcv[n].tid, NULL);
+		if (rcv[n].ret && ret == 0)
+			ret = rcv[n].ret;
+		close(rcv[n].s);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (snd.ret) {
+		if (fanout && snd.ret == -EINVAL) {
+			smokey_note("iddp: fan-out sending not supported");
+			return 0;
+		}
+		ret = snd.ret;
+	}
+
+	if (ret) {
+		smokey_warning("%s: transfer failed: %s", name, strerror(-ret));
+		return ret;
+	}
+
+	ns = (end.tv_sec - start.tv_sec) * 1000000000LL +
+		end.tv_nsec - start.tv_nsec;
+	smokey_trace("%s: %d datagrams to %d ports, %lld us, %lld ns/datagram",
+		     name, loops, nr, ns / 1000, ns / loops);
+
+	return 0;
+}
+
 static int run_iddp(struct smokey_test *t, int argc, char *const argv[])
 {
 	struct sched_param svparam = {.sched_priority = 71 };
 	struct sched_param clparam = {.sched_priority = 70 };
+	int receivers = 4, loops = 10000, ret;
 	pthread_attr_t svattr, clattr;
 	int s;
 
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(iddp, receivers))
+		receivers = SMOKEY_ARG_INT(iddp, receivers);
+	if (SMOKEY_ARG_ISSET(iddp, loops))
+		loops = SMOKEY_ARG_INT(iddp, loops);
+
+	if (receivers < 1 || receivers > IDDP_BENCH_MAXRCV || loops < 1)
+		return -EINVAL;
+
 	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
 	if (s < 0) {
 		if (errno == EAFNOSUPPORT)
@@ -174,5 +402,9 @@ static int run_iddp(struct smokey_test *t, int argc, char *const argv[])
 	pthread_cancel(svtid);
 	pthread_join(svtid, NULL);
 
-	return 0;
+	ret = run_bench(0, receivers, loops);
+	if (ret)
+		return ret;
+
+	return run_bench(1, receivers, loops);
 }
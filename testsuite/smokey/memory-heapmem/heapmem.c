@@ -3,13 +3,23 @@
  *
  * SPDX-License-Identifier: MIT
  */
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <boilerplate/heapmem.h>
 #include "memcheck/memcheck.h"
 
 smokey_test_plugin(memory_heapmem,
-		   MEMCHECK_ARGS,
+		   MEMCHECK_ARGLIST(
+			   SMOKEY_INT(max_threads),
+			   SMOKEY_INT(contention_rounds),
+		   ),
 		   "Check for the heapmem allocator sanity.\n"
 		   MEMCHECK_HELP_STRINGS
+		   "\tmax_threads=<N>\t\tmax. # of threads for contention test\n"
+		   "\tcontention_rounds=<N>\t# of alloc/free rounds per thread\n"
 	);
 
 #define MIN_HEAP_SIZE  8192
@@ -19,6 +29,10 @@ smokey_test_plugin(memory_heapmem,
 #define PATTERN_HEAP_SIZE  (128*1024)
 #define PATTERN_ROUNDS     128
 
+#define CONTENTION_HEAP_SIZE  (4 * 1024 * 1024)
+#define CONTENTION_ROUNDS     20000
+#define CONTENTION_BURST      16
+
 static struct heap_memory heap;
 
 static size_t get_arena_size(size_t heap_size)
@@ -44,8 +58,166 @@ static struct memcheck_descriptor heapmem_descriptor = {
 	.valid_flags = MEMCHECK_ALL_FLAGS,
 };
 
+struct contention_worker {
+	pthread_t tid;
+	struct heap_memory *heap;
+	int cpu;
+	int rounds;
+	int failed;
+};
+
+static void *contention_thread(void *arg)
+{
+	struct contention_worker *w = arg;
+	void *blocks[CONTENTION_BURST];
+	unsigned int seed = w->cpu;
+	cpu_set_t affinity;
+	int n, m;
+
+	CPU_ZERO(&affinity);
+	CPU_SET(w->cpu, &affinity);
+	sched_setaffinity(0, sizeof(affinity), &affinity);
+
+	/* Small, mixed-size requests only, served from buckets. */
+	for (n = 0; n < w->rounds; n++) {
+		for (m = 0; m < CONTENTION_BURST; m++) {
+			blocks[m] = heapmem_alloc(w->heap,
+					16 << (rand_r(&seed) % HEAPMEM_MAX));
+			if (blocks[m] == NULL) {
+				w->failed = 1;
+				break;
+			}
+		}
+		while (--m >= 0)
+			heapmem_free(w->heap, blocks[m]);
+	}
+
+	return NULL;
+}
+
+static int run_contention(struct heap_memory *heap, int nrthreads,
+			  int rounds, double *mops)
+{
+	struct contention_worker workers[nrthreads];
+	struct timespec start, end;
+	int n, ncpus, ret = 0;
+	double elapsed;
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus <= 0)
+		ncpus = 1;
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &start));
+
+	for (n = 0; n < nrthreads; n++) {
+		workers[n].heap = heap;
+		workers[n].cpu = n % ncpus;
+		workers[n].rounds = rounds;
+		workers[n].failed = 0;
+		ret = -__RT(pthread_create(&workers[n].tid, NULL,
+					   contention_thread, &workers[n]));
+		if (ret) {
+			nrthreads = n;
+			break;
+		}
+	}
+
+	for (n = 0; n < nrthreads; n++) {
+		__RT(pthread_join(workers[n].tid, NULL));
+		if (workers[n].failed)
+			ret = -ENOMEM;
+	}
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &end));
+
+	elapsed = (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9;
+	*mops = (2.0 * CONTENTION_BURST * rounds * nrthreads) / elapsed / 1e6;
+
+	return ret;
+}
+
+static int contention_test(struct smokey_test *t)
+{
+	int rounds = CONTENTION_ROUNDS, max_threads, nrthreads, ret = 0;
+	double plain_mops, mag_mops;
+	struct heap_memory heap;
+	size_t arena_size;
+	void *mem;
+
+	max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (max_threads <= 0)
+		max_threads = 1;
+
+	if (smokey_arg_isset(t, "max_threads"))
+		max_threads = smokey_arg_int(t, "max_threads");
+
+	if (smokey_arg_isset(t, "contention_rounds"))
+		rounds = smokey_arg_int(t, "contention_rounds");
+
+	if (max_threads <= 0 || rounds <= 0)
+		return 0;
+
+	arena_size = get_arena_size(CONTENTION_HEAP_SIZE);
+	mem = __STD(malloc(arena_size));
+	if (mem == NULL)
+		return -ENOMEM;
+
+	smokey_trace("== heapmem contention, %d alloc+free per thread",
+		     rounds * CONTENTION_BURST);
+	smokey_trace("%8s %16s %16s", "threads", "plain (Mops/s)",
+		     "magazines (Mops/s)");
+
+	for (nrthreads = 1;; nrthreads <<= 1) {
+		if (nrthreads > max_threads)
+			nrthreads = max_threads;
+		ret = heapmem_init(&heap, mem, arena_size);
+		if (ret)
+			break;
+		ret = run_contention(&heap, nrthreads, rounds, &plain_mops);
+		if (ret == 0 && !smokey_assert(heapmem_used_size(&heap) == 0))
+			ret = -EINVAL;
+		heapmem_destroy(&heap);
+		if (ret)
+			break;
+
+		ret = heapmem_init(&heap, mem, arena_size);
+		if (ret)
+			break;
+		ret = heapmem_enable_magazines(&heap);
+		if (ret == 0)
+			ret = run_contention(&heap, nrthreads, rounds,
+					     &mag_mops);
+		if (ret == 0) {
+			/* Cached blocks are still accounted until flushed. */
+			heapmem_flush_magazines(&heap);
+			if (!smokey_assert(heapmem_used_size(&heap) == 0))
+				ret = -EINVAL;
+		}
+		heapmem_destroy(&heap);
+		if (ret)
+			break;
+
+		smokey_trace("%8d %16.2f %16.2f", nrthreads,
+			     plain_mops, mag_mops);
+
+		if (nrthreads == max_threads)
+			break;
+	}
+
+	__STD(free(mem));
+
+	return ret;
+}
+
 static int run_memory_heapmem(struct smokey_test *t,
 			      int argc, char *const argv[])
 {
-	return memcheck_run(&heapmem_descriptor, t, argc, argv);
+	int ret;
+
+	ret = memcheck_run(&heapmem_descriptor, t, argc, argv);
+	if (ret)
+		return ret;
+
+	return contention_test(t);
 }
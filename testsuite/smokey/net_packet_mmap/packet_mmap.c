@@ -0,0 +1,503 @@
+/*
+ * RTnet AF_PACKET ring test over the loopback device
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netpacket/packet.h>
+
+#include <sys/cobalt.h>
+#include <rtdm/net.h>
+#include <smokey/smokey.h>
+#include "smokey_net.h"
+
+smokey_test_plugin(net_packet_mmap,
+	SMOKEY_ARGLIST(
+		SMOKEY_INT(frames),
+		SMOKEY_INT(frame_len),
+		SMOKEY_INT(batch),
+	),
+	"Check the RX/TX frame rings of RTnet packet sockets over the\n"
+	"\tloopback device, comparing their throughput with plain\n"
+	"\tsend/recv calls, and check select() on the RX ring.\n"
+	"\tframes=<N>\tframes to exchange (default 100000)\n"
+	"\tframe_len=<N>\tframe length, 64-1514 (default 128)\n"
+	"\tbatch=<N>\tframes per send call (default 8)"
+);
+
+/*
+ * <linux/if_packet.h> clashes with the glibc header smokey_net.h
+ * pulls in, mirror the TPACKET_V2 ABI bits we need.
+ */
+struct tpacket_req {
+	unsigned int tp_block_size;
+	unsigned int tp_block_nr;
+	unsigned int tp_frame_size;
+	unsigned int tp_frame_nr;
+};
+
+struct tpacket2_hdr {
+	uint32_t tp_status;
+	uint32_t tp_len;
+	uint32_t tp_snaplen;
+	uint16_t tp_mac;
+	uint16_t tp_net;
+	uint32_t tp_sec;
+	uint32_t tp_nsec;
+	uint16_t tp_vlan_tci;
+	uint16_t tp_vlan_tpid;
+	uint8_t tp_padding[4];
+};
+
+#define TPACKET_V2		1
+#define TPACKET_ALIGN(x)	(((x) + 15) & ~15)
+#define TPACKET2_HDRLEN		(TPACKET_ALIGN(sizeof(struct tpacket2_hdr)) + \
+				 sizeof(struct sockaddr_ll))
+#define TP_STATUS_KERNEL	0
+#define TP_STATUS_USER		(1 << 0)
+#define TP_STATUS_LOSING	(1 << 2)
+#define TP_STATUS_AVAILABLE	0
+#define TP_STATUS_SEND_REQUEST	(1 << 0)
+
+#define TEST_PROTO	(ETH_P_802_EX1 + 2)
+#define RING_FRAMES	256
+#define RING_FRAME_SIZE	2048
+#define RECV_TIMEOUT	1000000000LL	/* ns */
+#define IDLE_TIMEOUT	10000000LL	/* ns */
+
+struct ring {
+	void *mem;
+	size_t size;
+	size_t block_size;
+	int frames_per_block;
+};
+
+static int nr_frames = 100000, frame_len = 128, batch = 8;
+
+static int ifindex;
+
+static long long now_ns(void)
+{
+	struct timespec now;
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &now));
+
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static struct tpacket2_hdr *ring_frame(struct ring *ring, int n)
+{
+	return (void *)((char *)ring->mem +
+			(n / ring->frames_per_block) * ring->block_size +
+			(n % ring->frames_per_block) * RING_FRAME_SIZE);
+}
+
+static void build_frame(unsigned char *buf, unsigned int seq)
+{
+	struct ethhdr *eth = (struct ethhdr *)buf;
+
+	memset(eth->h_dest, 0, ETH_ALEN);
+	memset(eth->h_source, 0, ETH_ALEN);
+	eth->h_proto = htons(TEST_PROTO);
+	memcpy(buf + sizeof(*eth), &seq, sizeof(seq));
+}
+
+static int check_frame(const unsigned char *buf, int len, unsigned int seq)
+{
+	unsigned int got;
+
+	if (len != frame_len) {
+		smokey_warning("frame %u: got %d bytes, expected %d",
+			       seq, len, frame_len);
+		return -EPROTO;
+	}
+
+	memcpy(&got, buf + sizeof(struct ethhdr), sizeof(got));
+	if (got != seq) {
+		smokey_warning("frame %u: got frame %u instead", seq, got);
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
+static int open_socket(int protocol)
+{
+	int64_t timeout = RECV_TIMEOUT;
+	struct sockaddr_ll sll;
+	int sock, ret;
+
+	sock = smokey_check_errno(
+		__RT(socket(PF_PACKET, SOCK_RAW, htons(protocol))));
+	if (sock < 0)
+		return sock;
+
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(protocol);
+	sll.sll_ifindex = ifindex;
+	ret = smokey_check_errno(
+		__RT(bind(sock, (struct sockaddr *)&sll, sizeof(sll))));
+	if (ret == 0)
+		ret = smokey_check_errno(
+			__RT(ioctl(sock, RTNET_RTIOC_TIMEOUT, &timeout)));
+	if (ret < 0) {
+		__RT(close(sock));
+		return ret;
+	}
+
+	return sock;
+}
+
+static int setup_ring(int sock, int type, struct ring *ring)
+{
+	int version = TPACKET_V2, ret;
+	struct tpacket_req req;
+
+	ring->block_size = sysconf(_SC_PAGESIZE);
+	if (ring->block_size < RING_FRAME_SIZE)
+		ring->block_size = RING_FRAME_SIZE;
+	ring->frames_per_block = ring->block_size / RING_FRAME_SIZE;
+	ring->size = ring->block_size * (RING_FRAMES / ring->frames_per_block);
+
+	req.tp_block_size = ring->block_size;
+	req.tp_block_nr = RING_FRAMES / ring->frames_per_block;
+	req.tp_frame_size = RING_FRAME_SIZE;
+	req.tp_frame_nr = RING_FRAMES;
+
+	ret = __RT(setsockopt(sock, SOL_PACKET, PACKET_VERSION,
+			      &version, sizeof(version)));
+	if (ret == 0)
+		ret = __RT(setsockopt(sock, SOL_PACKET, type,
+				      &req, sizeof(req)));
+	if (ret) {
+		if (errno == ENOPROTOOPT)
+			return -ENOSYS;
+		return smokey_check_errno(ret);
+	}
+
+	ring->mem = __RT(mmap(NULL, ring->size, PROT_READ|PROT_WRITE,
+			      MAP_SHARED, sock, 0));
+	if (ring->mem == MAP_FAILED)
+		return smokey_check_errno(-1);
+
+	return 0;
+}
+
+static int run_rings(int txsock, int rxsock, double *rate)
+{
+	int txhead = 0, rxhead = 0, n, ret;
+	unsigned int sent = 0, received = 0;
+	struct ring tx, rx;
+	struct tpacket2_hdr *hdr;
+	long long start;
+
+	ret = setup_ring(txsock, PACKET_TX_RING, &tx);
+	if (ret)
+		return ret;
+
+	ret = setup_ring(rxsock, PACKET_RX_RING, &rx);
+	if (ret) {
+		munmap(tx.mem, tx.size);
+		return ret;
+	}
+
+	start = now_ns();
+
+	while (received < nr_frames) {
+		/* Never have more frames in flight than the RX ring holds. */
+		for (n = 0; n < batch && sent < nr_frames &&
+			     sent - received < RING_FRAMES; n++) {
+			hdr = ring_frame(&tx, txhead);
+			if (hdr->tp_status != TP_STATUS_AVAILABLE)
+				break;
+			build_frame((unsigned char *)hdr + TPACKET2_HDRLEN -
+				    sizeof(struct sockaddr_ll), sent);
+			hdr->tp_len = frame_len;
+			__sync_synchronize();
+			hdr->tp_status = TP_STATUS_SEND_REQUEST;
+			txhead = (txhead + 1) % RING_FRAMES;
+			sent++;
+		}
+
+		/* Out of rtskbs is fine, the frames are sent next round. */
+		ret = __RT(send(txsock, NULL, 0, 0));
+		if (ret < 0 && errno != ENOBUFS) {
+			ret = smokey_check_errno(ret);
+			goto out;
+		}
+
+		for (n = 0; received < nr_frames; n++) {
+			hdr = ring_frame(&rx, rxhead);
+			if ((hdr->tp_status & TP_STATUS_USER) == 0)
+				break;
+			__sync_synchronize();
+			if (hdr->tp_status & TP_STATUS_LOSING) {
+				smokey_warning("RX ring overflow");
+				ret = -EPROTO;
+				goto out;
+			}
+			ret = check_frame((unsigned char *)hdr + hdr->tp_mac,
+					  hdr->tp_len, received);
+			if (ret)
+				goto out;
+			__sync_synchronize();
+			hdr->tp_status = TP_STATUS_KERNEL;
+			rxhead = (rxhead + 1) % RING_FRAMES;
+			received++;
+		}
+
+		/* Frames may still travel through the RX dispatcher. */
+		if (n == 0 && received < nr_frames) {
+			ret = __RT(recv(rxsock, NULL, 0, 0));
+			if (ret < 0) {
+				if (errno == ETIMEDOUT)
+					smokey_warning("%u frames lost",
+						       sent - received);
+				ret = smokey_check_errno(ret);
+				goto out;
+			}
+		}
+	}
+
+	*rate = received / ((now_ns() - start) / 1e9);
+	ret = 0;
+out:
+	munmap(rx.mem, rx.size);
+	munmap(tx.mem, tx.size);
+
+	return ret;
+}
+
+static int wait_readable(int sock, long long timeout)
+{
+	struct timeval tv;
+	fd_set rfds;
+
+	FD_ZERO(&rfds);
+	FD_SET(sock, &rfds);
+	tv.tv_sec = timeout / 1000000000LL;
+	tv.tv_usec = (timeout % 1000000000LL) / 1000;
+
+	return smokey_check_errno(
+		__RT(select(sock + 1, &rfds, NULL, NULL, &tv)));
+}
+
+/*
+ * Release RX frames by writing tp_status only, as TPACKET readers
+ * do: select() must stop reporting the ring readable once drained.
+ */
+static int run_select(int txsock, int rxsock)
+{
+	struct tpacket2_hdr *hdr;
+	struct ring tx, rx;
+	unsigned int seq;
+	int ret;
+
+	ret = setup_ring(txsock, PACKET_TX_RING, &tx);
+	if (ret)
+		return ret;
+
+	ret = setup_ring(rxsock, PACKET_RX_RING, &rx);
+	if (ret) {
+		munmap(tx.mem, tx.size);
+		return ret;
+	}
+
+	for (seq = 0; seq < 4; seq++) {
+		hdr = ring_frame(&tx, seq);
+		build_frame((unsigned char *)hdr + TPACKET2_HDRLEN -
+			    sizeof(struct sockaddr_ll), seq);
+		hdr->tp_len = frame_len;
+		__sync_synchronize();
+		hdr->tp_status = TP_STATUS_SEND_REQUEST;
+		ret = smokey_check_errno(__RT(send(txsock, NULL, 0, 0)));
+		if (ret < 0)
+			goto out;
+
+		ret = wait_readable(rxsock, RECV_TIMEOUT);
+		if (ret < 0)
+			goto out;
+		hdr = ring_frame(&rx, seq);
+		if (ret != 1 || (hdr->tp_status & TP_STATUS_USER) == 0) {
+			smokey_warning("frame %u: RX ring not reported readable",
+				       seq);
+			ret = -EPROTO;
+			goto out;
+		}
+		__sync_synchronize();
+		ret = check_frame((unsigned char *)hdr + hdr->tp_mac,
+				  hdr->tp_len, seq);
+		if (ret)
+			goto out;
+		__sync_synchronize();
+		hdr->tp_status = TP_STATUS_KERNEL;
+
+		ret = wait_readable(rxsock, IDLE_TIMEOUT);
+		if (ret < 0)
+			goto out;
+		if (ret != 0) {
+			smokey_warning("frame %u: drained RX ring reported readable",
+				       seq);
+			ret = -EPROTO;
+			goto out;
+		}
+	}
+out:
+	munmap(rx.mem, rx.size);
+	munmap(tx.mem, tx.size);
+
+	return ret;
+}
+
+static int run_copies(int txsock, int rxsock, double *rate)
+{
+	unsigned int sent = 0, received = 0;
+	unsigned char buf[ETH_FRAME_LEN];
+	long long start;
+	int n, ret;
+
+	memset(buf, 0, sizeof(buf));
+
+	start = now_ns();
+
+	while (received < nr_frames) {
+		/* Socket pools hold 16 rtskbs by default. */
+		for (n = 0; n < batch && sent < nr_frames &&
+			     sent - received < 16; n++, sent++) {
+			build_frame(buf, sent);
+			ret = smokey_check_errno(
+				__RT(send(txsock, buf, frame_len, 0)));
+			if (ret < 0)
+				return ret;
+		}
+
+		do {
+			ret = smokey_check_errno(
+				__RT(recv(rxsock, buf, sizeof(buf), 0)));
+			if (ret < 0)
+				return ret;
+			ret = check_frame(buf, ret, received);
+			if (ret)
+				return ret;
+		} while (++received < sent);
+	}
+
+	*rate = received / ((now_ns() - start) / 1e9);
+
+	return 0;
+}
+
+static int open_pair(int *txsock, int *rxsock)
+{
+	*txsock = open_socket(0);
+	if (*txsock < 0)
+		return *txsock;
+
+	*rxsock = open_socket(TEST_PROTO);
+	if (*rxsock < 0) {
+		__RT(close(*txsock));
+		return *rxsock;
+	}
+
+	return 0;
+}
+
+static void close_pair(int txsock, int rxsock)
+{
+	__RT(close(rxsock));
+	__RT(close(txsock));
+}
+
+static int run_net_packet_mmap(struct smokey_test *t,
+			       int argc, char *const argv[])
+{
+	double ring_rate = 0, copy_rate = 0;
+	struct sockaddr_in peer;
+	int txsock, rxsock, ret, tmp;
+	struct ifreq ifr;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(net_packet_mmap, frames))
+		nr_frames = SMOKEY_ARG_INT(net_packet_mmap, frames);
+	if (SMOKEY_ARG_ISSET(net_packet_mmap, frame_len))
+		frame_len = SMOKEY_ARG_INT(net_packet_mmap, frame_len);
+	if (SMOKEY_ARG_ISSET(net_packet_mmap, batch))
+		batch = SMOKEY_ARG_INT(net_packet_mmap, batch);
+
+	if (nr_frames < 1 || batch < 1 ||
+	    frame_len < ETH_ZLEN + 4 || frame_len > ETH_FRAME_LEN) {
+		smokey_warning("invalid arguments");
+		return -EINVAL;
+	}
+
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	ret = smokey_net_setup("rt_loopback", "rtlo",
+			       _CC_COBALT_NET_AF_PACKET, &peer);
+	if (ret < 0)
+		return ret;
+
+	ret = open_pair(&txsock, &rxsock);
+	if (ret < 0)
+		goto out;
+
+	snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "rtlo");
+	ret = smokey_check_errno(__RT(ioctl(txsock, SIOCGIFINDEX, &ifr)));
+	close_pair(txsock, rxsock);
+	if (ret < 0)
+		goto out;
+	ifindex = ifr.ifr_ifindex;
+
+	ret = open_pair(&txsock, &rxsock);
+	if (ret < 0)
+		goto out;
+	ret = run_copies(txsock, rxsock, &copy_rate);
+	close_pair(txsock, rxsock);
+	if (ret < 0)
+		goto out;
+
+	ret = open_pair(&txsock, &rxsock);
+	if (ret < 0)
+		goto out;
+	ret = run_rings(txsock, rxsock, &ring_rate);
+	close_pair(txsock, rxsock);
+	if (ret == -ENOSYS)
+		smokey_note("net_packet_mmap: no ring support in AF_PACKET");
+	if (ret < 0)
+		goto out;
+
+	ret = open_pair(&txsock, &rxsock);
+	if (ret < 0)
+		goto out;
+	ret = run_select(txsock, rxsock);
+	close_pair(txsock, rxsock);
+	if (ret < 0)
+		goto out;
+
+	smokey_trace("%d frames of %d bytes, batches of %d", nr_frames,
+		     frame_len, batch);
+	smokey_trace("send/recv: %10.0f frames/s", copy_rate);
+	smokey_trace("rings:     %10.0f frames/s", ring_rate);
+out:
+	tmp = smokey_net_teardown("rt_loopback", "rtlo",
+				  _CC_COBALT_NET_AF_PACKET);
+	if (ret == 0)
+		ret = tmp;
+
+	return ret;
+}
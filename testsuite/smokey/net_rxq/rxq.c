@@ -0,0 +1,349 @@
+/*
+ * RTnet RX dispatch benchmark over the loopback device
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+
+#include <sys/cobalt.h>
+#include <smokey/smokey.h>
+#include "smokey_net.h"
+
+smokey_test_plugin(net_rxq,
+	SMOKEY_ARGLIST(
+		SMOKEY_INT(flows),
+		SMOKEY_INT(packets),
+		SMOKEY_INT(window),
+	),
+	"Measure RTnet receive throughput and latency with concurrent UDP\n"
+	"\tflows over the loopback device. Load rt_loopback with\n"
+	"\trx_dispatch=1 so that frames go through the RX dispatch queues,\n"
+	"\tand rtnet with rx_queues=<N> to spread them over N stack managers.\n"
+	"\tflows=<N>\tconcurrent UDP flows (default 4)\n"
+	"\tpackets=<N>\tpackets per flow (default 20000)\n"
+	"\twindow=<N>\tpackets in flight per flow (default 4)"
+);
+
+#define BASE_PORT	40000
+#define MAX_FLOWS	32
+#define RECV_TIMEOUT	1	/* seconds */
+
+struct flow {
+	int port;
+	int rsock;
+	sem_t window;
+	pthread_t sender;
+	pthread_t receiver;
+	unsigned long received;
+	unsigned long lost;
+	long long lat_min;
+	long long lat_max;
+	long long lat_sum;
+};
+
+static struct flow flows[MAX_FLOWS];
+
+static struct sockaddr_in peer;
+
+static int nr_flows = 4, nr_packets = 20000, window = 4;
+
+static long long now_ns(void)
+{
+	struct timespec now;
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &now));
+
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void *sender(void *arg)
+{
+	struct smokey_net_payload payload;
+	struct sockaddr_in to = peer;
+	struct flow *f = arg;
+	struct timespec ts;
+	int sock, ret = 0;
+
+	sock = smokey_check_errno(__RT(socket(PF_INET, SOCK_DGRAM, 0)));
+	if (sock < 0)
+		return (void *)(long)sock;
+
+	to.sin_port = htons(f->port);
+
+	for (payload.seq = 0; payload.seq < nr_packets; payload.seq++) {
+		/* Cobalt semaphores time out on CLOCK_REALTIME. */
+		__RT(clock_gettime(CLOCK_REALTIME, &ts));
+		ts.tv_sec += RECV_TIMEOUT;
+		if (__RT(sem_timedwait(&f->window, &ts))) {
+			ret = -errno;
+			/* A lost packet never gives its credit back. */
+			if (ret == -ETIMEDOUT) {
+				smokey_warning("flow %d: packet lost, window "
+					       "stalled at seq %u",
+					       f->port - BASE_PORT,
+					       payload.seq);
+				ret = -EPROTO;
+			}
+			break;
+		}
+		__RT(clock_gettime(CLOCK_MONOTONIC, &payload.ts));
+		ret = smokey_check_errno(
+			__RT(sendto(sock, &payload, sizeof(payload), 0,
+				    (struct sockaddr *)&to, sizeof(to))));
+		if (ret < 0)
+			break;
+		ret = 0;
+	}
+
+	__RT(close(sock));
+
+	return (void *)(long)ret;
+}
+
+static void *receiver(void *arg)
+{
+	struct smokey_net_payload payload;
+	struct flow *f = arg;
+	struct timeval timeout;
+	long long lat;
+	fd_set set;
+	int ret;
+
+	while (f->received < nr_packets) {
+		FD_ZERO(&set);
+		FD_SET(f->rsock, &set);
+		timeout.tv_sec = RECV_TIMEOUT;
+		timeout.tv_usec = 0;
+		ret = smokey_check_errno(
+			__RT(select(f->rsock + 1, &set, NULL, NULL, &timeout)));
+		if (ret < 0)
+			return (void *)(long)ret;
+		if (ret == 0)
+			break;	/* Sender is done, or stalled. */
+
+		ret = smokey_check_errno(
+			__RT(recv(f->rsock, &payload, sizeof(payload), 0)));
+		if (ret < 0)
+			return (void *)(long)ret;
+
+		lat = now_ns() - (payload.ts.tv_sec * 1000000000LL +
+				  payload.ts.tv_nsec);
+		if (lat < f->lat_min)
+			f->lat_min = lat;
+		if (lat > f->lat_max)
+			f->lat_max = lat;
+		f->lat_sum += lat;
+		f->received++;
+		__RT(sem_post(&f->window));
+	}
+
+	f->lost = nr_packets - f->received;
+
+	return NULL;
+}
+
+static int open_flow(struct flow *f, int port)
+{
+	struct sockaddr_in name;
+	int ret;
+
+	f->port = port;
+	f->received = 0;
+	f->lost = 0;
+	f->lat_min = ~0ULL >> 1;
+	f->lat_max = 0;
+	f->lat_sum = 0;
+
+	f->rsock = smokey_check_errno(__RT(socket(PF_INET, SOCK_DGRAM, 0)));
+	if (f->rsock < 0)
+		return f->rsock;
+
+	name = peer;
+	name.sin_port = htons(port);
+	ret = smokey_check_errno(
+		__RT(bind(f->rsock, (struct sockaddr *)&name, sizeof(name))));
+	if (ret < 0) {
+		__RT(close(f->rsock));
+		return ret;
+	}
+
+	ret = smokey_check_errno(__RT(sem_init(&f->window, 0, window)));
+	if (ret < 0)
+		__RT(close(f->rsock));
+
+	return ret;
+}
+
+static void close_flow(struct flow *f)
+{
+	__RT(sem_destroy(&f->window));
+	__RT(close(f->rsock));
+}
+
+static int start_thread(pthread_t *tid, void *(*fn)(void *), void *arg,
+			int prio)
+{
+	struct sched_param param = { .sched_priority = prio };
+	pthread_attr_t attr;
+	int ret;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+	ret = smokey_check_status(__RT(pthread_create(tid, &attr, fn, arg)));
+	pthread_attr_destroy(&attr);
+
+	return ret;
+}
+
+static const char *read_param(const char *path, char *buf, size_t len)
+{
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return "?";
+
+	if (fgets(buf, len, fp) == NULL)
+		strcpy(buf, "?");
+	else
+		buf[strcspn(buf, "\n")] = '\0';
+
+	fclose(fp);
+
+	return buf;
+}
+
+static int run_net_rxq(struct smokey_test *t, int argc, char *const argv[])
+{
+	unsigned long received = 0, lost = 0;
+	long long start, elapsed, lat_min = ~0ULL >> 1, lat_max = 0,
+		lat_sum = 0;
+	char queues[16], dispatch[16];
+	int n, ret, tmp;
+	void *status;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(net_rxq, flows))
+		nr_flows = SMOKEY_ARG_INT(net_rxq, flows);
+	if (SMOKEY_ARG_ISSET(net_rxq, packets))
+		nr_packets = SMOKEY_ARG_INT(net_rxq, packets);
+	if (SMOKEY_ARG_ISSET(net_rxq, window))
+		window = SMOKEY_ARG_INT(net_rxq, window);
+
+	if (nr_flows < 1 || nr_flows > MAX_FLOWS ||
+	    nr_packets < 1 || window < 1) {
+		smokey_warning("invalid arguments");
+		return -EINVAL;
+	}
+
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	ret = smokey_net_setup("rt_loopback", "rtlo",
+			       _CC_COBALT_NET_UDP, &peer);
+	if (ret < 0)
+		return ret;
+
+	smokey_trace("%d flows, %d packets each, window %d, "
+		     "rx_queues=%s, rx_dispatch=%s", nr_flows, nr_packets,
+		     window,
+		     read_param("/sys/module/rtnet/parameters/rx_queues",
+				queues, sizeof(queues)),
+		     read_param("/sys/module/rt_loopback/parameters/rx_dispatch",
+				dispatch, sizeof(dispatch)));
+
+	for (n = 0; n < nr_flows; n++) {
+		ret = open_flow(flows + n, BASE_PORT + n);
+		if (ret < 0)
+			goto out_close;
+	}
+
+	start = now_ns();
+
+	for (n = 0; n < nr_flows; n++) {
+		ret = start_thread(&flows[n].receiver, receiver, flows + n, 21);
+		if (ret < 0)
+			goto out_join;
+		ret = start_thread(&flows[n].sender, sender, flows + n, 20);
+		if (ret < 0) {
+			pthread_cancel(flows[n].receiver);
+			pthread_join(flows[n].receiver, NULL);
+			goto out_join;
+		}
+	}
+out_join:
+	while (--n >= 0) {
+		pthread_join(flows[n].sender, &status);
+		if (ret == 0)
+			ret = (int)(long)status;
+		pthread_join(flows[n].receiver, &status);
+		if (ret == 0)
+			ret = (int)(long)status;
+	}
+
+	elapsed = now_ns() - start;
+	n = nr_flows;
+
+	if (ret == 0) {
+		for (n = 0; n < nr_flows; n++) {
+			struct flow *f = flows + n;
+
+			if (f->received == 0)
+				continue;
+			smokey_trace("flow %2d: %8lu rcvd %6lu lost, "
+				     "latency min %.3f avg %.3f max %.3f us",
+				     n, f->received, f->lost,
+				     f->lat_min / 1000.0,
+				     f->lat_sum / (double)f->received / 1000.0,
+				     f->lat_max / 1000.0);
+			received += f->received;
+			lost += f->lost;
+			lat_sum += f->lat_sum;
+			if (f->lat_min < lat_min)
+				lat_min = f->lat_min;
+			if (f->lat_max > lat_max)
+				lat_max = f->lat_max;
+		}
+
+		if (received == 0) {
+			smokey_warning("no packet received");
+			ret = -EPROTO;
+		} else {
+			/* Do not account for the final receive timeout. */
+			if (lost)
+				elapsed -= RECV_TIMEOUT * 1000000000LL;
+			smokey_trace("total: %.0f packets/s, latency min %.3f "
+				     "avg %.3f max %.3f us",
+				     received / (elapsed / 1e9),
+				     lat_min / 1000.0,
+				     lat_sum / (double)received / 1000.0,
+				     lat_max / 1000.0);
+			if (lost) {
+				smokey_warning("%lu packets lost", lost);
+				ret = -EPROTO;
+			}
+		}
+	}
+
+out_close:
+	while (--n >= 0)
+		close_flow(flows + n);
+
+	tmp = smokey_net_teardown("rt_loopback", "rtlo", _CC_COBALT_NET_UDP);
+	if (ret == 0)
+		ret = tmp;
+
+	return ret;
+}
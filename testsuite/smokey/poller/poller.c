@@ -0,0 +1,286 @@
+/*
+ * Cobalt poller test.
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/timerfd.h>
+#include <cobalt/sys/cobalt.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(poller,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(loops),
+		   ),
+		   "Check the Cobalt poller, then compare the cost of waiting\n"
+		   "\ton 10, 100 and 1000 descriptors with select().\n"
+		   "\tloops=<n>, number of waits per set size (default 10000)"
+);
+
+static int arm_timerfd(int fd)
+{
+	struct itimerspec its = {
+		.it_value = { .tv_sec = 0, .tv_nsec = 1000 },
+	};
+
+	return timerfd_settime(fd, 0, &its, NULL);
+}
+
+static int check_poller(void)
+{
+	struct cobalt_poll_event ev, out[4];
+	struct timespec zero = { 0, 0 };
+	int pfd, tfd, fds[3], i, ret;
+	uint64_t ticks;
+
+	pfd = cobalt_poller_create(4, O_CLOEXEC);
+	if (pfd == -ENOSYS)
+		return -ENOSYS;
+	if (!smokey_assert(pfd >= 0))
+		return pfd;
+
+	tfd = smokey_check_errno(timerfd_create(CLOCK_MONOTONIC, 0));
+	if (tfd < 0) {
+		ret = tfd;
+		goto out;
+	}
+
+	ev.events = COBALT_POLLIN;
+	ev.data = 42;
+	ret = smokey_check_status(-cobalt_poller_ctl(pfd, COBALT_POLLER_ADD,
+						     tfd, &ev));
+	if (ret)
+		goto out;
+
+	if (!smokey_assert(cobalt_poller_ctl(pfd, COBALT_POLLER_ADD,
+					     tfd, &ev) == -EEXIST) ||
+	    !smokey_assert(cobalt_poller_ctl(pfd, COBALT_POLLER_MOD,
+					     pfd, &ev) == -EINVAL) ||
+	    !smokey_assert(cobalt_poller_ctl(pfd, COBALT_POLLER_ADD,
+					     STDIN_FILENO, &ev) == -EPERM)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Nothing ready yet. */
+	if (!smokey_assert(cobalt_poller_wait(pfd, out, 4, &zero) == 0)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = smokey_check_errno(arm_timerfd(tfd));
+	if (ret)
+		goto out;
+
+	ret = cobalt_poller_wait(pfd, out, 4, NULL);
+	if (!smokey_assert(ret == 1) ||
+	    !smokey_assert(out[0].events == COBALT_POLLIN) ||
+	    !smokey_assert(out[0].data == 42)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Level-triggered: reported until the timer is read. */
+	if (!smokey_assert(cobalt_poller_wait(pfd, out, 4, &zero) == 1)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	ret = smokey_check_errno(read(tfd, &ticks, sizeof(ticks)));
+	if (ret < 0)
+		goto out;
+	if (!smokey_assert(cobalt_poller_wait(pfd, out, 4, &zero) == 0)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Timerfds do not support POLLOUT. */
+	ev.events = COBALT_POLLIN | COBALT_POLLOUT;
+	if (!smokey_assert(cobalt_poller_ctl(pfd, COBALT_POLLER_MOD,
+					     tfd, &ev) == -EBADF)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Fill up the set. */
+	ev.events = COBALT_POLLIN;
+	for (i = 0; i < 3; i++) {
+		fds[i] = smokey_check_errno(timerfd_create(CLOCK_MONOTONIC, 0));
+		if (fds[i] < 0) {
+			ret = fds[i];
+			goto out;
+		}
+		ret = smokey_check_status(-cobalt_poller_ctl(pfd,
+					COBALT_POLLER_ADD, fds[i], &ev));
+		if (ret)
+			goto out;
+	}
+	if (!smokey_assert(cobalt_poller_ctl(pfd, COBALT_POLLER_ADD,
+					     STDOUT_FILENO, &ev) == -ENOSPC)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Closing a watched descriptor reports a hang up. */
+	close(fds[0]);
+	ret = cobalt_poller_wait(pfd, out, 4, &zero);
+	if (!smokey_assert(ret == 1) ||
+	    !smokey_assert(out[0].events == COBALT_POLLHUP)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	ret = smokey_check_status(-cobalt_poller_ctl(pfd, COBALT_POLLER_DEL,
+						     fds[0], NULL));
+	if (ret)
+		goto out;
+	if (!smokey_assert(cobalt_poller_wait(pfd, out, 4, &zero) == 0) ||
+	    !smokey_assert(cobalt_poller_ctl(pfd, COBALT_POLLER_DEL,
+					     fds[0], NULL) == -ENOENT))
+		ret = -EINVAL;
+
+	close(fds[1]);
+	close(fds[2]);
+out:
+	if (tfd >= 0)
+		close(tfd);
+	close(pfd);
+
+	return ret;
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Watch @nfds timerfds, the last one being always ready, and time
+ * the waits each service needs for reporting it.
+ */
+static int bench_size(int nfds, int loops)
+{
+	long long select_ns, poller_ns, start;
+	struct cobalt_poll_event ev, out[1];
+	int *fds, pfd, i, nr, maxfd = -1, ret;
+	fd_set in, rfds;
+
+	fds = malloc(nfds * sizeof(*fds));
+	if (fds == NULL)
+		return -ENOMEM;
+
+	pfd = cobalt_poller_create(nfds, 0);
+	if (pfd < 0) {
+		free(fds);
+		return pfd;
+	}
+
+	FD_ZERO(&in);
+	for (nr = 0; nr < nfds; nr++) {
+		fds[nr] = timerfd_create(CLOCK_MONOTONIC, 0);
+		if (fds[nr] < 0 || fds[nr] >= FD_SETSIZE) {
+			if (fds[nr] >= 0)
+				close(fds[nr]);
+			smokey_note("%d fds: cannot create that many "
+				    "selectable timers, skipped", nfds);
+			ret = 0;
+			goto out;
+		}
+		FD_SET(fds[nr], &in);
+		if (fds[nr] > maxfd)
+			maxfd = fds[nr];
+		ev.events = COBALT_POLLIN;
+		ev.data = nr;
+		ret = smokey_check_status(-cobalt_poller_ctl(pfd,
+					COBALT_POLLER_ADD, fds[nr], &ev));
+		if (ret) {
+			close(fds[nr]);
+			goto out;
+		}
+	}
+
+	ret = smokey_check_errno(arm_timerfd(fds[nfds - 1]));
+	if (ret)
+		goto out;
+
+	/* Let the timer tick, the descriptor stays ready. */
+	ret = cobalt_poller_wait(pfd, out, 1, NULL);
+	if (!smokey_assert(ret == 1 && out[0].data == nfds - 1)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* The first select() call binds the descriptors, skip it. */
+	rfds = in;
+	select(maxfd + 1, &rfds, NULL, NULL, NULL);
+
+	start = now_ns();
+	for (i = 0; i < loops; i++) {
+		rfds = in;
+		ret = select(maxfd + 1, &rfds, NULL, NULL, NULL);
+		if (ret != 1) {
+			ret = ret < 0 ? -errno : -EINVAL;
+			smokey_warning("select: %s", strerror(-ret));
+			goto out;
+		}
+	}
+	select_ns = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < loops; i++) {
+		ret = cobalt_poller_wait(pfd, out, 1, NULL);
+		if (ret != 1) {
+			ret = ret < 0 ? ret : -EINVAL;
+			smokey_warning("cobalt_poller_wait: %s",
+				       strerror(-ret));
+			goto out;
+		}
+	}
+	poller_ns = now_ns() - start;
+
+	smokey_trace("%4d fds: select %lld ns/wait, poller %lld ns/wait",
+		     nfds, select_ns / loops, poller_ns / loops);
+	ret = 0;
+out:
+	while (--nr >= 0)
+		close(fds[nr]);
+	close(pfd);
+	free(fds);
+
+	return ret;
+}
+
+static int run_poller(struct smokey_test *t, int argc, char *const argv[])
+{
+	int loops = 10000, ret;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(poller, loops))
+		loops = SMOKEY_ARG_INT(poller, loops);
+	if (loops <= 0)
+		return -EINVAL;
+
+	ret = check_poller();
+	if (ret)
+		return ret;
+
+	ret = bench_size(10, loops);
+	if (ret)
+		return ret;
+
+	ret = bench_size(100, loops);
+	if (ret)
+		return ret;
+
+	return bench_size(1000, loops);
+}
@@ -0,0 +1,463 @@
+/*
+ * Zero-copy POSIX message queue test.
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(posix_mqueue,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(loops),
+		   ),
+		   "Check zero-copy POSIX message queues, then compare the\n"
+		   "\tlatency and throughput of copied and slot-passed messages.\n"
+		   "\tloops=<n>, number of messages per size (default 10000)"
+);
+
+#define MQ_NAME		"/smokey-mqueue"
+#define MQ_CHECK_MSGS	4
+#define MQ_CHECK_MSGSZ	4096
+#define MQ_BENCH_MSGS	4
+
+struct bench_stamp {
+	long long sent;
+	int seq;
+};
+
+struct bench_context {
+	mqd_t mq;
+	size_t size;
+	int loops;
+	int slots;
+	long long sum_ns;
+	long long max_ns;
+	int ret;
+};
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static mqd_t open_queue(int oflags, long maxmsg, long msgsize, long flags)
+{
+	struct mq_attr qa = {
+		.mq_flags = flags,
+		.mq_maxmsg = maxmsg,
+		.mq_msgsize = msgsize,
+	};
+
+	mq_unlink(MQ_NAME);
+
+	return mq_open(MQ_NAME, oflags | O_CREAT | O_EXCL, 0600, &qa);
+}
+
+static void close_queue(mqd_t mq)
+{
+	mq_close(mq);
+	mq_unlink(MQ_NAME);
+}
+
+static int check_slots(void)
+{
+	int slot, rslot, slots[MQ_CHECK_MSGS], i, ret;
+	unsigned int prio;
+	void *buf, *rbuf;
+	char msg[16];
+	ssize_t len;
+	mqd_t mq, mq2 = -1;
+
+	mq = open_queue(O_RDWR | O_NONBLOCK, MQ_CHECK_MSGS, MQ_CHECK_MSGSZ, 0);
+	if (mq < 0)
+		return -errno;
+
+	/* Slots are meaningless for a copying queue. */
+	ret = mq_slot_alloc_np(mq, &buf, NULL);
+	close_queue(mq);
+	if (ret >= 0)
+		return -EINVAL;
+	if (errno == ENOSYS)
+		return -ENOSYS;
+	if (!smokey_assert(errno == EOPNOTSUPP))
+		return -EINVAL;
+
+	mq = open_queue(O_RDWR | O_NONBLOCK, MQ_CHECK_MSGS, MQ_CHECK_MSGSZ,
+			COBALT_MQ_ZEROCOPY);
+	if (mq < 0)
+		return smokey_check_errno(mq);
+
+	/* Slot to slot. */
+	slot = smokey_check_errno(mq_slot_alloc_np(mq, &buf, NULL));
+	if (slot < 0) {
+		ret = slot;
+		goto out;
+	}
+	memset(buf, 0xa5, 100);
+	ret = smokey_check_errno(mq_slot_send_np(mq, slot, 100, 3));
+	if (ret)
+		goto out;
+
+	len = smokey_check_errno(mq_slot_receive_np(mq, &rslot, &rbuf,
+						    &prio, NULL));
+	if (len < 0) {
+		ret = len;
+		goto out;
+	}
+	if (!smokey_assert(len == 100 && prio == 3) ||
+	    !smokey_assert(rslot == slot && rbuf == buf) ||
+	    !smokey_assert(((unsigned char *)rbuf)[99] == 0xa5)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	ret = smokey_check_errno(mq_slot_free_np(mq, rslot));
+	if (ret)
+		goto out;
+
+	/* A slot cannot be released twice. */
+	if (!smokey_assert(mq_slot_free_np(mq, rslot) < 0 && errno == EINVAL)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Copy in, slot out. */
+	ret = smokey_check_errno(mq_send(mq, "copied", 7, 1));
+	if (ret)
+		goto out;
+	len = smokey_check_errno(mq_slot_receive_np(mq, &rslot, &rbuf,
+						    NULL, NULL));
+	if (len < 0) {
+		ret = len;
+		goto out;
+	}
+	if (!smokey_assert(len == 7 && strcmp(rbuf, "copied") == 0)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	ret = smokey_check_errno(mq_slot_free_np(mq, rslot));
+	if (ret)
+		goto out;
+
+	/* Slot in, copy out. */
+	slot = smokey_check_errno(mq_slot_alloc_np(mq, &buf, NULL));
+	if (slot < 0) {
+		ret = slot;
+		goto out;
+	}
+	strcpy(buf, "in place");
+	ret = smokey_check_errno(mq_slot_send_np(mq, slot, 9, 0));
+	if (ret)
+		goto out;
+	len = smokey_check_errno(mq_receive(mq, msg, MQ_CHECK_MSGSZ, NULL));
+	if (len < 0) {
+		ret = len;
+		goto out;
+	}
+	if (!smokey_assert(len == 9 && strcmp(msg, "in place") == 0)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Slots belong to the descriptor they were obtained from. */
+	mq2 = smokey_check_errno(mq_open(MQ_NAME, O_RDWR | O_NONBLOCK));
+	if (mq2 < 0) {
+		ret = mq2;
+		goto out;
+	}
+	slot = smokey_check_errno(mq_slot_alloc_np(mq, &buf, NULL));
+	if (slot < 0) {
+		ret = slot;
+		goto out;
+	}
+	if (!smokey_assert(mq_slot_send_np(mq2, slot, 1, 0) < 0 &&
+			   errno == EINVAL) ||
+	    !smokey_assert(mq_slot_free_np(mq2, slot) < 0 &&
+			   errno == EINVAL)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	ret = smokey_check_errno(mq_slot_free_np(mq, slot));
+	if (ret)
+		goto out;
+
+	/* Closing a descriptor gives back the slots it holds. */
+	slot = smokey_check_errno(mq_slot_alloc_np(mq2, &buf, NULL));
+	if (slot < 0) {
+		ret = slot;
+		goto out;
+	}
+	mq_close(mq2);
+	mq2 = -1;
+
+	/* Exhaust the slots, then give them back unsent. */
+	for (i = 0; i < MQ_CHECK_MSGS; i++) {
+		slots[i] = smokey_check_errno(mq_slot_alloc_np(mq, &buf, NULL));
+		if (slots[i] < 0) {
+			ret = slots[i];
+			goto out;
+		}
+	}
+	if (!smokey_assert(mq_slot_alloc_np(mq, &buf, NULL) < 0 &&
+			   errno == EAGAIN)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	for (i = 0; i < MQ_CHECK_MSGS; i++) {
+		ret = smokey_check_errno(mq_slot_free_np(mq, slots[i]));
+		if (ret)
+			goto out;
+	}
+out:
+	if (mq2 >= 0)
+		mq_close(mq2);
+	close_queue(mq);
+
+	return ret;
+}
+
+static void create_fifo_thread(pthread_t *tid, int prio,
+			       void *(*fn)(void *), void *arg)
+{
+	struct sched_param param = {.sched_priority = prio };
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+
+	errno = pthread_create(tid, &attr, fn, arg);
+	if (errno) {
+		perror("pthread_create");
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_attr_destroy(&attr);
+}
+
+static void account(struct bench_context *b, const void *msg, int seq)
+{
+	const struct bench_stamp *st = msg;
+	long long ns = now_ns() - st->sent;
+
+	if (st->seq != seq && b->ret == 0)
+		b->ret = -EPROTO;
+
+	b->sum_ns += ns;
+	if (ns > b->max_ns)
+		b->max_ns = ns;
+}
+
+static void *copy_sender(void *arg)
+{
+	struct bench_context *b = arg;
+	struct bench_stamp *st;
+	char *buf;
+	int n;
+
+	buf = malloc(b->size);
+	if (buf == NULL) {
+		b->ret = -ENOMEM;
+		return NULL;
+	}
+
+	st = (struct bench_stamp *)buf;
+	for (n = 0; n < b->loops; n++) {
+		/* Produce the message locally, then have it copied. */
+		memset(buf, n, b->size);
+		st->seq = n;
+		st->sent = now_ns();
+		if (mq_send(b->mq, buf, b->size, 0)) {
+			b->ret = -errno;
+			break;
+		}
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+static void *copy_receiver(void *arg)
+{
+	struct bench_context *b = arg;
+	char *buf;
+	int n;
+
+	buf = malloc(b->size);
+	if (buf == NULL) {
+		b->ret = -ENOMEM;
+		return NULL;
+	}
+
+	for (n = 0; n < b->loops; n++) {
+		if (mq_receive(b->mq, buf, b->size, NULL) < 0) {
+			b->ret = -errno;
+			break;
+		}
+		account(b, buf, n);
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+static void *slot_sender(void *arg)
+{
+	struct bench_context *b = arg;
+	struct bench_stamp *st;
+	int n, slot;
+	void *buf;
+
+	for (n = 0; n < b->loops; n++) {
+		/* Produce the message right into the queue memory. */
+		slot = mq_slot_alloc_np(b->mq, &buf, NULL);
+		if (slot < 0) {
+			b->ret = -errno;
+			break;
+		}
+		memset(buf, n, b->size);
+		st = buf;
+		st->seq = n;
+		st->sent = now_ns();
+		if (mq_slot_send_np(b->mq, slot, b->size, 0)) {
+			b->ret = -errno;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void *slot_receiver(void *arg)
+{
+	struct bench_context *b = arg;
+	int n, slot;
+	void *buf;
+
+	for (n = 0; n < b->loops; n++) {
+		if (mq_slot_receive_np(b->mq, &slot, &buf, NULL, NULL) < 0) {
+			b->ret = -errno;
+			break;
+		}
+		account(b, buf, n);
+		if (mq_slot_free_np(b->mq, slot)) {
+			b->ret = -errno;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static int run_bench(const char *name, struct bench_context *b)
+{
+	struct bench_context rb = *b, sb = *b;
+	struct timespec start, end;
+	pthread_t rtid, stid;
+	long long ns;
+
+	/*
+	 * The receiver outranks the sender, so every message is
+	 * picked up as soon as it is posted: the per-message delay
+	 * covers production, posting, wake up and retrieval.
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	create_fifo_thread(&rtid, 71, b->slots ? slot_receiver : copy_receiver,
+			   &rb);
+	create_fifo_thread(&stid, 70, b->slots ? slot_sender : copy_sender,
+			   &sb);
+	pthread_join(stid, NULL);
+	if (sb.ret)
+		/* Unblock the receiver if the sender bailed out early. */
+		pthread_cancel(rtid);
+	pthread_join(rtid, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (sb.ret || rb.ret) {
+		smokey_warning("%s: transfer failed: %s", name,
+			       strerror(-(sb.ret ?: rb.ret)));
+		return sb.ret ?: rb.ret;
+	}
+
+	ns = (end.tv_sec - start.tv_sec) * 1000000000LL +
+		end.tv_nsec - start.tv_nsec;
+	smokey_trace("%s: %d x %zu bytes, avg %lld ns, max %lld ns, %lld MB/s",
+		     name, b->loops, b->size, rb.sum_ns / b->loops, rb.max_ns,
+		     ns > 0 ? (long long)b->size * b->loops * 1000 / ns : 0LL);
+
+	return 0;
+}
+
+static int bench_size(int loops, size_t size)
+{
+	struct bench_context b = {
+		.size = size,
+		.loops = loops,
+	};
+	char name[32];
+	int ret;
+
+	b.mq = open_queue(O_RDWR, MQ_BENCH_MSGS, size, 0);
+	if (b.mq < 0)
+		return smokey_check_errno(b.mq);
+
+	snprintf(name, sizeof(name), "copy/%zuk", size / 1024);
+	ret = run_bench(name, &b);
+	close_queue(b.mq);
+	if (ret)
+		return ret;
+
+	b.mq = open_queue(O_RDWR, MQ_BENCH_MSGS, size, COBALT_MQ_ZEROCOPY);
+	if (b.mq < 0) {
+		if (errno == ENOSPC) {
+			smokey_note("slot/%zuk: shared heap too small, "
+				    "skipped", size / 1024);
+			return 0;
+		}
+		return smokey_check_errno(b.mq);
+	}
+
+	b.slots = 1;
+	snprintf(name, sizeof(name), "slot/%zuk", size / 1024);
+	ret = run_bench(name, &b);
+	close_queue(b.mq);
+
+	return ret;
+}
+
+static int run_posix_mqueue(struct smokey_test *t, int argc, char *const argv[])
+{
+	int loops = 10000, ret;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(posix_mqueue, loops))
+		loops = SMOKEY_ARG_INT(posix_mqueue, loops);
+	if (loops <= 0)
+		return -EINVAL;
+
+	ret = check_slots();
+	if (ret)
+		return ret;
+
+	ret = bench_size(loops, 4096);
+	if (ret)
+		return ret;
+
+	return bench_size(loops, 16384);
+}
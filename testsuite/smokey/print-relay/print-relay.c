@@ -0,0 +1,151 @@
+/*
+ * rt_printf() latency benchmark, immediate vs deferred formatting.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <cobalt/tunables.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(print_relay,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(loops),
+		   ),
+		   "Check deferred formatting of rt_printf() output, then\n"
+		   "\tcompare the latency of immediate and deferred formatting.\n"
+		   "\tloops=<N>\tnumber of calls per mode (default 100000)"
+);
+
+/* Flush often enough for the relay buffer never to overflow. */
+#define FLUSH_PERIOD  64
+
+static inline long long diff_ns(const struct timespec *t0,
+				const struct timespec *t1)
+{
+	return (t1->tv_sec - t0->tv_sec) * 1000000000LL +
+		t1->tv_nsec - t0->tv_nsec;
+}
+
+static int check_output(void)
+{
+	char expected[256], buf[256], fmt[16];
+	const char *str = "abcdef";
+	int val = 42, n, m;
+	FILE *fp;
+
+	fp = tmpfile();
+	if (!smokey_assert(fp != NULL))
+		return -errno;
+
+	set_runtime_tunable(print_deferred, 1);
+
+#define TEST_FORMAT "%d|%5.2f|%-8s|%*d|%.*s|%lld|%zu|%%|%c|%p\n"
+#define TEST_ARGS   -1, 3.14159, str, 6, val, 3, str, -1LL << 40,	\
+		    (size_t)val, 'x', &val
+
+	snprintf(expected, sizeof(expected), TEST_FORMAT, TEST_ARGS);
+	n = rt_fprintf(fp, TEST_FORMAT, TEST_ARGS);
+	/* The libc wrappers must not defer, the format may go away. */
+	strcpy(fmt, "wrapped %d\n");
+	m = fprintf(fp, fmt, val);
+	memset(fmt, 0, sizeof(fmt));
+	rt_print_flush_buffers();
+
+	set_runtime_tunable(print_deferred, 0);
+
+	rewind(fp);
+	memset(buf, 0, sizeof(buf));
+	if (fgets(buf, sizeof(buf), fp) == NULL)
+		buf[0] = '\0';
+	if (fgets(fmt, sizeof(fmt), fp) == NULL)
+		fmt[0] = '\0';
+	fclose(fp);
+
+	if (!smokey_assert(n == 0) || !smokey_assert(m == 11))
+		return -EINVAL;
+
+	if (strcmp(buf, expected)) {
+		smokey_warning("expected \"%s\", got \"%s\"", expected, buf);
+		return -EINVAL;
+	}
+
+	if (strcmp(fmt, "wrapped 42\n")) {
+		smokey_warning("expected \"wrapped 42\", got \"%s\"", fmt);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void run_mode(FILE *fp, int deferred, int loops)
+{
+	long long sum = 0, max = 0, min = -1, dt;
+	struct timespec t0, t1;
+	int n;
+
+	set_runtime_tunable(print_deferred, deferred);
+
+	for (n = 0; n < loops; n++) {
+		if (n % FLUSH_PERIOD == 0)
+			rt_print_flush_buffers();
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		rt_fprintf(fp, "loop %d: x=%f, y=%ld, tag=%s\n",
+			   n, n * 0.5, (long)n * 3, "sample");
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		dt = diff_ns(&t0, &t1);
+		if (min < 0 || dt < min)
+			min = dt;
+		if (dt > max)
+			max = dt;
+		sum += dt;
+	}
+
+	rt_print_flush_buffers();
+	set_runtime_tunable(print_deferred, 0);
+
+	smokey_trace("%-10s min %4lld ns, avg %4lld ns, max %6lld ns",
+		     deferred ? "deferred:" : "immediate:",
+		     min, sum / loops, max);
+}
+
+static int run_print_relay(struct smokey_test *t, int argc, char *const argv[])
+{
+	struct sched_param param = { .sched_priority = 50 };
+	int loops = 100000, ret;
+	FILE *fp;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(print_relay, loops))
+		loops = SMOKEY_ARG_INT(print_relay, loops);
+	if (loops <= 0)
+		return -EINVAL;
+
+	ret = check_output();
+	if (ret)
+		return ret;
+
+	fp = fopen("/dev/null", "w");
+	if (!smokey_assert(fp != NULL))
+		return -errno;
+
+	ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (ret) {
+		fclose(fp);
+		return -ret;
+	}
+
+	run_mode(fp, 0, loops);
+	run_mode(fp, 1, loops);
+
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+	fclose(fp);
+
+	return 0;
+}
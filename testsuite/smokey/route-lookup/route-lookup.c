@@ -0,0 +1,63 @@
+/*
+ * RTnet route lookup benchmark, based on the routebench driver.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <rtdm/testing.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(route_lookup,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(max_routes),
+			   SMOKEY_INT(loops),
+		   ),
+		   "Compare the cost of a longest-prefix match lookup in the\n"
+		   "\tRTnet route trie with a linear scan as the table grows.\n"
+		   "\tmax_routes=<N>\tlargest route count (default 4096)\n"
+		   "\tloops=<N>\tlookups per measurement (default 100000)"
+);
+
+static int run_route_lookup(struct smokey_test *t, int argc, char *const argv[])
+{
+	int fd, ret = 0, max_routes = 4096, loops = 100000;
+	struct rttst_route_bench b;
+	unsigned int n;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(route_lookup, max_routes))
+		max_routes = SMOKEY_ARG_INT(route_lookup, max_routes);
+	if (SMOKEY_ARG_ISSET(route_lookup, loops))
+		loops = SMOKEY_ARG_INT(route_lookup, loops);
+
+	fd = __RT(open("/dev/rtdm/routebench", O_RDWR));
+	if (fd < 0) {
+		smokey_note("route_lookup: routebench driver not available, "
+			    "skipping (modprobe xeno_routebench?)");
+		return -ENOSYS;
+	}
+
+	for (n = 1; n <= max_routes; n *= 2) {
+		b.nr_routes = n;
+		b.loops = loops;
+		if (!__Terrno(ret, __RT(ioctl(fd, RTTST_RTIOC_ROUTE_BENCH, &b))))
+			break;
+		if (n == 1)
+			smokey_trace("%8s %8s %10s %10s %10s %10s",
+				     "routes", "nodes", "trie avg", "trie max",
+				     "linear avg", "linear max");
+		smokey_trace("%8u %8u %10lld %10lld %10lld %10lld",
+			     n, b.trie_nodes, (long long)b.trie_avg_ns,
+			     (long long)b.trie_max_ns,
+			     (long long)b.linear_avg_ns,
+			     (long long)b.linear_max_ns);
+	}
+
+	__RT(close(fd));
+
+	return ret;
+}
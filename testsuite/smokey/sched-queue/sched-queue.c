@@ -0,0 +1,76 @@
+/*
+ * Run queue benchmark, based on the schedbench driver.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <rtdm/testing.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(sched_queue,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(max_threads),
+			   SMOKEY_INT(prios),
+			   SMOKEY_INT(loops),
+		   ),
+		   "Measure the cost of picking the next thread from the\n"
+		   "\treal-time run queue as the count of runnable threads grows.\n"
+		   "\tmax_threads=<N>\tlargest thread count (default 1024)\n"
+		   "\tprios=<N>\tpriority levels in use, 1-99 (default 99)\n"
+		   "\tloops=<N>\tpicks per measurement (default 100000)"
+);
+
+static const char *queue_types[] = {
+	[RTTST_SCHEDBENCH_LINEAR] = "linear",
+	[RTTST_SCHEDBENCH_MULTILEVEL] = "multi-level",
+	[RTTST_SCHEDBENCH_BITMAP] = "bitmap-indexed",
+};
+
+static int run_sched_queue(struct smokey_test *t, int argc, char *const argv[])
+{
+	int fd, ret = 0, max_threads = 1024, prios = 99, loops = 100000;
+	struct rttst_sched_bench b;
+	unsigned int n;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(sched_queue, max_threads))
+		max_threads = SMOKEY_ARG_INT(sched_queue, max_threads);
+	if (SMOKEY_ARG_ISSET(sched_queue, prios))
+		prios = SMOKEY_ARG_INT(sched_queue, prios);
+	if (SMOKEY_ARG_ISSET(sched_queue, loops))
+		loops = SMOKEY_ARG_INT(sched_queue, loops);
+
+	fd = __RT(open("/dev/rtdm/schedbench", O_RDWR));
+	if (fd < 0) {
+		smokey_note("sched_queue: schedbench driver not available, "
+			    "skipping (modprobe xeno_schedbench?)");
+		return -ENOSYS;
+	}
+
+	for (n = 1; n <= max_threads; n *= 2) {
+		b.nr_threads = n;
+		b.nr_prios = prios;
+		b.loops = loops;
+		if (!__Terrno(ret, __RT(ioctl(fd, RTTST_RTIOC_SCHED_BENCH, &b))))
+			break;
+		if (n == 1)
+			smokey_trace("%s run queue, %u priority levels\n"
+				     "%8s %10s %10s %10s %10s",
+				     queue_types[b.queue_type], b.nr_prios,
+				     "threads", "pick avg", "pick max",
+				     "requeue avg", "requeue max");
+		smokey_trace("%8u %10lld %10lld %10lld %10lld",
+			     n, (long long)b.pick_avg_ns,
+			     (long long)b.pick_max_ns,
+			     (long long)b.requeue_avg_ns,
+			     (long long)b.requeue_max_ns);
+	}
+
+	__RT(close(fd));
+
+	return ret;
+}
@@ -0,0 +1,172 @@
+/*
+ * Context switch scaling benchmark, based on the switchtest driver.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <boilerplate/ancillaries.h>
+#include <rtdm/testing.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(switch_scaling,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(duration),
+			   SMOKEY_INT(max_cpus),
+		   ),
+		   "Measure how the context switch rate of each CPU scales as\n"
+		   "\tmore CPUs run independent switch loops concurrently.\n"
+		   "\tduration=<ms>\tlength of each run, 1-1000 (default 500)\n"
+		   "\tmax_cpus=<N>\tlargest count of busy CPUs (default all)"
+);
+
+struct scaling_run {
+	int fd;
+	int cpu;
+	int status;
+	pthread_barrier_t *barrier;
+	struct rttst_swtest_bench bench;
+};
+
+static void *run_on_cpu(void *arg)
+{
+	struct scaling_run *r = arg;
+
+	pthread_barrier_wait(r->barrier);
+
+	if (__RT(ioctl(r->fd, RTTST_RTIOC_SWTEST_BENCH, &r->bench)))
+		r->status = -errno;
+
+	return NULL;
+}
+
+static int run_step(struct scaling_run *runs, int nr, int duration,
+		    double *rates)
+{
+	pthread_barrier_t barrier;
+	pthread_t tids[nr];
+	int n, ret = 0;
+
+	pthread_barrier_init(&barrier, NULL, nr);
+
+	for (n = 0; n < nr; n++) {
+		runs[n].status = 0;
+		runs[n].barrier = &barrier;
+		runs[n].bench.duration_ms = duration;
+		runs[n].bench.__pad = 0;
+		/* The barrier could never complete on failure. */
+		if (!__T(ret, __STD(pthread_create(&tids[n], NULL,
+						   run_on_cpu, &runs[n]))))
+			exit(EXIT_FAILURE);
+	}
+
+	for (n = 0; n < nr; n++)
+		pthread_join(tids[n], NULL);
+
+	pthread_barrier_destroy(&barrier);
+
+	for (n = 0; n < nr; n++) {
+		if (runs[n].status) {
+			smokey_warning("CPU%d: %s", runs[n].cpu,
+				       symerror(runs[n].status));
+			return runs[n].status;
+		}
+		rates[n] = runs[n].bench.switches * 1e9 /
+			runs[n].bench.elapsed_ns;
+	}
+
+	return ret;
+}
+
+static int run_switch_scaling(struct smokey_test *t,
+			      int argc, char *const argv[])
+{
+	int duration = 500, max_cpus, nr_cpus = 0, cpu, nr, n, ret = 0;
+	double *rates, sum, min, base = 0;
+	struct scaling_run *runs;
+	cpu_set_t rt_cpus;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(switch_scaling, duration))
+		duration = SMOKEY_ARG_INT(switch_scaling, duration);
+
+	if (get_realtime_cpu_set(&rt_cpus))
+		return -ENOSYS;
+
+	max_cpus = CPU_COUNT(&rt_cpus);
+	if (SMOKEY_ARG_ISSET(switch_scaling, max_cpus) &&
+	    SMOKEY_ARG_INT(switch_scaling, max_cpus) < max_cpus)
+		max_cpus = SMOKEY_ARG_INT(switch_scaling, max_cpus);
+
+	if (max_cpus <= 0)
+		return -EINVAL;
+
+	runs = calloc(max_cpus, sizeof(*runs));
+	rates = calloc(max_cpus, sizeof(*rates));
+	if (runs == NULL || rates == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (cpu = 0; cpu < CPU_SETSIZE && nr_cpus < max_cpus; cpu++) {
+		if (!CPU_ISSET(cpu, &rt_cpus))
+			continue;
+		runs[nr_cpus].fd = __RT(open("/dev/rtdm/switchtest", O_RDWR));
+		if (runs[nr_cpus].fd < 0) {
+			if (nr_cpus == 0) {
+				smokey_note("switch_scaling: switchtest driver "
+					    "not available, skipping "
+					    "(modprobe xeno_switchtest?)");
+				ret = -ENOSYS;
+				goto out;
+			}
+			ret = -errno;
+			goto close;
+		}
+		runs[nr_cpus].cpu = cpu;
+		nr_cpus++;
+		if (!__Terrno(ret, __RT(ioctl(runs[nr_cpus - 1].fd,
+					       RTTST_RTIOC_SWTEST_SET_CPU,
+					       cpu))))
+			goto close;
+	}
+
+	smokey_trace("%6s %14s %14s %14s %8s",
+		     "cpus", "total sw/s", "avg sw/s/cpu", "min sw/s/cpu",
+		     "scaling");
+
+	for (nr = 1; nr <= nr_cpus; nr++) {
+		ret = run_step(runs, nr, duration, rates);
+		if (ret)
+			break;
+		sum = 0;
+		min = rates[0];
+		for (n = 0; n < nr; n++) {
+			sum += rates[n];
+			if (rates[n] < min)
+				min = rates[n];
+		}
+		if (nr == 1)
+			base = rates[0];
+		/*
+		 * Per-CPU rate relative to the single CPU case; 100%
+		 * means independent CPUs do not slow each other down.
+		 */
+		smokey_trace("%6d %14.0f %14.0f %14.0f %7.1f%%",
+			     nr, sum, sum / nr, min,
+			     base > 0 ? sum / nr * 100.0 / base : 0.0);
+	}
+close:
+	for (n = 0; n < nr_cpus; n++)
+		__RT(close(runs[n].fd));
+out:
+	free(rates);
+	free(runs);
+
+	return ret;
+}
@@ -0,0 +1,299 @@
+/*
+ * Count the syscalls issued by event and monitor operations, checking
+ * that uncontended paths complete in userland.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <cobalt/sys/cobalt.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(sync_fastpath,
+		   SMOKEY_NOARGS,
+		   "Check that Cobalt event and monitor operations do not\n"
+		   "\tenter the kernel unless some thread has to be woken up."
+);
+
+#define NR_LOOPS  1000
+
+static cobalt_event_t event;
+
+static cobalt_monitor_t monitor;
+
+static volatile int drain_waiting;
+
+static unsigned long long xsc_overhead;
+
+static void delay(void)
+{
+	struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+}
+
+static unsigned long long read_xsc(void)
+{
+	struct cobalt_threadstat stat;
+
+	if (cobalt_thread_stat(0, &stat))
+		return 0;
+
+	return stat.xsc;
+}
+
+/*
+ * Return the count of syscalls issued since @start was sampled,
+ * discounting the sampling calls.
+ */
+static long syscalls_since(unsigned long long start)
+{
+	return (long)(read_xsc() - start - xsc_overhead);
+}
+
+static int check_syscalls(const char *what, long count, long expected)
+{
+	smokey_trace("%-36s %ld syscall(s)", what, count);
+	if (count != expected) {
+		smokey_warning("%s: %ld syscall(s), expected %ld",
+			       what, count, expected);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int create_thread(pthread_t *tid, int prio,
+			 void *(*thread)(void *), void *arg)
+{
+	struct sched_param param;
+	pthread_attr_t thattr;
+	int ret;
+
+	pthread_attr_init(&thattr);
+	param.sched_priority = prio;
+	pthread_attr_setschedpolicy(&thattr, SCHED_FIFO);
+	pthread_attr_setschedparam(&thattr, &param);
+	pthread_attr_setinheritsched(&thattr, PTHREAD_EXPLICIT_SCHED);
+
+	if (!__T(ret, pthread_create(tid, &thattr, thread, arg)))
+		return ret;
+
+	return 0;
+}
+
+static void *event_waiter(void *arg)
+{
+	unsigned int bits;
+
+	return (void *)(long)cobalt_event_wait(&event, 0x4, &bits,
+					       COBALT_EVENT_ALL, NULL);
+}
+
+static void *drain_waiter(void *arg)
+{
+	long ret;
+
+	ret = cobalt_monitor_enter(&monitor);
+	if (ret)
+		return (void *)ret;
+
+	drain_waiting = 1;
+	ret = cobalt_monitor_wait(&monitor, COBALT_MONITOR_WAITDRAIN, NULL);
+	drain_waiting = 0;
+	cobalt_monitor_exit(&monitor);
+
+	return (void *)ret;
+}
+
+static int check_events(void)
+{
+	struct timespec zero = { .tv_sec = 0, .tv_nsec = 0 };
+	struct cobalt_event_info info;
+	unsigned long long start;
+	unsigned int bits;
+	int ret, n, wret;
+	pthread_t tid;
+	void *status;
+	long count;
+
+	if (!__T(ret, cobalt_event_init(&event, 0, COBALT_EVENT_FIFO)))
+		return ret;
+
+	cobalt_thread_harden();
+	start = read_xsc();
+	for (n = 0; n < NR_LOOPS; n++) {
+		cobalt_event_post(&event, 0x1);
+		cobalt_event_clear(&event, 0x1);
+	}
+	count = syscalls_since(start);
+	ret = check_syscalls("post+clear, no waiter", count, 0);
+	if (ret)
+		goto out;
+
+	cobalt_event_post(&event, 0x1);
+	cobalt_thread_harden();
+	start = read_xsc();
+	for (n = 0; n < NR_LOOPS; n++) {
+		ret = cobalt_event_wait(&event, 0x1, &bits,
+					COBALT_EVENT_ANY, NULL);
+		if (ret)
+			break;
+	}
+	wret = cobalt_event_wait(&event, 0x3, &bits, COBALT_EVENT_ALL, &zero);
+	count = syscalls_since(start);
+	if (!__T(ret, ret))
+		goto out;
+	if (!__Tassert(bits == 0x1) || !__Tassert(wret == -EWOULDBLOCK)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	ret = check_syscalls("wait satisfied, nonblocking poll", count, 0);
+	if (ret)
+		goto out;
+
+	ret = create_thread(&tid, 20, event_waiter, NULL);
+	if (ret)
+		goto out;
+
+	for (;;) {
+		ret = cobalt_event_inquire(&event, &info, NULL, 0);
+		if (ret < 0)
+			goto out;
+		if (ret > 0)
+			break;
+		delay();
+	}
+
+	cobalt_thread_harden();
+	start = read_xsc();
+	for (n = 0; n < NR_LOOPS; n++)
+		cobalt_event_post(&event, 0x2);
+	count = syscalls_since(start);
+	ret = check_syscalls("post, waiter wants other bits", count, 0);
+	if (ret) {
+		cobalt_event_post(&event, 0x4);
+		pthread_join(tid, NULL);
+		goto out;
+	}
+
+	cobalt_thread_harden();
+	start = read_xsc();
+	cobalt_event_post(&event, 0x4);
+	count = syscalls_since(start);
+	pthread_join(tid, &status);
+	ret = check_syscalls("post, waking up waiter", count, 1);
+	if (ret == 0 && !__Tassert(status == NULL))
+		ret = -EINVAL;
+out:
+	cobalt_event_destroy(&event);
+
+	return ret;
+}
+
+static int check_monitor(void)
+{
+	unsigned long long start;
+	pthread_t tid;
+	void *status;
+	int ret, n;
+	long count;
+
+	if (!__T(ret, cobalt_monitor_init(&monitor, CLOCK_MONOTONIC, 0)))
+		return ret;
+
+	cobalt_thread_harden();
+	start = read_xsc();
+	for (n = 0; n < NR_LOOPS; n++) {
+		cobalt_monitor_enter(&monitor);
+		cobalt_monitor_grant_all(&monitor);
+		cobalt_monitor_drain_all(&monitor);
+		cobalt_monitor_exit(&monitor);
+		cobalt_monitor_enter(&monitor);
+		cobalt_monitor_drain_sync(&monitor);
+		cobalt_monitor_exit(&monitor);
+	}
+	count = syscalls_since(start);
+	ret = check_syscalls("enter+grant+drain+exit, no waiter", count, 0);
+	if (ret)
+		goto out;
+
+	ret = create_thread(&tid, 20, drain_waiter, NULL);
+	if (ret)
+		goto out;
+
+	/*
+	 * The waiter only releases the gate once asleep, so seeing
+	 * the flag raised while holding the gate means it waits.
+	 */
+	for (;;) {
+		cobalt_monitor_enter(&monitor);
+		if (drain_waiting)
+			break;
+		cobalt_monitor_exit(&monitor);
+		delay();
+	}
+
+	cobalt_thread_harden();
+	start = read_xsc();
+	cobalt_monitor_grant_all(&monitor);
+	cobalt_monitor_exit(&monitor);
+	for (n = 0; n < NR_LOOPS; n++) {
+		cobalt_monitor_enter(&monitor);
+		cobalt_monitor_grant_all(&monitor);
+		cobalt_monitor_exit(&monitor);
+	}
+	count = syscalls_since(start);
+	ret = check_syscalls("grant+exit, drain waiter only", count, 0);
+
+	cobalt_thread_harden();
+	start = read_xsc();
+	cobalt_monitor_enter(&monitor);
+	cobalt_monitor_drain_all(&monitor);
+	cobalt_monitor_exit(&monitor);
+	count = syscalls_since(start);
+	pthread_join(tid, &status);
+	if (ret == 0)
+		ret = check_syscalls("drain+exit, waking up waiter", count, 1);
+	if (ret == 0 && !__Tassert(status == NULL))
+		ret = -EINVAL;
+out:
+	cobalt_monitor_destroy(&monitor);
+
+	return ret;
+}
+
+static void *run_checks(void *arg)
+{
+	unsigned long long start;
+	long ret;
+
+	/* Sampling the counter costs one syscall. */
+	cobalt_thread_harden();
+	start = read_xsc();
+	xsc_overhead = read_xsc() - start;
+
+	ret = check_events();
+	if (ret == 0)
+		ret = check_monitor();
+
+	return (void *)ret;
+}
+
+static int run_sync_fastpath(struct smokey_test *t,
+			     int argc, char *const argv[])
+{
+	pthread_t tid;
+	void *status;
+	int ret;
+
+	ret = create_thread(&tid, 10, run_checks, NULL);
+	if (ret)
+		return ret;
+
+	if (!__T(ret, pthread_join(tid, &status)))
+		return ret;
+
+	return (int)(long)status;
+}
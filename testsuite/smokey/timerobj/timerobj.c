@@ -0,0 +1,221 @@
+/*
+ * Copperplate timer server benchmark.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <boilerplate/time.h>
+#include <boilerplate/ancillaries.h>
+#include <copperplate/clockobj.h>
+#include <copperplate/timerobj.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(timerobj,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(timers),
+			   SMOKEY_INT(spread_ms),
+		   ),
+		   "Arm, cancel then fire a large number of copperplate timers,\n"
+		   "\treporting the insertion/removal cost and the expiry jitter.\n"
+		   "\ttimers=<N>\tnumber of timers (default 10000)\n"
+		   "\tspread_ms=<ms>\ttime span of the expiry dates (default 1000)"
+);
+
+struct bench_timer {
+	struct timerobj tmobj;
+	struct timespec fired;
+};
+
+struct bench_stat {
+	long long min_ns;
+	long long max_ns;
+	long long sum_ns;
+	int count;
+};
+
+static int fire_count;
+
+static inline long long diff_ts(const struct timespec *left,
+				const struct timespec *right)
+{
+	return (long long)(left->tv_sec - right->tv_sec) * 1000000000LL
+		+ left->tv_nsec - right->tv_nsec;
+}
+
+static void stat_init(struct bench_stat *st)
+{
+	st->min_ns = 1LL << 62;
+	st->max_ns = -st->min_ns;
+	st->sum_ns = 0;
+	st->count = 0;
+}
+
+static void stat_add(struct bench_stat *st, long long ns)
+{
+	if (ns < st->min_ns)
+		st->min_ns = ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
+	st->sum_ns += ns;
+	st->count++;
+}
+
+static void stat_print(const char *what, const struct bench_stat *st)
+{
+	smokey_trace("%-12s %8d %10.3f %10.3f %10.3f", what, st->count,
+		     st->min_ns / 1000.0, st->sum_ns / (st->count * 1000.0),
+		     st->max_ns / 1000.0);
+}
+
+static void fire_handler(struct timerobj *tmobj)
+{
+	struct bench_timer *bt = container_of(tmobj, struct bench_timer, tmobj);
+
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &bt->fired));
+	__sync_fetch_and_add(&fire_count, 1);
+}
+
+static void set_date(struct itimerspec *its, const struct timespec *origin,
+		     long long offset_ns)
+{
+	timespec_adds(&its->it_value, origin, offset_ns);
+	its->it_interval.tv_sec = 0;
+	its->it_interval.tv_nsec = 0;
+}
+
+static int arm_timer(struct bench_timer *bt, struct itimerspec *its,
+		     struct bench_stat *st)
+{
+	struct timespec t0, t1;
+	int ret;
+
+	timerobj_lock(&bt->tmobj);
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &t0));
+	ret = timerobj_start(&bt->tmobj, fire_handler, its);
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &t1));
+	if (ret == 0)
+		stat_add(st, diff_ts(&t1, &t0));
+
+	return ret;
+}
+
+static int run_timerobj(struct smokey_test *t, int argc, char *const argv[])
+{
+	int nrtimers = 10000, spread_ms = 1000, n, ret = 0, early = 0;
+	struct bench_stat insert, cancel, jitter;
+	struct timespec now, origin, t0, t1, nap;
+	struct bench_timer *timers;
+	struct itimerspec its;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(timerobj, timers) &&
+	    SMOKEY_ARG_INT(timerobj, timers) > 0)
+		nrtimers = SMOKEY_ARG_INT(timerobj, timers);
+
+	if (SMOKEY_ARG_ISSET(timerobj, spread_ms) &&
+	    SMOKEY_ARG_INT(timerobj, spread_ms) > 0)
+		spread_ms = SMOKEY_ARG_INT(timerobj, spread_ms);
+
+	timers = calloc(nrtimers, sizeof(*timers));
+	if (timers == NULL)
+		return -ENOMEM;
+
+	for (n = 0; n < nrtimers; n++) {
+		ret = timerobj_init(&timers[n].tmobj);
+		if (ret) {
+			/* e.g. Cobalt may not have that many timers. */
+			if (n == 0)
+				goto out;
+			smokey_note("timerobj: only %d timers available (%s)",
+				    n, symerror(ret));
+			nrtimers = n;
+			ret = 0;
+			break;
+		}
+	}
+
+	/*
+	 * Insertion/removal cost, with dates far enough in the future
+	 * for the timers not to fire while we are at it. Dates are
+	 * scattered so that they span all wheel levels.
+	 */
+	stat_init(&insert);
+	stat_init(&cancel);
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
+
+	for (n = 0; n < nrtimers; n++) {
+		set_date(&its, &now, 3600000000000LL +
+			 (long long)(random() % 1000000) * 1000000LL);
+		ret = arm_timer(&timers[n], &its, &insert);
+		if (!smokey_assert(ret == 0))
+			goto out_destroy;
+	}
+
+	for (n = nrtimers - 1; n >= 0; n--) {
+		timerobj_lock(&timers[n].tmobj);
+		__RT(clock_gettime(CLOCK_COPPERPLATE, &t0));
+		timerobj_stop(&timers[n].tmobj);
+		__RT(clock_gettime(CLOCK_COPPERPLATE, &t1));
+		stat_add(&cancel, diff_ts(&t1, &t0));
+	}
+
+	/*
+	 * Expiry jitter, with random dates over the test window,
+	 * armed in random order.
+	 */
+	stat_init(&jitter);
+	fire_count = 0;
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
+	timespec_adds(&origin, &now, 100000000LL);
+
+	for (n = 0; n < nrtimers; n++) {
+		set_date(&its, &origin,
+			 (long long)(random() % (spread_ms * 1000LL)) * 1000LL);
+		timers[n].fired.tv_sec = 0;
+		ret = arm_timer(&timers[n], &its, &insert);
+		if (!smokey_assert(ret == 0))
+			goto out_destroy;
+	}
+
+	nap.tv_sec = 0;
+	nap.tv_nsec = 10000000;
+	for (n = 0; n < spread_ms / 10 + 500; n++) {
+		if (__sync_fetch_and_add(&fire_count, 0) >= nrtimers)
+			break;
+		__RT(clock_nanosleep(CLOCK_MONOTONIC, 0, &nap, NULL));
+	}
+
+	for (n = 0; n < nrtimers; n++) {
+		if (!smokey_assert(timers[n].fired.tv_sec != 0)) {
+			ret = -ETIMEDOUT;
+			goto out_destroy;
+		}
+		if (timespec_before(&timers[n].fired,
+				    &timers[n].tmobj.itspec.it_value))
+			early++;
+		stat_add(&jitter, diff_ts(&timers[n].fired,
+					  &timers[n].tmobj.itspec.it_value));
+	}
+
+	smokey_trace("%-12s %8s %10s %10s %10s",
+		     "(usecs)", "count", "min", "avg", "max");
+	stat_print("arm", &insert);
+	stat_print("cancel", &cancel);
+	stat_print("expiry", &jitter);
+
+	if (!smokey_assert(early == 0))
+		ret = -EINVAL;
+
+out_destroy:
+	for (n = 0; n < nrtimers; n++) {
+		timerobj_lock(&timers[n].tmobj);
+		timerobj_destroy(&timers[n].tmobj);
+	}
+out:
+	free(timers);
+
+	return ret;
+}
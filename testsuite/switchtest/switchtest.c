@@ -37,6 +37,7 @@
 #include <asm/xenomai/features.h>
 #include <asm/xenomai/uapi/fptest.h>
 #include <cobalt/trace.h>
+#include <boilerplate/histogram.h>
 #include <rtdm/testing.h>
 #include <sys/cobalt.h>
 #include <xenomai/init.h>
@@ -92,6 +93,8 @@ struct cpu_tasks {
 	unsigned capacity;
 	unsigned fd;
 	unsigned long last_switches_count;
+	/* Round-trip time of the sleeper's switch requests, in ns. */
+	struct histogram rtt;
 };
 
 static sem_t sleeper_start;
@@ -102,6 +105,7 @@ static unsigned long data_lines = 21;
 static unsigned freeze_on_error;
 static int fp_features;
 static pthread_t main_tid;
+static const char *json_file;
 
 static inline unsigned stack_size(unsigned size)
 {
@@ -336,7 +340,7 @@ static void *sleeper_switcher(void *cookie)
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 
 	for (;;) {
-		struct timespec now, diff;
+		struct timespec now, diff, t0, t1;
 		unsigned expected, fp_val;
 		int err;
 		if (param->type == SLEEPER)
@@ -375,9 +379,14 @@ static void *sleeper_switcher(void *cookie)
 		expected = rtsw.from + i * 1000;
 		if (param->fp & UFPS)
 			fp_regs_set(fp_features, expected);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
 		err = ioctl(fd, RTTST_RTIOC_SWTEST_SWITCH_TO, &rtsw);
 		while (err == -1 && errno == EINTR)
 			err = ioctl(fd, RTTST_RTIOC_SWTEST_PEND, &param->swt);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		timespec_substract(&diff, &t1, &t0);
+		histogram_add(&param->cpu->rtt,
+			      diff.tv_sec * 1000000000LL + diff.tv_nsec);
 
 		switch (err) {
 		case 0:
@@ -1000,6 +1009,63 @@ static unsigned long xatoul(const char *str)
 	return result;
 }
 
+static void dump_rtt(struct cpu_tasks *cpus)
+{
+	struct histogram all, *h;
+	const char *sep = "";
+	FILE *fp = NULL;
+	char name[16];
+	unsigned i, n;
+
+	if (histogram_init(&all, 1000000000, HISTOGRAM_DEFAULT_SIGBITS)) {
+		perror("histogram_init");
+		return;
+	}
+
+	if (json_file) {
+		fp = strcmp(json_file, "-") ? fopen(json_file, "w") : stdout;
+		if (fp == NULL)
+			perror(json_file);
+		else
+			fprintf(fp, "{\"tool\":\"switchtest\",\"unit\":\"ns\","
+				"\"histograms\":[");
+	}
+
+	if (quiet < 2)
+		printf("RTP|%4s|%12s|%10s|%10s|%10s|%10s|%10s\n",
+		       "-cpu", "------rounds", "-p50 [us]", "-p99 [us]",
+		       "p99.9 [us]", "p99.999 us", "-max [us]");
+
+	for_each_cpu_index(i, n) {
+		h = &cpus[n].rtt;
+		histogram_merge(&all, h);
+		if (quiet < 2 && h->total)
+			printf("RTP|%4u|%12llu|%10.3f|%10.3f|%10.3f|%10.3f|%10.3f\n",
+			       i, (unsigned long long)h->total,
+			       histogram_percentile(h, 50) / 1000.0,
+			       histogram_percentile(h, 99) / 1000.0,
+			       histogram_percentile(h, 99.9) / 1000.0,
+			       histogram_percentile(h, 99.999) / 1000.0,
+			       h->max / 1000.0);
+		if (fp) {
+			snprintf(name, sizeof(name), "cpu%u", i);
+			fputs(sep, fp);
+			histogram_dump_json(h, fp, name);
+			sep = ",";
+		}
+	}
+
+	if (fp) {
+		fputs(sep, fp);
+		histogram_dump_json(&all, fp, "all");
+		fprintf(fp, "]}\n");
+		if (fp != stdout)
+			fclose(fp);
+	}
+
+	histogram_destroy(&all);
+}
+
 static void usage(FILE *fd, const char *progname)
 {
 	unsigned i, j;
@@ -1024,7 +1090,9 @@ static void usage(FILE *fd, const char *progname)
 		"--stress <period> or -s <period> enable a stress mode where:\n"
 		"  context switches occur every <period> us;\n"
 		"  a background task uses fpu (and check) fpu all the time.\n"
-		"--freeze trace upon error.\n\n"
+		"--freeze trace upon error.\n"
+		"--json <file> or -j <file>, dump the histograms of switch "
+		"round-trip times\nto <file> in JSON format.\n\n"
 		"Each 'threadspec' specifies the characteristics of a "
 		"thread to be created:\n"
 		"threadspec = (rtk|rtup|rtus|rtuo)(_fp|_ufpp|_ufps)*[0-9]*\n"
@@ -1180,6 +1248,7 @@ int main(int argc, const char *argv[])
 		static struct option long_options[] = {
 			{ "freeze",  0, NULL, 'f' },
 			{ "help",    0, NULL, 'h' },
+			{ "json",    1, NULL, 'j' },
 			{ "lines",   1, NULL, 'l' },
 			{ "nofpu",   0, NULL, 'n' },
 			{ "quiet",   0, NULL, 'q' },
@@ -1189,7 +1258,7 @@ int main(int argc, const char *argv[])
 			{ NULL,      0, NULL, 0   }
 		};
 		int i = 0;
-		int c = getopt_long(argc, (char *const *) argv, "fhl:nqQs:T:",
+		int c = getopt_long(argc, (char *const *) argv, "fhj:l:nqQs:T:",
 				    long_options, &i);
 
 		if (c == -1)
@@ -1204,6 +1273,10 @@ int main(int argc, const char *argv[])
 			usage(stdout, progname);
 			exit(EXIT_SUCCESS);
 
+		case 'j':
+			json_file = optarg;
+			break;
+
 		case 'l':
 			data_lines = xatoul(optarg);
 			break;
@@ -1303,6 +1376,12 @@ int main(int argc, const char *argv[])
 			exit(EXIT_FAILURE);
 		}
 
+		if (histogram_init(&cpus[n].rtt, 1000000000,
+				   HISTOGRAM_DEFAULT_SIGBITS)) {
+			perror("histogram_init");
+			exit(EXIT_FAILURE);
+		}
+
 		cpus[n].tasks[0].type = stress ? SWITCHER : SLEEPER;
 		cpus[n].tasks[0].fp = use_fp ? UFPS : 0;
 		cpus[n].tasks[0].cpu = &cpus[n];
@@ -1489,6 +1568,9 @@ int main(int argc, const char *argv[])
 		}
 		free(cpu->tasks);
 	}
+	dump_rtt(cpus);
+	for_each_cpu_index(i, n)
+		histogram_destroy(&cpus[n].rtt);
 	free(cpus);
 	__STD(sem_destroy(&sleeper_start));
 	__STD(pthread_mutex_destroy(&headers_lock));
@@ -29,6 +29,7 @@
 #include <string.h>
 #include <signal.h>
 #include <pthread.h>
+#include <time.h>
 #include <rtdm/analogy.h>
 
 typedef int (*dump_function_t) (a4l_desc_t *, a4l_cmd_t*, unsigned char *, int);
@@ -51,6 +52,7 @@ static char *str_chans = "0,1,2,3";
 static char *filename = FILENAME;
 
 static unsigned long wake_count = 0;
+static unsigned long seg_size = 0;
 static int real_time = 0;
 static int use_mmap = 0;
 static int verbose = 0;
@@ -87,6 +89,7 @@ struct option cmd_read_opts[] = {
 	{"mmap", no_argument, NULL, 'm'},
 	{"raw", no_argument, NULL, 'w'},
 	{"wake-count", required_argument, NULL, 'k'},
+	{"throughput", required_argument, NULL, 't'},
 	{"help", no_argument, NULL, 'h'},
 	{0},
 };
@@ -103,6 +106,8 @@ static void do_print_usage(void)
 	output("\t\t -m, --mmap: mmap the buffer");
 	output("\t\t -w, --raw: dump data in raw format");
 	output("\t\t -k, --wake-count: space available before waking up the process");
+	output("\t\t -t, --throughput: consume segments of the given size in place");
+	output("\t\t                   and report the throughput (implies -m)");
 	output("\t\t -h, --help: output this help");
 }
 
@@ -237,6 +242,47 @@ static int fetch_data_mmap(a4l_desc_t *dsc, unsigned int *cnt, dump_function_t d
 	return 0;
 }
 
+static int fetch_segments(a4l_desc_t *dsc, unsigned int *cnt)
+{
+	unsigned long offset, count, release = 0, nb_segs = 0;
+	struct timespec start, end;
+	double elapsed;
+	int ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (;;) {
+		/* Hand the segments consumed at the previous round back
+		   to the driver, then wait for the next ready ones */
+		ret = a4l_wait_segments(dsc, cmd.idx_subd, release,
+					A4L_INFINITE, &offset, &count);
+		if (ret < 0)
+			exit_err("a4l_wait_segments() failed (ret=%d)", ret);
+
+		if (count == 0) {
+			debug("no more data in the buffer ");
+			break;
+		}
+
+		/* The data is available in place at map + offset, there
+		   is nothing to copy */
+		release = (count + seg_size - 1) / seg_size;
+		nb_segs += release;
+		*cnt += count;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9;
+
+	output("%u bytes in %lu segments of %lu bytes, %.3f s",
+	       *cnt, nb_segs, seg_size, elapsed);
+	if (elapsed > 0)
+		output("throughput: %.3f MB/s", *cnt / elapsed / 1e6);
+
+	return 0;
+}
+
 static int map_subdevice_buffer(a4l_desc_t *dsc, unsigned long *buf_size, void **map)
 {
 	void *buf;
@@ -270,7 +316,7 @@ static int cmd_read(struct arguments *arg)
 	void *map = NULL;
 
 	for (;;) {
-		ret = getopt_long(argc, argv, "vrd:s:S:c:mwk:h",
+		ret = getopt_long(argc, argv, "vrd:s:S:c:mwk:t:h",
 				  cmd_read_opts, NULL);
 
 		if (ret == -1)
@@ -304,6 +350,10 @@ static int cmd_read(struct arguments *arg)
 		case 'k':
 			wake_count = strtoul(optarg, NULL, 0);
 			break;
+		case 't':
+			seg_size = strtoul(optarg, NULL, 0);
+			use_mmap = 1;
+			break;
 		case 'h':
 		default:
 			do_print_usage();
@@ -378,6 +428,13 @@ static int cmd_read(struct arguments *arg)
 			goto out;
 	}
 
+	if (seg_size) {
+		ret = a4l_set_segsize(&dsc, seg_size);
+		if (ret < 0)
+			exit_err("a4l_set_segsize failed (ret=%d)", ret);
+		debug("segment size successfully set (%lu)", seg_size);
+	}
+
 	ret = a4l_set_wakesize(&dsc, wake_count);
 	if (ret < 0)
 		exit_err("a4l_set_wakesize failed (ret=%d)", ret);
@@ -389,7 +446,12 @@ static int cmd_read(struct arguments *arg)
 		exit_err("a4l_snd_command failed (ret=%d)", ret);
 	debug("command sent");
 
-	if (use_mmap) {
+	if (seg_size) {
+		ret = fetch_segments(&dsc, &cnt);
+		if (ret)
+			exit_err("failed to fetch_segments (ret=%d)", ret);
+	}
+	else if (use_mmap) {
 		ret = fetch_data_mmap(&dsc, &cnt, dump_function, map, buf_size);
 		if (ret)
 			exit_err("failed to fetch_data_mmap (ret=%d)", ret);
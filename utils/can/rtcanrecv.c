@@ -23,6 +23,8 @@ static void print_usage(char *prg)
 	    " -R, --timestamp-rel   with relative timestamp\n"
 	    " -v, --verbose         be verbose\n"
 	    " -p, --print=MODULO    print every MODULO message\n"
+	    " -b, --burst=COUNT     receive up to COUNT messages per call\n"
+	    "                       (recvmmsg), report the call count on exit\n"
 	    " -h, --help            this help\n",
 	    prg);
 }
@@ -30,7 +32,8 @@ static void print_usage(char *prg)
 
 extern int optind, opterr, optopt;
 
-static int s = -1, verbose = 0, print = 1;
+static int s = -1, verbose = 0, print = 1, burst = 0;
+static long long burst_calls, burst_frames;
 static nanosecs_rel_t timeout = 0, with_timestamp = 0, timestamp_rel = 0;
 
 RT_TASK rt_task_desc;
@@ -60,6 +63,11 @@ static void cleanup(void)
     if (verbose)
 	printf("Cleaning up...\n");
 
+    if (burst > 0 && burst_calls > 0)
+	printf("%lld messages received in %lld calls (%lld.%02lld per call)\n",
+	       burst_frames, burst_calls, burst_frames / burst_calls,
+	       (burst_frames * 100 / burst_calls) % 100);
+
     if (s >= 0) {
 	ret = close(s);
 	s = -1;
@@ -78,15 +86,127 @@ static void cleanup_and_exit(int sig)
     exit(0);
 }
 
-static void rt_task(void)
+static void print_frame(int count, struct can_frame *frame,
+			struct sockaddr_can *addr, nanosecs_abs_t *timestamp)
+{
+    static nanosecs_abs_t timestamp_prev;
+    int i;
+
+    printf("#%d: (%d) ", count, addr->can_ifindex);
+    if (timestamp) {
+	if (timestamp_rel) {
+	    printf("%lldns ", (long long)(*timestamp - timestamp_prev));
+	    timestamp_prev = *timestamp;
+	} else
+	    printf("%lldns ", (long long)*timestamp);
+    }
+    if (frame->can_id & CAN_ERR_FLAG)
+	printf("!0x%08x!", frame->can_id & CAN_ERR_MASK);
+    else if (frame->can_id & CAN_EFF_FLAG)
+	printf("<0x%08x>", frame->can_id & CAN_EFF_MASK);
+    else
+	printf("<0x%03x>", frame->can_id & CAN_SFF_MASK);
+
+    printf(" [%d]", frame->can_dlc);
+    if (!(frame->can_id & CAN_RTR_FLAG))
+	for (i = 0; i < frame->can_dlc; i++) {
+	    printf(" %02x", frame->data[i]);
+	}
+    if (frame->can_id & CAN_ERR_FLAG) {
+	printf(" ERROR ");
+	if (frame->can_id & CAN_ERR_BUSOFF)
+	    printf("bus-off");
+	if (frame->can_id & CAN_ERR_CRTL)
+	    printf("controller problem");
+    } else if (frame->can_id & CAN_RTR_FLAG)
+	printf(" remote request");
+    printf("\n");
+}
+
+static int report_recv_error(void)
+{
+    switch (errno) {
+    case ETIMEDOUT:
+	if (verbose)
+	    printf("recv: timed out\n");
+	return 0;
+    case EBADF:
+	if (verbose)
+	    printf("recv: aborted because socket was closed\n");
+	break;
+    default:
+	fprintf(stderr, "recv: %s\n", strerror(errno));
+    }
+
+    return -1;
+}
+
+static void rt_task_burst(void)
 {
+    struct sockaddr_can *addrs;
+    nanosecs_abs_t *timestamps;
+    struct can_frame *frames;
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
     int i, ret, count = 0;
+
+    frames = calloc(burst, sizeof(*frames));
+    addrs = calloc(burst, sizeof(*addrs));
+    timestamps = calloc(burst, sizeof(*timestamps));
+    msgs = calloc(burst, sizeof(*msgs));
+    iovs = calloc(burst, sizeof(*iovs));
+    if (frames == NULL || addrs == NULL || timestamps == NULL ||
+	msgs == NULL || iovs == NULL) {
+	fprintf(stderr, "burst: %s\n", strerror(ENOMEM));
+	return;
+    }
+
+    for (i = 0; i < burst; i++) {
+	msgs[i].msg_hdr.msg_iov = &iovs[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+	msgs[i].msg_hdr.msg_name = &addrs[i];
+    }
+
+    while (1) {
+	/* The iovecs and lengths are updated by each call */
+	for (i = 0; i < burst; i++) {
+	    iovs[i].iov_base = &frames[i];
+	    iovs[i].iov_len = sizeof(can_frame_t);
+	    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_can);
+	    if (with_timestamp) {
+		msgs[i].msg_hdr.msg_control = &timestamps[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(nanosecs_abs_t);
+	    }
+	}
+
+	ret = recvmmsg(s, msgs, burst, MSG_WAITFORONE, NULL);
+	if (ret < 0) {
+	    if (report_recv_error())
+		break;
+	    continue;
+	}
+
+	burst_calls++;
+	burst_frames += ret;
+
+	for (i = 0; i < ret; i++, count++) {
+	    if (print && (count % print) == 0)
+		print_frame(count, &frames[i], &addrs[i],
+			    msgs[i].msg_hdr.msg_controllen ?
+			    &timestamps[i] : NULL);
+	}
+    }
+}
+
+static void rt_task(void)
+{
+    int ret, count = 0;
     struct can_frame frame;
     struct sockaddr_can addr;
     socklen_t addrlen = sizeof(addr);
     struct msghdr msg;
     struct iovec iov;
-    nanosecs_abs_t timestamp, timestamp_prev = 0;
+    nanosecs_abs_t timestamp;
 
     if (with_timestamp) {
 	msg.msg_iov = &iov;
@@ -106,52 +226,15 @@ static void rt_task(void)
 	    ret = recvfrom(s, (void *)&frame, sizeof(can_frame_t), 0,
 				  (struct sockaddr *)&addr, &addrlen);
 	if (ret < 0) {
-	    switch (errno) {
-	    case ETIMEDOUT:
-		if (verbose)
-		    printf("recv: timed out\n");
-		continue;
-	    case EBADF:
-		if (verbose)
-		    printf("recv: aborted because socket was closed\n");
+	    if (report_recv_error())
 		break;
-	    default:
-		fprintf(stderr, "recv: %s\n", strerror(errno));
-	    }
-	    break;
+	    continue;
 	}
 
-	if (print && (count % print) == 0) {
-	    printf("#%d: (%d) ", count, addr.can_ifindex);
-	    if (with_timestamp && msg.msg_controllen) {
-		if (timestamp_rel) {
-		printf("%lldns ", (long long)(timestamp - timestamp_prev));
-		    timestamp_prev = timestamp;
-		} else
-		    printf("%lldns ", (long long)timestamp);
-	    }
-	    if (frame.can_id & CAN_ERR_FLAG)
-		printf("!0x%08x!", frame.can_id & CAN_ERR_MASK);
-	    else if (frame.can_id & CAN_EFF_FLAG)
-		printf("<0x%08x>", frame.can_id & CAN_EFF_MASK);
-	    else
-		printf("<0x%03x>", frame.can_id & CAN_SFF_MASK);
-
-	    printf(" [%d]", frame.can_dlc);
-	    if (!(frame.can_id & CAN_RTR_FLAG))
-		for (i = 0; i < frame.can_dlc; i++) {
-		    printf(" %02x", frame.data[i]);
-		}
-	    if (frame.can_id & CAN_ERR_FLAG) {
-		printf(" ERROR ");
-		if (frame.can_id & CAN_ERR_BUSOFF)
-		    printf("bus-off");
-		if (frame.can_id & CAN_ERR_CRTL)
-		    printf("controller problem");
-	    } else if (frame.can_id & CAN_RTR_FLAG)
-		printf(" remote request");
-	    printf("\n");
-	}
+	if (print && (count % print) == 0)
+	    print_frame(count, &frame, &addr,
+			with_timestamp && msg.msg_controllen ?
+			&timestamp : NULL);
 	count++;
     }
 }
@@ -173,13 +256,14 @@ int main(int argc, char **argv)
 	{ "timeout", required_argument, 0, 't'},
 	{ "timestamp", no_argument, 0, 'T'},
 	{ "timestamp-rel", no_argument, 0, 'R'},
+	{ "burst", required_argument, 0, 'b'},
 	{ 0, 0, 0, 0},
     };
 
     signal(SIGTERM, cleanup_and_exit);
     signal(SIGINT, cleanup_and_exit);
 
-    while ((opt = getopt_long(argc, argv, "hve:f:t:p:RT",
+    while ((opt = getopt_long(argc, argv, "hve:f:t:p:RTb:",
 			      long_options, NULL)) != -1) {
 	switch (opt) {
 	case 'h':
@@ -221,6 +305,10 @@ int main(int argc, char **argv)
 	    timeout = (nanosecs_rel_t)strtoul(optarg, NULL, 0) * 1000000;
 	    break;
 
+	case 'b':
+	    burst = strtoul(optarg, NULL, 0);
+	    break;
+
 	case 'R':
 	    timestamp_rel = 1;
 	case 'T':
@@ -315,7 +403,10 @@ int main(int argc, char **argv)
 	goto failure;
     }
 
-    rt_task();
+    if (burst > 0)
+	rt_task_burst();
+    else
+	rt_task();
     /* never returns */
 
  failure:
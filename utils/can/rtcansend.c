@@ -31,6 +31,8 @@ static void print_usage(char *prg)
 	    " -L, --loopback=0|1    switch local loopback off or on\n"
 	    " -v, --verbose         be verbose\n"
 	    " -p, --print=MODULO    print every MODULO message\n"
+	    " -b, --burst=COUNT     send COUNT messages per call (sendmmsg)\n"
+	    "                       and report the transmit rate\n"
 	    " -h, --help            this help\n",
 	    prg);
 }
@@ -40,7 +42,7 @@ RT_TASK rt_task_desc;
 
 static int s=-1, dlc=0, rtr=0, extended=0, verbose=0, loops=1;
 static SRTIME delay=1000000;
-static int count=0, print=1, use_send=0, loopback=-1;
+static int count=0, print=1, use_send=0, loopback=-1, burst=0;
 static nanosecs_rel_t timeout = 0;
 static struct can_frame frame;
 static struct sockaddr_can to_addr;
@@ -73,6 +75,85 @@ static void cleanup_and_exit(int sig)
     exit(0);
 }
 
+static void report_send_error(void)
+{
+    switch (errno) {
+    case ETIMEDOUT:
+	if (verbose)
+	    printf("send(to): timed out\n");
+	break;
+    case EBADF:
+	if (verbose)
+	    printf("send(to): aborted because socket was closed\n");
+	break;
+    default:
+	fprintf(stderr, "send: %s\n", strerror(errno));
+	break;
+    }
+}
+
+static void rt_task_burst(void)
+{
+    struct can_frame *frames;
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+    RTIME start, ns;
+    long long sent = 0;
+    int i, j, n, ret;
+
+    frames = calloc(burst, sizeof(*frames));
+    msgs = calloc(burst, sizeof(*msgs));
+    iovs = calloc(burst, sizeof(*iovs));
+    if (frames == NULL || msgs == NULL || iovs == NULL) {
+	fprintf(stderr, "burst: %s\n", strerror(ENOMEM));
+	goto out;
+    }
+
+    for (j = 0; j < burst; j++) {
+	frames[j] = frame;
+	msgs[j].msg_hdr.msg_iov = &iovs[j];
+	msgs[j].msg_hdr.msg_iovlen = 1;
+	if (!use_send) {
+	    msgs[j].msg_hdr.msg_name = &to_addr;
+	    msgs[j].msg_hdr.msg_namelen = sizeof(to_addr);
+	}
+    }
+
+    start = rt_timer_read();
+
+    for (i = 0; i < loops; i++) {
+	if (delay)
+	    rt_task_sleep(rt_timer_ns2ticks(delay));
+	for (j = 0; j < burst; j++) {
+	    if (count) {
+		n = i * burst + j;
+		memcpy(&frames[j].data[0], &n, sizeof(n));
+	    }
+	    /* The iovecs are consumed by each call */
+	    iovs[j].iov_base = &frames[j];
+	    iovs[j].iov_len = sizeof(can_frame_t);
+	}
+	ret = sendmmsg(s, msgs, burst, 0);
+	if (ret < 0) {
+	    report_send_error();
+	    break;
+	}
+	sent += ret;
+	if (verbose && (i % print) == 0)
+	    printf("burst #%d: %d of %d messages sent\n", i, ret, burst);
+    }
+
+    ns = rt_timer_ticks2ns(rt_timer_read() - start);
+    printf("%lld messages sent in %lld us", sent, (long long)ns / 1000);
+    if (ns)
+	printf(" (%lld messages/s)", sent * 1000000000LL / (long long)ns);
+    printf("\n");
+ out:
+    free(iovs);
+    free(msgs);
+    free(frames);
+}
+
 static void rt_task(void)
 {
     int i, j, ret;
@@ -88,19 +169,7 @@ static void rt_task(void)
 	    ret = sendto(s, (void *)&frame, sizeof(can_frame_t), 0,
 				(struct sockaddr *)&to_addr, sizeof(to_addr));
 	if (ret < 0) {
-	    switch (errno) {
-	    case ETIMEDOUT:
-		if (verbose)
-		    printf("send(to): timed out\n");
-		break;
-	    case EBADF:
-		if (verbose)
-		    printf("send(to): aborted because socket was closed\n");
-		break;
-	    default:
-		fprintf(stderr, "send: %s\n", strerror(errno));
-		break;
-	    }
+	    report_send_error();
 	    i = loops;		/* abort */
 	    break;
 	}
@@ -137,6 +206,7 @@ int main(int argc, char **argv)
 	{ "send", no_argument, 0, 's'},
 	{ "timeout", required_argument, 0, 't'},
 	{ "loopback", required_argument, 0, 'L'},
+	{ "burst", required_argument, 0, 'b'},
 	{ 0, 0, 0, 0},
     };
 
@@ -145,7 +215,7 @@ int main(int argc, char **argv)
 
     frame.can_id = 1;
 
-    while ((opt = getopt_long(argc, argv, "hvi:l:red:t:cp:sL:",
+    while ((opt = getopt_long(argc, argv, "hvi:l:red:t:cp:sL:b:",
 			      long_options, NULL)) != -1) {
 	switch (opt) {
 	case 'h':
@@ -195,6 +265,10 @@ int main(int argc, char **argv)
 	    loopback = strtoul(optarg, NULL, 0);
 	    break;
 
+	case 'b':
+	    burst = strtoul(optarg, NULL, 0);
+	    break;
+
 	default:
 	    fprintf(stderr, "Unknown option %c\n", opt);
 	    break;
@@ -295,7 +369,10 @@ int main(int argc, char **argv)
 	goto failure;
     }
 
-    rt_task();
+    if (burst > 0)
+	rt_task_burst();
+    else
+	rt_task();
 
     cleanup();
     return 0;
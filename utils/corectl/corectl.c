@@ -21,6 +21,8 @@
 #include <getopt.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <error.h>
 #include <sys/cobalt.h>
 #include <xenomai/init.h>
@@ -51,6 +53,13 @@ static const struct option options[] = {
 		.flag = &action,
 		.val = start_opt,
 	},
+	{
+#define sysstat_opt	3
+		.name = "syscall-stats",
+		.has_arg = optional_argument,
+		.flag = &action,
+		.val = sysstat_opt,
+	},
 	{ /* Sentinel */ }
 };
 
@@ -60,6 +69,7 @@ void application_usage(void)
 	fprintf(stderr, "--stop [<grace-seconds>]	stop Xenomai/cobalt services\n");
 	fprintf(stderr, "--start  			start Xenomai/cobalt services\n");
 	fprintf(stderr, "--status			query Xenomai/cobalt status\n");
+	fprintf(stderr, "--syscall-stats [on|off|reset]	control syscall latency accounting\n");
 }
 
 static int core_stop(__u32 grace_period)
@@ -104,8 +114,35 @@ static int core_status(void)
 	return 0;
 }
 
+static int syscall_stats(const char *arg)
+{
+	__u32 op;
+	int ret;
+
+	if (arg == NULL)
+		op = _CC_COBALT_SYSSTAT_QUERY;
+	else if (strcmp(arg, "on") == 0)
+		op = _CC_COBALT_SYSSTAT_ON;
+	else if (strcmp(arg, "off") == 0)
+		op = _CC_COBALT_SYSSTAT_OFF;
+	else if (strcmp(arg, "reset") == 0)
+		op = _CC_COBALT_SYSSTAT_RESET;
+	else
+		return -EINVAL;
+
+	ret = cobalt_corectl(_CC_COBALT_SYSSTAT, &op, sizeof(op));
+	if (ret)
+		return ret;
+
+	if (arg == NULL)
+		printf("%s\n", op == _CC_COBALT_SYSSTAT_ON ? "on" : "off");
+
+	return 0;
+}
+
 int main(int argc, char *const argv[])
 {
+	const char *sysstat_arg = NULL;
 	__u32 grace_period = 0;
 	int lindex, c, ret;
 	
@@ -123,6 +160,9 @@ int main(int argc, char *const argv[])
 		switch (lindex) {
 		case stop_opt:
 			grace_period = optarg ? atoi(optarg) : 0;
+		case sysstat_opt:
+			sysstat_arg = optarg;
+			break;
 		case start_opt:
 		case status_opt:
 			break;
@@ -141,6 +181,9 @@ int main(int argc, char *const argv[])
 	case status_opt:
 		ret = core_status();
 		break;
+	case sysstat_opt:
+		ret = syscall_stats(sysstat_arg);
+		break;
 	default:
 		xenomai_usage();
 		exit(1);
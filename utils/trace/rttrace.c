@@ -0,0 +1,662 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * This utility streams the Cobalt event trace rings mapped from
+ * /dev/rtdm/memdev-trace to a compact file, and renders per-thread
+ * timelines from such file.
+ */
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <error.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include <signal.h>
+#include <linux/types.h>
+#include <rtdm/uapi/rtdm.h>
+#include <cobalt/uapi/kernel/heap.h>
+#include <cobalt/uapi/kernel/tracering.h>
+
+#define TRACE_DEVICE  "/dev/rtdm/" COBALT_MEMDEV_TRACE
+
+static const struct option base_options[] = {
+	{
+#define help_opt	0
+		.name = "help",
+		.has_arg = no_argument,
+	},
+#define record_opt	1
+	{
+		.name = "record",
+		.has_arg = required_argument,
+	},
+#define show_opt	2
+	{
+		.name = "show",
+		.has_arg = required_argument,
+	},
+#define duration_opt	3
+	{
+		.name = "duration",
+		.has_arg = required_argument,
+	},
+#define period_opt	4
+	{
+		.name = "period",
+		.has_arg = required_argument,
+	},
+#define pid_opt		5
+	{
+		.name = "pid",
+		.has_arg = required_argument,
+	},
+#define width_opt	6
+	{
+		.name = "width",
+		.has_arg = required_argument,
+	},
+	{ /* Sentinel */ }
+};
+
+/*
+ * Trace file layout: a header, followed by fixed-size records which
+ * are either events copied from the rings, thread names or loss
+ * notices. Records are grouped per CPU, in chronological order
+ * within each group.
+ */
+#define RTTRACE_MAGIC	0x52545452	/* "RTTR" */
+#define RTTRACE_NAME	0x100
+#define RTTRACE_LOST	0x101
+
+struct rttrace_header {
+	uint32_t magic;
+	uint32_t nr_cpus;
+	uint64_t clock_freq;
+};
+
+struct rttrace_event {
+	uint16_t type;
+	uint16_t cpu;
+	int32_t pid;
+	uint64_t stamp;
+	uint32_t arg0;		/* Lost count for RTTRACE_LOST. */
+	uint32_t arg1;
+};
+
+struct rttrace_name {
+	uint16_t type;
+	uint16_t __pad;
+	int32_t pid;
+	char name[16];
+};
+
+union rttrace_record {
+	uint16_t type;
+	struct rttrace_event event;
+	struct rttrace_name name;
+};
+
+struct thread {
+	pid_t pid;
+	char name[17];
+	unsigned long runs;
+	unsigned long wakeups;
+	unsigned long relaxes;
+	uint64_t run_ticks;
+	uint64_t max_run;
+	uint64_t max_latency;
+	uint64_t wake_stamp;	/* Zero unless a wakeup is pending. */
+	char *timeline;
+	struct thread *next;
+};
+
+#define THREAD_HASH_SIZE  256
+
+static struct thread *thread_hash[THREAD_HASH_SIZE];
+
+static int nr_threads;
+
+static volatile sig_atomic_t stop_recording;
+
+static struct thread *find_thread(pid_t pid, int create)
+{
+	struct thread **head = thread_hash + (pid & (THREAD_HASH_SIZE - 1)), *t;
+
+	for (t = *head; t; t = t->next)
+		if (t->pid == pid)
+			return t;
+
+	if (!create)
+		return NULL;
+
+	t = calloc(1, sizeof(*t));
+	if (t == NULL)
+		error(1, ENOMEM, "find_thread");
+
+	t->pid = pid;
+	strcpy(t->name, pid ? "?" : "[root]");
+	t->next = *head;
+	*head = t;
+	nr_threads++;
+
+	return t;
+}
+
+static void read_thread_name(pid_t pid, char *name, size_t len)
+{
+	char path[64];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+	fp = fopen(path, "r");
+	if (fp == NULL || fgets(name, len, fp) == NULL)
+		strncpy(name, "?", len);
+	else
+		name[strcspn(name, "\n")] = '\0';
+
+	if (fp)
+		fclose(fp);
+}
+
+static void write_record(FILE *fp, const void *rec)
+{
+	if (fwrite(rec, sizeof(union rttrace_record), 1, fp) != 1)
+		error(1, errno, "write error");
+}
+
+static void log_thread_name(FILE *fp, pid_t pid)
+{
+	struct rttrace_name n;
+
+	/* We only track threads for which the name was logged. */
+	if (pid <= 0 || find_thread(pid, 0))
+		return;
+
+	find_thread(pid, 1);
+	memset(&n, 0, sizeof(n));
+	n.type = RTTRACE_NAME;
+	n.pid = pid;
+	read_thread_name(pid, n.name, sizeof(n.name));
+	write_record(fp, &n);
+}
+
+static unsigned long drain_ring(FILE *fp, const struct cobalt_trace_ring *ring,
+				unsigned int nr_events, uint64_t *tail)
+{
+	const struct cobalt_trace_event *slot;
+	struct cobalt_trace_event ev;
+	struct rttrace_event rec;
+	unsigned long count = 0;
+	uint64_t head, pos, lost = 0;
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	if (head - *tail > nr_events) {
+		lost = head - *tail - nr_events;
+		*tail = head - nr_events;
+	}
+
+	for (pos = *tail; pos < head; pos++) {
+		slot = ring->events + (pos & (nr_events - 1));
+		ev.seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		ev.stamp = slot->stamp;
+		ev.type = slot->type;
+		ev.pid = slot->pid;
+		ev.arg0 = slot->arg0;
+		ev.arg1 = slot->arg1;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		/* Overwritten while we were reading it? */
+		if (ev.seq != pos + 1 ||
+		    __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != ev.seq) {
+			lost++;
+			continue;
+		}
+		log_thread_name(fp, ev.pid);
+		if (ev.type == COBALT_TRACE_SWITCH)
+			log_thread_name(fp, ev.arg0);
+		rec.type = ev.type;
+		rec.cpu = ring->cpu;
+		rec.pid = ev.pid;
+		rec.stamp = ev.stamp;
+		rec.arg0 = ev.arg0;
+		rec.arg1 = ev.arg1;
+		write_record(fp, &rec);
+		count++;
+	}
+
+	*tail = head;
+
+	if (lost) {
+		memset(&rec, 0, sizeof(rec));
+		rec.type = RTTRACE_LOST;
+		rec.cpu = ring->cpu;
+		rec.arg0 = lost;
+		write_record(fp, &rec);
+	}
+
+	return count;
+}
+
+static void sigstop(int sig)
+{
+	stop_recording = 1;
+}
+
+static int record_trace(const char *path, int duration, int period_ms)
+{
+	const struct cobalt_trace_header *hdr;
+	struct cobalt_memdev_stat statbuf;
+	const struct cobalt_trace_ring *ring;
+	struct rttrace_header fhdr;
+	unsigned long count = 0;
+	struct timespec ts, end;
+	uint64_t *tails, head;
+	unsigned int cpu;
+	void *area;
+	FILE *fp;
+	int fd;
+
+	fd = open(TRACE_DEVICE, O_RDONLY);
+	if (fd < 0)
+		error(1, errno, "cannot open %s", TRACE_DEVICE);
+
+	if (ioctl(fd, MEMDEV_RTIOC_STAT, &statbuf))
+		error(1, errno, "cannot get size of %s", TRACE_DEVICE);
+
+	area = mmap(NULL, statbuf.size, PROT_READ, MAP_SHARED, fd, 0);
+	if (area == MAP_FAILED)
+		error(1, errno, "cannot map %s", TRACE_DEVICE);
+
+	close(fd);
+
+	hdr = area;
+	if (hdr->magic != COBALT_TRACE_MAGIC)
+		error(1, 0, "bad trace area magic (%#x)", hdr->magic);
+
+	tails = calloc(hdr->nr_cpus, sizeof(*tails));
+	if (tails == NULL)
+		error(1, ENOMEM, "record_trace");
+
+	/* Start with the backlog still present in the rings. */
+	for (cpu = 0; cpu < hdr->nr_cpus; cpu++) {
+		ring = area + getpagesize() + cpu * hdr->ring_size;
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		tails[cpu] = head > hdr->nr_events ? head - hdr->nr_events : 0;
+	}
+
+	fp = strcmp(path, "-") ? fopen(path, "w") : stdout;
+	if (fp == NULL)
+		error(1, errno, "cannot create %s", path);
+
+	fhdr.magic = RTTRACE_MAGIC;
+	fhdr.nr_cpus = hdr->nr_cpus;
+	fhdr.clock_freq = hdr->clock_freq;
+	if (fwrite(&fhdr, sizeof(fhdr), 1, fp) != 1)
+		error(1, errno, "write error");
+
+	signal(SIGINT, sigstop);
+	signal(SIGTERM, sigstop);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += duration;
+
+	for (;;) {
+		for (cpu = 0; cpu < hdr->nr_cpus; cpu++) {
+			ring = area + getpagesize() + cpu * hdr->ring_size;
+			count += drain_ring(fp, ring, hdr->nr_events,
+					    tails + cpu);
+		}
+		if (stop_recording)
+			break;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		if (duration > 0 && (ts.tv_sec > end.tv_sec ||
+				     (ts.tv_sec == end.tv_sec &&
+				      ts.tv_nsec >= end.tv_nsec)))
+			break;
+		ts.tv_sec = period_ms / 1000;
+		ts.tv_nsec = (period_ms % 1000) * 1000000;
+		nanosleep(&ts, NULL);
+	}
+
+	if (fp != stdout)
+		fclose(fp);
+
+	fprintf(stderr, "%lu events recorded\n", count);
+
+	return 0;
+}
+
+static int compare_events(const void *a, const void *b)
+{
+	const struct rttrace_event *ea = a, *eb = b;
+
+	if (ea->stamp != eb->stamp)
+		return ea->stamp < eb->stamp ? -1 : 1;
+
+	return (int)ea->cpu - (int)eb->cpu;
+}
+
+static const char *event_label(const struct rttrace_event *ev)
+{
+	switch (ev->type) {
+	case COBALT_TRACE_SWITCH:
+		return "switch";
+	case COBALT_TRACE_WAKEUP:
+		return "wakeup";
+	case COBALT_TRACE_RELAX:
+		return "relax";
+	case COBALT_TRACE_HARDEN:
+		return "harden";
+	case COBALT_TRACE_TIMER:
+		return "timer";
+	default:
+		return "?";
+	}
+}
+
+static inline double ticks_to_us(uint64_t ticks, uint64_t freq)
+{
+	return (double)ticks * 1000000.0 / (double)freq;
+}
+
+static void mark_timeline(struct thread *t, uint64_t from, uint64_t to,
+			  uint64_t start, uint64_t span, int width)
+{
+	int col, last;
+
+	if (t->timeline == NULL) {
+		t->timeline = malloc(width + 1);
+		if (t->timeline == NULL)
+			error(1, ENOMEM, "mark_timeline");
+		memset(t->timeline, '.', width);
+		t->timeline[width] = '\0';
+	}
+
+	col = (from - start) * width / span;
+	last = (to - start) * width / span;
+	for (; col <= last && col < width; col++)
+		t->timeline[col] = '#';
+}
+
+static int show_trace(const char *path, pid_t filter_pid, int width)
+{
+	struct thread *t, *prev, **threads, **curr_thread;
+	struct rttrace_event *events = NULL, *ev;
+	unsigned long nr_events = 0, max_events = 0, lost = 0;
+	uint64_t start, span, *curr_start, run;
+	union rttrace_record rec;
+	struct rttrace_header fhdr;
+	unsigned long n;
+	unsigned int cpu;
+	int i;
+	FILE *fp;
+
+	fp = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	if (fp == NULL)
+		error(1, errno, "cannot open %s", path);
+
+	if (fread(&fhdr, sizeof(fhdr), 1, fp) != 1 ||
+	    fhdr.magic != RTTRACE_MAGIC || fhdr.clock_freq == 0)
+		error(1, 0, "%s: not a trace file", path);
+
+	while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+		switch (rec.type) {
+		case RTTRACE_NAME:
+			t = find_thread(rec.name.pid, 1);
+			memcpy(t->name, rec.name.name, sizeof(rec.name.name));
+			break;
+		case RTTRACE_LOST:
+			lost += rec.event.arg0;
+			break;
+		default:
+			if (rec.event.cpu >= fhdr.nr_cpus)
+				error(1, 0, "%s: corrupted trace file", path);
+			if (nr_events == max_events) {
+				max_events = max_events ? max_events * 2 : 4096;
+				events = realloc(events,
+						 max_events * sizeof(*events));
+				if (events == NULL)
+					error(1, ENOMEM, "show_trace");
+			}
+			events[nr_events++] = rec.event;
+		}
+	}
+
+	if (fp != stdin)
+		fclose(fp);
+
+	if (nr_events == 0) {
+		fputs("no event\n", stderr);
+		return 0;	/* This is not an error. */
+	}
+
+	qsort(events, nr_events, sizeof(*events), compare_events);
+	start = events[0].stamp;
+	span = events[nr_events - 1].stamp - start + 1;
+
+	curr_thread = calloc(fhdr.nr_cpus, sizeof(*curr_thread));
+	curr_start = calloc(fhdr.nr_cpus, sizeof(*curr_start));
+	if (curr_thread == NULL || curr_start == NULL)
+		error(1, ENOMEM, "show_trace");
+
+	if (filter_pid >= 0)
+		printf("%-14s %-4s %-7s %s\n", "TIME(us)", "CPU", "EVENT", "INFO");
+
+	for (n = 0, ev = events; n < nr_events; n++, ev++) {
+		cpu = ev->cpu;
+		switch (ev->type) {
+		case COBALT_TRACE_SWITCH:
+			/*
+			 * Account the run of the outgoing thread, which
+			 * started with the previous switch on this CPU.
+			 */
+			prev = curr_thread[cpu];
+			if (prev) {
+				run = ev->stamp - curr_start[cpu];
+				prev->run_ticks += run;
+				if (run > prev->max_run)
+					prev->max_run = run;
+				mark_timeline(prev, curr_start[cpu], ev->stamp,
+					      start, span, width);
+			}
+			t = find_thread(ev->pid, 1);
+			t->runs++;
+			if (t->wake_stamp) {
+				run = ev->stamp - t->wake_stamp;
+				if (run > t->max_latency)
+					t->max_latency = run;
+				t->wake_stamp = 0;
+			}
+			curr_thread[cpu] = t;
+			curr_start[cpu] = ev->stamp;
+			break;
+		case COBALT_TRACE_WAKEUP:
+			t = find_thread(ev->pid, 1);
+			t->wakeups++;
+			if (t->wake_stamp == 0)
+				t->wake_stamp = ev->stamp;
+			break;
+		case COBALT_TRACE_RELAX:
+			find_thread(ev->pid, 1)->relaxes++;
+			break;
+		}
+
+		if (filter_pid < 0)
+			continue;
+
+		if (ev->pid != filter_pid &&
+		    !(ev->type == COBALT_TRACE_SWITCH &&
+		      (pid_t)ev->arg0 == filter_pid))
+			continue;
+
+		printf("%-14.3f %-4u %-7s ",
+		       ticks_to_us(ev->stamp - start, fhdr.clock_freq),
+		       cpu, event_label(ev));
+		switch (ev->type) {
+		case COBALT_TRACE_SWITCH:
+			if (ev->pid == filter_pid)
+				printf("in, prio %u, from pid %d\n",
+				       ev->arg1, (pid_t)ev->arg0);
+			else
+				printf("out, to pid %d\n", ev->pid);
+			break;
+		case COBALT_TRACE_WAKEUP:
+			printf("mask %#x, prio %u\n", ev->arg0, ev->arg1);
+			break;
+		case COBALT_TRACE_RELAX:
+			printf("reason %u\n", ev->arg0);
+			break;
+		default:
+			printf("\n");
+		}
+	}
+
+	/* Close the runs still ongoing at the end of the capture. */
+	for (cpu = 0; cpu < fhdr.nr_cpus; cpu++) {
+		prev = curr_thread[cpu];
+		if (prev == NULL)
+			continue;
+		run = start + span - 1 - curr_start[cpu];
+		prev->run_ticks += run;
+		if (run > prev->max_run)
+			prev->max_run = run;
+		mark_timeline(prev, curr_start[cpu], start + span - 1,
+			      start, span, width);
+	}
+
+	if (filter_pid >= 0)
+		return 0;
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	if (threads == NULL)
+		error(1, ENOMEM, "show_trace");
+
+	for (i = 0, n = 0; i < THREAD_HASH_SIZE; i++)
+		for (t = thread_hash[i]; t; t = t->next)
+			threads[n++] = t;
+
+	printf("%lu events over %.3f us, %u CPUs, %lu lost\n\n",
+	       nr_events, ticks_to_us(span, fhdr.clock_freq),
+	       fhdr.nr_cpus, lost);
+
+	printf("%-7s %-8s %-12s %-12s %-8s %-12s %-6s %s\n",
+	       "PID", "RUNS", "RUN(us)", "MAXRUN(us)", "WAKEUPS",
+	       "MAXLAT(us)", "RELAX", "NAME");
+
+	for (n = 0; n < (unsigned long)nr_threads; n++) {
+		t = threads[n];
+		printf("%-7d %-8lu %-12.3f %-12.3f %-8lu %-12.3f %-6lu %s\n",
+		       t->pid, t->runs,
+		       ticks_to_us(t->run_ticks, fhdr.clock_freq),
+		       ticks_to_us(t->max_run, fhdr.clock_freq),
+		       t->wakeups,
+		       ticks_to_us(t->max_latency, fhdr.clock_freq),
+		       t->relaxes, t->name);
+	}
+
+	printf("\n%-7s |%.*s| %s\n", "PID", width,
+	       "---------------------------------------------------------------"
+	       "---------------------------------------------------------------"
+	       "---------------------------------------------------------------"
+	       "---------------------------------------------------------------",
+	       "NAME");
+
+	for (n = 0; n < (unsigned long)nr_threads; n++) {
+		t = threads[n];
+		if (t->timeline)
+			printf("%-7d |%s| %s\n", t->pid, t->timeline, t->name);
+	}
+
+	return 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: rttrace [options]\n");
+	fprintf(stderr, "   --record <file>			stream the trace rings to file\n");
+	fprintf(stderr, "   --duration <seconds>			stop recording after some time\n");
+	fprintf(stderr, "   --period <ms>			polling period (default 10 ms)\n");
+	fprintf(stderr, "   --show <file>			render per-thread timelines\n");
+	fprintf(stderr, "   --pid <pid>				list the events of a single thread\n");
+	fprintf(stderr, "   --width <columns>			timeline width (default 64)\n");
+	fprintf(stderr, "   --help				print this help\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	const char *record_file = NULL, *show_file = NULL;
+	int duration = 0, period = 10, width = 64;
+	pid_t pid = -1;
+	int c, lindex;
+
+	for (;;) {
+		c = getopt_long_only(argc, argv, "", base_options, &lindex);
+		if (c == EOF)
+			break;
+		if (c == '?') {
+			usage();
+			return EINVAL;
+		}
+		if (c > 0)
+			continue;
+
+		switch (lindex) {
+		case help_opt:
+			usage();
+			exit(0);
+		case record_opt:
+			record_file = optarg;
+			break;
+		case show_opt:
+			show_file = optarg;
+			break;
+		case duration_opt:
+			duration = atoi(optarg);
+			break;
+		case period_opt:
+			period = atoi(optarg);
+			if (period <= 0)
+				error(1, EINVAL, "--period");
+			break;
+		case pid_opt:
+			pid = atoi(optarg);
+			break;
+		case width_opt:
+			width = atoi(optarg);
+			if (width <= 0 || width > 252)
+				error(1, EINVAL, "--width");
+			break;
+		default:
+			return EINVAL;
+		}
+	}
+
+	if (record_file)
+		return record_trace(record_file, duration, period);
+
+	if (show_file)
+		return show_trace(show_file, pid, width);
+
+	usage();
+
+	return EINVAL;
+}